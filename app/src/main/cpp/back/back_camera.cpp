@@ -1,7 +1,15 @@
 // back_camera.cpp
 
 #include "back_camera.h"
+#include "crop_region.h"
+#include "stream_negotiator.h"
 #include "../common/logging.h"
+#include "../common/dual_compositor.h"
+#include "../common/frame_mailbox.h"
+#include "../common/present_scheduler.h"
+#include "../common/time_utils.h"
+#include "../common/vsync_monitor.h"
+#include "../common/window_frame.h"
 
 #include <android/native_window_jni.h>
 #include <android/native_window.h>
@@ -23,7 +31,6 @@
 #include <cstring>
 #include <vector>
 #include <thread>
-#include <condition_variable>
 #include <algorithm>
 #include <cmath>
 #include <dlfcn.h>
@@ -35,6 +42,23 @@
 #ifndef BACK_EDGE_PX
 #define BACK_EDGE_PX 24
 #endif
+// 1: YV12 window in sensor orientation, rotated by the compositor through the buffer
+// transform; NV21 chroma is only split into planes, no colour conversion on the CPU.
+#ifndef BACK_WINDOW_YUV
+#define BACK_WINDOW_YUV 0
+#endif
+// 1: post frames by sensor timestamp on the display's vsync grid (see PresentScheduler).
+#ifndef BACK_PRESENT_PACING
+#define BACK_PRESENT_PACING 1
+#endif
+// Smallest frame the preview needs after rotation: 16:9 at the 800 px panel height. The
+// capture size is negotiated to cover it (see stream_negotiator.h).
+#ifndef BACK_COVER_W
+#define BACK_COVER_W 450
+#endif
+#ifndef BACK_COVER_H
+#define BACK_COVER_H 800
+#endif
 
 static constexpr double UVC_SEAM_SIGMA_X = 2.0;
 static constexpr double UVC_SEAM_SIGMA_Y = 0.8;
@@ -54,6 +78,7 @@ namespace backcam {
     static ANativeWindow *gImgReaderWindow = nullptr;
 
     static ANativeWindow *gJavaWindow = nullptr;
+    static ComposeLayer *gLayer = nullptr;   // panel compositor instead of gJavaWindow
 
     static ACameraOutputTarget *gTarget = nullptr;
     static ACaptureSessionOutputContainer *gOutputs = nullptr;
@@ -67,17 +92,61 @@ namespace backcam {
     static int gSensorOrientationDeg = 0;
     static std::string gLastError;
 
-    static std::mutex gFrameLock;
-    static std::condition_variable gFrameCv;
-    static std::vector<uint8_t> gFrameYuv;
-    static std::atomic<bool> gFrameReady{false};
-    static int gFrameW = 0;
-    static int gFrameH = 0;
+    // Telemetry. Capture results (camera callback thread) time every frame, including
+    // ones the app never sees; the stage latencies cover frames that were posted.
+    static constexpr double kEmaAlpha = 1.0 / 8.0;
+    static bool gTsRealtime = false;                       // sensor timestamps on BOOTTIME
+    static std::atomic<long long> gIntervalNs{0};          // smoothed sensor frame interval
+    static std::atomic<int> gIntervalJitterUs{0};
+    static std::atomic<long long> gLostFrames{0};          // capture failed / buffer lost
+    static std::atomic<long long> gReaderSkipped{0};       // passed over by acquireLatestImage
+    static std::atomic<int> gFrameDurationUs{0};
+    static std::atomic<int> gExposureUs{0};
+    static std::atomic<int> gRollingShutterSkewUs{0};
+    static std::atomic<int> gAcquireLatencyUs{0};          // sensor -> onImageAvailable
+    static std::atomic<int> gConvertLatencyUs{0};          // onImageAvailable -> converted
+    static std::atomic<int> gPostLatencyUs{0};             // converted -> unlockAndPost
+    static long long gPrevResultTsNs = 0;                  // capture callback thread only
+    static double gIntervalEmaNs = 0.0, gJitterEmaNs = 0.0;
+    static long long gPrevImageTsNs = 0;                   // image callback thread only
+    static double gAcquireEmaNs = 0.0;
+
+    static void emaStoreUs(double &ema, double ns, std::atomic<int> &outUs) {
+        ema = ema == 0.0 ? ns : ema + kEmaAlpha * (ns - ema);
+        outUs.store((int) (ema / 1000.0), std::memory_order_relaxed);
+    }
+
+    // onImageAvailable -> decLoop handoff of the AImage itself: the callback only
+    // acquires it, decLoop converts from its planes and deletes it. Held at once: the
+    // one being converted and one pending, which leaves acquireLatestImage the two
+    // free slots it needs out of kMaxImages.
+    struct YuvFrame {
+        AImage *image = nullptr;
+        int w = 0;
+        int h = 0;
+        long long tsNs = 0;
+        long long acquiredNs = 0;   // CLOCK_BOOTTIME
+    };
+    static FrameMailbox<YuvFrame> gMailbox;
+
+    static PresentScheduler gPacer;   // decLoop only
+    static bool gVsyncHeld = false;
+    static bool gYuvOut = false;      // window is YV12 + buffer transform (BACK_WINDOW_YUV)
+    static int gRotationDeg = 90;     // clockwise turn from sensor to display, set by start()
 
     static std::thread gThDec;
 
-    static constexpr int kPreviewW = 1280;
-    static constexpr int kPreviewH = 720;
+    static constexpr int kMaxImages = 4;
+    static int gStreamW = 1280;   // negotiated YUV size, sensor orientation
+    static int gStreamH = 720;
+
+    // Sensor-side crop to what the view shows (setVisibleRegion). gCropLock guards the
+    // region and the plan and nests inside gLock; decLoop only reads the packed band.
+    static std::mutex gCropLock;
+    static NormRect gVisible;            // of the uncropped output frame, from the view
+    static CropCaps gCropCaps;           // set by start()
+    static CropPlan gCrop;
+    static std::atomic<uint64_t> gBandPacked{0xffffffff00000000ull};   // x0 y0 x1 y1, 16 bit
 
     static void setLastErrorLocked(const std::string &msg) { gLastError = msg; }
 
@@ -152,140 +221,304 @@ namespace backcam {
         cv::GaussianBlur(bottomRoi, bottomRoi, cv::Size(0, 0), 2.0, 2.0);
     }
 
-    static void renderRgbaToWindow(const uint8_t *rgba, int w, int h) {
-        if (!gJavaWindow) return;
-        ANativeWindow_Buffer out{};
-        if (ANativeWindow_lock(gJavaWindow, &out, nullptr) != 0) return;
-
-        uint8_t *dst = (uint8_t *) out.bits;
-        int dstStride = out.stride * 4;
-        int srcStride = w * 4;
-
-        int copyH = std::min(h, out.height);
-        int copyWBytes = std::min(w, out.width) * 4;
-
-        for (int y = 0; y < copyH; y++) {
-            std::memcpy(dst + y * dstStride, rgba + y * srcStride, copyWBytes);
-            if (copyWBytes < dstStride) {
-                std::memset(dst + y * dstStride + copyWBytes, 0, (size_t) (dstStride - copyWBytes));
-            }
-        }
-        for (int y = copyH; y < out.height; y++) {
-            std::memset(dst + y * dstStride, 0, (size_t) dstStride);
+    // The band of a w x h sensor image that ends up as the bottom `seam` rows once
+    // rotated clockwise by `rotation`.
+    static cv::Rect displayedBottom(int w, int h, int seam, int rotation) {
+        switch (rotation) {
+            case 90:
+                return {w - std::min(seam, w), 0, std::min(seam, w), h};
+            case 180:
+                return {0, 0, w, std::min(seam, h)};
+            case 270:
+                return {0, 0, std::min(seam, w), h};
+            default:
+                return {0, h - std::min(seam, h), w, std::min(seam, h)};
         }
+    }
 
-        ANativeWindow_unlockAndPost(gJavaWindow);
+    // applyBottomSeamBlur on an unrotated YV12 frame the compositor turns by `rotation`.
+    // Chroma gets half the band and half the sigma.
+    static void applyBottomSeamBlurYuv(const Yuv420Planes &p, int w, int h, int rotation) {
+        const int seam = (int) BACK_SEAM_PX;
+        if (seam <= 0 || w <= 0 || h <= 0) return;
+        cv::Mat y(h, w, CV_8UC1, p.y, p.yStride);
+        cv::Mat yBand = y(displayedBottom(w, h, seam, rotation));
+        cv::GaussianBlur(yBand, yBand, cv::Size(0, 0), 2.0, 2.0);
+
+        const int cw = w / 2, ch = h / 2;
+        if (cw <= 0 || ch <= 0) return;
+        const cv::Rect cRect = displayedBottom(cw, ch, std::max(1, seam / 2), rotation);
+        for (uint8_t *plane: {p.u, p.v}) {
+            cv::Mat c(ch, cw, CV_8UC1, plane, p.uvStride);
+            cv::Mat band = c(cRect);
+            cv::GaussianBlur(band, band, cv::Size(0, 0), 1.0, 1.0);
+        }
     }
 
+    // Keeps the newest image only: acquireLatestImage returns older queued ones itself,
+    // and a frame the decoder never picked up is returned here as soon as publish()
+    // hands its slot back.
     static void onImageAvailable(void *ctx, AImageReader *reader) {
         AImage *image = nullptr;
-        media_status_t status = AImageReader_acquireNextImage(reader, &image);
-        if (status != AMEDIA_OK || !image) return;
+        media_status_t status = AImageReader_acquireLatestImage(reader, &image);
+        if (status != AMEDIA_OK || !image) return;   // e.g. all kMaxImages held
+        if (!gRunning.load(std::memory_order_relaxed)) {
+            AImage_delete(image);
+            return;
+        }
 
+        const long long acquiredNs = nowBoottimeNs();
         int64_t tsNs = 0;
         AImage_getTimestamp(image, &tsNs);
         gLastSensorTsNs.store((long long) tsNs, std::memory_order_relaxed);
+        if (gTsRealtime && tsNs > 0 && acquiredNs > tsNs) {
+            emaStoreUs(gAcquireEmaNs, (double) (acquiredNs - tsNs), gAcquireLatencyUs);
+        }
+        // Frames acquireLatestImage closed unseen show up as gaps between timestamps.
+        const long long intervalNs = gIntervalNs.load(std::memory_order_relaxed);
+        if (gPrevImageTsNs != 0 && intervalNs > 0 && tsNs > gPrevImageTsNs) {
+            const long long missed = (tsNs - gPrevImageTsNs + intervalNs / 2) / intervalNs - 1;
+            if (missed > 0) gReaderSkipped.fetch_add(missed, std::memory_order_relaxed);
+        }
+        gPrevImageTsNs = (long long) tsNs;
 
         int32_t w = 0, h = 0;
         AImage_getWidth(image, &w);
         AImage_getHeight(image, &h);
 
-        int32_t yLen = 0, uLen = 0, vLen = 0;
-        uint8_t *yData = nullptr;
-        uint8_t *uData = nullptr;
-        uint8_t *vData = nullptr;
-        int32_t yStride = 0, uStride = 0, vStride = 0;
-        int32_t uvPixelStride = 0;
+        YuvFrame &slot = gMailbox.writeSlot();
+        if (slot.image) AImage_delete(slot.image);
+        slot.image = image;
+        slot.w = w;
+        slot.h = h;
+        slot.tsNs = (long long) tsNs;
+        slot.acquiredNs = acquiredNs;
+
+        if (gMailbox.publish()) {
+            YuvFrame &stale = gMailbox.writeSlot();
+            if (stale.image) AImage_delete(stale.image);
+            stale.image = nullptr;
+        }
+    }
 
-        AImage_getPlaneData(image, 0, &yData, &yLen);
+    static bool readPlanes(AImage *image, Yuv420Source &p) {
+        uint8_t *y = nullptr, *u = nullptr, *v = nullptr;
+        int32_t yLen = 0, uLen = 0, vLen = 0;
+        int32_t yStride = 0, uStride = 0, vStride = 0, pixelStride = 0;
+        if (AImage_getPlaneData(image, 0, &y, &yLen) != AMEDIA_OK ||
+            AImage_getPlaneData(image, 1, &u, &uLen) != AMEDIA_OK ||
+            AImage_getPlaneData(image, 2, &v, &vLen) != AMEDIA_OK)
+            return false;
         AImage_getPlaneRowStride(image, 0, &yStride);
-
-        AImage_getPlaneData(image, 1, &uData, &uLen);
         AImage_getPlaneRowStride(image, 1, &uStride);
-        AImage_getPlanePixelStride(image, 1, &uvPixelStride);
-
-        AImage_getPlaneData(image, 2, &vData, &vLen);
         AImage_getPlaneRowStride(image, 2, &vStride);
+        AImage_getPlanePixelStride(image, 1, &pixelStride);
+        if (!y || !u || !v || yStride <= 0 || uStride <= 0 || vStride <= 0 || pixelStride <= 0)
+            return false;
+        p.y = y;
+        p.u = u;
+        p.v = v;
+        p.yStride = (size_t) yStride;
+        p.uStride = (size_t) uStride;
+        p.vStride = (size_t) vStride;
+        p.uvPixelStride = pixelStride;
+        return true;
+    }
 
-        {
-            std::lock_guard<std::mutex> lk(gFrameLock);
-            size_t needed = (size_t) (w * h * 3 / 2);
-            if (gFrameYuv.size() < needed) gFrameYuv.resize(needed);
-
-            gFrameW = w;
-            gFrameH = h;
-
-            uint8_t *dst = gFrameYuv.data();
-            for (int r = 0; r < h; ++r) {
-                std::memcpy(dst + r * w, yData + r * yStride, w);
+    // Any YUV_420_888 layout into three planes (the passthrough fallback when the image
+    // is not NV21).
+    static void planesToYuv420(const Yuv420Source &p, int w, int h, const Yuv420Planes &d) {
+        for (int r = 0; r < h; ++r) {
+            std::memcpy(d.y + r * d.yStride, p.y + r * p.yStride, (size_t) w);
+        }
+        const int cw = w / 2, ch = h / 2, ps = p.uvPixelStride;
+        for (int r = 0; r < ch; ++r) {
+            const uint8_t *uRow = p.u + r * p.uStride;
+            const uint8_t *vRow = p.v + r * p.vStride;
+            uint8_t *du = d.u + r * d.uvStride;
+            uint8_t *dv = d.v + r * d.uvStride;
+            if (ps == 1) {
+                std::memcpy(du, uRow, (size_t) cw);
+                std::memcpy(dv, vRow, (size_t) cw);
+                continue;
             }
-
-            uint8_t *uvDst = dst + (w * h);
-            int uvH = h / 2;
-            int uvW = w / 2;
-
-            if (uvPixelStride == 2) {
-                for (int r = 0; r < uvH; ++r) {
-                    const uint8_t *vRow = vData + r * vStride;
-                    const uint8_t *uRow = uData + r * uStride;
-                    uint8_t *dRow = uvDst + r * w;
-                    for (int c = 0; c < uvW; ++c) {
-                        dRow[c * 2 + 0] = vRow[c * uvPixelStride];
-                        dRow[c * 2 + 1] = uRow[c * uvPixelStride];
-                    }
-                }
-            } else {
-                for (int r = 0; r < uvH; ++r) {
-                    for (int c = 0; c < uvW; ++c) {
-                        uvDst[r * w + c * 2 + 0] = vData[r * vStride + c * uvPixelStride];
-                        uvDst[r * w + c * 2 + 1] = uData[r * uStride + c * uvPixelStride];
-                    }
-                }
+            for (int c = 0; c < cw; ++c) {
+                du[c] = uRow[c * ps];
+                dv[c] = vRow[c * ps];
             }
-            gFrameReady.store(true, std::memory_order_relaxed);
         }
+    }
 
-        gFrameCv.notify_one();
-        AImage_delete(image);
+    static uint64_t packBand(const NormRect &b) {
+        const auto q = [](float v) {
+            return (uint64_t) std::lround(std::clamp(v, 0.0f, 1.0f) * 65535.0f);
+        };
+        return q(b.x0) | q(b.y0) << 16 | q(b.x1) << 32 | q(b.y1) << 48;
     }
 
-    static void decLoop() {
-        std::vector<uint8_t> localYuv;
-        cv::Mat rgbaReuse;
-        int lw = 0, lh = 0;
+    // The visible band of a w x h sensor image, widened to even pixels so the chroma
+    // planes start on a sample.
+    static cv::Rect visibleBand(int w, int h) {
+        const uint64_t b = gBandPacked.load(std::memory_order_relaxed);
+        const auto at = [b](int shift, int size, bool up) {
+            const double v = (double) ((b >> shift) & 0xffff) * size / 65535.0;
+            const int px = up ? ((int) std::ceil(v) + 1) & ~1 : (int) std::floor(v) & ~1;
+            return std::clamp(px, 0, size);
+        };
+        const int x0 = at(0, w, false), y0 = at(16, h, false);
+        const int x1 = std::max(at(32, w, true), x0), y1 = std::max(at(48, h, true), y0);
+        return {x0, y0, x1 - x0, y1 - y0};
+    }
 
-        while (gRunning.load(std::memory_order_relaxed)) {
-            {
-                std::unique_lock<std::mutex> lk(gFrameLock);
-                gFrameCv.wait(lk, [] {
-                    return !gRunning.load(std::memory_order_relaxed) ||
-                           gFrameReady.load(std::memory_order_relaxed);
-                });
-                if (!gRunning.load(std::memory_order_relaxed)) break;
-
-                size_t need = (size_t) (gFrameW * gFrameH * 3 / 2);
-                if (localYuv.size() < need) localYuv.resize(need);
-                std::memcpy(localYuv.data(), gFrameYuv.data(), need);
-                lw = gFrameW;
-                lh = gFrameH;
-                gFrameReady.store(false, std::memory_order_relaxed);
-            }
+    static Yuv420Source cropSource(const Yuv420Source &p, const cv::Rect &r) {
+        Yuv420Source c = p;
+        c.y += r.y * p.yStride + r.x;
+        c.u += (r.y / 2) * p.uStride + (r.x / 2) * p.uvPixelStride;
+        c.v += (r.y / 2) * p.vStride + (r.x / 2) * p.uvPixelStride;
+        return c;
+    }
+
+    static Yuv420Planes cropPlanes(const Yuv420Planes &p, const cv::Rect &r) {
+        Yuv420Planes c = p;
+        c.y += r.y * p.yStride + r.x;
+        c.u += (r.y / 2) * p.uvStride + r.x / 2;
+        c.v += (r.y / 2) * p.uvStride + r.x / 2;
+        return c;
+    }
 
-            if (lw <= 0 || lh <= 0) continue;
+    // Where rectangle r of a w x h sensor image lands once rotated clockwise by `rotation`.
+    static cv::Rect rotatedRect(const cv::Rect &r, int w, int h, int rotation) {
+        switch (rotation) {
+            case 90:
+                return {h - r.y - r.height, r.x, r.height, r.width};
+            case 180:
+                return {w - r.x - r.width, h - r.y - r.height, r.width, r.height};
+            case 270:
+                return {r.y, w - r.x - r.width, r.height, r.width};
+            default:
+                return r;
+        }
+    }
 
-            cv::Mat yuv(lh + lh / 2, lw, CV_8UC1, localYuv.data());
+    // `layer`: gLayer as start() found it, fixed for the run.
+    static void decLoop(ComposeLayer *layer) {
+        cv::Mat rotReuse;    // rotated frame, only when the window buffer cannot take it
+        double convertEmaNs = 0.0, postEmaNs = 0.0;
+        const auto stageDone = [&](long long acquiredNs, long long convertedNs) {
+            const long long postedNs = nowBoottimeNs();
+            if (acquiredNs > 0) {
+                emaStoreUs(convertEmaNs, (double) (convertedNs - acquiredNs), gConvertLatencyUs);
+            }
+            emaStoreUs(postEmaNs, (double) (postedNs - convertedNs), gPostLatencyUs);
+        };
 
-            if (rgbaReuse.empty()) {
-                rgbaReuse = cv::Mat(lh, lw, CV_8UC4);
+        while (gRunning.load(std::memory_order_relaxed)) {
+            YuvFrame *fr = gMailbox.waitAcquire(100000000LL);
+            if (!fr) continue;
+
+            // The image goes back to the reader as soon as its planes are consumed.
+            AImage *image = fr->image;
+            fr->image = nullptr;
+            if (!image) continue;
+            const auto done = [&image] {
+                if (image) AImage_delete(image);
+                image = nullptr;
+            };
+
+            const int lw = fr->w;
+            const int lh = fr->h;
+            const long long acquiredNs = fr->acquiredNs;
+            Yuv420Source planesIn;
+            if (lw <= 0 || lh <= 0 || !readPlanes(image, planesIn)) {
+                done();
+                continue;
             }
 
-            cv::cvtColor(yuv, rgbaReuse, cv::COLOR_YUV2RGBA_NV21);
+            const cv::Rect band = visibleBand(lw, lh);
+            if (band.empty()) {
+                done();
+                continue;
+            }
 
-            cv::rotate(rgbaReuse, rgbaReuse, cv::ROTATE_90_CLOCKWISE);
+            // A locked window buffer is posted whatever happens, so check that the frame
+            // will convert into it before reserving a slot or locking.
+            const Yuv420Source src = cropSource(planesIn, band);
+            if (!yuv420Valid(src, band.width, band.height) ||
+                !WindowFrame::accepts(gJavaWindow, layer, lw, lh, gYuvOut)) {
+                done();
+                continue;
+            }
 
-            applyBottomSeamBlur(rgbaReuse);
+            const bool paced = BACK_PRESENT_PACING && fr->tsNs > 0 && !layer;
+            if (paced) {
+                gPacer.setDisplayTiming(displayPeriodNs(), lastVsyncNs());
+                if (!gPacer.reserveSlot(fr->tsNs)) {
+                    done();
+                    continue;
+                }
+            }
+            // Gives up a frame after its slot was reserved; `wf` goes out black, if locked.
+            const auto drop = [&](WindowFrame &wf) {
+                done();
+                wf.discard();
+                if (paced) gPacer.cancelReservedSlot();
+            };
+
+            if (gYuvOut) {
+                // Passthrough: split chroma into the YV12 buffer, the compositor converts
+                // and rotates.
+                WindowFrame wf(gJavaWindow, layer);
+                // Only the visible band is copied; the rest of the buffer is off screen.
+                Yuv420Planes planes;
+                if (!wf.locked() || !wf.yuvPlanes(lw, lh, planes)) {
+                    drop(wf);
+                    continue;
+                }
+                planes = cropPlanes(planes, band);
+                if (yuv420Layout(src) != Yuv420Layout::NV21 ||
+                    !nv21ToYuv420(src.y, src.yStride, src.v, src.vStride, band.width,
+                                  band.height, planes)) {
+                    planesToYuv420(src, band.width, band.height, planes);
+                }
+                done();
+                const long long convertedNs = nowBoottimeNs();
+                applyBottomSeamBlurYuv(planes, band.width, band.height, gRotationDeg);
+                if (paced) gPacer.waitForReservedSlot();
+                wf.post();
+                if (paced) gPacer.presented();
+                stageDone(acquiredNs, convertedNs);
+                continue;
+            }
 
-            renderRgbaToWindow(rgbaReuse.data, rgbaReuse.cols, rgbaReuse.rows);
+            // Converted and rotated in one tiled pass from the image planes straight into
+            // the window buffer; the image is held until the buffer is locked. Only the
+            // visible band is converted, the rest of the buffer is off screen.
+            WindowFrame wf(gJavaWindow, layer);
+            if (!wf.locked()) {
+                drop(wf);
+                continue;
+            }
+            const bool turned = gRotationDeg == 90 || gRotationDeg == 270;
+            cv::Mat &dst = wf.target(turned ? lh : lw, turned ? lw : lh, rotReuse);
+            const cv::Rect shownRect = rotatedRect(band, lw, lh, gRotationDeg);
+            cv::Mat shown = dst(shownRect);
+            if (!yuv420ToRgbaRotated(src, band.width, band.height, gRotationDeg, shown.data,
+                                     shown.step)) {
+                drop(wf);
+                continue;
+            }
+            // The compositor scales the layer frame itself; it must not see the rest.
+            wf.setValid(shownRect);
+            done();
+            const long long convertedNs = nowBoottimeNs();
+
+            applyBottomSeamBlur(shown);
+
+            wf.flush();
+            if (paced) gPacer.waitForReservedSlot();
+            wf.post();
+            if (paced) gPacer.presented();
+            stageDone(acquiredNs, convertedNs);
         }
     }
 
@@ -321,6 +554,14 @@ namespace backcam {
             AImageReader_delete(gImgReader);
             gImgReader = nullptr;
         }
+        // The reader has taken the buffers back; the AImage objects still need deleting.
+        gMailbox.reset([](YuvFrame &f) {
+            if (f.image) AImage_delete(f.image);
+            f.image = nullptr;
+            f.w = f.h = 0;
+            f.tsNs = 0;
+            f.acquiredNs = 0;
+        });
         if (gJavaWindow) {
             ANativeWindow_release(gJavaWindow);
             gJavaWindow = nullptr;
@@ -335,9 +576,53 @@ namespace backcam {
         gLastSensorTsNs.store(0, std::memory_order_relaxed);
         gFpsX100.store(0, std::memory_order_relaxed);
         gChosenFps.store(0, std::memory_order_relaxed);
+        gTsRealtime = false;
+        gIntervalNs.store(0, std::memory_order_relaxed);
+        gIntervalJitterUs.store(0, std::memory_order_relaxed);
+        gLostFrames.store(0, std::memory_order_relaxed);
+        gReaderSkipped.store(0, std::memory_order_relaxed);
+        gFrameDurationUs.store(0, std::memory_order_relaxed);
+        gExposureUs.store(0, std::memory_order_relaxed);
+        gRollingShutterSkewUs.store(0, std::memory_order_relaxed);
+        gAcquireLatencyUs.store(0, std::memory_order_relaxed);
+        gConvertLatencyUs.store(0, std::memory_order_relaxed);
+        gPostLatencyUs.store(0, std::memory_order_relaxed);
+        gPrevResultTsNs = 0;
+        gIntervalEmaNs = gJitterEmaNs = 0.0;
+        gPrevImageTsNs = 0;
+        gAcquireEmaNs = 0.0;
+        {
+            std::lock_guard<std::mutex> ck(gCropLock);   // gVisible outlives the session
+            gCropCaps = {};
+            gCrop = {};
+            gBandPacked.store(packBand(NormRect{}), std::memory_order_relaxed);
+        }
+        gYuvOut = false;
+        gPacer.reset();
+        if (gVsyncHeld) {
+            vsyncMonitorRelease();
+            gVsyncHeld = false;
+        }
         gLastError.clear();
     }
 
+    // REALTIME: sensor timestamps are CLOCK_BOOTTIME, so they can be compared with
+    // nowBoottimeNs(); UNKNOWN ones only with each other.
+    static bool readTimestampRealtime(const char *cameraId) {
+        if (!gMgr || !cameraId) return false;
+        ACameraMetadata *chars = nullptr;
+        if (ACameraManager_getCameraCharacteristics(gMgr, cameraId, &chars) != ACAMERA_OK ||
+            !chars)
+            return false;
+        ACameraMetadata_const_entry e{};
+        const bool realtime =
+                ACameraMetadata_getConstEntry(chars, ACAMERA_SENSOR_INFO_TIMESTAMP_SOURCE, &e) ==
+                ACAMERA_OK && e.count > 0 &&
+                e.data.u8[0] == ACAMERA_SENSOR_INFO_TIMESTAMP_SOURCE_REALTIME;
+        ACameraMetadata_free(chars);
+        return realtime;
+    }
+
     static int readSensorOrientationDeg(const char *cameraId) {
         if (!gMgr || !cameraId) return 0;
         ACameraMetadata *chars = nullptr;
@@ -354,6 +639,26 @@ namespace backcam {
         return deg;
     }
 
+    // The CPU turn is the sensor orientation itself, snapped to a quarter turn: 90 on
+    // nearly every back camera (what the portrait preview was laid out for); sensors
+    // mounted otherwise get 0 / 180 / 270.
+    static int displayRotationDeg(int sensorDeg) {
+        return ((((sensorDeg % 360) + 360) % 360 + 45) / 90 * 90) % 360;
+    }
+
+    static int32_t bufferTransformFor(int rotationDeg) {
+        switch (rotationDeg) {
+            case 90:
+                return ANATIVEWINDOW_TRANSFORM_ROTATE_90;
+            case 180:
+                return ANATIVEWINDOW_TRANSFORM_ROTATE_180;
+            case 270:
+                return ANATIVEWINDOW_TRANSFORM_ROTATE_270;
+            default:
+                return ANATIVEWINDOW_TRANSFORM_IDENTITY;
+        }
+    }
+
     static bool isBackFacing(const char *cameraId) {
         if (!gMgr) return false;
         ACameraMetadata *chars = nullptr;
@@ -431,6 +736,156 @@ namespace backcam {
             nullptr, onSessionClosed, onSessionReady, onSessionActive
     };
 
+    static bool resultI64(const ACameraMetadata *result, uint32_t tag, int64_t &out) {
+        ACameraMetadata_const_entry e{};
+        if (ACameraMetadata_getConstEntry(result, tag, &e) != ACAMERA_OK || e.count == 0)
+            return false;
+        out = e.data.i64[0];
+        return true;
+    }
+
+    // Every completed frame, whether or not its image reaches decLoop.
+    static void onCaptureCompleted(void *, ACameraCaptureSession *, ACaptureRequest *,
+                                   const ACameraMetadata *result) {
+        if (!result) return;
+        int64_t v = 0;
+        if (resultI64(result, ACAMERA_SENSOR_FRAME_DURATION, v))
+            gFrameDurationUs.store((int) (v / 1000), std::memory_order_relaxed);
+        if (resultI64(result, ACAMERA_SENSOR_EXPOSURE_TIME, v))
+            gExposureUs.store((int) (v / 1000), std::memory_order_relaxed);
+        if (resultI64(result, ACAMERA_SENSOR_ROLLING_SHUTTER_SKEW, v))
+            gRollingShutterSkewUs.store((int) (v / 1000), std::memory_order_relaxed);
+
+        int64_t ts = 0;
+        if (!resultI64(result, ACAMERA_SENSOR_TIMESTAMP, ts)) return;
+        if (gPrevResultTsNs != 0 && ts > gPrevResultTsNs) {
+            const double dt = (double) (ts - gPrevResultTsNs);
+            if (gIntervalEmaNs != 0.0) {
+                gJitterEmaNs += kEmaAlpha * (std::fabs(dt - gIntervalEmaNs) - gJitterEmaNs);
+                gIntervalJitterUs.store((int) (gJitterEmaNs / 1000.0), std::memory_order_relaxed);
+            }
+            gIntervalEmaNs = gIntervalEmaNs == 0.0 ? dt : gIntervalEmaNs +
+                                                          kEmaAlpha * (dt - gIntervalEmaNs);
+            gIntervalNs.store((long long) gIntervalEmaNs, std::memory_order_relaxed);
+            const double fps = 1e9 / gIntervalEmaNs;
+            if (fps > 0.0 && fps < 10000.0)
+                gFpsX100.store((int) (fps * 100.0), std::memory_order_relaxed);
+        }
+        gPrevResultTsNs = ts;
+    }
+
+    static void onCaptureFailed(void *, ACameraCaptureSession *, ACaptureRequest *,
+                                ACameraCaptureFailure *) {
+        gLostFrames.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    static void onCaptureBufferLost(void *, ACameraCaptureSession *, ACaptureRequest *,
+                                    ANativeWindow *, int64_t) {
+        gLostFrames.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    static ACameraCaptureSession_captureCallbacks gCaptureCbs = {
+            nullptr, nullptr, nullptr, onCaptureCompleted, onCaptureFailed, nullptr, nullptr,
+            onCaptureBufferLost
+    };
+
+    // YUV_420_888 output sizes with their minimum frame durations, and the AE target
+    // ranges, for negotiateStream().
+    static StreamCaps readStreamCaps(const char *cameraId) {
+        StreamCaps caps;
+        if (!gMgr || !cameraId) return caps;
+        ACameraMetadata *chars = nullptr;
+        if (ACameraManager_getCameraCharacteristics(gMgr, cameraId, &chars) != ACAMERA_OK ||
+            !chars)
+            return caps;
+
+        ACameraMetadata_const_entry e{};
+        // (format, width, height, input) quadruples.
+        if (ACameraMetadata_getConstEntry(chars, ACAMERA_SCALER_AVAILABLE_STREAM_CONFIGURATIONS,
+                                          &e) == ACAMERA_OK) {
+            for (uint32_t i = 0; i + 3 < e.count; i += 4) {
+                if (e.data.i32[i] != AIMAGE_FORMAT_YUV_420_888 || e.data.i32[i + 3] != 0)
+                    continue;
+                caps.yuvSizes.push_back({e.data.i32[i + 1], e.data.i32[i + 2], 0});
+            }
+        }
+        // (format, width, height, duration ns) quadruples.
+        if (ACameraMetadata_getConstEntry(chars, ACAMERA_SCALER_AVAILABLE_MIN_FRAME_DURATIONS,
+                                          &e) == ACAMERA_OK) {
+            for (uint32_t i = 0; i + 3 < e.count; i += 4) {
+                if (e.data.i64[i] != AIMAGE_FORMAT_YUV_420_888) continue;
+                for (StreamSize &s: caps.yuvSizes) {
+                    if (s.w == (int) e.data.i64[i + 1] && s.h == (int) e.data.i64[i + 2])
+                        s.minFrameDurationNs = (long long) e.data.i64[i + 3];
+                }
+            }
+        }
+        if (ACameraMetadata_getConstEntry(chars, ACAMERA_CONTROL_AE_AVAILABLE_TARGET_FPS_RANGES,
+                                          &e) == ACAMERA_OK) {
+            for (uint32_t i = 0; i + 1 < e.count; i += 2) {
+                caps.fpsRanges.push_back({e.data.i32[i], e.data.i32[i + 1]});
+            }
+        }
+        ACameraMetadata_free(chars);
+        return caps;
+    }
+
+    // Active array and zoom limits for planCrop(). CONTROL_ZOOM_RATIO (API 30) is used
+    // when the camera lists a ratio range, SCALER_CROP_REGION otherwise.
+    static CropCaps readCropCaps(const char *cameraId) {
+        CropCaps caps;
+        if (!gMgr || !cameraId) return caps;
+        ACameraMetadata *chars = nullptr;
+        if (ACameraManager_getCameraCharacteristics(gMgr, cameraId, &chars) != ACAMERA_OK ||
+            !chars)
+            return caps;
+
+        ACameraMetadata_const_entry e{};
+        // (left, top, width, height)
+        if (ACameraMetadata_getConstEntry(chars, ACAMERA_SENSOR_INFO_ACTIVE_ARRAY_SIZE, &e) ==
+            ACAMERA_OK && e.count >= 4) {
+            caps.activeW = e.data.i32[2];
+            caps.activeH = e.data.i32[3];
+        }
+        if (ACameraMetadata_getConstEntry(chars, ACAMERA_CONTROL_ZOOM_RATIO_RANGE, &e) ==
+            ACAMERA_OK && e.count >= 2 && e.data.f[1] > 1.0f) {
+            caps.zoomRatio = true;
+            caps.maxZoom = e.data.f[1];
+        } else if (ACameraMetadata_getConstEntry(chars, ACAMERA_SCALER_AVAILABLE_MAX_DIGITAL_ZOOM,
+                                                 &e) == ACAMERA_OK && e.count >= 1) {
+            caps.maxZoom = e.data.f[0];
+        }
+        if (ACameraMetadata_getConstEntry(chars, ACAMERA_SCALER_CROPPING_TYPE, &e) ==
+            ACAMERA_OK && e.count >= 1) {
+            caps.freeform = e.data.u8[0] == ACAMERA_SCALER_CROPPING_TYPE_FREEFORM;
+        }
+        ACameraMetadata_free(chars);
+        return caps;
+    }
+
+    // Re-plans the crop for gVisible; true when it changed. gLock held (stream, rotation).
+    static bool planCropLocked() {
+        std::lock_guard<std::mutex> ck(gCropLock);
+        const CropPlan p = planCrop(gCropCaps, gStreamW, gStreamH,
+                                    toSensor(gVisible, gRotationDeg));
+        const bool changed = p.zoomRatio != gCrop.zoomRatio || p.cropX != gCrop.cropX ||
+                             p.cropY != gCrop.cropY || p.cropW != gCrop.cropW ||
+                             p.cropH != gCrop.cropH;
+        gCrop = p;
+        gBandPacked.store(packBand(p.band), std::memory_order_relaxed);
+        return changed;
+    }
+
+    static void applyCropLocked(ACaptureRequest *req) {
+        std::lock_guard<std::mutex> ck(gCropLock);
+        if (gCropCaps.zoomRatio) {
+            ACaptureRequest_setEntry_float(req, ACAMERA_CONTROL_ZOOM_RATIO, 1, &gCrop.zoomRatio);
+        } else if (gCrop.cropW > 0 && gCrop.cropH > 0) {
+            const int32_t region[4] = {gCrop.cropX, gCrop.cropY, gCrop.cropW, gCrop.cropH};
+            ACaptureRequest_setEntry_i32(req, ACAMERA_SCALER_CROP_REGION, 4, region);
+        }
+    }
+
     static void trySetFrameRate(ANativeWindow *win, float fps) {
         if (!win) return;
         void *h = dlopen("libandroid.so", RTLD_NOW);
@@ -444,21 +899,28 @@ namespace backcam {
     bool start(JNIEnv *env, jobject surface, int desiredFps) {
         std::lock_guard<std::mutex> lk(gLock);
         clearLastErrorLocked();
+        if (gThDec.joinable()) {
+            // A start() without a stop() in between leaves decLoop running; end it before
+            // the mailbox is reset below.
+            gRunning.store(false);
+            gMailbox.wake();
+            gThDec.join();
+        }
         closeAllLocked();
 
-        gRunning.store(true);
-        gThDec = std::thread(decLoop);
-
-        gJavaWindow = ANativeWindow_fromSurface(env, surface);
-        if (!gJavaWindow) {
-            setLastErrorLocked("ANativeWindow_fromSurface failed");
-            return false;
+        if (BACK_PRESENT_PACING && !gLayer) {
+            vsyncMonitorAcquire();
+            gVsyncHeld = true;
         }
 
-        ANativeWindow_setBuffersGeometry(gJavaWindow, kPreviewH, kPreviewW,
-                                         AHARDWAREBUFFER_FORMAT_R8G8B8A8_UNORM);
-
-        trySetFrameRate(gJavaWindow, (float) desiredFps);
+        // Composited: frames go to the layer, paced by the compositor; no window.
+        if (!gLayer) {
+            gJavaWindow = ANativeWindow_fromSurface(env, surface);
+            if (!gJavaWindow) {
+                setLastErrorLocked("ANativeWindow_fromSurface failed");
+                return false;
+            }
+        }
 
         gMgr = ACameraManager_create();
         if (!gMgr) {
@@ -473,9 +935,39 @@ namespace backcam {
         }
         gChosenCamId = camId;
         gSensorOrientationDeg = readSensorOrientationDeg(camId.c_str());
+        gRotationDeg = displayRotationDeg(gSensorOrientationDeg);
+        gTsRealtime = readTimestampRealtime(camId.c_str());
+
+        // The view's cover area turned back into sensor orientation.
+        StreamRequest want;
+        const bool turned = gRotationDeg == 90 || gRotationDeg == 270;
+        want.coverW = turned ? BACK_COVER_H : BACK_COVER_W;
+        want.coverH = turned ? BACK_COVER_W : BACK_COVER_H;
+        want.desiredFps = desiredFps;
+        const StreamChoice stream = negotiateStream(readStreamCaps(camId.c_str()), want);
+        gStreamW = stream.w;
+        gStreamH = stream.h;
+        ALOGI("BackCam stream %dx%d fps=[%d,%d] -> %d (wanted %dx%d@%d): %s", stream.w,
+              stream.h, stream.fpsRange.min, stream.fpsRange.max, stream.fps, want.coverW,
+              want.coverH, desiredFps, stream.why.c_str());
+        trySetFrameRate(gJavaWindow, (float) stream.fps);
+
+        // YUV passthrough keeps the sensor orientation and lets the buffer transform do
+        // the turn the RGBA path does on the CPU.
+        gYuvOut = BACK_WINDOW_YUV && gJavaWindow &&
+                  ANativeWindow_setBuffersGeometry(gJavaWindow, gStreamW, gStreamH,
+                                                   AHARDWAREBUFFER_FORMAT_YV12) == 0 &&
+                  ANativeWindow_setBuffersTransform(gJavaWindow,
+                                                    bufferTransformFor(gRotationDeg)) == 0;
+        if (!gYuvOut && gJavaWindow) {
+            (void) ANativeWindow_setBuffersTransform(gJavaWindow, ANATIVEWINDOW_TRANSFORM_IDENTITY);
+            ANativeWindow_setBuffersGeometry(gJavaWindow, turned ? gStreamH : gStreamW,
+                                             turned ? gStreamW : gStreamH,
+                                             AHARDWAREBUFFER_FORMAT_R8G8B8A8_UNORM);
+        }
 
-        media_status_t ms = AImageReader_new(kPreviewW, kPreviewH, AIMAGE_FORMAT_YUV_420_888, 4,
-                                             &gImgReader);
+        media_status_t ms = AImageReader_new(gStreamW, gStreamH, AIMAGE_FORMAT_YUV_420_888,
+                                             kMaxImages, &gImgReader);
         if (ms != AMEDIA_OK || !gImgReader) {
             setLastErrorLocked("AImageReader_new failed");
             return false;
@@ -507,9 +999,10 @@ namespace backcam {
         ACameraDevice_createCaptureRequest(gDevice, TEMPLATE_PREVIEW, &gPreviewRequest);
         ACaptureRequest_addTarget(gPreviewRequest, gTarget);
 
-        int32_t fpsRange[2] = {30, 30};
+        int32_t fpsRange[2] = {stream.fpsRange.min, stream.fpsRange.max};
         ACaptureRequest_setEntry_i32(gPreviewRequest, ACAMERA_CONTROL_AE_TARGET_FPS_RANGE, 2,
                                      fpsRange);
+        gChosenFps.store(stream.fps, std::memory_order_relaxed);
 
         uint8_t af = ACAMERA_CONTROL_AF_MODE_CONTINUOUS_VIDEO;
         ACaptureRequest_setEntry_u8(gPreviewRequest, ACAMERA_CONTROL_AF_MODE, 1, &af);
@@ -521,25 +1014,62 @@ namespace backcam {
         ACaptureRequest_setEntry_u8(gPreviewRequest, ACAMERA_LENS_OPTICAL_STABILIZATION_MODE, 1,
                                     &os);
 
+        gCropCaps = readCropCaps(camId.c_str());
+        planCropLocked();
+        applyCropLocked(gPreviewRequest);
+
         cs = ACameraDevice_createCaptureSession(gDevice, gOutputs, &gSessionCbs, &gSession);
         if (cs != ACAMERA_OK) {
             setLastErrorLocked("createCaptureSession failed");
             return false;
         }
 
-        ACameraCaptureSession_setRepeatingRequest(gSession, nullptr, 1, &gPreviewRequest, nullptr);
+        // decLoop reads the window, rotation, output format and stream size set above, so
+        // it starts only once they are final, just before the first frame can arrive.
+        gRunning.store(true);
+        gThDec = std::thread(decLoop, gLayer);
+
+        ACameraCaptureSession_setRepeatingRequest(gSession, &gCaptureCbs, 1, &gPreviewRequest,
+                                                  nullptr);
 
         ALOGI("BackCam started via ImageReader+OpenCV pipeline.");
         return true;
     }
 
+    void setVisibleRegion(float left, float top, float right, float bottom, float shown[4]) {
+        {
+            std::lock_guard<std::mutex> ck(gCropLock);
+            gVisible = {left, top, right, bottom};
+        }
+        // start() holds gLock while the camera opens: the region waits for it rather
+        // than blocking the UI thread, and start() applies it.
+        std::unique_lock<std::mutex> lk(gLock, std::try_to_lock);
+        if (lk.owns_lock() && gSession && gPreviewRequest && planCropLocked()) {
+            applyCropLocked(gPreviewRequest);
+            ACameraCaptureSession_setRepeatingRequest(gSession, &gCaptureCbs, 1,
+                                                      &gPreviewRequest, nullptr);
+        }
+        std::lock_guard<std::mutex> ck(gCropLock);
+        const NormRect out = lk.owns_lock() && gSession ? toOutput(gCrop.shown, gRotationDeg)
+                                                        : NormRect{};
+        shown[0] = out.x0;
+        shown[1] = out.y0;
+        shown[2] = out.x1;
+        shown[3] = out.y1;
+    }
+
+    void setComposeLayer(ComposeLayer *layer) {
+        std::lock_guard<std::mutex> lk(gLock);
+        gLayer = layer;
+    }
+
     void stop() {
         std::lock_guard<std::mutex> lk(gLock);
-        if (gRunning.load()) {
-            gRunning.store(false);
-            gFrameCv.notify_all();
-            if (gThDec.joinable()) gThDec.join();
-        }
+        // gRunning may already be false (device disconnected or in error) with decLoop
+        // still on its way out; it must be gone before closeAllLocked() frees what it uses.
+        gRunning.store(false);
+        gMailbox.wake();
+        if (gThDec.joinable()) gThDec.join();
         closeAllLocked();
     }
 
@@ -553,6 +1083,32 @@ namespace backcam {
 
     int chosenFps() { return gChosenFps.load(std::memory_order_relaxed); }
 
+    int presentJitterUs() { return gPacer.stats().jitterUs; }
+
+    long long presentLateDrops() { return gPacer.stats().lateDrops; }
+
+    int presentLatencyUs() { return gPacer.stats().latencyUs; }
+
+    int frameIntervalJitterUs() { return gIntervalJitterUs.load(std::memory_order_relaxed); }
+
+    long long overwrittenFrames() {
+        return gMailbox.dropped() + gReaderSkipped.load(std::memory_order_relaxed);
+    }
+
+    long long lostFrames() { return gLostFrames.load(std::memory_order_relaxed); }
+
+    int acquireLatencyUs() { return gAcquireLatencyUs.load(std::memory_order_relaxed); }
+
+    int convertLatencyUs() { return gConvertLatencyUs.load(std::memory_order_relaxed); }
+
+    int postLatencyUs() { return gPostLatencyUs.load(std::memory_order_relaxed); }
+
+    int frameDurationUs() { return gFrameDurationUs.load(std::memory_order_relaxed); }
+
+    int exposureUs() { return gExposureUs.load(std::memory_order_relaxed); }
+
+    int rollingShutterSkewUs() { return gRollingShutterSkewUs.load(std::memory_order_relaxed); }
+
     std::string lastError() {
         std::lock_guard<std::mutex> lk(gLock);
         return gLastError;
@@ -3,7 +3,13 @@
 #include <jni.h>
 #include <string>
 
+class ComposeLayer;
+
 namespace backcam {
+    // With a layer set, start() renders into it for the panel compositor and `surface`
+    // may be null. Takes effect at the next start().
+    void setComposeLayer(ComposeLayer *layer);
+
     bool start(JNIEnv *env, jobject surface, int desiredFps);
 
     void stop();
@@ -16,6 +22,48 @@ namespace backcam {
 
     std::string lastError();
 
+    // Present pacing (see uvc::UvcCamera::presentJitterUs and friends).
+    int presentJitterUs();
+
+    long long presentLateDrops();
+
+    int presentLatencyUs();
+
+    // Sensor frame-interval jitter: smoothed |interval - mean interval| over capture
+    // results (estimatedFpsX100() is the mean).
+    int frameIntervalJitterUs();
+
+    // Frames that reached the app but were never converted: replaced in the handoff
+    // before decLoop took them, or closed unseen by acquireLatestImage (from timestamp
+    // gaps).
+    long long overwrittenFrames();
+
+    // Captures the camera reported failed or whose buffer it lost.
+    long long lostFrames();
+
+    // Smoothed per-stage latency of posted frames: sensor timestamp -> onImageAvailable
+    // (0 when the sensor clock is not CLOCK_BOOTTIME), -> converted into the window
+    // buffer, -> unlockAndPost.
+    int acquireLatencyUs();
+
+    int convertLatencyUs();
+
+    int postLatencyUs();
+
+    // From the last capture result: SENSOR_FRAME_DURATION, SENSOR_EXPOSURE_TIME and
+    // SENSOR_ROLLING_SHUTTER_SKEW.
+    int frameDurationUs();
+
+    int exposureUs();
+
+    int rollingShutterSkewUs();
+
+    // The part of the uncropped preview frame the view shows, in [0, 1] of the window
+    // buffer. The ISP is zoomed in on it (SCALER_CROP_REGION / CONTROL_ZOOM_RATIO) and
+    // only it is converted; `shown` gets the part of the uncropped frame the buffer now
+    // holds (all of it while the camera is not running).
+    void setVisibleRegion(float left, float top, float right, float bottom, float shown[4]);
+
     int sensorOrientationDeg();
     std::string chosenCameraId();
 }
@@ -0,0 +1,86 @@
+// crop_region.cpp
+
+#include "crop_region.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace backcam {
+
+    static constexpr float kMinCropGain = 0.98f;
+
+    NormRect toSensor(const NormRect &o, int rotation) {
+        switch (((rotation % 360) + 360) % 360) {
+            case 90:   // output (x, y) = (1 - sy, sx)
+                return {o.y0, 1.0f - o.x1, o.y1, 1.0f - o.x0};
+            case 180:
+                return {1.0f - o.x1, 1.0f - o.y1, 1.0f - o.x0, 1.0f - o.y0};
+            case 270:  // output (x, y) = (sy, 1 - sx)
+                return {1.0f - o.y1, o.x0, 1.0f - o.y0, o.x1};
+            default:
+                return o;
+        }
+    }
+
+    NormRect toOutput(const NormRect &s, int rotation) {
+        return toSensor(s, 360 - (((rotation % 360) + 360) % 360));
+    }
+
+    static NormRect clamp01(NormRect r) {
+        r.x0 = std::clamp(r.x0, 0.0f, 1.0f);
+        r.y0 = std::clamp(r.y0, 0.0f, 1.0f);
+        r.x1 = std::clamp(r.x1, r.x0, 1.0f);
+        r.y1 = std::clamp(r.y1, r.y0, 1.0f);
+        return r;
+    }
+
+    CropPlan planCrop(const CropCaps &caps, int streamW, int streamH, const NormRect &visibleIn) {
+        CropPlan p;
+        const NormRect v = clamp01(visibleIn);
+        if (v.w() <= 0.0f || v.h() <= 0.0f) return p;
+
+        // Normalised coordinates of a stream-aspect field of view: a square in them is
+        // a stream-aspect rectangle, so the crop is s x s for one scale s.
+        const bool centred = caps.zoomRatio || !caps.freeform;
+        float s;
+        if (centred) {
+            s = 2.0f * std::max({0.5f - v.x0, v.x1 - 0.5f, 0.5f - v.y0, v.y1 - 0.5f});
+        } else {
+            s = std::max(v.w(), v.h());
+        }
+        s = std::clamp(s, 1.0f / std::max(1.0f, caps.maxZoom), 1.0f);
+        if (s >= kMinCropGain) s = 1.0f;
+
+        if (centred) {
+            p.shown = {0.5f - s / 2.0f, 0.5f - s / 2.0f, 0.5f + s / 2.0f, 0.5f + s / 2.0f};
+        } else {
+            // Around the visible centre, pushed back inside the frame.
+            const float cx = std::clamp((v.x0 + v.x1) / 2.0f, s / 2.0f, 1.0f - s / 2.0f);
+            const float cy = std::clamp((v.y0 + v.y1) / 2.0f, s / 2.0f, 1.0f - s / 2.0f);
+            p.shown = {cx - s / 2.0f, cy - s / 2.0f, cx + s / 2.0f, cy + s / 2.0f};
+        }
+        p.band = clamp01({(v.x0 - p.shown.x0) / s, (v.y0 - p.shown.y0) / s,
+                          (v.x1 - p.shown.x0) / s, (v.y1 - p.shown.y0) / s});
+
+        if (caps.zoomRatio) {
+            p.zoomRatio = 1.0f / s;
+            return p;
+        }
+        // The stream's own field of view: the largest centred stream-aspect rectangle of
+        // the active array.
+        if (caps.activeW <= 0 || caps.activeH <= 0 || streamW <= 0 || streamH <= 0) return p;
+        int baseW = caps.activeW, baseH = caps.activeH;
+        if ((long long) caps.activeW * streamH > (long long) caps.activeH * streamW) {
+            baseW = (int) ((long long) caps.activeH * streamW / streamH);
+        } else {
+            baseH = (int) ((long long) caps.activeW * streamH / streamW);
+        }
+        const int baseX = (caps.activeW - baseW) / 2, baseY = (caps.activeH - baseH) / 2;
+        p.cropX = baseX + (int) std::lround(p.shown.x0 * (float) baseW);
+        p.cropY = baseY + (int) std::lround(p.shown.y0 * (float) baseH);
+        p.cropW = std::max(1, (int) std::lround(s * (float) baseW));
+        p.cropH = std::max(1, (int) std::lround(s * (float) baseH));
+        return p;
+    }
+
+} // namespace backcam
@@ -0,0 +1,52 @@
+// crop_region.h
+
+#pragma once
+
+namespace backcam {
+
+    // A rectangle in [0, 1] coordinates of some frame (x right, y down, x1 / y1 exclusive).
+    struct NormRect {
+        float x0 = 0.0f;
+        float y0 = 0.0f;
+        float x1 = 1.0f;
+        float y1 = 1.0f;
+
+        float w() const { return x1 - x0; }
+
+        float h() const { return y1 - y0; }
+    };
+
+    // The same area of a frame rotated clockwise by `rotation` (0 / 90 / 180 / 270),
+    // given in the rotated frame: toSensor() undoes the output rotation, toOutput()
+    // applies it.
+    NormRect toSensor(const NormRect &output, int rotation);
+
+    NormRect toOutput(const NormRect &sensor, int rotation);
+
+    // What the camera allows for cropping. zoomRatio: CONTROL_ZOOM_RATIO is available
+    // (centred zoom up to maxZoom); otherwise SCALER_CROP_REGION up to
+    // SCALER_AVAILABLE_MAX_DIGITAL_ZOOM, off-centre only with freeform cropping.
+    struct CropCaps {
+        int activeW = 0;   // SENSOR_INFO_ACTIVE_ARRAY_SIZE
+        int activeH = 0;
+        float maxZoom = 1.0f;
+        bool zoomRatio = false;
+        bool freeform = false;
+    };
+
+    struct CropPlan {
+        float zoomRatio = 1.0f;   // CONTROL_ZOOM_RATIO, when caps.zoomRatio
+        // SCALER_CROP_REGION in active-array pixels (left, top, width, height), when
+        // !caps.zoomRatio.
+        int cropX = 0, cropY = 0, cropW = 0, cropH = 0;
+        NormRect shown;   // part of the uncropped stream field of view the stream now carries
+        NormRect band;    // visible part of the cropped stream: the only part worth converting
+    };
+
+    // Zooms the ISP in on `visible` (sensor orientation, in the uncropped stream's field
+    // of view) as far as the stream's aspect ratio, the centring rule and maxZoom allow,
+    // so the stream's pixels go to what is shown; `band` is what remains to skip on the
+    // CPU. A crop within 2 % of the full view is not worth a resample and is skipped.
+    CropPlan planCrop(const CropCaps &caps, int streamW, int streamH, const NormRect &visible);
+
+} // namespace backcam
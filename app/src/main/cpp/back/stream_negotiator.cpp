@@ -0,0 +1,130 @@
+// stream_negotiator.cpp
+
+#include "stream_negotiator.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+namespace backcam {
+
+    static constexpr int kFallbackW = 1280;
+    static constexpr int kFallbackH = 720;
+    static constexpr int kFallbackFps = 30;
+
+    static bool sameAspect(int w, int h, int refW, int refH) {
+        if (refW <= 0 || refH <= 0) return true;
+        // |w/h - refW/refH| <= 1 % of refW/refH, in integers.
+        const long long a = (long long) w * refH, b = (long long) refW * h;
+        return std::llabs(a - b) * 100 <= b;
+    }
+
+    // Highest rate the sensor can stream this size at (0 = duration not listed).
+    static int sizeMaxFps(const StreamSize &s) {
+        return s.minFrameDurationNs > 0 ? (int) (1000000000LL / s.minFrameDurationNs) : 0;
+    }
+
+    static int achievedFps(const FpsRange &r, int want, int sizeFps) {
+        return std::min({r.max, want, sizeFps > 0 ? sizeFps : r.max});
+    }
+
+    // Best range for a size that can do up to `sizeFps` (0 = unknown, no limit): the
+    // highest rate reachable without exceeding `want`, then the highest floor, then
+    // the narrowest. False when every range starts above what is wanted or possible.
+    static bool pickRange(const std::vector<FpsRange> &ranges, int want, int sizeFps,
+                          FpsRange &out) {
+        bool found = false;
+        int bestFps = 0;
+        for (const FpsRange &r: ranges) {
+            if (r.max <= 0 || r.min > r.max || r.min > want) continue;
+            if (sizeFps > 0 && r.min > sizeFps) continue;
+            const int fps = achievedFps(r, want, sizeFps);
+            if (!found || fps > bestFps || (fps == bestFps && r.min > out.min) ||
+                (fps == bestFps && r.min == out.min && r.max < out.max)) {
+                out = r;
+                bestFps = fps;
+                found = true;
+            }
+        }
+        return found;
+    }
+
+    StreamChoice negotiateStream(const StreamCaps &caps, const StreamRequest &req) {
+        const int want = req.desiredFps > 0 ? req.desiredFps : kFallbackFps;
+        StreamChoice c;
+        if (caps.yuvSizes.empty()) {
+            c.w = kFallbackW;
+            c.h = kFallbackH;
+            c.fpsRange = {kFallbackFps, kFallbackFps};
+            c.fps = kFallbackFps;
+            c.why = "no stream configurations, default 1280x720@30";
+            return c;
+        }
+
+        std::vector<StreamSize> sizes = caps.yuvSizes;
+        std::sort(sizes.begin(), sizes.end(), [](const StreamSize &a, const StreamSize &b) {
+            const long long pa = (long long) a.w * a.h, pb = (long long) b.w * b.h;
+            return pa != pb ? pa < pb : a.w < b.w;
+        });
+
+        // A range that cannot be read still leaves the size's own limit.
+        std::vector<FpsRange> ranges = caps.fpsRanges;
+        if (ranges.empty()) ranges.push_back({kFallbackFps, kFallbackFps});
+
+        const StreamSize *best = nullptr;
+        FpsRange bestRange;
+        int bestFps = -1;
+        for (const StreamSize &s: sizes) {
+            if (s.w < req.coverW || s.h < req.coverH) continue;
+            if (!sameAspect(s.w, s.h, req.coverW, req.coverH)) continue;
+            FpsRange r;
+            if (!pickRange(ranges, want, sizeMaxFps(s), r)) continue;
+            const int fps = achievedFps(r, want, sizeMaxFps(s));
+            // Smallest first, so only a strictly faster size replaces the current one.
+            if (fps > bestFps) {
+                best = &s;
+                bestRange = r;
+                bestFps = fps;
+            }
+            if (fps >= want) break;
+        }
+
+        if (best) {
+            c.why = bestFps >= want ? "smallest covering size at the requested rate"
+                                    : "no covering size reaches the requested rate; fastest";
+        } else {
+            // Nothing covers: the largest size, preferring the requested aspect ratio.
+            for (int pass = 0; pass < 2 && !best; pass++) {
+                for (auto it = sizes.rbegin(); it != sizes.rend(); ++it) {
+                    if (pass == 0 && !sameAspect(it->w, it->h, req.coverW, req.coverH))
+                        continue;
+                    FpsRange r;
+                    if (!pickRange(ranges, want, sizeMaxFps(*it), r)) continue;
+                    best = &*it;
+                    bestRange = r;
+                    bestFps = achievedFps(r, want, sizeMaxFps(*it));
+                    c.why = pass == 0 ? "no size covers the view; largest of its aspect ratio"
+                                      : "no size covers the view; largest";
+                    break;
+                }
+            }
+        }
+        if (!best) {
+            // Every range above every size's limit: take the largest size and the
+            // lowest range, and let the camera clamp.
+            best = &sizes.back();
+            bestRange = *std::min_element(ranges.begin(), ranges.end(),
+                                          [](const FpsRange &a, const FpsRange &b) {
+                                              return a.max < b.max;
+                                          });
+            bestFps = achievedFps(bestRange, want, sizeMaxFps(*best));
+            c.why = "no usable fps range";
+        }
+
+        c.w = best->w;
+        c.h = best->h;
+        c.fpsRange = bestRange;
+        c.fps = bestFps;
+        return c;
+    }
+
+} // namespace backcam
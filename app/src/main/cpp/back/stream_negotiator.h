@@ -0,0 +1,55 @@
+// stream_negotiator.h
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace backcam {
+
+    // One YUV_420_888 output size from SCALER_AVAILABLE_STREAM_CONFIGURATIONS with its
+    // SCALER_AVAILABLE_MIN_FRAME_DURATIONS entry (0 = not listed).
+    struct StreamSize {
+        int w = 0;
+        int h = 0;
+        long long minFrameDurationNs = 0;
+    };
+
+    struct FpsRange {
+        int min = 0;
+        int max = 0;
+    };
+
+    // The part of a camera's characteristics the negotiator looks at, as plain data:
+    // read from ACameraMetadata on a device, written by hand in tests.
+    struct StreamCaps {
+        std::vector<StreamSize> yuvSizes;
+        std::vector<FpsRange> fpsRanges;   // CONTROL_AE_AVAILABLE_TARGET_FPS_RANGES
+    };
+
+    // What the preview needs: at least coverW x coverH pixels in sensor orientation, in
+    // the same aspect ratio (the view's transform assumes it), at desiredFps.
+    struct StreamRequest {
+        int coverW = 0;
+        int coverH = 0;
+        int desiredFps = 30;
+    };
+
+    struct StreamChoice {
+        int w = 0;
+        int h = 0;
+        FpsRange fpsRange;   // goes into CONTROL_AE_TARGET_FPS_RANGE
+        int fps = 0;         // what the size and range allow together
+        std::string why;     // one line for the log
+    };
+
+    // Picks the output size and AE range. A size qualifies when it covers the request
+    // in the requested aspect ratio (1 % tolerance); among those the first size that
+    // reaches desiredFps wins, smallest first, and failing that the fastest one.
+    // The range is the one that reaches that rate with the highest floor, so
+    // exposure does not drag the rate down. With no qualifying size the largest size
+    // of the right aspect ratio is taken, then any largest size; with no
+    // capabilities at all, 1280x720 at {30, 30} (what start() always used to ask for).
+    StreamChoice negotiateStream(const StreamCaps &caps, const StreamRequest &req);
+
+} // namespace backcam
@@ -0,0 +1,73 @@
+// compositor_window.cpp
+
+#include "compositor_window.h"
+#include "present_scheduler.h"
+#include "vsync_monitor.h"
+
+static constexpr long long kFallbackPeriodNs = 16666667LL;   // before the first vsync
+
+WindowComposeSink::WindowComposeSink(ANativeWindow *win, int w, int h) : mWin(win) {
+    if (mWin) {
+        (void) ANativeWindow_setBuffersGeometry(mWin, w, h,
+                                                AHARDWAREBUFFER_FORMAT_R8G8B8A8_UNORM);
+    }
+}
+
+WindowComposeSink::~WindowComposeSink() {
+    mFrame.reset();   // posts a buffer still locked
+    if (mWin) ANativeWindow_release(mWin);
+}
+
+bool WindowComposeSink::lock(int w, int h, uint8_t *&rgba, size_t &stride) {
+    mFrame.emplace(mWin);
+    if (!mFrame->locked()) {
+        mFrame.reset();
+        return false;
+    }
+    cv::Mat &dst = mFrame->target(w, h, mStaging);
+    rgba = dst.data;
+    stride = dst.step;
+    return true;
+}
+
+void WindowComposeSink::post() {
+    if (mFrame) mFrame->post();
+    mFrame.reset();
+}
+
+bool CompositorLoop::start(std::unique_ptr<ComposeSink> sink) {
+    std::lock_guard<std::mutex> lk(mLock);
+    if (mRunning.load() || !sink) return false;
+    mSink = std::move(sink);
+    vsyncMonitorAcquire();
+    mVsyncHeld = true;
+    mRunning.store(true);
+    mThread = std::thread(&CompositorLoop::loop, this);
+    return true;
+}
+
+void CompositorLoop::stop() {
+    std::lock_guard<std::mutex> lk(mLock);
+    mRunning.store(false);
+    if (mThread.joinable()) mThread.join();
+    if (mVsyncHeld) {
+        vsyncMonitorRelease();
+        mVsyncHeld = false;
+    }
+    mSink.reset();
+}
+
+void CompositorLoop::loop() {
+    PresentClock &clock = systemPresentClock();
+    while (mRunning.load(std::memory_order_relaxed)) {
+        // Wake on the next vsync and compose for the one after: one post per refresh.
+        long long period = displayPeriodNs();
+        if (period <= 0) period = kFallbackPeriodNs;
+        const long long vsync = lastVsyncNs();
+        const long long now = clock.nowNs();
+        clock.sleepUntilNs(vsync > 0 && vsync <= now
+                           ? vsync + ((now - vsync) / period + 1) * period : now + period);
+        mRefreshes.fetch_add(1, std::memory_order_relaxed);
+        mComp.composeIfNew(*mSink);
+    }
+}
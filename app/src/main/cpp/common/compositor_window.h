@@ -0,0 +1,66 @@
+// compositor_window.h
+
+#pragma once
+
+#include "dual_compositor.h"
+#include "window_frame.h"
+
+#include <android/native_window.h>
+
+#include <opencv2/core.hpp>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+// An ANativeWindow set to RGBA8888 at the panel size, written through WindowFrame (so a
+// buffer of another size goes through staging). Takes ownership of `win`.
+class WindowComposeSink : public ComposeSink {
+public:
+    WindowComposeSink(ANativeWindow *win, int w, int h);
+
+    ~WindowComposeSink() override;
+
+    bool lock(int w, int h, uint8_t *&rgba, size_t &stride) override;
+
+    void post() override;
+
+private:
+    ANativeWindow *mWin = nullptr;
+    std::optional<WindowFrame> mFrame;
+    cv::Mat mStaging;
+};
+
+// Runs a DualCompositor on its own thread, aligned to the display's vsync: wakes once
+// per refresh and composes only when a layer has something new, so it posts at most
+// once per refresh.
+class CompositorLoop {
+public:
+    explicit CompositorLoop(DualCompositor &comp) : mComp(comp) {}
+
+    ~CompositorLoop() { stop(); }
+
+    CompositorLoop(const CompositorLoop &) = delete;
+
+    CompositorLoop &operator=(const CompositorLoop &) = delete;
+
+    bool start(std::unique_ptr<ComposeSink> sink);
+
+    void stop();
+
+    // Display refreshes the thread woke for.
+    long long refreshes() const { return mRefreshes.load(std::memory_order_relaxed); }
+
+private:
+    void loop();
+
+    DualCompositor &mComp;
+    std::mutex mLock;   // start / stop
+    std::unique_ptr<ComposeSink> mSink;
+    std::thread mThread;
+    std::atomic<bool> mRunning{false};
+    bool mVsyncHeld = false;
+    std::atomic<long long> mRefreshes{0};
+};
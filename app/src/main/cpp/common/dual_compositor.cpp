@@ -0,0 +1,222 @@
+// dual_compositor.cpp
+
+#include "dual_compositor.h"
+#include "time_utils.h"
+
+#include <algorithm>
+#include <cmath>
+
+static constexpr double kEmaAlpha = 1.0 / 8.0;
+
+bool MemoryComposeSink::lock(int w, int h, uint8_t *&rgba, size_t &stride) {
+    if (w <= 0 || h <= 0) return false;
+    mW = w;
+    mH = h;
+    mRgba.resize((size_t) w * h * 4);
+    rgba = mRgba.data();
+    stride = (size_t) w * 4;
+    return true;
+}
+
+uint8_t *ComposeLayer::frame(int w, int h, size_t &stride) {
+    Frame &f = mMailbox.writeSlot();
+    f.w = w;
+    f.h = h;
+    f.rgba.resize((size_t) w * h * 4);
+    f.validX = f.validY = 0;
+    f.validW = w;
+    f.validH = h;
+    stride = (size_t) w * 4;
+    return f.rgba.data();
+}
+
+void ComposeLayer::setValid(int x, int y, int w, int h) {
+    Frame &f = mMailbox.writeSlot();
+    f.validX = std::clamp(x, 0, f.w);
+    f.validY = std::clamp(y, 0, f.h);
+    f.validW = std::clamp(w, 0, f.w - f.validX);
+    f.validH = std::clamp(h, 0, f.h - f.validY);
+}
+
+// Bilinear source positions of one layer for its current frame size and valid
+// rectangle: per output column the left tap and its weight (0..256); rows are worked out
+// as they come. Taps stay inside the rectangle.
+struct DualCompositor::Mapping {
+    int frameW = 0, frameH = 0;
+    int srcX = 0, srcY = 0;   // the valid rectangle
+    int srcW = 0, srcH = 0;
+    int dstW = 0, dstH = 0;
+    double invScale = 1.0;   // source pixels per output pixel
+    double offY = 0.0;       // source y of output row 0's centre, less half a pixel
+    std::vector<int> x0;     // byte offset of the left tap
+    std::vector<uint16_t> fx;
+    std::vector<uint8_t> vert;   // the two source rows blended vertically
+
+    bool matches(const ComposeLayer::Frame &f, int dw, int dh) const {
+        return frameW == f.w && frameH == f.h && srcX == f.validX && srcY == f.validY &&
+               srcW == f.validW && srcH == f.validH && dstW == dw && dstH == dh;
+    }
+
+    void build(const ComposeLayer::Frame &f, int dw, int dh) {
+        frameW = f.w;
+        frameH = f.h;
+        srcX = f.validX;
+        srcY = f.validY;
+        const int sw = srcW = f.validW;
+        const int sh = srcH = f.validH;
+        dstW = dw;
+        dstH = dh;
+        // Cover: the larger scale, centred; the other axis is cropped.
+        const double scale = std::max((double) dw / sw, (double) dh / sh);
+        invScale = 1.0 / scale;
+        const double offX = ((double) sw - dw * invScale) / 2.0 + 0.5 * invScale - 0.5;
+        offY = ((double) sh - dh * invScale) / 2.0 + 0.5 * invScale - 0.5;
+        x0.resize(dw);
+        fx.resize(dw);
+        for (int x = 0; x < dw; ++x) {
+            const double sx = std::clamp(offX + x * invScale, 0.0, (double) (sw - 1));
+            const int ix = std::min((int) sx, std::max(0, sw - 2));
+            x0[x] = ix * 4;
+            fx[x] = sw > 1 ? (uint16_t) std::lround((sx - ix) * 256.0) : 0;
+        }
+        vert.resize((size_t) sw * 4 + 4);
+    }
+
+    // Output row `y` (0 = top of this layer's area) into `dst`, alpha included.
+    void sampleRow(const ComposeLayer::Frame &f, int y, uint8_t *dst) {
+        const size_t stride = (size_t) frameW * 4, rowBytes = (size_t) srcW * 4;
+        const double sy = std::clamp(offY + y * invScale, 0.0, (double) (srcH - 1));
+        const int iy = std::min((int) sy, std::max(0, srcH - 2));
+        const int fy = srcH > 1 ? (int) std::lround((sy - iy) * 256.0) : 0;
+        const uint8_t *r0 = f.rgba.data() + (size_t) (srcY + iy) * stride + (size_t) srcX * 4;
+        const uint8_t *src = r0;
+        if (fy > 0) {
+            const uint8_t *r1 = r0 + stride;
+            for (size_t i = 0; i < rowBytes; ++i) {
+                vert[i] = (uint8_t) ((r0[i] * (256 - fy) + r1[i] * fy + 128) >> 8);
+            }
+            src = vert.data();
+        }
+        const int right = srcW > 1 ? 4 : 0;
+        for (int x = 0; x < dstW; ++x) {
+            const uint8_t *p = src + x0[x];
+            const int w1 = fx[x], w0 = 256 - w1;
+            uint8_t *o = dst + x * 4;
+            o[0] = (uint8_t) ((p[0] * w0 + p[right] * w1 + 128) >> 8);
+            o[1] = (uint8_t) ((p[1] * w0 + p[right + 1] * w1 + 128) >> 8);
+            o[2] = (uint8_t) ((p[2] * w0 + p[right + 2] * w1 + 128) >> 8);
+            o[3] = (uint8_t) ((p[3] * w0 + p[right + 3] * w1 + 128) >> 8);
+        }
+    }
+};
+
+static void fillBlack(uint8_t *row, int w) {
+    for (int x = 0; x < w; ++x) {
+        row[x * 4] = row[x * 4 + 1] = row[x * 4 + 2] = 0;
+        row[x * 4 + 3] = 255;
+    }
+}
+
+DualCompositor::DualCompositor(const ComposeLayout &layout)
+        : mLayout(layout), mTopMap(new Mapping()), mBottomMap(new Mapping()) {
+    mLayout.seamY = std::clamp(mLayout.seamY, 0, mLayout.h);
+    mLayout.overlap = std::clamp(mLayout.overlap, 0,
+                                 2 * std::min(mLayout.seamY, mLayout.h - mLayout.seamY));
+    mRowA.resize((size_t) mLayout.w * 4);
+    mRowB.resize((size_t) mLayout.w * 4);
+    mSeam.setRows(mLayout.overlap);
+}
+
+DualCompositor::~DualCompositor() = default;
+
+ComposeStats DualCompositor::stats() const {
+    ComposeStats s;
+    s.composed = mComposed.load(std::memory_order_relaxed);
+    s.composeUs = mComposeUs.load(std::memory_order_relaxed);
+    return s;
+}
+
+bool DualCompositor::acquireLayers() {
+    bool fresh = false;
+    for (ComposeLayer *l: {&mTop, &mBottom}) {
+        if (const ComposeLayer::Frame *f = l->mMailbox.tryAcquire()) {
+            l->mShown = f;
+            fresh = true;
+        }
+    }
+    return fresh;
+}
+
+bool DualCompositor::composeOnce(ComposeSink &sink) {
+    acquireLayers();
+    return composeInto(sink);
+}
+
+bool DualCompositor::composeIfNew(ComposeSink &sink) {
+    return acquireLayers() && composeInto(sink);
+}
+
+bool DualCompositor::composeInto(ComposeSink &sink) {
+    uint8_t *out = nullptr;
+    size_t stride = 0;
+    if (!sink.lock(mLayout.w, mLayout.h, out, stride)) return false;
+    const long long t0 = nowBoottimeNs();
+    compose(out, stride);
+    const double ns = (double) (nowBoottimeNs() - t0);
+    sink.post();
+    mComposeEmaNs = mComposeEmaNs == 0.0 ? ns : mComposeEmaNs + kEmaAlpha * (ns - mComposeEmaNs);
+    mComposeUs.store((int) (mComposeEmaNs / 1000.0), std::memory_order_relaxed);
+    mComposed.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+void DualCompositor::compose(uint8_t *out, size_t outStride) {
+    const int w = mLayout.w, h = mLayout.h;
+    const int bandTop = mLayout.seamY - mLayout.overlap / 2;
+    const int bandEnd = bandTop + mLayout.overlap;
+
+    const ComposeLayer::Frame *top = mTop.mShown;
+    const ComposeLayer::Frame *bottom = mBottom.mShown;
+    if (top && (top->validW <= 0 || top->validH <= 0)) top = nullptr;
+    if (bottom && (bottom->validW <= 0 || bottom->validH <= 0)) bottom = nullptr;
+    if (top && !mTopMap->matches(*top, w, bandEnd)) mTopMap->build(*top, w, bandEnd);
+    if (bottom && !mBottomMap->matches(*bottom, w, h - bandTop))
+        mBottomMap->build(*bottom, w, h - bandTop);
+
+    const auto sampleTop = [&](int y, uint8_t *dst) {
+        if (top) mTopMap->sampleRow(*top, y, dst);
+        else fillBlack(dst, w);
+    };
+    const auto sampleBottom = [&](int y, uint8_t *dst) {
+        if (bottom) mBottomMap->sampleRow(*bottom, y - bandTop, dst);
+        else fillBlack(dst, w);
+    };
+
+    for (int y = 0; y < bandTop; ++y) sampleTop(y, out + (size_t) y * outStride);
+
+    // Band: bottom over top by the ramp times the bottom layer's alpha.
+    if (mSeamMode.load(std::memory_order_relaxed) == SeamMode::MultiBand) {
+        const size_t rowBytes = (size_t) w * 4;
+        mBandA.resize(rowBytes * mLayout.overlap);
+        mBandB.resize(rowBytes * mLayout.overlap);
+        mBandRowsA.resize(mLayout.overlap);
+        mBandRowsB.resize(mLayout.overlap);
+        for (int i = 0; i < mLayout.overlap; ++i) {
+            sampleTop(bandTop + i, mBandA.data() + i * rowBytes);
+            sampleBottom(bandTop + i, mBandB.data() + i * rowBytes);
+            mBandRowsA[i] = mBandA.data() + i * rowBytes;
+            mBandRowsB[i] = mBandB.data() + i * rowBytes;
+        }
+        mSeam.blend(mBandRowsA.data(), mBandRowsB.data(), out + (size_t) bandTop * outStride,
+                    outStride, w, SeamMode::MultiBand, true);
+    } else {
+        for (int y = bandTop; y < bandEnd; ++y) {
+            sampleTop(y, mRowA.data());
+            sampleBottom(y, mRowB.data());
+            mSeam.blendRow(y - bandTop, mRowA.data(), mRowB.data(),
+                           out + (size_t) y * outStride, w, true);
+        }
+    }
+
+    for (int y = bandEnd; y < h; ++y) sampleBottom(y, out + (size_t) y * outStride);
+}
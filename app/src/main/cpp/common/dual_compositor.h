@@ -0,0 +1,155 @@
+// dual_compositor.h
+
+#pragma once
+
+#include "frame_mailbox.h"
+#include "seam_blend.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Where DualCompositor's frames go: one RGBA buffer per composed frame.
+class ComposeSink {
+public:
+    virtual ~ComposeSink() = default;
+
+    // A w x h RGBA buffer to write the next frame into; false skips the frame.
+    virtual bool lock(int w, int h, uint8_t *&rgba, size_t &stride) = 0;
+
+    virtual void post() = 0;
+};
+
+// A host buffer: what tests compose into.
+class MemoryComposeSink : public ComposeSink {
+public:
+    bool lock(int w, int h, uint8_t *&rgba, size_t &stride) override;
+
+    void post() override { ++mPosts; }
+
+    const uint8_t *frame() const { return mRgba.data(); }
+
+    size_t stride() const { return (size_t) mW * 4; }
+
+    int width() const { return mW; }
+
+    int height() const { return mH; }
+
+    long long posts() const { return mPosts; }
+
+private:
+    std::vector<uint8_t> mRgba;
+    int mW = 0;
+    int mH = 0;
+    long long mPosts = 0;
+};
+
+// One camera's frames on their way to the compositor, in place of its own window: the
+// pipeline renders RGBA into frame() and publish()es it (see WindowFrame). One producer
+// thread at a time; the compositor keeps the newest frame until a newer one arrives.
+class ComposeLayer {
+public:
+    // Buffer of the next frame, w x h RGBA, reused from frame to frame. All of it is the
+    // picture unless setValid() narrows that.
+    uint8_t *frame(int w, int h, size_t &stride);
+
+    // Only the rectangle (x, y, w, h) of the frame being written holds the picture: the
+    // compositor scales that to cover the layer's area and never reads the rest. Call
+    // after frame(); clamped to the frame.
+    void setValid(int x, int y, int w, int h);
+
+    void publish() { (void) mMailbox.publish(); }
+
+    // Frames replaced before the compositor took them.
+    long long overwritten() const { return mMailbox.dropped(); }
+
+private:
+    friend class DualCompositor;
+
+    struct Frame {
+        std::vector<uint8_t> rgba;
+        int w = 0;
+        int h = 0;
+        int validX = 0, validY = 0, validW = 0, validH = 0;   // the picture within w x h
+    };
+
+    FrameMailbox<Frame> mMailbox;
+    const Frame *mShown = nullptr;   // compositor side
+};
+
+// The stacked panel: the top layer fills rows [0, seamY + overlap / 2), the bottom one
+// rows [seamY - overlap / 2, h), each frame's valid rectangle scaled to cover its area
+// (centre crop, bilinear).
+// The `overlap` rows in between show both, the bottom layer blended over the top one by
+// a linear ramp times its own alpha (the UVC seam feather), see SeamBlender.
+struct ComposeLayout {
+    int w = 2160;
+    int h = 1600;
+    int seamY = 800;
+    int overlap = 44;   // the old TextureView offsets: +14 on the back view, -30 on UVC
+};
+
+struct ComposeStats {
+    long long composed = 0;   // frames posted
+    int composeUs = 0;        // smoothed time to write one output frame
+};
+
+// The panel's one output. Takes the newest frame from each layer and writes the whole
+// output in one pass (each pixel once: top, blended band, bottom). Needs nothing from
+// the platform; CompositorLoop (compositor_window.h) drives it on the display's vsync.
+// One composing thread at a time.
+class DualCompositor {
+public:
+    explicit DualCompositor(const ComposeLayout &layout = ComposeLayout());
+
+    ~DualCompositor();
+
+    DualCompositor(const DualCompositor &) = delete;
+
+    DualCompositor &operator=(const DualCompositor &) = delete;
+
+    ComposeLayer &top() { return mTop; }
+
+    ComposeLayer &bottom() { return mBottom; }
+
+    const ComposeLayout &layout() const { return mLayout; }
+
+    // How the band is blended; Linear unless set. Takes effect from the next frame.
+    void setSeamMode(SeamMode mode) { mSeamMode.store(mode, std::memory_order_relaxed); }
+
+    // Takes whatever the layers have and composes one frame into `sink` now; false
+    // when the sink had no buffer.
+    bool composeOnce(ComposeSink &sink);
+
+    // composeOnce() only when a layer published a frame since the last compose.
+    bool composeIfNew(ComposeSink &sink);
+
+    ComposeStats stats() const;
+
+private:
+    struct Mapping;
+
+    bool acquireLayers();
+
+    bool composeInto(ComposeSink &sink);
+
+    void compose(uint8_t *out, size_t outStride);
+
+    ComposeLayout mLayout;
+    ComposeLayer mTop;
+    ComposeLayer mBottom;
+
+    std::unique_ptr<Mapping> mTopMap;      // compositor thread only
+    std::unique_ptr<Mapping> mBottomMap;
+    std::vector<uint8_t> mRowA, mRowB;     // band rows before blending (Linear)
+    std::vector<uint8_t> mBandA, mBandB;   // the whole band of each layer (MultiBand)
+    std::vector<const uint8_t *> mBandRowsA, mBandRowsB;
+    SeamBlender mSeam;
+    std::atomic<SeamMode> mSeamMode{SeamMode::Linear};
+
+    double mComposeEmaNs = 0.0;
+    std::atomic<long long> mComposed{0};
+    std::atomic<int> mComposeUs{0};
+};
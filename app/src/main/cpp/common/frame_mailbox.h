@@ -0,0 +1,97 @@
+// frame_mailbox.h
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <ctime>
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "futex word must be 32-bit");
+
+static inline void futexWaitWord(std::atomic<uint32_t> *word, uint32_t expected,
+                                 long long timeoutNs) {
+    timespec ts{};
+    ts.tv_sec = (time_t) (timeoutNs / 1000000000LL);
+    ts.tv_nsec = (long) (timeoutNs % 1000000000LL);
+    (void) syscall(SYS_futex, reinterpret_cast<uint32_t *>(word), FUTEX_WAIT_PRIVATE, expected,
+                   timeoutNs >= 0 ? &ts : nullptr, nullptr, 0);
+}
+
+static inline void futexWakeWord(std::atomic<uint32_t> *word) {
+    (void) syscall(SYS_futex, reinterpret_cast<uint32_t *>(word), FUTEX_WAKE_PRIVATE, 1,
+                   nullptr, nullptr, 0);
+}
+
+// Single-producer / single-consumer latest-value triple buffer.
+//
+// The producer fills writeSlot() without any lock and publish()es it; the consumer
+// takes the newest published slot with tryAcquire()/waitAcquire() and keeps it
+// until its next acquire. Neither side ever blocks the other: publish and acquire
+// are one atomic exchange each, and the consumer sleeps on a futex sequence word.
+//
+// publish() returns true when it replaced a frame the consumer never saw. That
+// stale frame is handed back as the new writeSlot(), so the producer can recycle
+// whatever it owns (a V4L2 buffer, an AImage) before reusing the slot.
+template<typename T>
+class FrameMailbox {
+public:
+    T &writeSlot() { return mSlots[mWrite]; }
+
+    bool publish() {
+        uint32_t prev = mMiddle.exchange(mWrite | kFresh, std::memory_order_acq_rel);
+        mWrite = prev & kIndexMask;
+        bool overwritten = (prev & kFresh) != 0;
+        if (overwritten) mDropped.fetch_add(1, std::memory_order_relaxed);
+        mSeq.fetch_add(1, std::memory_order_release);
+        futexWakeWord(&mSeq);
+        return overwritten;
+    }
+
+    T *tryAcquire() {
+        if (!(mMiddle.load(std::memory_order_acquire) & kFresh)) return nullptr;
+        uint32_t prev = mMiddle.exchange(mRead, std::memory_order_acq_rel);
+        mRead = prev & kIndexMask;
+        return &mSlots[mRead];
+    }
+
+    // Returns the newest frame, or nullptr after a timeout or wake(); callers loop
+    // and re-check their own running flag.
+    T *waitAcquire(long long timeoutNs) {
+        uint32_t seq = mSeq.load(std::memory_order_acquire);
+        if (T *t = tryAcquire()) return t;
+        futexWaitWord(&mSeq, seq, timeoutNs);
+        return tryAcquire();
+    }
+
+    void wake() {
+        mSeq.fetch_add(1, std::memory_order_release);
+        futexWakeWord(&mSeq);
+    }
+
+    long long dropped() const { return mDropped.load(std::memory_order_relaxed); }
+
+    // Only valid while neither side is running (setup / teardown).
+    template<typename F>
+    void reset(F &&clearSlot) {
+        for (auto &s: mSlots) clearSlot(s);
+        mWrite = 0;
+        mMiddle.store(1, std::memory_order_relaxed);
+        mRead = 2;
+        mDropped.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    static constexpr uint32_t kIndexMask = 0x3;
+    static constexpr uint32_t kFresh = 0x4;
+
+    T mSlots[3];
+    alignas(64) std::atomic<uint32_t> mMiddle{1};
+    alignas(64) std::atomic<uint32_t> mSeq{0};
+    alignas(64) uint32_t mWrite = 0;    // producer only
+    alignas(64) uint32_t mRead = 2;     // consumer only
+    std::atomic<long long> mDropped{0};
+};
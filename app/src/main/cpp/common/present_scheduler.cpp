@@ -0,0 +1,153 @@
+// present_scheduler.cpp
+
+#include "present_scheduler.h"
+#include "time_utils.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cmath>
+
+// Post this long before the vsync a frame is meant for: lock + copy + unlockAndPost,
+// and the compositor's latch point.
+static constexpr long long kLeadNs = 4000000LL;
+// A frame still this far from its slot is a timestamp discontinuity, not pacing.
+static constexpr long long kMaxWaitNs = 250000000LL;
+// Budget decay per frame once the peak has passed (1/32: ~0.5 s at 60 fps).
+static constexpr int kBudgetDecayShift = 5;
+
+class SystemPresentClock : public PresentClock {
+public:
+    long long nowNs() override { return nowBoottimeNs(); }
+
+    void sleepUntilNs(long long ns) override {
+        timespec ts{};
+        ts.tv_sec = (time_t) (ns / 1000000000LL);
+        ts.tv_nsec = (long) (ns % 1000000000LL);
+        while (clock_nanosleep(CLOCK_BOOTTIME, TIMER_ABSTIME, &ts, nullptr) == EINTR) {}
+    }
+};
+
+PresentClock &systemPresentClock() {
+    static SystemPresentClock clock;
+    return clock;
+}
+
+static long long floorDiv(long long a, long long b) {
+    long long q = a / b;
+    return (a % b != 0 && (a < 0) != (b < 0)) ? q - 1 : q;
+}
+
+void PresentScheduler::reset() {
+    mBudgetNs = -1;
+    mLastTargetNs = 0;
+    mPrevTargetNs = 0;
+    mPendingCaptureNs = 0;
+    mPrevPostNs = 0;
+    mPrevCaptureNs = 0;
+    mJitterEmaNs = 0.0;
+    mPresented.store(0, std::memory_order_relaxed);
+    mLateDrops.store(0, std::memory_order_relaxed);
+    mJitterUs.store(0, std::memory_order_relaxed);
+    mMaxJitterUs.store(0, std::memory_order_relaxed);
+    mLatencyUs.store(0, std::memory_order_relaxed);
+}
+
+void PresentScheduler::setDisplayTiming(long long periodNs, long long vsyncNs) {
+    mPeriodNs = std::max(0LL, periodNs);
+    mVsyncNs = vsyncNs;
+    mPeriodUs.store((int) (mPeriodNs / 1000), std::memory_order_relaxed);
+}
+
+bool PresentScheduler::waitForSlot(long long captureNs) {
+    if (!reserveSlot(captureNs)) return false;
+    waitForReservedSlot();
+    return true;
+}
+
+bool PresentScheduler::reserveSlot(long long captureNs) {
+    const long long now = mClock.nowNs();
+    const long long readyNs = now - captureNs;
+    if (mBudgetNs < 0) mBudgetNs = readyNs;
+    mPrevTargetNs = mLastTargetNs;
+
+    long long target = captureNs + mBudgetNs;
+    if (mPeriodNs > 0 && mVsyncNs != 0) {
+        const long long lead = std::min(kLeadNs, mPeriodNs / 4);
+        const long long k = floorDiv(target + lead - mVsyncNs + mPeriodNs - 1, mPeriodNs);
+        target = mVsyncNs + k * mPeriodNs - lead;
+    }
+    const long long natural = target;
+    // Never two frames for one vsync: the later one takes the next slot, or is
+    // dropped if that puts it a whole period behind its own.
+    if (mPeriodNs > 0 && mLastTargetNs != 0 && target < mLastTargetNs + mPeriodNs)
+        target = mLastTargetNs + mPeriodNs;
+
+    if (target - now > kMaxWaitNs || captureNs < mPrevCaptureNs) {
+        // Clock jump or timestamps restarted: start over from this frame.
+        mBudgetNs = readyNs;
+        mLastTargetNs = 0;
+        mPrevPostNs = 0;
+        target = now;
+    } else {
+        const long long tol = mPeriodNs > 0 ? mPeriodNs / 4 : 2000000LL;
+        const bool late = now > target + tol;
+        const bool behind = mPeriodNs > 0 && target - natural > mPeriodNs;
+        if (late || behind) {
+            // A late frame still shows how long frames take to get here.
+            updateBudget(readyNs);
+            mLateDrops.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+    }
+
+    mLastTargetNs = target;
+    mPendingCaptureNs = captureNs;
+    return true;
+}
+
+void PresentScheduler::waitForReservedSlot() {
+    const long long now = mClock.nowNs();
+    // Judged against the old budget when the slot was reserved, updated only now.
+    updateBudget(now - mPendingCaptureNs);
+    if (mLastTargetNs > now) mClock.sleepUntilNs(mLastTargetNs);
+}
+
+void PresentScheduler::cancelReservedSlot() {
+    mLastTargetNs = mPrevTargetNs;
+    mPendingCaptureNs = mPrevCaptureNs;
+}
+
+// The budget jumps to a new peak at once and decays slowly.
+void PresentScheduler::updateBudget(long long readyNs) {
+    mBudgetNs = readyNs > mBudgetNs ? readyNs
+                                    : mBudgetNs - ((mBudgetNs - readyNs) >> kBudgetDecayShift);
+    mLatencyUs.store((int) std::min<long long>(mBudgetNs / 1000, INT_MAX),
+                     std::memory_order_relaxed);
+}
+
+void PresentScheduler::presented() {
+    const long long post = mClock.nowNs();
+    mPresented.fetch_add(1, std::memory_order_relaxed);
+    if (mPrevPostNs != 0) {
+        const double dev = std::fabs((double) ((post - mPrevPostNs) -
+                                               (mPendingCaptureNs - mPrevCaptureNs)));
+        mJitterEmaNs = mJitterEmaNs == 0.0 ? dev : mJitterEmaNs + (dev - mJitterEmaNs) / 16.0;
+        mJitterUs.store((int) (mJitterEmaNs / 1000.0), std::memory_order_relaxed);
+        if ((int) (dev / 1000.0) > mMaxJitterUs.load(std::memory_order_relaxed))
+            mMaxJitterUs.store((int) (dev / 1000.0), std::memory_order_relaxed);
+    }
+    mPrevPostNs = post;
+    mPrevCaptureNs = mPendingCaptureNs;
+}
+
+PresentStats PresentScheduler::stats() const {
+    PresentStats s;
+    s.presented = mPresented.load(std::memory_order_relaxed);
+    s.lateDrops = mLateDrops.load(std::memory_order_relaxed);
+    s.jitterUs = mJitterUs.load(std::memory_order_relaxed);
+    s.maxJitterUs = mMaxJitterUs.load(std::memory_order_relaxed);
+    s.latencyUs = mLatencyUs.load(std::memory_order_relaxed);
+    s.periodUs = mPeriodUs.load(std::memory_order_relaxed);
+    return s;
+}
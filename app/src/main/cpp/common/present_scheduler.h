@@ -0,0 +1,103 @@
+// present_scheduler.h
+
+#pragma once
+
+#include <atomic>
+
+// Time source for PresentScheduler. The system clock reads CLOCK_BOOTTIME; tests use
+// ManualPresentClock, whose sleeps only move time forward.
+class PresentClock {
+public:
+    virtual ~PresentClock() = default;
+
+    virtual long long nowNs() = 0;
+
+    virtual void sleepUntilNs(long long ns) = 0;
+};
+
+PresentClock &systemPresentClock();
+
+class ManualPresentClock : public PresentClock {
+public:
+    long long nowNs() override { return mNowNs; }
+
+    void sleepUntilNs(long long ns) override {
+        if (ns > mNowNs) mNowNs = ns;
+    }
+
+    void advanceTo(long long ns) { sleepUntilNs(ns); }
+
+private:
+    long long mNowNs = 0;
+};
+
+struct PresentStats {
+    long long presented = 0;
+    long long lateDrops = 0;   // missed their slot, or a second frame for one vsync
+    int jitterUs = 0;          // smoothed |post interval - capture interval|
+    int maxJitterUs = 0;
+    int latencyUs = 0;         // capture -> post budget currently scheduled
+    int periodUs = 0;          // display period in use (0 = unknown)
+};
+
+// Paces frames by their capture timestamps: each frame is posted at its capture time
+// plus a latency budget (the slowly decaying peak of capture -> ready delay), snapped
+// to just before a display vsync, so decode jitter never reaches the screen. A frame
+// ready after its slot is dropped, not queued behind the next one. The capture and
+// clock domains may differ by a constant offset; it cancels out of the budget.
+//
+// One presenting thread per scheduler; stats() may be read from any thread.
+class PresentScheduler {
+public:
+    explicit PresentScheduler(PresentClock &clock = systemPresentClock()) : mClock(clock) {}
+
+    // Forget the budget and cadence (new stream, new mode, reconnect).
+    void reset();
+
+    // Display period and the time of any vsync, in the clock's domain; 0 = unknown,
+    // in which case frames are paced without vsync alignment.
+    void setDisplayTiming(long long periodNs, long long vsyncNs);
+
+    // Sleeps until the frame's slot and returns true, or returns false at once when
+    // the frame is late and should be dropped.
+    bool waitForSlot(long long captureNs);
+
+    // waitForSlot() in two steps, for producers that write the frame only once they
+    // know it will be shown: reserveSlot() decides (false = drop, skip the work) and
+    // waitForReservedSlot() sleeps once the frame is ready to post. The budget then
+    // covers the work done in between.
+    bool reserveSlot(long long captureNs);
+
+    void waitForReservedSlot();
+
+    // Gives back the slot from the last successful reserveSlot() when its frame will
+    // not be posted after all (failed decode), so the next frame may take it.
+    void cancelReservedSlot();
+
+    // Right after the frame from the last successful waitForSlot() was posted.
+    void presented();
+
+    PresentStats stats() const;
+
+private:
+    void updateBudget(long long readyNs);
+
+    PresentClock &mClock;
+
+    long long mPeriodNs = 0;
+    long long mVsyncNs = 0;
+    long long mBudgetNs = -1;        // < 0: no frame seen yet
+    long long mLastTargetNs = 0;   // also the reserved slot until it is waited for
+    long long mPrevTargetNs = 0;   // mLastTargetNs before the pending reservation
+    long long mPendingCaptureNs = 0;
+    long long mPrevPostNs = 0;
+    long long mPrevCaptureNs = 0;
+    double mJitterEmaNs = 0.0;
+
+    std::atomic<long long> mPresented{0};
+    std::atomic<long long> mLateDrops{0};
+    std::atomic<int> mJitterUs{0};
+    std::atomic<int> mMaxJitterUs{0};
+    std::atomic<int> mLatencyUs{0};
+    std::atomic<int> mPeriodUs{0};
+};
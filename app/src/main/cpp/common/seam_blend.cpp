@@ -0,0 +1,291 @@
+// seam_blend.cpp
+
+#include "seam_blend.h"
+
+#include <algorithm>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define SEAM_HAVE_NEON 1
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#define SEAM_HAVE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+static constexpr int kMaxLevels = 4;    // below the band's full size
+static constexpr int kMinLevelSize = 4;
+
+void SeamBlender::setRows(int rows) {
+    rows = std::max(0, rows);
+    if ((int) mLut.size() == rows) return;
+    // Centre of each band row on a 0..256 ramp; always below 256, so weight * alpha
+    // stays within 16 bits.
+    mLut.resize(rows);
+    for (int i = 0; i < rows; ++i) mLut[i] = (uint16_t) ((2 * i + 1) * 256 / (2 * rows));
+}
+
+void seamBlendRowScalar(const uint8_t *upper, const uint8_t *lower, uint8_t *out, int width,
+                        int weight, bool lowerAlpha) {
+    for (int x = 0; x < width; ++x) {
+        const uint8_t *a = upper + x * 4, *b = lower + x * 4;
+        const int wb = lowerAlpha ? (weight * (b[3] + (b[3] >> 7)) + 128) >> 8 : weight;
+        const int wa = 256 - wb;
+        uint8_t *o = out + x * 4;
+        o[0] = (uint8_t) ((a[0] * wa + b[0] * wb + 128) >> 8);
+        o[1] = (uint8_t) ((a[1] * wa + b[1] * wb + 128) >> 8);
+        o[2] = (uint8_t) ((a[2] * wa + b[2] * wb + 128) >> 8);
+        o[3] = 255;
+    }
+}
+
+// The vector kernels do the scalar arithmetic in 16-bit lanes (a * wa + b * wb + 128
+// peaks at 65408) and return how many pixels they covered.
+#if SEAM_HAVE_NEON
+
+static int blendRowNeon(const uint8_t *a, const uint8_t *b, uint8_t *o, int width,
+                        int weight, bool lowerAlpha) {
+    const uint16x8_t w = vdupq_n_u16((uint16_t) weight);
+    const uint16x8_t c256 = vdupq_n_u16(256);
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        const uint8x8x4_t va = vld4_u8(a + 4 * x);
+        const uint8x8x4_t vb = vld4_u8(b + 4 * x);
+        uint16x8_t wb = w;
+        if (lowerAlpha) {
+            const uint16x8_t al = vmovl_u8(vb.val[3]);
+            wb = vrshrq_n_u16(vmulq_u16(vaddq_u16(al, vshrq_n_u16(al, 7)), w), 8);
+        }
+        const uint16x8_t wa = vsubq_u16(c256, wb);
+        uint8x8x4_t vo;
+        for (int c = 0; c < 3; ++c) {
+            const uint16x8_t s = vmlaq_u16(vmulq_u16(vmovl_u8(va.val[c]), wa),
+                                           vmovl_u8(vb.val[c]), wb);
+            vo.val[c] = vrshrn_n_u16(s, 8);
+        }
+        vo.val[3] = vdup_n_u8(255);
+        vst4_u8(o + 4 * x, vo);
+    }
+    return x;
+}
+
+#elif SEAM_HAVE_SSE2
+
+// Per pixel weight * alpha for two pixels' worth of 16-bit lanes.
+static inline __m128i alphaWeightSse2(__m128i b, __m128i w, __m128i c128) {
+    __m128i al = _mm_shufflehi_epi16(_mm_shufflelo_epi16(b, 0xFF), 0xFF);
+    al = _mm_add_epi16(al, _mm_srli_epi16(al, 7));
+    return _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(al, w), c128), 8);
+}
+
+static inline __m128i lerpSse2(__m128i a, __m128i b, __m128i wb, __m128i c256,
+                               __m128i c128) {
+    const __m128i s = _mm_add_epi16(_mm_mullo_epi16(a, _mm_sub_epi16(c256, wb)),
+                                    _mm_mullo_epi16(b, wb));
+    return _mm_srli_epi16(_mm_add_epi16(s, c128), 8);
+}
+
+static int blendRowSse2(const uint8_t *a, const uint8_t *b, uint8_t *o, int width,
+                        int weight, bool lowerAlpha) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i w = _mm_set1_epi16((short) weight);
+    const __m128i c256 = _mm_set1_epi16(256), c128 = _mm_set1_epi16(128);
+    const __m128i opaque = _mm_set1_epi32((int) 0xFF000000u);
+    int x = 0;
+    for (; x + 4 <= width; x += 4) {
+        const __m128i va = _mm_loadu_si128((const __m128i *) (a + 4 * x));
+        const __m128i vb = _mm_loadu_si128((const __m128i *) (b + 4 * x));
+        const __m128i aLo = _mm_unpacklo_epi8(va, zero), aHi = _mm_unpackhi_epi8(va, zero);
+        const __m128i bLo = _mm_unpacklo_epi8(vb, zero), bHi = _mm_unpackhi_epi8(vb, zero);
+        const __m128i wLo = lowerAlpha ? alphaWeightSse2(bLo, w, c128) : w;
+        const __m128i wHi = lowerAlpha ? alphaWeightSse2(bHi, w, c128) : w;
+        const __m128i px = _mm_packus_epi16(lerpSse2(aLo, bLo, wLo, c256, c128),
+                                            lerpSse2(aHi, bHi, wHi, c256, c128));
+        _mm_storeu_si128((__m128i *) (o + 4 * x), _mm_or_si128(px, opaque));
+    }
+    return x;
+}
+
+#endif
+
+const char *seamBlendIsa() {
+#if SEAM_HAVE_NEON
+    return "neon";
+#elif SEAM_HAVE_SSE2
+    return "sse2";
+#else
+    return "scalar";
+#endif
+}
+
+void SeamBlender::blendRow(int row, const uint8_t *upper, const uint8_t *lower, uint8_t *out,
+                           int width, bool lowerAlpha) const {
+    const int w = mLut[row];
+#if SEAM_HAVE_NEON
+    const int done = blendRowNeon(upper, lower, out, width, w, lowerAlpha);
+#elif SEAM_HAVE_SSE2
+    const int done = blendRowSse2(upper, lower, out, width, w, lowerAlpha);
+#else
+    const int done = 0;
+#endif
+    seamBlendRowScalar(upper + done * 4, lower + done * 4, out + done * 4, width - done, w,
+                       lowerAlpha);
+}
+
+// ---- MultiBand ----
+
+// [1 4 6 4 1] / 16 both ways, keeping every other row and column; edges replicate.
+static void pyrDown(const int16_t *src, int w, int h, int ch, int16_t *dst, int dw, int dh,
+                    std::vector<int32_t> &tmp) {
+    const size_t rowLen = (size_t) w * ch;
+    tmp.resize(rowLen);
+    for (int y = 0; y < dh; ++y) {
+        const int16_t *r[5];
+        for (int k = 0; k < 5; ++k) r[k] = src + std::clamp(2 * y + k - 2, 0, h - 1) * rowLen;
+        for (size_t i = 0; i < rowLen; ++i) {
+            tmp[i] = r[0][i] + 4 * (r[1][i] + r[3][i]) + 6 * r[2][i] + r[4][i];
+        }
+        int16_t *d = dst + (size_t) y * dw * ch;
+        for (int x = 0; x < dw; ++x) {
+            int xs[5];
+            for (int k = 0; k < 5; ++k) xs[k] = std::clamp(2 * x + k - 2, 0, w - 1) * ch;
+            for (int c = 0; c < ch; ++c) {
+                const int s = tmp[xs[0] + c] + 4 * (tmp[xs[1] + c] + tmp[xs[3] + c]) +
+                              6 * tmp[xs[2] + c] + tmp[xs[4] + c];
+                d[x * ch + c] = (int16_t) ((s + 128) >> 8);
+            }
+        }
+    }
+}
+
+// dst += sign * the 2x upsample of src (the same kernel, 4x gain), dst w x h with
+// src (w + 1) / 2 x (h + 1) / 2. Building and collapsing the pyramid use this same
+// rounding, so a level comes back exactly.
+static void pyrUpAdd(const int16_t *src, int sw, int sh, int ch, int16_t *dst, int w, int h,
+                     int sign, std::vector<int32_t> &tmp) {
+    const size_t srcLen = (size_t) sw * ch;
+    tmp.resize(srcLen);
+    for (int y = 0; y < h; ++y) {
+        const int i = y / 2;
+        const int16_t *r0 = src + std::max(i - 1, 0) * srcLen;
+        const int16_t *r1 = src + i * srcLen;
+        const int16_t *r2 = src + std::min(i + 1, sh - 1) * srcLen;
+        if (y & 1) {
+            for (size_t k = 0; k < srcLen; ++k) tmp[k] = 4 * (r1[k] + r2[k]);
+        } else {
+            for (size_t k = 0; k < srcLen; ++k) tmp[k] = r0[k] + 6 * r1[k] + r2[k];
+        }
+        int16_t *d = dst + (size_t) y * w * ch;
+        for (int x = 0; x < w; ++x) {
+            const int j = x / 2;
+            const int x0 = std::max(j - 1, 0) * ch, x1 = j * ch;
+            const int x2 = std::min(j + 1, sw - 1) * ch;
+            for (int c = 0; c < ch; ++c) {
+                const int s = (x & 1) ? 4 * (tmp[x1 + c] + tmp[x2 + c])
+                                      : tmp[x0 + c] + 6 * tmp[x1 + c] + tmp[x2 + c];
+                d[x * ch + c] = (int16_t) (d[x * ch + c] + sign * ((s + 32) >> 6));
+            }
+        }
+    }
+}
+
+// Weight of the lower image for one row of a detail level `h` rows high standing for
+// `rows` band rows: 0..256 across the `width` band rows around the seam line.
+static int detailWeight(int y, int h, int rows, int width) {
+    const int centre2 = (2 * y + 1) * rows;            // 2h * band position of the row
+    const int from2 = h * (rows - width);              // 2h * start of the switch
+    return std::clamp((centre2 - from2) * 128 / (h * width), 0, 256);
+}
+
+void SeamBlender::blendMultiBand(const uint8_t *const *upper, const uint8_t *const *lower,
+                                 uint8_t *out, size_t outStride, int width, bool lowerAlpha) {
+    const int rows = this->rows();
+    int levels = 0;
+    while (levels < kMaxLevels && (rows >> (levels + 1)) >= kMinLevelSize &&
+           (width >> (levels + 1)) >= kMinLevelSize) {
+        ++levels;
+    }
+    mLevels.resize(levels + 1);
+    for (int k = 0; k <= levels; ++k) {
+        Level &l = mLevels[k];
+        l.w = k ? (mLevels[k - 1].w + 1) / 2 : width;
+        l.h = k ? (mLevels[k - 1].h + 1) / 2 : rows;
+        const size_t n = (size_t) l.w * l.h;
+        l.d.resize(n * 4);
+        l.m.resize(n);
+        l.s.assign(n * 4, 0);
+        l.r.assign(n * 4, 0);
+    }
+
+    Level &l0 = mLevels[0];
+    for (int y = 0; y < rows; ++y) {
+        const uint8_t *a = upper[y], *b = lower[y];
+        int16_t *d = l0.d.data() + (size_t) y * width * 4;
+        int16_t *m = l0.m.data() + (size_t) y * width;
+        for (int i = 0; i < width * 4; ++i) d[i] = (int16_t) (b[i] - a[i]);
+        for (int x = 0; x < width; ++x) {
+            const int al = b[x * 4 + 3];
+            m[x] = (int16_t) (lowerAlpha ? al + (al >> 7) : 256);
+        }
+    }
+
+    // Gaussian levels, then each but the last minus the next one upsampled.
+    for (int k = 0; k < levels; ++k) {
+        Level &f = mLevels[k], &c = mLevels[k + 1];
+        pyrDown(f.d.data(), f.w, f.h, 4, c.d.data(), c.w, c.h, mTmp);
+        pyrDown(f.m.data(), f.w, f.h, 1, c.m.data(), c.w, c.h, mTmp);
+    }
+    for (int k = 0; k < levels; ++k) {
+        Level &f = mLevels[k], &c = mLevels[k + 1];
+        pyrUpAdd(c.d.data(), c.w, c.h, 4, f.d.data(), f.w, f.h, -1, mTmp);
+    }
+
+    // Low-pass and weighted detail back up to full size. Detail level k switches over
+    // rows >> (levels - k) rows.
+    Level &top = mLevels[levels];
+    top.s = top.d;
+    for (int k = levels - 1; k >= 0; --k) {
+        Level &f = mLevels[k], &c = mLevels[k + 1];
+        const int switchRows = std::max(1, rows >> (levels - k));
+        for (int y = 0; y < f.h; ++y) {
+            const int w = detailWeight(y, f.h, rows, switchRows);
+            const size_t p0 = (size_t) y * f.w;
+            for (int x = 0; x < f.w; ++x) {
+                const int m = (w * f.m[p0 + x] + 128) >> 8;
+                const int16_t *d = f.d.data() + (p0 + x) * 4;
+                int16_t *r = f.r.data() + (p0 + x) * 4;
+                for (int c = 0; c < 3; ++c) r[c] = (int16_t) ((d[c] * m + 128) >> 8);
+            }
+        }
+        pyrUpAdd(c.s.data(), c.w, c.h, 4, f.s.data(), f.w, f.h, 1, mTmp);
+        if (k + 1 < levels) pyrUpAdd(c.r.data(), c.w, c.h, 4, f.r.data(), f.w, f.h, 1, mTmp);
+    }
+
+    // upper + Linear weight * low-pass + detail.
+    for (int y = 0; y < rows; ++y) {
+        const uint8_t *a = upper[y];
+        const int16_t *lo = l0.s.data() + (size_t) y * width * 4;
+        const int16_t *r = l0.r.data() + (size_t) y * width * 4;
+        const int16_t *m = l0.m.data() + (size_t) y * width;
+        uint8_t *o = out + (size_t) y * outStride;
+        for (int x = 0; x < width; ++x) {
+            const int wb = (mLut[y] * m[x] + 128) >> 8;
+            for (int c = 0; c < 3; ++c) {
+                const int i = x * 4 + c;
+                o[i] = (uint8_t) std::clamp(a[i] + ((lo[i] * wb + 128) >> 8) + r[i], 0, 255);
+            }
+            o[x * 4 + 3] = 255;
+        }
+    }
+}
+
+void SeamBlender::blend(const uint8_t *const *upper, const uint8_t *const *lower, uint8_t *out,
+                        size_t outStride, int width, SeamMode mode, bool lowerAlpha) {
+    if (rows() == 0 || width <= 0) return;
+    if (mode == SeamMode::MultiBand) {
+        blendMultiBand(upper, lower, out, outStride, width, lowerAlpha);
+        return;
+    }
+    for (int y = 0; y < rows(); ++y) {
+        blendRow(y, upper[y], lower[y], out + (size_t) y * outStride, width, lowerAlpha);
+    }
+}
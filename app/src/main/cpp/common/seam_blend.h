@@ -0,0 +1,68 @@
+// seam_blend.h
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+enum class SeamMode {
+    Linear,     // one weight per band row
+    MultiBand   // Laplacian pyramid of the band: fine detail switches over fewer rows
+};
+
+// Blends the overlap band between two stacked RGBA images, the lower one fading in
+// downwards. The weights of the lower image are a 0..256 fixed-point LUT built once
+// per overlap height (the centre of each band row on a linear ramp); with
+// `lowerAlpha` each weight is also scaled by the lower pixel's alpha (the UVC seam
+// feather). Output alpha is 255. Row kernels use NEON on ARM and SSE2 on x86.
+//
+// MultiBand splits lower - upper over the band (and only the band) into a fixed-point
+// Laplacian pyramid. The low-pass takes the Linear weights at full resolution; each
+// detail level switches over half as many rows as the one below it, centred on the
+// seam, so edges stop ghosting while colour still fades over the whole band. The band
+// edges therefore match Linear, flat areas blend exactly as Linear does, and all
+// weights 0 gives back the upper image.
+class SeamBlender {
+public:
+    explicit SeamBlender(int rows = 0) { setRows(rows); }
+
+    void setRows(int rows);
+
+    int rows() const { return (int) mLut.size(); }
+
+    int weight(int row) const { return mLut[row]; }
+
+    // Row `row` of the band: out = upper * (256 - w) + lower * w, rounded.
+    void blendRow(int row, const uint8_t *upper, const uint8_t *lower, uint8_t *out,
+                  int width, bool lowerAlpha) const;
+
+    // The whole band: output row i (at out + i * outStride) from upper[i] and lower[i],
+    // i < rows(). The rows may repeat (pointers only).
+    void blend(const uint8_t *const *upper, const uint8_t *const *lower, uint8_t *out,
+               size_t outStride, int width, SeamMode mode, bool lowerAlpha);
+
+private:
+    struct Level {
+        int w = 0;
+        int h = 0;
+        std::vector<int16_t> d;   // lower - upper: Gaussian, then Laplacian
+        std::vector<int16_t> m;   // lower alpha as a 0..256 weight, one channel
+        std::vector<int16_t> s;   // low-pass on its way up
+        std::vector<int16_t> r;   // weighted detail on its way up
+    };
+
+    void blendMultiBand(const uint8_t *const *upper, const uint8_t *const *lower,
+                        uint8_t *out, size_t outStride, int width, bool lowerAlpha);
+
+    std::vector<uint16_t> mLut;
+    std::vector<Level> mLevels;   // MultiBand scratch, reused while the size holds
+    std::vector<int32_t> mTmp;
+};
+
+// Scalar blendRow(), the reference for the vector kernels.
+void seamBlendRowScalar(const uint8_t *upper, const uint8_t *lower, uint8_t *out, int width,
+                        int weight, bool lowerAlpha);
+
+// "neon", "sse2" or "scalar": the path SeamBlender::blendRow() takes.
+const char *seamBlendIsa();
@@ -9,3 +9,17 @@ static inline long long nowBoottimeNs() {
     clock_gettime(CLOCK_BOOTTIME, &ts);
     return (long long) ts.tv_sec * 1000000000LL + (long long) ts.tv_nsec;
 }
+
+static inline long long nowMonotonicNs() {
+    timespec ts{};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long) ts.tv_sec * 1000000000LL + (long long) ts.tv_nsec;
+}
+
+// CLOCK_MONOTONIC stops during suspend, CLOCK_BOOTTIME does not; the offset between
+// them only changes across a suspend, so sampling it now is exact for recent stamps.
+static inline long long monotonicToBoottimeNs(long long monoNs) {
+    long long boot = nowBoottimeNs();
+    long long mono = nowMonotonicNs();
+    return monoNs + (boot - mono);
+}
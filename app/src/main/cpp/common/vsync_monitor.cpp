@@ -0,0 +1,122 @@
+// vsync_monitor.cpp
+
+#include "vsync_monitor.h"
+#include "logging.h"
+#include "time_utils.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <mutex>
+#include <thread>
+
+#include <android/choreographer.h>
+#include <android/looper.h>
+
+// Frame callbacks per measurement burst, and the pause between bursts. The phase of
+// a 60-120 Hz display drifts by well under a microsecond per second, so resyncing
+// twice a second is plenty and keeps the thread asleep almost all the time.
+static constexpr int kBurstFrames = 4;
+static constexpr long long kResyncNs = 500000000LL;
+
+static std::mutex gLock;
+static int gRefs = 0;
+static std::thread gTh;
+static std::atomic<bool> gRun{false};
+static std::atomic<ALooper *> gLooper{nullptr};
+
+static std::atomic<long long> gPeriodNs{0};
+static std::atomic<long long> gVsyncNs{0};
+
+namespace {
+    // Owned by the monitor thread.
+    struct Burst {
+        AChoreographer *ch = nullptr;
+        int left = 0;
+        long long prevNs = 0;   // CLOCK_MONOTONIC of the previous callback in this burst
+        long long nextNs = 0;   // when the next burst starts (monotonic)
+    };
+}
+
+static void onFrame(int64_t frameTimeNanos, void *data) {
+    auto *b = static_cast<Burst *>(data);
+    if (!gRun.load()) return;
+
+    const long long t = (long long) frameTimeNanos;
+    gVsyncNs.store(monotonicToBoottimeNs(t), std::memory_order_relaxed);
+
+    if (b->prevNs > 0 && t > b->prevNs) {
+        // Divide out frames the callback missed; ignore gaps too long to be one burst.
+        const long long dt = t - b->prevNs;
+        const long long est = gPeriodNs.load(std::memory_order_relaxed);
+        const long long n = est > 0 ? std::max(1LL, std::llround((double) dt / (double) est)) : 1;
+        if (n <= 8) {
+            const long long per = dt / n;
+            gPeriodNs.store(est > 0 ? est + (per - est) / 8 : per, std::memory_order_relaxed);
+        }
+    }
+    b->prevNs = t;
+
+    if (--b->left > 0) {
+        AChoreographer_postFrameCallback64(b->ch, onFrame, b);
+    } else {
+        b->prevNs = 0;
+        b->nextNs = nowMonotonicNs() + kResyncNs;
+    }
+}
+
+static void onRefreshRate(int64_t vsyncPeriodNanos, void *) {
+    if (vsyncPeriodNanos > 0) gPeriodNs.store((long long) vsyncPeriodNanos, std::memory_order_relaxed);
+}
+
+static void monitorLoop() {
+    // The extra reference keeps the looper valid for ALooper_wake() until the join.
+    ALooper *looper = ALooper_prepare(0);
+    ALooper_acquire(looper);
+    gLooper.store(looper);
+    AChoreographer *ch = AChoreographer_getInstance();
+    if (!ch) {
+        ALOGE("vsync: no choreographer on this thread");
+        return;
+    }
+
+    Burst b;
+    b.ch = ch;
+    AChoreographer_registerRefreshRateCallback(ch, onRefreshRate, nullptr);
+
+    while (gRun.load()) {
+        if (b.left <= 0 && nowMonotonicNs() >= b.nextNs) {
+            b.left = kBurstFrames;
+            AChoreographer_postFrameCallback64(ch, onFrame, &b);
+        }
+        // Sleep on the looper through a burst, or until the next one is due.
+        const int timeoutMs = b.left > 0 ? -1
+                                         : (int) std::max(0LL, (b.nextNs - nowMonotonicNs()) / 1000000LL);
+        ALooper_pollOnce(timeoutMs, nullptr, nullptr, nullptr);
+    }
+
+    // A frame callback still queued dies with this thread's choreographer.
+    AChoreographer_unregisterRefreshRateCallback(ch, onRefreshRate, nullptr);
+}
+
+void vsyncMonitorAcquire() {
+    std::lock_guard<std::mutex> lk(gLock);
+    if (gRefs++ > 0) return;
+    gRun.store(true);
+    gTh = std::thread(monitorLoop);
+}
+
+void vsyncMonitorRelease() {
+    std::lock_guard<std::mutex> lk(gLock);
+    if (gRefs == 0 || --gRefs > 0) return;
+    // The thread publishes its looper before it first checks gRun, so either it sees
+    // the flag or the wake reaches a looper it is about to poll.
+    gRun.store(false);
+    if (ALooper *l = gLooper.load()) ALooper_wake(l);
+    if (gTh.joinable()) gTh.join();
+    if (ALooper *l = gLooper.exchange(nullptr)) ALooper_release(l);
+}
+
+long long displayPeriodNs() { return gPeriodNs.load(std::memory_order_relaxed); }
+
+long long lastVsyncNs() { return gVsyncNs.load(std::memory_order_relaxed); }
@@ -0,0 +1,16 @@
+// vsync_monitor.h
+
+#pragma once
+
+// Refcounted background thread that follows the display through AChoreographer:
+// the vsync period (refresh-rate callback, refined by short bursts of frame callbacks)
+// and the time of a recent vsync, for PresentScheduler to align posts to.
+void vsyncMonitorAcquire();
+
+void vsyncMonitorRelease();
+
+// 0 until the first measurement.
+long long displayPeriodNs();
+
+// CLOCK_BOOTTIME of a recent vsync; 0 until the first frame callback.
+long long lastVsyncNs();
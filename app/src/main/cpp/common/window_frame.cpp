@@ -0,0 +1,136 @@
+// window_frame.cpp
+
+#include "window_frame.h"
+#include "dual_compositor.h"
+
+#include <algorithm>
+#include <cstring>
+
+static void copyRgbaToBuffer(const ANativeWindow_Buffer &out, const uint8_t *rgba, size_t srcStride,
+                             int w, int h) {
+    uint8_t *dst = (uint8_t *) out.bits;
+    const size_t dstStride = (size_t) out.stride * 4;
+
+    const int copyH = std::min(h, out.height);
+    const size_t copyWBytes = (size_t) std::min(w, out.width) * 4;
+
+    for (int y = 0; y < copyH; y++) {
+        std::memcpy(dst + y * dstStride, rgba + y * srcStride, copyWBytes);
+        if (copyWBytes < dstStride) {
+            std::memset(dst + y * dstStride + copyWBytes, 0, dstStride - copyWBytes);
+        }
+    }
+    for (int y = copyH; y < out.height; y++) {
+        std::memset(dst + y * dstStride, 0, dstStride);
+    }
+}
+
+WindowFrame::WindowFrame(ANativeWindow *win, ComposeLayer *layer) : mWin(win), mLayer(layer) {
+    if (mLayer) {
+        mLocked = true;
+        return;
+    }
+    mLocked = mWin && ANativeWindow_lock(mWin, &mOut, nullptr) == 0;
+    // Both 32-bit window formats take RGBA bytes as they are (X is ignored).
+    mFourBytes = mLocked && (mOut.format == AHARDWAREBUFFER_FORMAT_R8G8B8A8_UNORM ||
+                             mOut.format == AHARDWAREBUFFER_FORMAT_R8G8B8X8_UNORM);
+}
+
+bool WindowFrame::accepts(ANativeWindow *win, ComposeLayer *layer, int w, int h, bool yuv) {
+    if (layer) return !yuv;
+    if (!win) return false;
+    const int32_t format = ANativeWindow_getFormat(win);
+    if (yuv) {
+        return format == AHARDWAREBUFFER_FORMAT_YV12 && ANativeWindow_getWidth(win) == w &&
+               ANativeWindow_getHeight(win) == h && !(h & 1);
+    }
+    return format == AHARDWAREBUFFER_FORMAT_R8G8B8A8_UNORM ||
+           format == AHARDWAREBUFFER_FORMAT_R8G8B8X8_UNORM;
+}
+
+WindowFrame::~WindowFrame() {
+    if (mLocked) post();
+}
+
+cv::Mat &WindowFrame::target(int w, int h, cv::Mat &staging) {
+    if (mLayer) {
+        size_t stride = 0;
+        uint8_t *rgba = mLayer->frame(w, h, stride);
+        mMat = cv::Mat(h, w, CV_8UC4, rgba, stride);
+        mStaging = nullptr;
+        return mMat;
+    }
+    if (mFourBytes && mOut.width == w && mOut.height == h && mOut.stride >= w) {
+        mMat = cv::Mat(h, w, CV_8UC4, mOut.bits, (size_t) mOut.stride * 4);
+        mStaging = nullptr;
+        return mMat;
+    }
+    staging.create(h, w, CV_8UC4);
+    mStaging = &staging;
+    return staging;
+}
+
+void WindowFrame::setValid(const cv::Rect &r) {
+    if (mLayer && !mMat.empty()) mLayer->setValid(r.x, r.y, r.width, r.height);
+}
+
+bool WindowFrame::yuvPlanes(int w, int h, Yuv420Planes &p) const {
+    if (!mLocked || mOut.format != AHARDWAREBUFFER_FORMAT_YV12) return false;
+    if (mOut.width != w || mOut.height != h || mOut.stride < w || (h & 1)) return false;
+    const size_t yStride = (size_t) mOut.stride;
+    const size_t cStride = ((yStride / 2) + 15) & ~(size_t) 15;
+    uint8_t *base = (uint8_t *) mOut.bits;
+    p.y = base;
+    p.yStride = yStride;
+    p.v = base + yStride * (size_t) h;
+    p.u = p.v + cStride * (size_t) (h / 2);
+    p.uvStride = cStride;
+    return true;
+}
+
+void WindowFrame::flush() {
+    if (!mLocked || !mStaging) return;
+    if (mFourBytes)
+        copyRgbaToBuffer(mOut, mStaging->data, mStaging->step, mStaging->cols, mStaging->rows);
+    mStaging = nullptr;
+}
+
+void WindowFrame::post() {
+    if (!mLocked) return;
+    if (mLayer) {
+        if (!mMat.empty()) mLayer->publish();
+        mLocked = false;
+        mMat.release();
+        return;
+    }
+    flush();
+    ANativeWindow_unlockAndPost(mWin);
+    mLocked = false;
+    mMat.release();
+}
+
+void WindowFrame::discard() {
+    if (!mLocked) return;
+    if (mLayer) {
+        mLocked = false;   // not published
+        mMat.release();
+        return;
+    }
+    mStaging = nullptr;
+    uint8_t *bits = (uint8_t *) mOut.bits;
+    if (mOut.format == AHARDWAREBUFFER_FORMAT_YV12) {
+        // Luma 16, chroma 128 (both chroma planes follow luma).
+        const size_t yBytes = (size_t) mOut.stride * mOut.height;
+        const size_t cStride = (((size_t) mOut.stride / 2) + 15) & ~(size_t) 15;
+        std::memset(bits, 16, yBytes);
+        std::memset(bits + yBytes, 128, cStride * (size_t) (mOut.height / 2) * 2);
+    } else if (mFourBytes) {
+        for (int y = 0; y < mOut.height; y++) {
+            uint32_t *row = (uint32_t *) (bits + (size_t) y * mOut.stride * 4);
+            std::fill(row, row + mOut.width, 0xFF000000u);   // R G B 0, A 255
+        }
+    }
+    ANativeWindow_unlockAndPost(mWin);
+    mLocked = false;
+    mMat.release();
+}
@@ -0,0 +1,74 @@
+// window_frame.h
+
+#pragma once
+
+#include <android/native_window.h>
+
+#include <opencv2/core.hpp>
+
+#include "yuv_convert.h"
+
+// One ANativeWindow_lock .. unlockAndPost cycle. target() hands out the window buffer
+// itself, as an RGBA Mat over its stride, when it is exactly the frame's size, so the
+// producer converts straight into it and the frame is written once. Otherwise (window
+// geometry not applied yet, or a different frame size) it returns the caller's staging
+// Mat, which flush() copies in, zero-filling the rest of the buffer. YV12 buffers (YUV
+// passthrough) are written through yuvPlanes() instead; staging never reaches them.
+//
+// With a ComposeLayer the frame goes to the panel compositor instead of the window:
+// target() is always the layer's own buffer and post() publishes it (if it was written).
+class ComposeLayer;
+
+class WindowFrame {
+public:
+    explicit WindowFrame(ANativeWindow *win, ComposeLayer *layer = nullptr);
+
+    // Posts whatever the buffer holds if post() was not called.
+    ~WindowFrame();
+
+    WindowFrame(const WindowFrame &) = delete;
+
+    WindowFrame &operator=(const WindowFrame &) = delete;
+
+    // Whether a buffer locked from `win` now would take a w x h frame: through target()
+    // (any 32-bit RGBA buffer; staging covers another size) or, with `yuv`, through
+    // yuvPlanes() (YV12 of exactly that size). A locked window buffer can only be
+    // posted, so producers check this before locking; a layer takes any RGBA frame.
+    static bool accepts(ANativeWindow *win, ComposeLayer *layer, int w, int h, bool yuv);
+
+    bool locked() const { return mLocked; }
+
+    // True when the last target() is the window buffer.
+    bool direct() const { return mLocked && !mStaging; }
+
+    // Only valid while locked.
+    cv::Mat &target(int w, int h, cv::Mat &staging);
+
+    // Only `r` of the last target() was written. A layer hands it to the compositor,
+    // which then shows just that part; a window buffer is shown whole (the view crops
+    // it), so there this does nothing.
+    void setValid(const cv::Rect &r);
+
+    // YV12 layout (Y, then Cr, then Cb at a 16-aligned half stride) of a buffer that is
+    // exactly w x h. Only valid while locked.
+    bool yuvPlanes(int w, int h, Yuv420Planes &p) const;
+
+    // Copies the staging Mat into an RGBA buffer, if one is in use. Idempotent.
+    void flush();
+
+    void post();
+
+    // Gives up a frame that could not be written. A layer keeps showing its previous
+    // frame; a window buffer cannot be handed back unposted, so it goes out opaque
+    // black instead of with whatever it last held.
+    void discard();
+
+private:
+    ANativeWindow *mWin = nullptr;
+    ComposeLayer *mLayer = nullptr;
+    ANativeWindow_Buffer mOut{};
+    bool mLocked = false;
+    bool mFourBytes = false;
+    cv::Mat mMat;
+    cv::Mat *mStaging = nullptr;
+};
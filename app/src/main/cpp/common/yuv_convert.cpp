@@ -0,0 +1,876 @@
+// yuv_convert.cpp
+
+#include "yuv_convert.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define YUV_HAVE_NEON 1
+#include <arm_neon.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#define YUV_HAVE_X86 1
+#include <immintrin.h>
+#endif
+
+// OpenCV's BT.601 coefficients (color_yuv.simd.hpp), scaled by 2^20.
+static constexpr int kShift = 20;
+static constexpr int kHalf = 1 << (kShift - 1);
+static constexpr int kCY = 1220542;
+static constexpr int kCUB = 2116026;
+static constexpr int kCUG = -409993;
+static constexpr int kCVG = -852492;
+static constexpr int kCVR = 1673527;
+
+struct PairIdx {
+    int y0, y1, u, v;
+};
+
+static PairIdx pairIdx(Yuv422Layout l) {
+    switch (l) {
+        case Yuv422Layout::UYVY:
+            return {1, 3, 0, 2};
+        case Yuv422Layout::YVYU:
+            return {0, 2, 3, 1};
+        case Yuv422Layout::YUYV:
+        default:
+            return {0, 2, 1, 3};
+    }
+}
+
+static inline uint8_t sat8(int v) { return (uint8_t) (v < 0 ? 0 : (v > 255 ? 255 : v)); }
+
+// Two horizontally adjacent pixels sharing one chroma sample -> 8 RGBA bytes.
+static inline void pairScalar(int yE, int yO, int uRaw, int vRaw, uint8_t *o) {
+    const int u = uRaw - 128;
+    const int v = vRaw - 128;
+    const int ruv = kHalf + kCVR * v;
+    const int guv = kHalf + kCVG * v + kCUG * u;
+    const int buv = kHalf + kCUB * u;
+
+    const int y0 = (yE - 16 > 0 ? yE - 16 : 0) * kCY;
+    const int y1 = (yO - 16 > 0 ? yO - 16 : 0) * kCY;
+
+    o[0] = sat8((y0 + ruv) >> kShift);
+    o[1] = sat8((y0 + guv) >> kShift);
+    o[2] = sat8((y0 + buv) >> kShift);
+    o[3] = 255;
+    o[4] = sat8((y1 + ruv) >> kShift);
+    o[5] = sat8((y1 + guv) >> kShift);
+    o[6] = sat8((y1 + buv) >> kShift);
+    o[7] = 255;
+}
+
+// Pixel pairs [from, pairs) of one row.
+static void rowScalar(const uint8_t *s, uint8_t *d, int from, int pairs, const PairIdx &ix) {
+    for (int p = from; p < pairs; p++) {
+        const uint8_t *q = s + 4 * p;
+        pairScalar(q[ix.y0], q[ix.y1], q[ix.u], q[ix.v], d + 8 * p);
+    }
+}
+
+void LumaStats::clear() {
+    std::memset(hist, 0, sizeof(hist));
+    std::memset(zoneSum, 0, sizeof(zoneSum));
+    std::memset(zoneCount, 0, sizeof(zoneCount));
+    samples = 0;
+}
+
+// Y0 of every pair in one row into the histogram and its zone's sum.
+static void meterRow(const uint8_t *s, int pairs, int zy, const PairIdx &ix, LumaStats &st) {
+    for (int zx = 0; zx < LumaStats::kZonesX; zx++) {
+        const int p0 = pairs * zx / LumaStats::kZonesX;
+        const int p1 = pairs * (zx + 1) / LumaStats::kZonesX;
+        uint32_t sum = 0;
+        for (int p = p0; p < p1; p++) {
+            const uint8_t y = s[4 * p + ix.y0];
+            st.hist[y]++;
+            sum += y;
+        }
+        st.zoneSum[zy][zx] += sum;
+        st.zoneCount[zy][zx] += (uint32_t) (p1 - p0);
+    }
+    st.samples += (uint32_t) pairs;
+}
+
+#if YUV_HAVE_NEON
+
+static inline int32x4_t chanNeon(int32x4_t y, int32x4_t uv) {
+    return vshrq_n_s32(vaddq_s32(y, uv), kShift);
+}
+
+static inline uint8x8_t narrowNeon(int32x4_t lo, int32x4_t hi) {
+    return vqmovun_s16(vcombine_s16(vqmovn_s32(lo), vqmovn_s32(hi)));
+}
+
+// 8 pairs (16 pixels) -> RGBA, from even / odd luma and their shared chroma.
+static inline void storePairsNeon(uint8x8_t yE8raw, uint8x8_t yO8raw, uint8x8_t u8,
+                                  uint8x8_t v8, uint8_t *d) {
+    const int32x4_t half = vdupq_n_s32(kHalf);
+    const uint8x8_t c16 = vdup_n_u8(16);
+    const uint8x8_t c128 = vdup_n_u8(128);
+
+    const uint8x8_t yE8 = vqsub_u8(yE8raw, c16);
+    const uint8x8_t yO8 = vqsub_u8(yO8raw, c16);
+    const int16x8_t u16 = vreinterpretq_s16_u16(vsubl_u8(u8, c128));
+    const int16x8_t v16 = vreinterpretq_s16_u16(vsubl_u8(v8, c128));
+
+    uint8x8_t rE, gE, bE, rO, gO, bO;
+    {
+        int32x4_t uL = vmovl_s16(vget_low_s16(u16)), uH = vmovl_s16(vget_high_s16(u16));
+        int32x4_t vL = vmovl_s16(vget_low_s16(v16)), vH = vmovl_s16(vget_high_s16(v16));
+        int32x4_t ruvL = vmlaq_n_s32(half, vL, kCVR), ruvH = vmlaq_n_s32(half, vH, kCVR);
+        int32x4_t guvL = vmlaq_n_s32(vmlaq_n_s32(half, vL, kCVG), uL, kCUG);
+        int32x4_t guvH = vmlaq_n_s32(vmlaq_n_s32(half, vH, kCVG), uH, kCUG);
+        int32x4_t buvL = vmlaq_n_s32(half, uL, kCUB), buvH = vmlaq_n_s32(half, uH, kCUB);
+
+        uint16x8_t e = vmovl_u8(yE8), o = vmovl_u8(yO8);
+        int32x4_t yEL = vmulq_n_s32(vreinterpretq_s32_u32(vmovl_u16(vget_low_u16(e))), kCY);
+        int32x4_t yEH = vmulq_n_s32(vreinterpretq_s32_u32(vmovl_u16(vget_high_u16(e))), kCY);
+        int32x4_t yOL = vmulq_n_s32(vreinterpretq_s32_u32(vmovl_u16(vget_low_u16(o))), kCY);
+        int32x4_t yOH = vmulq_n_s32(vreinterpretq_s32_u32(vmovl_u16(vget_high_u16(o))), kCY);
+
+        rE = narrowNeon(chanNeon(yEL, ruvL), chanNeon(yEH, ruvH));
+        gE = narrowNeon(chanNeon(yEL, guvL), chanNeon(yEH, guvH));
+        bE = narrowNeon(chanNeon(yEL, buvL), chanNeon(yEH, buvH));
+        rO = narrowNeon(chanNeon(yOL, ruvL), chanNeon(yOH, ruvH));
+        gO = narrowNeon(chanNeon(yOL, guvL), chanNeon(yOH, guvH));
+        bO = narrowNeon(chanNeon(yOL, buvL), chanNeon(yOH, buvH));
+    }
+
+    const uint8x8x2_t r = vzip_u8(rE, rO);
+    const uint8x8x2_t g = vzip_u8(gE, gO);
+    const uint8x8x2_t b = vzip_u8(bE, bO);
+    uint8x16x4_t out;
+    out.val[0] = vcombine_u8(r.val[0], r.val[1]);
+    out.val[1] = vcombine_u8(g.val[0], g.val[1]);
+    out.val[2] = vcombine_u8(b.val[0], b.val[1]);
+    out.val[3] = vdupq_n_u8(255);
+    vst4q_u8(d, out);
+}
+
+// 16 pixels per step: vld4 splits the pairs into Y0 / U / Y1 / V planes.
+static int rowNeon(const uint8_t *s, uint8_t *d, int pairs, const PairIdx &ix) {
+    int p = 0;
+    for (; p + 8 <= pairs; p += 8) {
+        const uint8x8x4_t q = vld4_u8(s + 4 * p);
+        storePairsNeon(q.val[ix.y0], q.val[ix.y1], q.val[ix.u], q.val[ix.v], d + 8 * p);
+    }
+    return p;
+}
+
+#endif
+
+#if YUV_HAVE_X86
+
+// pshufb masks that pull Y0, Y1, U and V of each pair into the low byte of a dword.
+struct X86Masks {
+    int8_t y0[16], y1[16], u[16], v[16];
+};
+
+static X86Masks x86Masks(const PairIdx &ix) {
+    X86Masks m{};
+    for (int k = 0; k < 4; k++) {
+        for (int b = 0; b < 4; b++) {
+            const bool lo = b == 0;
+            m.y0[4 * k + b] = lo ? (int8_t) (4 * k + ix.y0) : (int8_t) -128;
+            m.y1[4 * k + b] = lo ? (int8_t) (4 * k + ix.y1) : (int8_t) -128;
+            m.u[4 * k + b] = lo ? (int8_t) (4 * k + ix.u) : (int8_t) -128;
+            m.v[4 * k + b] = lo ? (int8_t) (4 * k + ix.v) : (int8_t) -128;
+        }
+    }
+    return m;
+}
+
+// (y + uv) >> 20 for even and odd pixels, saturated and put back in pixel order.
+__attribute__((target("sse4.1")))
+static inline __m128i chanSse41(__m128i yE, __m128i yO, __m128i uv) {
+    __m128i e = _mm_srai_epi32(_mm_add_epi32(yE, uv), kShift);
+    __m128i o = _mm_srai_epi32(_mm_add_epi32(yO, uv), kShift);
+    __m128i w = _mm_packs_epi32(_mm_unpacklo_epi32(e, o), _mm_unpackhi_epi32(e, o));
+    return _mm_packus_epi16(w, w);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i chanAvx2(__m256i yE, __m256i yO, __m256i uv) {
+    __m256i e = _mm256_srai_epi32(_mm256_add_epi32(yE, uv), kShift);
+    __m256i o = _mm256_srai_epi32(_mm256_add_epi32(yO, uv), kShift);
+    __m256i w = _mm256_packs_epi32(_mm256_unpacklo_epi32(e, o), _mm256_unpackhi_epi32(e, o));
+    return _mm256_packus_epi16(w, w);
+}
+
+// 4 pairs (8 pixels) -> RGBA; each input holds one byte value per dword.
+__attribute__((target("sse4.1")))
+static inline void storePairsSse41(__m128i yE, __m128i yO, __m128i u, __m128i v, uint8_t *d) {
+    const __m128i half = _mm_set1_epi32(kHalf);
+    const __m128i c16 = _mm_set1_epi32(16), c128 = _mm_set1_epi32(128);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i cy = _mm_set1_epi32(kCY), cvr = _mm_set1_epi32(kCVR);
+    const __m128i cvg = _mm_set1_epi32(kCVG), cug = _mm_set1_epi32(kCUG);
+    const __m128i cub = _mm_set1_epi32(kCUB);
+    const __m128i alpha = _mm_set1_epi8((char) 0xFF);
+
+    yE = _mm_mullo_epi32(_mm_max_epi32(_mm_sub_epi32(yE, c16), zero), cy);
+    yO = _mm_mullo_epi32(_mm_max_epi32(_mm_sub_epi32(yO, c16), zero), cy);
+    u = _mm_sub_epi32(u, c128);
+    v = _mm_sub_epi32(v, c128);
+    const __m128i ruv = _mm_add_epi32(half, _mm_mullo_epi32(v, cvr));
+    const __m128i guv = _mm_add_epi32(_mm_add_epi32(half, _mm_mullo_epi32(v, cvg)),
+                                      _mm_mullo_epi32(u, cug));
+    const __m128i buv = _mm_add_epi32(half, _mm_mullo_epi32(u, cub));
+
+    const __m128i r = chanSse41(yE, yO, ruv);
+    const __m128i g = chanSse41(yE, yO, guv);
+    const __m128i b = chanSse41(yE, yO, buv);
+    const __m128i rg = _mm_unpacklo_epi8(r, g);
+    const __m128i ba = _mm_unpacklo_epi8(b, alpha);
+    _mm_storeu_si128((__m128i *) d, _mm_unpacklo_epi16(rg, ba));
+    _mm_storeu_si128((__m128i *) (d + 16), _mm_unpackhi_epi16(rg, ba));
+}
+
+// 8 pixels per step (4 pairs).
+__attribute__((target("sse4.1")))
+static int rowSse41(const uint8_t *s, uint8_t *d, int pairs, const PairIdx &ix) {
+    const X86Masks mk = x86Masks(ix);
+    const __m128i my0 = _mm_loadu_si128((const __m128i *) mk.y0);
+    const __m128i my1 = _mm_loadu_si128((const __m128i *) mk.y1);
+    const __m128i mu = _mm_loadu_si128((const __m128i *) mk.u);
+    const __m128i mv = _mm_loadu_si128((const __m128i *) mk.v);
+
+    int p = 0;
+    for (; p + 4 <= pairs; p += 4) {
+        const __m128i q = _mm_loadu_si128((const __m128i *) (s + 4 * p));
+        storePairsSse41(_mm_shuffle_epi8(q, my0), _mm_shuffle_epi8(q, my1),
+                        _mm_shuffle_epi8(q, mu), _mm_shuffle_epi8(q, mv), d + 8 * p);
+    }
+    return p;
+}
+
+// 8 pairs (16 pixels) -> RGBA: the SSE4.1 sequence on both 128-bit lanes (pairs 0-3
+// low, 4-7 high), then a lane fix-up.
+__attribute__((target("avx2")))
+static inline void storePairsAvx2(__m256i yE, __m256i yO, __m256i u, __m256i v, uint8_t *d) {
+    const __m256i half = _mm256_set1_epi32(kHalf);
+    const __m256i c16 = _mm256_set1_epi32(16), c128 = _mm256_set1_epi32(128);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i cy = _mm256_set1_epi32(kCY), cvr = _mm256_set1_epi32(kCVR);
+    const __m256i cvg = _mm256_set1_epi32(kCVG), cug = _mm256_set1_epi32(kCUG);
+    const __m256i cub = _mm256_set1_epi32(kCUB);
+    const __m256i alpha = _mm256_set1_epi8((char) 0xFF);
+
+    yE = _mm256_mullo_epi32(_mm256_max_epi32(_mm256_sub_epi32(yE, c16), zero), cy);
+    yO = _mm256_mullo_epi32(_mm256_max_epi32(_mm256_sub_epi32(yO, c16), zero), cy);
+    u = _mm256_sub_epi32(u, c128);
+    v = _mm256_sub_epi32(v, c128);
+    const __m256i ruv = _mm256_add_epi32(half, _mm256_mullo_epi32(v, cvr));
+    const __m256i guv = _mm256_add_epi32(_mm256_add_epi32(half, _mm256_mullo_epi32(v, cvg)),
+                                         _mm256_mullo_epi32(u, cug));
+    const __m256i buv = _mm256_add_epi32(half, _mm256_mullo_epi32(u, cub));
+
+    const __m256i r = chanAvx2(yE, yO, ruv);
+    const __m256i g = chanAvx2(yE, yO, guv);
+    const __m256i b = chanAvx2(yE, yO, buv);
+    const __m256i rg = _mm256_unpacklo_epi8(r, g);
+    const __m256i ba = _mm256_unpacklo_epi8(b, alpha);
+    const __m256i lo = _mm256_unpacklo_epi16(rg, ba);   // px 0-3 | 8-11
+    const __m256i hi = _mm256_unpackhi_epi16(rg, ba);   // px 4-7 | 12-15
+    _mm256_storeu_si256((__m256i *) d, _mm256_permute2x128_si256(lo, hi, 0x20));
+    _mm256_storeu_si256((__m256i *) (d + 32), _mm256_permute2x128_si256(lo, hi, 0x31));
+}
+
+// 16 pixels per step.
+__attribute__((target("avx2")))
+static int rowAvx2(const uint8_t *s, uint8_t *d, int pairs, const PairIdx &ix) {
+    const X86Masks mk = x86Masks(ix);
+    const __m256i my0 = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *) mk.y0));
+    const __m256i my1 = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *) mk.y1));
+    const __m256i mu = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *) mk.u));
+    const __m256i mv = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *) mk.v));
+
+    int p = 0;
+    for (; p + 8 <= pairs; p += 8) {
+        const __m256i q = _mm256_loadu_si256((const __m256i *) (s + 4 * p));
+        storePairsAvx2(_mm256_shuffle_epi8(q, my0), _mm256_shuffle_epi8(q, my1),
+                       _mm256_shuffle_epi8(q, mu), _mm256_shuffle_epi8(q, mv), d + 8 * p);
+    }
+    return p;
+}
+
+#endif
+
+using RowFn = int (*)(const uint8_t *, uint8_t *, int, const PairIdx &);
+
+static RowFn pickRow(const char **isa) {
+#if YUV_HAVE_NEON
+    *isa = "neon";
+    return rowNeon;
+#elif YUV_HAVE_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        *isa = "avx2";
+        return rowAvx2;
+    }
+    if (__builtin_cpu_supports("sse4.1")) {
+        *isa = "sse4.1";
+        return rowSse41;
+    }
+    *isa = "scalar";
+    return nullptr;
+#else
+    *isa = "scalar";
+    return nullptr;
+#endif
+}
+
+static const char *gIsa = "scalar";
+static const RowFn gRow = pickRow(&gIsa);
+
+static bool convert(const uint8_t *src, size_t srcStride, int width, int rows, uint8_t *dst,
+                    size_t dstStride, Yuv422Layout layout, RowFn row, LumaStats *stats) {
+    if (!src || !dst || width <= 0 || rows <= 0 || (width & 1)) return false;
+    if (srcStride < (size_t) width * 2 || dstStride < (size_t) width * 4) return false;
+
+    const PairIdx ix = pairIdx(layout);
+    const int pairs = width / 2;
+    for (int y = 0; y < rows; y++) {
+        const uint8_t *s = src + (size_t) y * srcStride;
+        uint8_t *d = dst + (size_t) y * dstStride;
+        const int done = row ? row(s, d, pairs, ix) : 0;
+        rowScalar(s, d, done, pairs, ix);
+        if (stats && y % stats->rowStep == 0) {
+            meterRow(s, pairs, y * LumaStats::kZonesY / rows, ix, *stats);
+        }
+    }
+    return true;
+}
+
+bool yuv422ToRgba(const uint8_t *src, size_t srcStride, int width, int rows, uint8_t *dst,
+                  size_t dstStride, Yuv422Layout layout, LumaStats *stats) {
+    if (stats && stats->rowStep < 1) stats->rowStep = 1;
+    return convert(src, srcStride, width, rows, dst, dstStride, layout, gRow, stats);
+}
+
+bool yuv422ToRgbaScalar(const uint8_t *src, size_t srcStride, int width, int rows,
+                        uint8_t *dst, size_t dstStride, Yuv422Layout layout) {
+    return convert(src, srcStride, width, rows, dst, dstStride, layout, nullptr, nullptr);
+}
+
+const char *yuvConvertIsa() { return gIsa; }
+
+// ---- YUV_420_888 -> RGBA ----
+
+// One output row from its luma row and the chroma row it shares with its neighbour.
+// Semi-planar kernels take the interleaved plane and whether V comes first.
+using PlanarRowFn = int (*)(const uint8_t *y, const uint8_t *u, const uint8_t *v, uint8_t *d,
+                            int pairs);
+using SemiRowFn = int (*)(const uint8_t *y, const uint8_t *uv, uint8_t *d, int pairs, bool vu);
+
+static void row420Scalar(const uint8_t *y, const uint8_t *u, const uint8_t *v, int ps,
+                         uint8_t *d, int from, int pairs) {
+    for (int p = from; p < pairs; p++) {
+        pairScalar(y[2 * p], y[2 * p + 1], u[(size_t) p * ps], v[(size_t) p * ps], d + 8 * p);
+    }
+}
+
+#if YUV_HAVE_NEON
+
+static int planarRowNeon(const uint8_t *y, const uint8_t *u, const uint8_t *v, uint8_t *d,
+                         int pairs) {
+    int p = 0;
+    for (; p + 8 <= pairs; p += 8) {
+        const uint8x8x2_t yy = vld2_u8(y + 2 * p);
+        storePairsNeon(yy.val[0], yy.val[1], vld1_u8(u + p), vld1_u8(v + p), d + 8 * p);
+    }
+    return p;
+}
+
+static int semiRowNeon(const uint8_t *y, const uint8_t *uv, uint8_t *d, int pairs, bool vu) {
+    const int ui = vu ? 1 : 0;
+    int p = 0;
+    for (; p + 8 <= pairs; p += 8) {
+        const uint8x8x2_t yy = vld2_u8(y + 2 * p);
+        const uint8x8x2_t cc = vld2_u8(uv + 2 * p);
+        storePairsNeon(yy.val[0], yy.val[1], cc.val[ui], cc.val[1 - ui], d + 8 * p);
+    }
+    return p;
+}
+
+#endif
+
+#if YUV_HAVE_X86
+
+// Even / odd bytes of 8 into dwords; the 256-bit loads repeat them per lane from 16.
+alignas(16) static const int8_t kEven8[16] = {0, -1, -1, -1, 2, -1, -1, -1,
+                                              4, -1, -1, -1, 6, -1, -1, -1};
+alignas(16) static const int8_t kOdd8[16] = {1, -1, -1, -1, 3, -1, -1, -1,
+                                             5, -1, -1, -1, 7, -1, -1, -1};
+alignas(32) static const int8_t kEven16[32] = {0, -1, -1, -1, 2, -1, -1, -1,
+                                               4, -1, -1, -1, 6, -1, -1, -1,
+                                               8, -1, -1, -1, 10, -1, -1, -1,
+                                               12, -1, -1, -1, 14, -1, -1, -1};
+alignas(32) static const int8_t kOdd16[32] = {1, -1, -1, -1, 3, -1, -1, -1,
+                                              5, -1, -1, -1, 7, -1, -1, -1,
+                                              9, -1, -1, -1, 11, -1, -1, -1,
+                                              13, -1, -1, -1, 15, -1, -1, -1};
+
+static inline int32_t load32(const uint8_t *p) {
+    int32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+// 4 pairs per step.
+__attribute__((target("sse4.1")))
+static int planarRowSse41(const uint8_t *y, const uint8_t *u, const uint8_t *v, uint8_t *d,
+                          int pairs) {
+    const __m128i me = _mm_load_si128((const __m128i *) kEven8);
+    const __m128i mo = _mm_load_si128((const __m128i *) kOdd8);
+    int p = 0;
+    for (; p + 4 <= pairs; p += 4) {
+        const __m128i yy = _mm_loadl_epi64((const __m128i *) (y + 2 * p));
+        storePairsSse41(_mm_shuffle_epi8(yy, me), _mm_shuffle_epi8(yy, mo),
+                        _mm_cvtepu8_epi32(_mm_cvtsi32_si128(load32(u + p))),
+                        _mm_cvtepu8_epi32(_mm_cvtsi32_si128(load32(v + p))), d + 8 * p);
+    }
+    return p;
+}
+
+__attribute__((target("sse4.1")))
+static int semiRowSse41(const uint8_t *y, const uint8_t *uv, uint8_t *d, int pairs, bool vu) {
+    const __m128i me = _mm_load_si128((const __m128i *) kEven8);
+    const __m128i mo = _mm_load_si128((const __m128i *) kOdd8);
+    const __m128i mu = vu ? mo : me, mv = vu ? me : mo;
+    int p = 0;
+    for (; p + 4 <= pairs; p += 4) {
+        const __m128i yy = _mm_loadl_epi64((const __m128i *) (y + 2 * p));
+        const __m128i cc = _mm_loadl_epi64((const __m128i *) (uv + 2 * p));
+        storePairsSse41(_mm_shuffle_epi8(yy, me), _mm_shuffle_epi8(yy, mo),
+                        _mm_shuffle_epi8(cc, mu), _mm_shuffle_epi8(cc, mv), d + 8 * p);
+    }
+    return p;
+}
+
+// 8 pairs per step.
+__attribute__((target("avx2")))
+static int planarRowAvx2(const uint8_t *y, const uint8_t *u, const uint8_t *v, uint8_t *d,
+                         int pairs) {
+    const __m256i me = _mm256_load_si256((const __m256i *) kEven16);
+    const __m256i mo = _mm256_load_si256((const __m256i *) kOdd16);
+    int p = 0;
+    for (; p + 8 <= pairs; p += 8) {
+        const __m256i yy = _mm256_broadcastsi128_si256(
+                _mm_loadu_si128((const __m128i *) (y + 2 * p)));
+        storePairsAvx2(_mm256_shuffle_epi8(yy, me), _mm256_shuffle_epi8(yy, mo),
+                       _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *) (u + p))),
+                       _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *) (v + p))),
+                       d + 8 * p);
+    }
+    return p;
+}
+
+__attribute__((target("avx2")))
+static int semiRowAvx2(const uint8_t *y, const uint8_t *uv, uint8_t *d, int pairs, bool vu) {
+    const __m256i me = _mm256_load_si256((const __m256i *) kEven16);
+    const __m256i mo = _mm256_load_si256((const __m256i *) kOdd16);
+    const __m256i mu = vu ? mo : me, mv = vu ? me : mo;
+    int p = 0;
+    for (; p + 8 <= pairs; p += 8) {
+        const __m256i yy = _mm256_broadcastsi128_si256(
+                _mm_loadu_si128((const __m128i *) (y + 2 * p)));
+        const __m256i cc = _mm256_broadcastsi128_si256(
+                _mm_loadu_si128((const __m128i *) (uv + 2 * p)));
+        storePairsAvx2(_mm256_shuffle_epi8(yy, me), _mm256_shuffle_epi8(yy, mo),
+                       _mm256_shuffle_epi8(cc, mu), _mm256_shuffle_epi8(cc, mv), d + 8 * p);
+    }
+    return p;
+}
+
+#endif
+
+struct Yuv420Fns {
+    PlanarRowFn planar = nullptr;
+    SemiRowFn semi = nullptr;
+};
+
+// Same ISA as gRow.
+static Yuv420Fns pickYuv420() {
+    Yuv420Fns f;
+#if YUV_HAVE_NEON
+    f = {planarRowNeon, semiRowNeon};
+#elif YUV_HAVE_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) f = {planarRowAvx2, semiRowAvx2};
+    else if (__builtin_cpu_supports("sse4.1")) f = {planarRowSse41, semiRowSse41};
+#endif
+    return f;
+}
+
+static const Yuv420Fns gYuv420 = pickYuv420();
+
+Yuv420Layout yuv420Layout(const Yuv420Source &s) {
+    if (s.uvPixelStride == 1) return Yuv420Layout::I420;
+    if (s.uvPixelStride == 2 && s.uStride == s.vStride) {
+        if (s.v == s.u + 1) return Yuv420Layout::NV12;
+        if (s.u == s.v + 1) return Yuv420Layout::NV21;
+    }
+    return Yuv420Layout::Other;
+}
+
+const char *yuv420LayoutName(Yuv420Layout layout) {
+    switch (layout) {
+        case Yuv420Layout::I420:
+            return "I420";
+        case Yuv420Layout::NV12:
+            return "NV12";
+        case Yuv420Layout::NV21:
+            return "NV21";
+        case Yuv420Layout::Other:
+        default:
+            return "other";
+    }
+}
+
+static bool valid420(const Yuv420Source &s, int width, int height) {
+    if (!s.y || !s.u || !s.v || width <= 0 || height <= 0 || (width & 1)) return false;
+    const size_t chromaRow = (size_t) (width / 2 - 1) * (size_t) s.uvPixelStride + 1;
+    return s.uvPixelStride >= 1 && s.yStride >= (size_t) width && s.uStride >= chromaRow &&
+           s.vStride >= chromaRow;
+}
+
+bool yuv420Valid(const Yuv420Source &src, int width, int height) {
+    return valid420(src, width, height);
+}
+
+// Pixels [x0, x0 + width) of row r; x0 and width even.
+static void convertRow420(const Yuv420Source &s, Yuv420Layout layout, const Yuv420Fns &fns,
+                          int r, int x0, int width, uint8_t *d) {
+    const int pairs = width / 2;
+    const size_t c0 = (size_t) (x0 / 2) * (size_t) s.uvPixelStride;
+    const uint8_t *y = s.y + (size_t) r * s.yStride + x0;
+    const uint8_t *u = s.u + (size_t) (r / 2) * s.uStride + c0;
+    const uint8_t *v = s.v + (size_t) (r / 2) * s.vStride + c0;
+    int done = 0;
+    switch (layout) {
+        case Yuv420Layout::I420:
+            if (fns.planar) done = fns.planar(y, u, v, d, pairs);
+            break;
+        case Yuv420Layout::NV12:
+            if (fns.semi) done = fns.semi(y, u, d, pairs, false);
+            break;
+        case Yuv420Layout::NV21:
+            if (fns.semi) done = fns.semi(y, v, d, pairs, true);
+            break;
+        case Yuv420Layout::Other:
+            break;
+    }
+    row420Scalar(y, u, v, s.uvPixelStride, d, done, pairs);
+}
+
+static bool convert420(const Yuv420Source &s, int width, int height, uint8_t *dst,
+                       size_t dstStride, const Yuv420Fns &fns) {
+    if (!valid420(s, width, height) || !dst || dstStride < (size_t) width * 4) return false;
+
+    const Yuv420Layout layout = yuv420Layout(s);
+    for (int r = 0; r < height; r++) {
+        convertRow420(s, layout, fns, r, 0, width, dst + (size_t) r * dstStride);
+    }
+    return true;
+}
+
+// 90 / 270: source tiles of kTileW x kTileH pixels are converted row by row into an
+// L1-resident block (8 KB), then written out rotated: each tile column becomes a run of
+// kTileH pixels in a destination row, so both sides are touched at least 64 bytes at a
+// time instead of one pixel per destination row. The tile is wide so that each row
+// kernel call covers several vector iterations. 180 needs no tiles: a source row,
+// converted, is the destination row mirrored, so it goes through one tile row.
+static constexpr int kTileW = 64;
+static constexpr int kTileH = 32;
+
+static bool convert420Rotated(const Yuv420Source &s, int width, int height, int rotation,
+                              uint8_t *dst, size_t dstStride, const Yuv420Fns &fns) {
+    rotation = ((rotation % 360) + 360) % 360;
+    if (rotation % 90 != 0) return false;
+    if (rotation == 0) return convert420(s, width, height, dst, dstStride, fns);
+    const int outW = rotation == 180 ? width : height;
+    if (!valid420(s, width, height) || !dst || dstStride < (size_t) outW * 4) return false;
+
+    const Yuv420Layout layout = yuv420Layout(s);
+    uint32_t tile[kTileH][kTileW];
+    if (rotation == 180) {
+        // (r, c) -> (h - 1 - r, w - 1 - c), kTileW pixels at a time
+        for (int r = 0; r < height; r++) {
+            uint8_t *o = dst + (size_t) (height - 1 - r) * dstStride;
+            for (int tx = 0; tx < width; tx += kTileW) {
+                const int tw = std::min(kTileW, width - tx);
+                convertRow420(s, layout, fns, r, tx, tw, (uint8_t *) tile[0]);
+                uint8_t *run = o + (size_t) (width - tx - tw) * 4;
+                for (int k = 0; k < tw; k++) std::memcpy(run + 4 * k, &tile[0][tw - 1 - k], 4);
+            }
+        }
+        return true;
+    }
+
+    for (int ty = 0; ty < height; ty += kTileH) {
+        const int th = std::min(kTileH, height - ty);
+        for (int tx = 0; tx < width; tx += kTileW) {
+            const int tw = std::min(kTileW, width - tx);   // even: width and tx are
+            for (int i = 0; i < th; i++) {
+                convertRow420(s, layout, fns, ty + i, tx, tw, (uint8_t *) tile[i]);
+            }
+            if (rotation == 90) {
+                // Clockwise: (r, c) -> (c, h - 1 - r)
+                for (int c = 0; c < tw; c++) {
+                    uint8_t *o = dst + (size_t) (tx + c) * dstStride +
+                                 (size_t) (height - ty - th) * 4;
+                    for (int k = 0; k < th; k++) std::memcpy(o + 4 * k, &tile[th - 1 - k][c], 4);
+                }
+            } else {
+                // 270 clockwise: (r, c) -> (w - 1 - c, r)
+                for (int c = 0; c < tw; c++) {
+                    uint8_t *o = dst + (size_t) (width - 1 - tx - c) * dstStride + (size_t) ty * 4;
+                    for (int k = 0; k < th; k++) std::memcpy(o + 4 * k, &tile[k][c], 4);
+                }
+            }
+        }
+    }
+    return true;
+}
+
+bool yuv420ToRgba(const Yuv420Source &src, int width, int height, uint8_t *dst,
+                  size_t dstStride) {
+    return convert420(src, width, height, dst, dstStride, gYuv420);
+}
+
+bool yuv420ToRgbaScalar(const Yuv420Source &src, int width, int height, uint8_t *dst,
+                        size_t dstStride) {
+    return convert420(src, width, height, dst, dstStride, Yuv420Fns{});
+}
+
+bool yuv420ToRgbaRotated(const Yuv420Source &src, int width, int height, int rotation,
+                         uint8_t *dst, size_t dstStride) {
+    return convert420Rotated(src, width, height, rotation, dst, dstStride, gYuv420);
+}
+
+bool yuv420ToRgbaRotatedScalar(const Yuv420Source &src, int width, int height, int rotation,
+                               uint8_t *dst, size_t dstStride) {
+    return convert420Rotated(src, width, height, rotation, dst, dstStride, Yuv420Fns{});
+}
+
+// ---- 4:2:0 repack (YUV passthrough) ----
+
+// One output row pair: luma of s0 / s1 into y0 / y1, their averaged chroma into u / v.
+// Returns the pairs done; the scalar loop finishes the row.
+using RepackRowFn = int (*)(const uint8_t *s0, const uint8_t *s1, uint8_t *y0, uint8_t *y1,
+                            uint8_t *u, uint8_t *v, int pairs, const PairIdx &ix);
+
+// One chroma row: interleaved V/U into two planes.
+using SplitRowFn = int (*)(const uint8_t *vu, uint8_t *u, uint8_t *v, int n);
+
+static void repackRowScalar(const uint8_t *s0, const uint8_t *s1, uint8_t *y0, uint8_t *y1,
+                            uint8_t *u, uint8_t *v, int from, int pairs, const PairIdx &ix) {
+    for (int p = from; p < pairs; p++) {
+        const uint8_t *a = s0 + 4 * p;
+        const uint8_t *b = s1 + 4 * p;
+        y0[2 * p] = a[ix.y0];
+        y0[2 * p + 1] = a[ix.y1];
+        y1[2 * p] = b[ix.y0];
+        y1[2 * p + 1] = b[ix.y1];
+        u[p] = (uint8_t) ((a[ix.u] + b[ix.u] + 1) >> 1);
+        v[p] = (uint8_t) ((a[ix.v] + b[ix.v] + 1) >> 1);
+    }
+}
+
+static void splitRowScalar(const uint8_t *vu, uint8_t *u, uint8_t *v, int from, int n) {
+    for (int c = from; c < n; c++) {
+        v[c] = vu[2 * c];
+        u[c] = vu[2 * c + 1];
+    }
+}
+
+#if YUV_HAVE_NEON
+
+// 16 pairs per step; vrhadd rounds the same way as the scalar mean.
+static int repackRowNeon(const uint8_t *s0, const uint8_t *s1, uint8_t *y0, uint8_t *y1,
+                         uint8_t *u, uint8_t *v, int pairs, const PairIdx &ix) {
+    int p = 0;
+    for (; p + 16 <= pairs; p += 16) {
+        const uint8x16x4_t a = vld4q_u8(s0 + 4 * p);
+        const uint8x16x4_t b = vld4q_u8(s1 + 4 * p);
+        uint8x16x2_t ya, yb;
+        ya.val[0] = a.val[ix.y0];
+        ya.val[1] = a.val[ix.y1];
+        yb.val[0] = b.val[ix.y0];
+        yb.val[1] = b.val[ix.y1];
+        vst2q_u8(y0 + 2 * p, ya);
+        vst2q_u8(y1 + 2 * p, yb);
+        vst1q_u8(u + p, vrhaddq_u8(a.val[ix.u], b.val[ix.u]));
+        vst1q_u8(v + p, vrhaddq_u8(a.val[ix.v], b.val[ix.v]));
+    }
+    return p;
+}
+
+static int splitRowNeon(const uint8_t *vu, uint8_t *u, uint8_t *v, int n) {
+    int c = 0;
+    for (; c + 16 <= n; c += 16) {
+        const uint8x16x2_t q = vld2q_u8(vu + 2 * c);
+        vst1q_u8(v + c, q.val[0]);
+        vst1q_u8(u + c, q.val[1]);
+    }
+    return c;
+}
+
+#endif
+
+#if YUV_HAVE_X86
+
+// pshufb mask for 4 pairs: Y0..Y7 in bytes 0-7, U0..U3 in 8-11, V0..V3 in 12-15.
+static void repackMask(const PairIdx &ix, int8_t m[16]) {
+    for (int k = 0; k < 8; k++) m[k] = (int8_t) (4 * (k / 2) + ((k & 1) ? ix.y1 : ix.y0));
+    for (int j = 0; j < 4; j++) {
+        m[8 + j] = (int8_t) (4 * j + ix.u);
+        m[12 + j] = (int8_t) (4 * j + ix.v);
+    }
+}
+
+// 16 luma and 8 U / 8 V from 8 pairs of one row.
+__attribute__((target("sse4.1")))
+static inline void splitPairsSse41(const uint8_t *s, __m128i m, __m128i cm, __m128i &y,
+                                   __m128i &c) {
+    const __m128i a = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) s), m);
+    const __m128i b = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (s + 16)), m);
+    y = _mm_unpacklo_epi64(a, b);
+    c = _mm_shuffle_epi8(_mm_unpackhi_epi64(a, b), cm);   // U0-7 | V0-7
+}
+
+// 8 pairs per step; pavgb rounds the same way as the scalar mean.
+__attribute__((target("sse4.1")))
+static int repackRowSse41(const uint8_t *s0, const uint8_t *s1, uint8_t *y0, uint8_t *y1,
+                          uint8_t *u, uint8_t *v, int pairs, const PairIdx &ix) {
+    int8_t mk[16];
+    repackMask(ix, mk);
+    const __m128i m = _mm_loadu_si128((const __m128i *) mk);
+    const __m128i cm = _mm_setr_epi8(0, 1, 2, 3, 8, 9, 10, 11, 4, 5, 6, 7, 12, 13, 14, 15);
+
+    int p = 0;
+    for (; p + 8 <= pairs; p += 8) {
+        __m128i ya, ca, yb, cb;
+        splitPairsSse41(s0 + 4 * p, m, cm, ya, ca);
+        splitPairsSse41(s1 + 4 * p, m, cm, yb, cb);
+        _mm_storeu_si128((__m128i *) (y0 + 2 * p), ya);
+        _mm_storeu_si128((__m128i *) (y1 + 2 * p), yb);
+        const __m128i c = _mm_avg_epu8(ca, cb);
+        _mm_storel_epi64((__m128i *) (u + p), c);
+        _mm_storel_epi64((__m128i *) (v + p), _mm_srli_si128(c, 8));
+    }
+    return p;
+}
+
+__attribute__((target("sse4.1")))
+static int splitRowSse41(const uint8_t *vu, uint8_t *u, uint8_t *v, int n) {
+    const __m128i m = _mm_setr_epi8(0, 2, 4, 6, 8, 10, 12, 14, 1, 3, 5, 7, 9, 11, 13, 15);
+    int c = 0;
+    for (; c + 8 <= n; c += 8) {
+        const __m128i q = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (vu + 2 * c)), m);
+        _mm_storel_epi64((__m128i *) (v + c), q);
+        _mm_storel_epi64((__m128i *) (u + c), _mm_srli_si128(q, 8));
+    }
+    return c;
+}
+
+#endif
+
+struct RepackFns {
+    RepackRowFn repack = nullptr;
+    SplitRowFn split = nullptr;
+    const char *isa = "scalar";
+};
+
+static RepackFns pickRepack() {
+    RepackFns f;
+#if YUV_HAVE_NEON
+    f = {repackRowNeon, splitRowNeon, "neon"};
+#elif YUV_HAVE_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse4.1")) f = {repackRowSse41, splitRowSse41, "sse4.1"};
+#endif
+    return f;
+}
+
+static const RepackFns gRepack = pickRepack();
+
+static bool validPlanes(const Yuv420Planes &d, int width) {
+    return d.y && d.u && d.v && d.yStride >= (size_t) width &&
+           d.uvStride >= (size_t) ((width + 1) / 2);
+}
+
+static bool repack422(const uint8_t *src, size_t srcStride, int width, int rows,
+                      const Yuv420Planes &dst, Yuv422Layout layout, RepackRowFn row,
+                      LumaStats *stats) {
+    if (!src || width <= 0 || rows <= 0 || (width & 1) || !validPlanes(dst, width)) return false;
+    if (srcStride < (size_t) width * 2) return false;
+
+    const PairIdx ix = pairIdx(layout);
+    const int pairs = width / 2;
+    for (int y = 0; y < rows; y += 2) {
+        // An odd last row pairs with itself: its luma is written twice, chroma as is.
+        const int y1 = std::min(y + 1, rows - 1);
+        const uint8_t *s0 = src + (size_t) y * srcStride;
+        const uint8_t *s1 = src + (size_t) y1 * srcStride;
+        uint8_t *d0 = dst.y + (size_t) y * dst.yStride;
+        uint8_t *d1 = dst.y + (size_t) y1 * dst.yStride;
+        uint8_t *u = dst.u + (size_t) (y / 2) * dst.uvStride;
+        uint8_t *v = dst.v + (size_t) (y / 2) * dst.uvStride;
+        const int done = row ? row(s0, s1, d0, d1, u, v, pairs, ix) : 0;
+        repackRowScalar(s0, s1, d0, d1, u, v, done, pairs, ix);
+        if (stats) {
+            if (y % stats->rowStep == 0)
+                meterRow(s0, pairs, y * LumaStats::kZonesY / rows, ix, *stats);
+            if (y1 != y && y1 % stats->rowStep == 0)
+                meterRow(s1, pairs, y1 * LumaStats::kZonesY / rows, ix, *stats);
+        }
+    }
+    return true;
+}
+
+static bool splitNv21(const uint8_t *y, size_t yStride, const uint8_t *vu, size_t vuStride,
+                      int width, int height, const Yuv420Planes &dst, SplitRowFn row) {
+    if (!y || !vu || width <= 0 || height <= 0 || (width & 1) || (height & 1)) return false;
+    if (yStride < (size_t) width || vuStride < (size_t) width || !validPlanes(dst, width))
+        return false;
+
+    for (int r = 0; r < height; r++) {
+        std::memcpy(dst.y + (size_t) r * dst.yStride, y + (size_t) r * yStride, (size_t) width);
+    }
+    const int n = width / 2;
+    for (int r = 0; r < height / 2; r++) {
+        const uint8_t *s = vu + (size_t) r * vuStride;
+        uint8_t *u = dst.u + (size_t) r * dst.uvStride;
+        uint8_t *v = dst.v + (size_t) r * dst.uvStride;
+        const int done = row ? row(s, u, v, n) : 0;
+        splitRowScalar(s, u, v, done, n);
+    }
+    return true;
+}
+
+bool yuv422ToYuv420(const uint8_t *src, size_t srcStride, int width, int rows,
+                    const Yuv420Planes &dst, Yuv422Layout layout, LumaStats *stats) {
+    if (stats && stats->rowStep < 1) stats->rowStep = 1;
+    return repack422(src, srcStride, width, rows, dst, layout, gRepack.repack, stats);
+}
+
+bool yuv422ToYuv420Scalar(const uint8_t *src, size_t srcStride, int width, int rows,
+                          const Yuv420Planes &dst, Yuv422Layout layout) {
+    return repack422(src, srcStride, width, rows, dst, layout, nullptr, nullptr);
+}
+
+bool nv21ToYuv420(const uint8_t *y, size_t yStride, const uint8_t *vu, size_t vuStride,
+                  int width, int height, const Yuv420Planes &dst) {
+    return splitNv21(y, yStride, vu, vuStride, width, height, dst, gRepack.split);
+}
+
+bool nv21ToYuv420Scalar(const uint8_t *y, size_t yStride, const uint8_t *vu, size_t vuStride,
+                        int width, int height, const Yuv420Planes &dst) {
+    return splitNv21(y, yStride, vu, vuStride, width, height, dst, nullptr);
+}
+
+const char *yuvRepackIsa() { return gRepack.isa; }
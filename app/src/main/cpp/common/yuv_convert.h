@@ -0,0 +1,125 @@
+// yuv_convert.h
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Byte order of one packed 4:2:2 pixel pair.
+enum class Yuv422Layout {
+    YUYV,   // Y0 U Y1 V
+    UYVY,   // U Y0 V Y1
+    YVYU    // Y0 V Y1 U
+};
+
+// Luma histogram and per-zone sums gathered during conversion, for exposure
+// metering. Every `rowStep`-th row is sampled (one Y per pixel pair) right after
+// it is converted, while its source bytes are still in cache.
+struct LumaStats {
+    static constexpr int kZonesX = 4;
+    static constexpr int kZonesY = 4;
+
+    int rowStep = 8;
+    uint32_t hist[256];
+    uint32_t zoneSum[kZonesY][kZonesX];
+    uint32_t zoneCount[kZonesY][kZonesX];
+    uint32_t samples;
+
+    void clear();
+};
+
+// Packed 4:2:2 -> RGBA8888 with alpha = 255, one pass, bit-exact with
+// cv::cvtColor(COLOR_YUV2RGBA_YUY2 / _UYVY / _YVYU): BT.601 limited range in
+// 20-bit fixed point. Converting only the first `rows` rows is the crop. Uses NEON
+// on ARM and SSE4.1 / AVX2 on x86 when the CPU has them. Width must be even.
+// `stats`, when given, is accumulated into (not cleared).
+bool yuv422ToRgba(const uint8_t *src, size_t srcStride, int width, int rows, uint8_t *dst,
+                  size_t dstStride, Yuv422Layout layout, LumaStats *stats = nullptr);
+
+// Same conversion without SIMD; the reference the vector paths are checked against.
+bool yuv422ToRgbaScalar(const uint8_t *src, size_t srcStride, int width, int rows,
+                        uint8_t *dst, size_t dstStride, Yuv422Layout layout);
+
+// "neon", "avx2", "sse4.1" or "scalar": the path yuv422ToRgba() takes on this CPU.
+const char *yuvConvertIsa();
+
+// One YUV_420_888 image as AImage reports it: three plane pointers, their row strides
+// and the chroma pixel stride (the same for U and V).
+struct Yuv420Source {
+    const uint8_t *y = nullptr;
+    const uint8_t *u = nullptr;
+    const uint8_t *v = nullptr;
+    size_t yStride = 0;
+    size_t uStride = 0;
+    size_t vStride = 0;
+    int uvPixelStride = 0;
+};
+
+// How the chroma planes of a Yuv420Source alias each other.
+enum class Yuv420Layout {
+    I420,   // pixel stride 1: separate U and V planes
+    NV12,   // pixel stride 2, V = U + 1: one interleaved U/V plane
+    NV21,   // pixel stride 2, U = V + 1: one interleaved V/U plane
+    Other   // anything else, read sample by sample
+};
+
+Yuv420Layout yuv420Layout(const Yuv420Source &src);
+
+// Whether the converters below accept `src` at width x height: they fail only on these
+// checks, before writing anything, so a producer can test first and lock its output
+// buffer only for a frame that will convert.
+bool yuv420Valid(const Yuv420Source &src, int width, int height);
+
+const char *yuv420LayoutName(Yuv420Layout layout);
+
+// YUV_420_888 -> RGBA8888 with alpha = 255, read in place from the planes with no
+// intermediate buffer; the matrix and rounding of yuv422ToRgba(), so bit-exact with
+// cv::cvtColor(COLOR_YUV2RGBA_NV21 / _NV12 / _I420) of the same samples. I420, NV12
+// and NV21 each have their own NEON / SSE4.1 / AVX2 row kernel (yuvConvertIsa()),
+// other layouts take the scalar loop. Width must be even; an odd last row uses the
+// chroma row above it.
+bool yuv420ToRgba(const Yuv420Source &src, int width, int height, uint8_t *dst,
+                  size_t dstStride);
+
+bool yuv420ToRgbaScalar(const Yuv420Source &src, int width, int height, uint8_t *dst,
+                        size_t dstStride);
+
+// yuv420ToRgba() and a clockwise rotation by `rotation` degrees (0 / 90 / 180 / 270) in
+// one pass over cache-sized tiles. `dst` is height x width for 90 / 270, width x height
+// otherwise.
+bool yuv420ToRgbaRotated(const Yuv420Source &src, int width, int height, int rotation,
+                         uint8_t *dst, size_t dstStride);
+
+bool yuv420ToRgbaRotatedScalar(const Yuv420Source &src, int width, int height, int rotation,
+                               uint8_t *dst, size_t dstStride);
+
+// Destination of the 4:2:0 repack kernels: three planes, chroma at half resolution in
+// both directions (a locked YV12 window buffer, or an I420 / YV12 image).
+struct Yuv420Planes {
+    uint8_t *y = nullptr;
+    size_t yStride = 0;
+    uint8_t *u = nullptr;
+    uint8_t *v = nullptr;
+    size_t uvStride = 0;
+};
+
+// Packed 4:2:2 -> planar 4:2:0 with no colour conversion, for YUV window buffers the
+// compositor converts: luma is copied, each chroma sample is the rounded mean of the
+// two rows it covers (an odd last row is taken as is). Width must be even. `stats`
+// as in yuv422ToRgba().
+bool yuv422ToYuv420(const uint8_t *src, size_t srcStride, int width, int rows,
+                    const Yuv420Planes &dst, Yuv422Layout layout, LumaStats *stats = nullptr);
+
+bool yuv422ToYuv420Scalar(const uint8_t *src, size_t srcStride, int width, int rows,
+                          const Yuv420Planes &dst, Yuv422Layout layout);
+
+// NV21 (Y plane + interleaved V/U plane) -> planar 4:2:0: luma copied, chroma split.
+// Width and height must be even.
+bool nv21ToYuv420(const uint8_t *y, size_t yStride, const uint8_t *vu, size_t vuStride,
+                  int width, int height, const Yuv420Planes &dst);
+
+bool nv21ToYuv420Scalar(const uint8_t *y, size_t yStride, const uint8_t *vu, size_t vuStride,
+                        int width, int height, const Yuv420Planes &dst);
+
+// "neon", "sse4.1" or "scalar": the path the repack kernels take on this CPU.
+const char *yuvRepackIsa();
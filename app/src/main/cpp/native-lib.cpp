@@ -1,13 +1,17 @@
 #include <jni.h>
 #include <string>
 
-#include <android/bitmap.h>
+#include <android/native_window_jni.h>
 
 #include <opencv2/core.hpp>
 #include <opencv2/imgproc.hpp>
 
 #include "back/back_camera.h"
+#include "common/compositor_window.h"
+#include "common/dual_compositor.h"
+#include "common/seam_blend.h"
 #include "uvc/uvc_camera.h"
+#include "uvc/mjpeg_decoder.h"
 
 extern "C" JNIEXPORT jboolean JNICALL
 Java_com_uzera_camcpp_BackAction_nativeStartBackPreview(JNIEnv *env, jobject, jobject surface,
@@ -52,45 +56,310 @@ Java_com_uzera_camcpp_BackAction_nativeGetBackChosenCameraId(JNIEnv *env, jobjec
     return env->NewStringUTF(id.c_str());
 }
 
+extern "C" JNIEXPORT jint JNICALL
+Java_com_uzera_camcpp_BackAction_nativeGetBackPresentJitterUs(JNIEnv *, jobject) {
+    return (jint) backcam::presentJitterUs();
+}
+
+extern "C" JNIEXPORT jlong JNICALL
+Java_com_uzera_camcpp_BackAction_nativeGetBackPresentLateDrops(JNIEnv *, jobject) {
+    return (jlong) backcam::presentLateDrops();
+}
+
+extern "C" JNIEXPORT jint JNICALL
+Java_com_uzera_camcpp_BackAction_nativeGetBackPresentLatencyUs(JNIEnv *, jobject) {
+    return (jint) backcam::presentLatencyUs();
+}
+
+extern "C" JNIEXPORT jint JNICALL
+Java_com_uzera_camcpp_BackAction_nativeGetBackFrameIntervalJitterUs(JNIEnv *, jobject) {
+    return (jint) backcam::frameIntervalJitterUs();
+}
+
+extern "C" JNIEXPORT jlong JNICALL
+Java_com_uzera_camcpp_BackAction_nativeGetBackOverwrittenFrames(JNIEnv *, jobject) {
+    return (jlong) backcam::overwrittenFrames();
+}
+
+extern "C" JNIEXPORT jlong JNICALL
+Java_com_uzera_camcpp_BackAction_nativeGetBackLostFrames(JNIEnv *, jobject) {
+    return (jlong) backcam::lostFrames();
+}
+
+extern "C" JNIEXPORT jint JNICALL
+Java_com_uzera_camcpp_BackAction_nativeGetBackAcquireLatencyUs(JNIEnv *, jobject) {
+    return (jint) backcam::acquireLatencyUs();
+}
+
+extern "C" JNIEXPORT jint JNICALL
+Java_com_uzera_camcpp_BackAction_nativeGetBackConvertLatencyUs(JNIEnv *, jobject) {
+    return (jint) backcam::convertLatencyUs();
+}
+
+extern "C" JNIEXPORT jint JNICALL
+Java_com_uzera_camcpp_BackAction_nativeGetBackPostLatencyUs(JNIEnv *, jobject) {
+    return (jint) backcam::postLatencyUs();
+}
+
+extern "C" JNIEXPORT jint JNICALL
+Java_com_uzera_camcpp_BackAction_nativeGetBackFrameDurationUs(JNIEnv *, jobject) {
+    return (jint) backcam::frameDurationUs();
+}
+
+extern "C" JNIEXPORT jint JNICALL
+Java_com_uzera_camcpp_BackAction_nativeGetBackExposureUs(JNIEnv *, jobject) {
+    return (jint) backcam::exposureUs();
+}
+
+extern "C" JNIEXPORT jint JNICALL
+Java_com_uzera_camcpp_BackAction_nativeGetBackRollingShutterSkewUs(JNIEnv *, jobject) {
+    return (jint) backcam::rollingShutterSkewUs();
+}
+
+extern "C" JNIEXPORT jfloatArray JNICALL
+Java_com_uzera_camcpp_BackAction_nativeSetBackVisibleRegion(JNIEnv *env, jobject, jfloat left,
+                                                             jfloat top, jfloat right,
+                                                             jfloat bottom) {
+    float shown[4];
+    backcam::setVisibleRegion(left, top, right, bottom, shown);
+    jfloatArray out = env->NewFloatArray(4);
+    if (out) env->SetFloatArrayRegion(out, 0, 4, shown);
+    return out;
+}
+
+// The stacked panel in one window (MainActivity NATIVE_COMPOSITOR); the cameras render
+// into its layers, so it is never destroyed.
+static DualCompositor &panelCompositor() {
+    static DualCompositor *comp = new DualCompositor();
+    return *comp;
+}
+
+static CompositorLoop &panelLoop() {
+    static CompositorLoop *loop = new CompositorLoop(panelCompositor());
+    return *loop;
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_uzera_camcpp_BackAction_nativeSetBackComposited(JNIEnv *, jobject, jboolean on) {
+    backcam::setComposeLayer(on ? &panelCompositor().top() : nullptr);
+}
+
+// UvcAction handles are UvcCamera pointers from nativeCreateExtCamera; 0 addresses the
+// process-wide default instance.
+static uvc::UvcCamera &extCam(jlong handle) {
+    static uvc::UvcCamera *def = new uvc::UvcCamera();   // never destroyed
+    return handle ? *reinterpret_cast<uvc::UvcCamera *>(handle) : *def;
+}
+
+extern "C" JNIEXPORT jlong JNICALL
+Java_com_uzera_camcpp_UvcAction_nativeCreateExtCamera(JNIEnv *, jobject) {
+    return (jlong) new uvc::UvcCamera();
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_uzera_camcpp_UvcAction_nativeDestroyExtCamera(JNIEnv *, jobject, jlong handle) {
+    delete reinterpret_cast<uvc::UvcCamera *>(handle);   // stops it first
+}
 
 extern "C" JNIEXPORT jboolean JNICALL
-Java_com_uzera_camcpp_UvcAction_nativeStartExternalPreview(JNIEnv *env, jobject, jobject surface,
-                                                              jint desiredFps) {
-    return uvc::start(env, surface, (int) desiredFps) ? JNI_TRUE : JNI_FALSE;
+Java_com_uzera_camcpp_UvcAction_nativeStartExternalPreview(JNIEnv *env, jobject, jlong handle,
+                                                              jobject surface, jint desiredFps) {
+    return extCam(handle).start(env, surface, (int) desiredFps) ? JNI_TRUE : JNI_FALSE;
+}
+
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_uzera_camcpp_UvcAction_nativeStartExternalPreviewAsync(JNIEnv *env, jobject,
+                                                                   jlong handle, jobject surface,
+                                                                   jint desiredFps) {
+    return extCam(handle).startAsync(env, surface, (int) desiredFps) ? JNI_TRUE : JNI_FALSE;
+}
+
+extern "C" JNIEXPORT jint JNICALL
+Java_com_uzera_camcpp_UvcAction_nativeGetExtStartState(JNIEnv *, jobject, jlong handle) {
+    return (jint) extCam(handle).startState();
 }
 
 extern "C" JNIEXPORT void JNICALL
-Java_com_uzera_camcpp_UvcAction_nativeStopExternalPreview(JNIEnv *, jobject) {
-    uvc::stop();
+Java_com_uzera_camcpp_UvcAction_nativeStopExternalPreview(JNIEnv *, jobject, jlong handle) {
+    extCam(handle).stop();
 }
 
 extern "C" JNIEXPORT jlong JNICALL
-Java_com_uzera_camcpp_UvcAction_nativeGetExtLastSensorTimestampNs(JNIEnv *, jobject) {
-    return (jlong) uvc::lastFrameTimestampNs();
+Java_com_uzera_camcpp_UvcAction_nativeGetExtLastSensorTimestampNs(JNIEnv *, jobject, jlong handle) {
+    return (jlong) extCam(handle).lastFrameTimestampNs();
 }
 
 extern "C" JNIEXPORT jint JNICALL
-Java_com_uzera_camcpp_UvcAction_nativeGetExtEstimatedFpsX100(JNIEnv *, jobject) {
-    return (jint) uvc::estimatedFpsX100();
+Java_com_uzera_camcpp_UvcAction_nativeGetExtEstimatedFpsX100(JNIEnv *, jobject, jlong handle) {
+    return (jint) extCam(handle).estimatedFpsX100();
 }
 
 extern "C" JNIEXPORT jint JNICALL
-Java_com_uzera_camcpp_MainActivity_nativeGetExtChosenFps(JNIEnv *, jobject) {
-    return (jint) uvc::chosenFps();
+Java_com_uzera_camcpp_MainActivity_nativeGetExtChosenFps(JNIEnv *, jobject, jlong handle) {
+    return (jint) extCam(handle).chosenFps();
+}
+
+extern "C" JNIEXPORT jint JNICALL
+Java_com_uzera_camcpp_UvcAction_nativeGetExtBuffersInFlight(JNIEnv *, jobject, jlong handle) {
+    return (jint) extCam(handle).buffersInFlight();
 }
 
 extern "C" JNIEXPORT jstring JNICALL
-Java_com_uzera_camcpp_UvcAction_nativeGetExtLastError(JNIEnv *env, jobject) {
-    std::string s = uvc::lastError();
+Java_com_uzera_camcpp_UvcAction_nativeGetExtMemoryMode(JNIEnv *env, jobject, jlong handle) {
+    std::string s = extCam(handle).memoryMode();
     return env->NewStringUTF(s.c_str());
 }
 
+extern "C" JNIEXPORT jlong JNICALL
+Java_com_uzera_camcpp_UvcAction_nativeGetExtDroppedFrames(JNIEnv *, jobject, jlong handle) {
+    return (jlong) extCam(handle).droppedFrames();
+}
+
+extern "C" JNIEXPORT jlong JNICALL
+Java_com_uzera_camcpp_UvcAction_nativeGetExtRejectedFrames(JNIEnv *, jobject, jlong handle) {
+    return (jlong) extCam(handle).rejectedFrames();
+}
+
+extern "C" JNIEXPORT jlong JNICALL
+Java_com_uzera_camcpp_UvcAction_nativeGetExtSkippedFrames(JNIEnv *, jobject, jlong handle) {
+    return (jlong) extCam(handle).skippedFrames();
+}
+
+extern "C" JNIEXPORT jint JNICALL
+Java_com_uzera_camcpp_UvcAction_nativeGetExtDequeueLatencyUs(JNIEnv *, jobject, jlong handle) {
+    return (jint) extCam(handle).dequeueLatencyUs();
+}
+
+extern "C" JNIEXPORT jint JNICALL
+Java_com_uzera_camcpp_UvcAction_nativeGetExtMjpegDecodeUs(JNIEnv *, jobject, jlong handle) {
+    return (jint) extCam(handle).mjpegDecodeUs();
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_uzera_camcpp_UvcAction_nativeSetExtMjpegDecodeWorkers(JNIEnv *, jobject,
+                                                               jlong handle, jint n) {
+    extCam(handle).setMjpegDecodeWorkers((int) n);
+}
+
+extern "C" JNIEXPORT jint JNICALL
+Java_com_uzera_camcpp_UvcAction_nativeGetExtMjpegDecodeWorkers(JNIEnv *, jobject, jlong handle) {
+    return (jint) extCam(handle).mjpegDecodeWorkers();
+}
+
+extern "C" JNIEXPORT jint JNICALL
+Java_com_uzera_camcpp_UvcAction_nativeGetExtMjpegSlices(JNIEnv *, jobject, jlong handle) {
+    return (jint) extCam(handle).mjpegSlices();
+}
+
+extern "C" JNIEXPORT jint JNICALL
+Java_com_uzera_camcpp_UvcAction_nativeGetExtAeLuma(JNIEnv *, jobject, jlong handle) {
+    return (jint) extCam(handle).aeLuma();
+}
+
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_uzera_camcpp_UvcAction_nativeGetExtDeviceLost(JNIEnv *, jobject, jlong handle) {
+    return extCam(handle).deviceLost() ? JNI_TRUE : JNI_FALSE;
+}
+
+extern "C" JNIEXPORT jint JNICALL
+Java_com_uzera_camcpp_UvcAction_nativeGetExtReconnectCount(JNIEnv *, jobject, jlong handle) {
+    return (jint) extCam(handle).reconnectCount();
+}
+
+extern "C" JNIEXPORT jint JNICALL
+Java_com_uzera_camcpp_UvcAction_nativeGetExtReconnectToFirstFrameMs(JNIEnv *, jobject,
+                                                                    jlong handle) {
+    return (jint) extCam(handle).reconnectToFirstFrameMs();
+}
+
+extern "C" JNIEXPORT jint JNICALL
+Java_com_uzera_camcpp_UvcAction_nativeGetExtPresentJitterUs(JNIEnv *, jobject, jlong handle) {
+    return (jint) extCam(handle).presentJitterUs();
+}
+
+extern "C" JNIEXPORT jlong JNICALL
+Java_com_uzera_camcpp_UvcAction_nativeGetExtPresentLateDrops(JNIEnv *, jobject, jlong handle) {
+    return (jlong) extCam(handle).presentLateDrops();
+}
+
+extern "C" JNIEXPORT jint JNICALL
+Java_com_uzera_camcpp_UvcAction_nativeGetExtPresentLatencyUs(JNIEnv *, jobject, jlong handle) {
+    return (jint) extCam(handle).presentLatencyUs();
+}
+
+extern "C" JNIEXPORT jstring JNICALL
+Java_com_uzera_camcpp_UvcAction_nativeGetExtTimestampSource(JNIEnv *env, jobject, jlong handle) {
+    std::string s = extCam(handle).timestampSource();
+    return env->NewStringUTF(s.c_str());
+}
+
+extern "C" JNIEXPORT jstring JNICALL
+Java_com_uzera_camcpp_UvcAction_nativeGetExtLastError(JNIEnv *env, jobject, jlong handle) {
+    std::string s = extCam(handle).lastError();
+    return env->NewStringUTF(s.c_str());
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_uzera_camcpp_UvcAction_nativeSetExtCacheDir(JNIEnv *env, jobject,
+                                                     jlong handle, jstring dir) {
+    const char *d = env->GetStringUTFChars(dir, nullptr);
+    extCam(handle).setCacheDir(d ? d : "");
+    if (d) env->ReleaseStringUTFChars(dir, d);
+}
+
 extern "C" JNIEXPORT jstring JNICALL
-Java_com_uzera_camcpp_UvcAction_nativeGetExtChosenMode(JNIEnv *env, jobject) {
-    std::string s = uvc::chosenMode();
+Java_com_uzera_camcpp_UvcAction_nativeGetExtStartTimings(JNIEnv *env, jobject, jlong handle) {
+    std::string s = extCam(handle).startTimings();
     return env->NewStringUTF(s.c_str());
 }
 
+extern "C" JNIEXPORT void JNICALL
+Java_com_uzera_camcpp_UvcAction_nativeSetExtComposited(JNIEnv *, jobject, jlong handle,
+                                                         jboolean on) {
+    extCam(handle).setComposeLayer(on ? &panelCompositor().bottom() : nullptr);
+}
+
+extern "C" JNIEXPORT jint JNICALL
+Java_com_uzera_camcpp_UvcAction_nativeGetExtNode(JNIEnv *, jobject, jlong handle) {
+    return (jint) extCam(handle).node();
+}
+
+extern "C" JNIEXPORT jstring JNICALL
+Java_com_uzera_camcpp_UvcAction_nativeGetExtChosenMode(JNIEnv *env, jobject, jlong handle) {
+    std::string s = extCam(handle).chosenMode();
+    return env->NewStringUTF(s.c_str());
+}
+
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_uzera_camcpp_MainActivity_nativeStartCompositor(JNIEnv *env, jobject, jobject surface) {
+    ANativeWindow *win = ANativeWindow_fromSurface(env, surface);
+    if (!win) return JNI_FALSE;
+    const ComposeLayout &lay = panelCompositor().layout();
+    return panelLoop().start(std::make_unique<WindowComposeSink>(win, lay.w, lay.h))
+           ? JNI_TRUE : JNI_FALSE;
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_uzera_camcpp_MainActivity_nativeStopCompositor(JNIEnv *, jobject) {
+    panelLoop().stop();
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_uzera_camcpp_MainActivity_nativeSetCompositorSeamMode(JNIEnv *, jobject,
+                                                                jboolean multiBand) {
+    panelCompositor().setSeamMode(multiBand ? SeamMode::MultiBand : SeamMode::Linear);
+}
+
+extern "C" JNIEXPORT jlong JNICALL
+Java_com_uzera_camcpp_MainActivity_nativeGetCompositorFrames(JNIEnv *, jobject) {
+    return (jlong) panelCompositor().stats().composed;
+}
+
+extern "C" JNIEXPORT jint JNICALL
+Java_com_uzera_camcpp_MainActivity_nativeGetCompositorComposeUs(JNIEnv *, jobject) {
+    return (jint) panelCompositor().stats().composeUs;
+}
+
 extern "C" JNIEXPORT jstring JNICALL
 Java_com_uzera_camcpp_MainActivity_nativeGetOpenCvVersion(JNIEnv *env, jobject) {
     return env->NewStringUTF(CV_VERSION);
@@ -105,81 +374,11 @@ Java_com_uzera_camcpp_MainActivity_nativeOpenCvSmokeTest(JNIEnv *env, jobject) {
     return env->NewStringUTF(s.c_str());
 }
 
-static inline bool
-lockBitmapRGBA(JNIEnv *env, jobject bmp, AndroidBitmapInfo &info, void **pixels) {
-    if (!bmp) return false;
-    if (AndroidBitmap_getInfo(env, bmp, &info) != ANDROID_BITMAP_RESULT_SUCCESS) return false;
-    if (info.format != ANDROID_BITMAP_FORMAT_RGBA_8888) return false;
-    if (AndroidBitmap_lockPixels(env, bmp, pixels) != ANDROID_BITMAP_RESULT_SUCCESS) return false;
-    return true;
-}
-
-static inline void unlockBitmap(JNIEnv *env, jobject bmp) {
-    if (bmp) AndroidBitmap_unlockPixels(env, bmp);
-}
-
-extern "C" JNIEXPORT jboolean JNICALL
-Java_com_uzera_camcpp_MainActivity_nativeBlendSeam(JNIEnv *env, jobject,
-                                                   jobject backStrip,
-                                                   jobject extStrip,
-                                                   jobject outBand,
-                                                   jint overlapPx) {
-    if (overlapPx <= 4) return JNI_FALSE;
-
-    AndroidBitmapInfo bi{}, ei{}, oi{};
-    void *bp = nullptr;
-    void *ep = nullptr;
-    void *op = nullptr;
-
-    if (!lockBitmapRGBA(env, backStrip, bi, &bp)) return JNI_FALSE;
-    if (!lockBitmapRGBA(env, extStrip, ei, &ep)) {
-        unlockBitmap(env, backStrip);
-        return JNI_FALSE;
-    }
-    if (!lockBitmapRGBA(env, outBand, oi, &op)) {
-        unlockBitmap(env, extStrip);
-        unlockBitmap(env, backStrip);
-        return JNI_FALSE;
-    }
-
-    const int W = (int) bi.width;
-    const int H = (int) bi.height;
-
-    const int overlap = (int) overlapPx;
-    const int outH = overlap * 2;
-
-    bool ok = true;
-
-    if ((int) ei.width != W || (int) ei.height != H) ok = false;
-    if ((int) oi.width != W || (int) oi.height != outH) ok = false;
-    if (H != overlap) ok = false;
-
-    if (ok) {
-        cv::Mat back(H, W, CV_8UC4, bp);
-        cv::Mat ext(H, W, CV_8UC4, ep);
-        cv::Mat out(outH, W, CV_8UC4, op);
-
-        for (int y = 0; y < outH; y++) {
-            float a = 1.0f - (float) y / (float) (outH - 1);
-            int by = (y < overlap) ? y : (overlap - 1);
-            int ey = (y < overlap) ? 0 : (y - overlap);
-
-            if (ey < 0) ey = 0;
-            if (ey > overlap - 1) ey = overlap - 1;
-
-            cv::Mat br = back.row(by);
-            cv::Mat er = ext.row(ey);
-            cv::Mat orow = out.row(y);
-
-            cv::addWeighted(br, a, er, 1.0f - a, 0.0, orow);
-        }
-
-        cv::GaussianBlur(out, out, cv::Size(0, 0), 1.6, 0.6);
-    }
-
-    unlockBitmap(env, outBand);
-    unlockBitmap(env, extStrip);
-    unlockBitmap(env, backStrip);
-
-    return ok ? JNI_TRUE : JNI_FALSE;
+extern "C" JNIEXPORT jstring JNICALL
+Java_com_uzera_camcpp_MainActivity_nativeBenchmarkMjpeg(JNIEnv *env, jobject, jstring dir,
+                                                        jint passes) {
+    const char *d = env->GetStringUTFChars(dir, nullptr);
+    std::string s = uvc::benchmarkMjpegDir(d ? d : "", (int) passes);
+    if (d) env->ReleaseStringUTFChars(dir, d);
+    return env->NewStringUTF(s.c_str());
 }
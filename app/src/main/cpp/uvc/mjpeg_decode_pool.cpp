@@ -0,0 +1,179 @@
+// mjpeg_decode_pool.cpp
+
+#include "mjpeg_decode_pool.h"
+#include "../common/time_utils.h"
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+
+namespace uvc {
+
+    int mjpegWorkersFor(int decodeUs, int fps, int maxWorkers) {
+        if (decodeUs <= 0 || fps <= 0) return 1;
+        const double periodUs = 1e6 / (double) fps;
+        int need = (int) std::ceil((double) decodeUs * 1.25 / periodUs);
+
+        int cores = (int) std::thread::hardware_concurrency();
+        int spare = cores > 2 ? cores - 2 : 1;   // capture + presenter keep their own cores
+        return std::clamp(need, 1, std::max(1, std::min(spare, maxWorkers)));
+    }
+
+    bool MjpegDecodePool::start(int workers, int outW, int outH, long long maxReorderWaitNs,
+                                PresentFn present, ReleaseFn release) {
+        stop();
+        if (workers < 1 || outW <= 0 || outH <= 0) return false;
+
+        mOutW = outW;
+        mOutH = outH;
+        mMaxWaitNs = maxReorderWaitNs;
+        mPresent = std::move(present);
+        mRelease = std::move(release);
+        mNextSeq = 0;
+        mStop = false;
+        mAvgDecodeUs.store(0, std::memory_order_relaxed);
+        mReorderDrops.store(0, std::memory_order_relaxed);
+
+        for (int i = 0; i < workers; i++) {
+            auto w = std::make_unique<Worker>();
+            w->rgba = cv::Mat(outH, outW, CV_8UC4);
+            mWorkers.push_back(std::move(w));
+        }
+        for (auto &w: mWorkers) w->th = std::thread(&MjpegDecodePool::workerLoop, this, w.get());
+        mPresenter = std::thread(&MjpegDecodePool::presenterLoop, this);
+        return true;
+    }
+
+    void MjpegDecodePool::stop() {
+        if (mWorkers.empty()) return;
+        {
+            std::lock_guard<std::mutex> lk(mLock);
+            mStop = true;
+        }
+        mWorkCv.notify_all();
+        mDoneCv.notify_all();
+        mIdleCv.notify_all();
+        for (auto &w: mWorkers) {
+            if (w->th.joinable()) w->th.join();
+        }
+        if (mPresenter.joinable()) mPresenter.join();
+
+        // Anything still holding a payload gives it back.
+        for (auto &w: mWorkers) {
+            if (w->state == State::Decoding && w->job.token >= 0 && mRelease) {
+                mRelease(w->job.token);
+            }
+        }
+        mWorkers.clear();
+    }
+
+    bool MjpegDecodePool::waitIdle(long long timeoutNs) {
+        std::unique_lock<std::mutex> lk(mLock);
+        return mIdleCv.wait_for(lk, std::chrono::nanoseconds(timeoutNs), [&] {
+            if (mStop) return false;
+            for (auto &w: mWorkers) {
+                if (w->state == State::Idle) return true;
+            }
+            return false;
+        });
+    }
+
+    bool MjpegDecodePool::submit(MjpegJob &job) {
+        {
+            std::lock_guard<std::mutex> lk(mLock);
+            Worker *idle = nullptr;
+            for (auto &w: mWorkers) {
+                if (w->state == State::Idle) {
+                    idle = w.get();
+                    break;
+                }
+            }
+            if (!idle) return false;
+            MjpegJob &j = idle->job;
+            j.seq = job.seq;
+            j.token = job.token;
+            j.tsNs = job.tsNs;
+            j.owned.swap(job.owned);
+            job.owned.clear();
+            j.data = j.owned.empty() ? job.data : j.owned.data();
+            j.size = j.owned.empty() ? job.size : j.owned.size();
+            idle->state = State::Decoding;
+        }
+        mWorkCv.notify_all();
+        return true;
+    }
+
+    void MjpegDecodePool::workerLoop(Worker *w) {
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lk(mLock);
+                mWorkCv.wait(lk, [&] { return mStop || w->state == State::Decoding; });
+                if (mStop) return;
+            }
+
+            const MjpegJob &job = w->job;
+            bool ok = w->dec.decodeRgba(job.data, job.size, w->rgba.data, w->rgba.step, mOutW,
+                                        mOutH);
+            if (job.token >= 0 && mRelease) mRelease(job.token);
+
+            int avg = mAvgDecodeUs.load(std::memory_order_relaxed);
+            int cur = w->dec.avgDecodeUs();
+            mAvgDecodeUs.store(avg == 0 ? cur : (avg * 7 + cur) / 8, std::memory_order_relaxed);
+
+            {
+                std::lock_guard<std::mutex> lk(mLock);
+                w->ok = ok;
+                w->doneNs = nowBoottimeNs();
+                w->job.token = -1;
+                w->state = State::Done;
+            }
+            mDoneCv.notify_all();
+        }
+    }
+
+    void MjpegDecodePool::presenterLoop() {
+        std::unique_lock<std::mutex> lk(mLock);
+        while (!mStop) {
+            Worker *oldestDone = nullptr;
+            uint64_t oldestBusySeq = UINT64_MAX;
+            for (auto &w: mWorkers) {
+                if (w->state == State::Done) {
+                    if (w->job.seq < mNextSeq) {
+                        // A newer frame already went out; this one can only go backwards.
+                        w->state = State::Idle;
+                        mReorderDrops.fetch_add(1, std::memory_order_relaxed);
+                        mIdleCv.notify_one();
+                        continue;
+                    }
+                    if (!oldestDone || w->job.seq < oldestDone->job.seq) oldestDone = w.get();
+                } else if (w->state == State::Decoding) {
+                    oldestBusySeq = std::min(oldestBusySeq, w->job.seq);
+                }
+            }
+
+            if (!oldestDone) {
+                mDoneCv.wait(lk);
+                continue;
+            }
+
+            if (oldestBusySeq < oldestDone->job.seq) {
+                long long waited = nowBoottimeNs() - oldestDone->doneNs;
+                if (waited < mMaxWaitNs) {
+                    mDoneCv.wait_for(lk, std::chrono::nanoseconds(mMaxWaitNs - waited));
+                    continue;
+                }
+            }
+
+            Worker *w = oldestDone;
+            mNextSeq = w->job.seq + 1;
+            const bool ok = w->ok;
+            const long long ts = w->job.tsNs;
+            lk.unlock();
+            if (ok && mPresent) mPresent(w->rgba, ts);
+            lk.lock();
+            w->state = State::Idle;
+            mIdleCv.notify_one();
+        }
+    }
+
+} // namespace uvc
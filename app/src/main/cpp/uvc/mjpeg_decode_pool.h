@@ -0,0 +1,114 @@
+// mjpeg_decode_pool.h
+
+#pragma once
+
+#include "mjpeg_decoder.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+namespace uvc {
+
+    // One compressed frame handed to the pool. `token` identifies whatever backs
+    // `data` (a V4L2 buffer index) and is passed to the release callback as soon as
+    // the payload has been decoded; `owned` keeps copied payloads alive instead.
+    struct MjpegJob {
+        uint64_t seq = 0;
+        const uint8_t *data = nullptr;
+        size_t size = 0;
+        int token = -1;
+        std::vector<uint8_t> owned;
+        long long tsNs = 0;
+    };
+
+    // N decode workers, each with its own MjpegDecoder and RGBA output, plus a
+    // presenter thread that hands finished frames to `present` strictly in `seq`
+    // order. A frame that finishes early waits at most `maxReorderWaitNs` for older
+    // ones; after that it is presented and the older frames are dropped when they
+    // complete, so output order never goes backwards and added latency stays bounded.
+    class MjpegDecodePool {
+    public:
+        using PresentFn = std::function<void(cv::Mat &rgba, long long tsNs)>;
+        using ReleaseFn = std::function<void(int token)>;
+
+        ~MjpegDecodePool() { stop(); }
+
+        bool start(int workers, int outW, int outH, long long maxReorderWaitNs,
+                   PresentFn present, ReleaseFn release);
+
+        void stop();
+
+        bool running() const { return !mWorkers.empty(); }
+
+        int workers() const { return (int) mWorkers.size(); }
+
+        int outW() const { return mOutW; }
+
+        int outH() const { return mOutH; }
+
+        // Blocks until a worker is free (true) or the timeout / stop hits (false).
+        bool waitIdle(long long timeoutNs);
+
+        // Non-blocking. Returns false when every worker is busy and leaves `job`
+        // untouched. On success `job.owned` is swapped with a recycled buffer, so
+        // copy-mode payloads circulate without reallocating.
+        bool submit(MjpegJob &job);
+
+        // Mean per-frame decode time across workers (single-core cost).
+        int avgDecodeUs() const { return mAvgDecodeUs.load(std::memory_order_relaxed); }
+
+        // Frames decoded but dropped because a newer one was already presented.
+        long long reorderDrops() const { return mReorderDrops.load(std::memory_order_relaxed); }
+
+    private:
+        enum class State {
+            Idle, Decoding, Done
+        };
+
+        struct Worker {
+            std::thread th;
+            MjpegDecoder dec;
+            cv::Mat rgba;
+            MjpegJob job;
+            State state = State::Idle;
+            bool ok = false;
+            long long doneNs = 0;
+        };
+
+        void workerLoop(Worker *w);
+
+        void presenterLoop();
+
+        std::mutex mLock;
+        std::condition_variable mWorkCv;
+        std::condition_variable mDoneCv;
+        std::condition_variable mIdleCv;
+        std::vector<std::unique_ptr<Worker>> mWorkers;
+        std::thread mPresenter;
+        bool mStop = false;
+
+        int mOutW = 0;
+        int mOutH = 0;
+        long long mMaxWaitNs = 0;
+        uint64_t mNextSeq = 0;
+        PresentFn mPresent;
+        ReleaseFn mRelease;
+
+        std::atomic<int> mAvgDecodeUs{0};
+        std::atomic<long long> mReorderDrops{0};
+    };
+
+    // Workers needed to sustain `fps` when one frame takes `decodeUs` on one core,
+    // with 25% headroom, capped by the cores we can spare and `maxWorkers`.
+    int mjpegWorkersFor(int decodeUs, int fps, int maxWorkers);
+
+} // namespace uvc
@@ -0,0 +1,300 @@
+// mjpeg_decoder.cpp
+
+#include "mjpeg_decoder.h"
+#include "mjpeg_slice_decoder.h"
+#include "../common/time_utils.h"
+
+#include <android/bitmap.h>
+#include <android/imagedecoder.h>
+
+#include <dirent.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+#if MJPEG_HAVE_LIBJPEG
+#include <csetjmp>
+#include <jpeglib.h>
+#include <jerror.h>
+#endif
+
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+
+namespace uvc {
+
+    bool jpegFrameSize(const uint8_t *jpeg, size_t size, int &w, int &h) {
+        if (!jpeg || size < 4 || jpeg[0] != 0xFF || jpeg[1] != 0xD8) return false;
+
+        size_t p = 2;
+        while (p + 4 <= size) {
+            if (jpeg[p] != 0xFF) return false;
+            while (p < size && jpeg[p] == 0xFF) p++;
+            if (p >= size) return false;
+            const uint8_t m = jpeg[p++];
+
+            if (m == 0x01 || (m >= 0xD0 && m <= 0xD8)) continue;
+            if (m == 0xD9 || m == 0xDA) return false;
+            if (p + 2 > size) return false;
+
+            const size_t len = ((size_t) jpeg[p] << 8) | jpeg[p + 1];
+            if (len < 2 || p + len > size) return false;
+
+            const bool isSof = m >= 0xC0 && m <= 0xCF && m != 0xC4 && m != 0xC8 && m != 0xCC;
+            if (isSof) {
+                if (len < 7) return false;
+                h = ((int) jpeg[p + 3] << 8) | jpeg[p + 4];
+                w = ((int) jpeg[p + 5] << 8) | jpeg[p + 6];
+                return w > 0 && h > 0;
+            }
+            p += len;
+        }
+        return false;
+    }
+
+#if MJPEG_HAVE_LIBJPEG
+
+    // The decompressor of one MjpegDecoder. libjpeg reports errors through error_exit,
+    // which must not return, so it longjmps back into the call that set `jump`; nothing
+    // with a destructor may live on the stack between that setjmp and the libjpeg calls.
+    struct MjpegDecoder::Turbo {
+        jpeg_decompress_struct cinfo{};
+        jpeg_error_mgr jerr{};
+        std::jmp_buf jump{};
+        std::vector<JSAMPROW> rows;
+        bool created = false;
+        bool truncated = false;   // the payload ran out; libjpeg filled the rest in grey
+
+        static void onError(j_common_ptr c) {
+            std::longjmp(static_cast<Turbo *>(c->client_data)->jump, 1);
+        }
+
+        // Corrupt-data warnings are not fatal (many cameras pad their scans); a payload
+        // that ends early is, like AImageDecoder's INCOMPLETE.
+        static void onMessage(j_common_ptr c, int level) {
+            if (level < 0 && c->err->msg_code == JWRN_JPEG_EOF)
+                static_cast<Turbo *>(c->client_data)->truncated = true;
+        }
+
+        // False when headers and library disagree on the version or struct size.
+        bool create() {
+            cinfo.err = jpeg_std_error(&jerr);
+            jerr.error_exit = onError;
+            jerr.emit_message = onMessage;
+            cinfo.client_data = this;
+            if (setjmp(jump)) return false;
+            jpeg_create_decompress(&cinfo);
+            cinfo.client_data = this;
+            created = true;
+            return true;
+        }
+
+        ~Turbo() {
+            if (created) jpeg_destroy_decompress(&cinfo);
+        }
+    };
+
+    MjpegDecoder::MjpegDecoder() {
+        auto t = std::make_unique<Turbo>();
+        if (t->create()) mTurbo = std::move(t);
+    }
+
+    // jpeg_abort_decompress after the last wanted row (or an error) puts the object
+    // back to its state before jpeg_read_header, with its pools kept for the next frame.
+    bool MjpegDecoder::decodeTurbo(const uint8_t *jpeg, size_t size, uint8_t *dst,
+                                   size_t dstStride, int outW, int outH) {
+        Turbo &t = *mTurbo;
+        jpeg_decompress_struct &ci = t.cinfo;
+        t.rows.resize((size_t) outH);
+        for (int y = 0; y < outH; y++) t.rows[y] = dst + (size_t) y * dstStride;
+        t.truncated = false;
+
+        if (setjmp(t.jump)) {
+            jpeg_abort_decompress(&ci);
+            return false;
+        }
+        jpeg_mem_src(&ci, jpeg, (unsigned long) size);
+        if (jpeg_read_header(&ci, TRUE) != JPEG_HEADER_OK || (int) ci.image_width != outW ||
+            (int) ci.image_height < outH) {
+            jpeg_abort_decompress(&ci);
+            return false;
+        }
+        ci.out_color_space = JCS_EXT_RGBA;
+        jpeg_start_decompress(&ci);
+        while (ci.output_scanline < (JDIMENSION) outH && !t.truncated) {
+            const JDIMENSION y = ci.output_scanline;
+            if (jpeg_read_scanlines(&ci, t.rows.data() + y, (JDIMENSION) outH - y) == 0) break;
+        }
+        const bool ok = ci.output_scanline >= (JDIMENSION) outH && !t.truncated;
+        jpeg_abort_decompress(&ci);
+        return ok;
+    }
+
+#else
+
+    struct MjpegDecoder::Turbo {
+    };
+
+    MjpegDecoder::MjpegDecoder() = default;
+
+    bool MjpegDecoder::decodeTurbo(const uint8_t *, size_t, uint8_t *, size_t, int, int) {
+        return false;
+    }
+
+#endif
+
+    MjpegDecoder::~MjpegDecoder() = default;
+
+    // AImageDecoder is bound to the buffer it was created from and the NDK has no call
+    // to point it at another, so each frame pays for a create / delete (header parse and
+    // allocation included). mLastSetupUs keeps that part apart from the decode itself.
+    bool MjpegDecoder::decodePlatform(const uint8_t *jpeg, size_t size, uint8_t *dst,
+                                      size_t dstStride, int outW, int outH) {
+        const long long t0 = nowBoottimeNs();
+        AImageDecoder *dec = nullptr;
+        if (AImageDecoder_createFromBuffer(jpeg, size, &dec) != ANDROID_IMAGE_DECODER_SUCCESS ||
+            !dec)
+            return false;
+
+        long long decodeNs = 0;
+        bool ok = false;
+        do {
+            if (AImageDecoder_setAndroidBitmapFormat(dec, ANDROID_BITMAP_FORMAT_RGBA_8888) !=
+                ANDROID_IMAGE_DECODER_SUCCESS) {
+                mPlatformOk = false;
+                break;
+            }
+            const AImageDecoderHeaderInfo *info = AImageDecoder_getHeaderInfo(dec);
+            const int w = AImageDecoderHeaderInfo_getWidth(info);
+            const int h = AImageDecoderHeaderInfo_getHeight(info);
+            if (w != outW || outH > h) break;
+            if (outH < h) {
+                ARect crop{0, 0, outW, outH};
+                if (AImageDecoder_setCrop(dec, crop) != ANDROID_IMAGE_DECODER_SUCCESS) break;
+            }
+            if (AImageDecoder_getMinimumStride(dec) > dstStride) break;
+            const long long d0 = nowBoottimeNs();
+            ok = AImageDecoder_decodeImage(dec, dst, dstStride, dstStride * (size_t) outH) ==
+                 ANDROID_IMAGE_DECODER_SUCCESS;
+            decodeNs = nowBoottimeNs() - d0;
+        } while (false);
+
+        AImageDecoder_delete(dec);
+        if (ok) mLastSetupUs = (int) ((nowBoottimeNs() - t0 - decodeNs) / 1000);
+        return ok;
+    }
+
+    bool MjpegDecoder::decodeOpenCv(const uint8_t *jpeg, size_t size, uint8_t *dst,
+                                    size_t dstStride, int outW, int outH) {
+        try {
+            cv::Mat buf(1, (int) size, CV_8UC1, const_cast<uint8_t *>(jpeg));
+            cv::imdecode(buf, cv::IMREAD_COLOR, &mBgr);
+            if (mBgr.empty() || mBgr.cols != outW || mBgr.rows < outH) return false;
+
+            cv::Mat out(outH, outW, CV_8UC4, dst, dstStride);
+            cv::cvtColor(mBgr.rowRange(0, outH), out, cv::COLOR_BGR2RGBA);
+            return true;
+        } catch (...) {
+            return false;
+        }
+    }
+
+    bool MjpegDecoder::decodeRgba(const uint8_t *jpeg, size_t size, uint8_t *dst,
+                                  size_t dstStride, int outW, int outH) {
+        if (!jpeg || size == 0 || !dst || outW <= 0 || outH <= 0) return false;
+        if (dstStride < (size_t) outW * 4) return false;
+
+        const long long t0 = nowBoottimeNs();
+        mLastSetupUs = 0;
+        bool ok = mTurbo && decodeTurbo(jpeg, size, dst, dstStride, outW, outH);
+        if (!ok && mPlatformOk) ok = decodePlatform(jpeg, size, dst, dstStride, outW, outH);
+        if (!ok) ok = decodeOpenCv(jpeg, size, dst, dstStride, outW, outH);
+        if (!ok) return false;
+
+        mLastUs = (int) ((nowBoottimeNs() - t0) / 1000);
+        mAvgUs = mAvgUs == 0.0 ? mLastUs : mAvgUs + ((double) mLastUs - mAvgUs) / 8.0;
+        return true;
+    }
+
+    std::string benchmarkMjpegDir(const std::string &dir, int passes) {
+        std::vector<std::vector<uint8_t>> corpus;
+        if (DIR *d = opendir(dir.c_str())) {
+            while (dirent *e = readdir(d)) {
+                std::string name = e->d_name;
+                auto dot = name.rfind('.');
+                if (dot == std::string::npos) continue;
+                std::string ext = name.substr(dot);
+                if (ext != ".jpg" && ext != ".jpeg" && ext != ".mjpg") continue;
+                std::ifstream f(dir + "/" + name, std::ios::binary);
+                corpus.emplace_back(std::istreambuf_iterator<char>(f),
+                                    std::istreambuf_iterator<char>());
+            }
+            closedir(d);
+        }
+        if (corpus.empty()) return "no .jpg/.mjpg files in " + dir;
+        passes = std::max(1, passes);
+
+        MjpegDecoder dec;
+        MjpegSliceDecoder sliceDec(0);
+        std::vector<uint8_t> rgba;
+        cv::Mat rgbaOld;
+        long long directNs = 0, setupUs = 0, oldNs = 0, slicedNs = 0, slicedDirectNs = 0;
+        int frames = 0, failed = 0, sliced = 0;
+
+        for (int p = 0; p < passes; p++) {
+            for (auto &jpg: corpus) {
+                int w = 0, h = 0;
+                if (!jpegFrameSize(jpg.data(), jpg.size(), w, h)) {
+                    failed++;
+                    continue;
+                }
+                rgba.resize((size_t) w * (size_t) h * 4);
+
+                long long t0 = nowBoottimeNs();
+                if (!dec.decodeRgba(jpg.data(), jpg.size(), rgba.data(), (size_t) w * 4, w, h))
+                    failed++;
+                long long t1 = nowBoottimeNs();
+                setupUs += dec.lastSetupUs();
+                try {
+                    cv::Mat buf(1, (int) jpg.size(), CV_8UC1, jpg.data());
+                    cv::Mat bgr = cv::imdecode(buf, cv::IMREAD_COLOR);
+                    if (!bgr.empty()) cv::cvtColor(bgr, rgbaOld, cv::COLOR_BGR2RGBA);
+                } catch (...) {
+                }
+                long long t2 = nowBoottimeNs();
+
+                directNs += t1 - t0;
+                oldNs += t2 - t1;
+                frames++;
+
+                if (sliceDec.prepare(jpg.data(), jpg.size())) {
+                    long long t3 = nowBoottimeNs();
+                    if (sliceDec.decodeRgba(rgba.data(), (size_t) w * 4, w, h)) {
+                        slicedNs += nowBoottimeNs() - t3;
+                        slicedDirectNs += t1 - t0;
+                        sliced++;
+                    }
+                }
+            }
+        }
+
+        // direct includes setup: the AImageDecoder create / delete a frame pays when it
+        // goes through the platform decoder.
+        char out[352];
+        std::snprintf(out, sizeof(out),
+                      "backend=%s frames=%d failed=%d direct=%.2fms (setup=%.3fms) "
+                      "imdecode+cvtColor=%.2fms speedup=%.2fx sliced=%d/%d %.2fms "
+                      "(%.2fx vs direct)",
+                      dec.hasLibjpeg() ? "libjpeg-turbo" : "AImageDecoder", frames, failed,
+                      directNs / 1e6 / std::max(frames, 1), setupUs / 1e3 / std::max(frames, 1),
+                      oldNs / 1e6 / std::max(frames, 1),
+                      directNs > 0 ? (double) oldNs / (double) directNs : 0.0, sliced, frames,
+                      slicedNs / 1e6 / std::max(sliced, 1),
+                      slicedNs > 0 ? (double) slicedDirectNs / (double) slicedNs : 0.0);
+        return out;
+    }
+
+} // namespace uvc
@@ -0,0 +1,81 @@
+// mjpeg_decoder.h
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include <opencv2/core.hpp>
+
+namespace uvc {
+
+    // Reads the frame size from the SOFn segment without decoding anything.
+    bool jpegFrameSize(const uint8_t *jpeg, size_t size, int &w, int &h);
+
+    // Per-thread MJPEG decoder that writes RGBA8888 straight into caller memory.
+    //
+    // The primary backend is libjpeg-turbo, the static library the OpenCV SDK's
+    // imgcodecs is built on (MJPEG_HAVE_LIBJPEG, see CMakeLists.txt): one
+    // jpeg_decompress_struct lives as long as the decoder, jpeg_mem_src points it at
+    // each payload, and rows [0, outH) are written in RGBA straight into the caller's
+    // memory. The platform AImageDecoder (libjnigraphics, API 30) is the fallback; it
+    // is created and deleted per frame. If that refuses a payload as well,
+    // cv::imdecode into a reused BGR Mat plus one cvtColor. The object owns all
+    // scratch state, so keep one per decoding thread and reuse it for every frame.
+    class MjpegDecoder {
+    public:
+        MjpegDecoder();
+
+        ~MjpegDecoder();
+
+        MjpegDecoder(const MjpegDecoder &) = delete;
+
+        MjpegDecoder &operator=(const MjpegDecoder &) = delete;
+
+        // Decodes rows [0, outH) of a w x h JPEG into dst (outW == w). Never throws.
+        bool decodeRgba(const uint8_t *jpeg, size_t size, uint8_t *dst, size_t dstStride,
+                        int outW, int outH);
+
+        int lastDecodeUs() const { return mLastUs; }
+
+        // Part of lastDecodeUs() spent creating and deleting the platform decoder; 0 when
+        // the frame went through libjpeg-turbo or OpenCV.
+        int lastSetupUs() const { return mLastSetupUs; }
+
+        // Exponential moving average of successful decodes.
+        int avgDecodeUs() const { return (int) mAvgUs; }
+
+        // Whether this build decodes with libjpeg-turbo and its session object could be
+        // created (headers and library of the same version).
+        bool hasLibjpeg() const { return mTurbo != nullptr; }
+
+    private:
+        struct Turbo;
+
+        bool decodeTurbo(const uint8_t *jpeg, size_t size, uint8_t *dst, size_t dstStride,
+                         int outW, int outH);
+
+        bool decodePlatform(const uint8_t *jpeg, size_t size, uint8_t *dst, size_t dstStride,
+                            int outW, int outH);
+
+        bool decodeOpenCv(const uint8_t *jpeg, size_t size, uint8_t *dst, size_t dstStride,
+                          int outW, int outH);
+
+        std::unique_ptr<Turbo> mTurbo;
+        bool mPlatformOk = true;
+        cv::Mat mBgr;
+        int mLastUs = 0;
+        int mLastSetupUs = 0;
+        double mAvgUs = 0.0;
+    };
+
+    // Decodes every *.jpg / *.mjpg file in dir `passes` times with MjpegDecoder, with
+    // the old imdecode + cvtColor(BGR2RGBA) path and, for files with restart markers,
+    // with MjpegSliceDecoder, and returns a one-line summary naming the backend. The
+    // per-frame AImageDecoder create / delete, where it is used, is reported on its own
+    // as `setup`.
+    std::string benchmarkMjpegDir(const std::string &dir, int passes);
+
+} // namespace uvc
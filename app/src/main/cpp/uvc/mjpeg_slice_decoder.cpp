@@ -0,0 +1,242 @@
+// mjpeg_slice_decoder.cpp
+
+#include "mjpeg_slice_decoder.h"
+#include "../common/time_utils.h"
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+
+namespace uvc {
+
+    static inline int be16(const uint8_t *p) { return ((int) p[0] << 8) | p[1]; }
+
+    bool parseJpegRestartLayout(const uint8_t *jpeg, size_t size, JpegRestartLayout &out) {
+        out = JpegRestartLayout{};
+        if (!jpeg || size < 4 || jpeg[0] != 0xFF || jpeg[1] != 0xD8) return false;
+
+        int ncomp = 0, hmax = 1, vmax = 1;
+        size_t p = 2;
+        while (p + 4 <= size) {
+            if (jpeg[p] != 0xFF) return false;
+            while (p < size && jpeg[p] == 0xFF) p++;
+            if (p >= size) return false;
+            const uint8_t m = jpeg[p++];
+
+            if (m == 0x01 || (m >= 0xD0 && m <= 0xD7)) continue;
+            if (m == 0xD8 || m == 0xD9) return false;
+            if (p + 2 > size) return false;
+
+            const size_t len = (size_t) be16(jpeg + p);
+            if (len < 2 || p + len > size) return false;
+
+            if (m == 0xC0 || m == 0xC1) {
+                if (len < 8) return false;
+                out.sofHeightOff = p + 3;
+                out.height = be16(jpeg + p + 3);
+                out.width = be16(jpeg + p + 5);
+                ncomp = jpeg[p + 7];
+                if (ncomp < 1 || len < 8 + 3 * (size_t) ncomp) return false;
+                for (int c = 0; c < ncomp; c++) {
+                    const uint8_t hv = jpeg[p + 8 + 3 * c + 1];
+                    hmax = std::max(hmax, (int) (hv >> 4));
+                    vmax = std::max(vmax, (int) (hv & 0x0F));
+                }
+            } else if (m >= 0xC2 && m <= 0xCF && m != 0xC4 && m != 0xC8 && m != 0xCC) {
+                return false;   // progressive, lossless or arithmetic
+            } else if (m == 0xDD) {
+                if (len < 4) return false;
+                out.restartInterval = be16(jpeg + p + 2);
+            } else if (m == 0xDA) {
+                if (ncomp == 0 || jpeg[p + 2] != ncomp) return false;   // one interleaved scan
+                out.scanStart = p + len;
+                break;
+            }
+            p += len;
+        }
+        if (out.scanStart == 0 || out.restartInterval <= 0 || out.width <= 0 || out.height <= 0)
+            return false;
+
+        out.mcuW = ncomp == 1 ? 8 : 8 * hmax;
+        out.mcuH = ncomp == 1 ? 8 : 8 * vmax;
+        out.mcusPerRow = (out.width + out.mcuW - 1) / out.mcuW;
+        out.mcuRows = (out.height + out.mcuH - 1) / out.mcuH;
+
+        size_t q = out.scanStart, start = q;
+        for (;;) {
+            const void *ff = std::memchr(jpeg + q, 0xFF, size - q);
+            if (!ff) return false;
+            q = (size_t) ((const uint8_t *) ff - jpeg);
+            if (q + 1 >= size) return false;
+
+            const uint8_t n = jpeg[q + 1];
+            if (n == 0x00) {
+                q += 2;     // stuffed 0xFF data byte
+            } else if (n == 0xFF) {
+                q += 1;     // fill byte
+            } else if (n >= 0xD0 && n <= 0xD7) {
+                out.begin.push_back(start);
+                out.end.push_back(q);
+                q += 2;
+                start = q;
+            } else if (n == 0xD9) {
+                if (q > start) {
+                    out.begin.push_back(start);
+                    out.end.push_back(q);
+                }
+                break;
+            } else {
+                return false;   // DNL or another marker inside the scan
+            }
+        }
+
+        const long long mcus = (long long) out.mcusPerRow * out.mcuRows;
+        const long long expect = (mcus + out.restartInterval - 1) / out.restartInterval;
+        return (long long) out.begin.size() == expect && expect >= 2;
+    }
+
+    MjpegSliceDecoder::MjpegSliceDecoder(int threads) {
+        if (threads <= 0) {
+            int cores = (int) std::thread::hardware_concurrency();
+            threads = std::clamp(cores - 2, 2, 4);
+        }
+        for (int i = 0; i < threads; i++) mWorkers.push_back(std::make_unique<Worker>());
+        for (int i = 1; i < threads; i++) {
+            mWorkers[i]->th = std::thread(&MjpegSliceDecoder::workerLoop, this, i);
+        }
+    }
+
+    MjpegSliceDecoder::~MjpegSliceDecoder() {
+        {
+            std::lock_guard<std::mutex> lk(mLock);
+            mStop = true;
+        }
+        mStartCv.notify_all();
+        for (auto &w: mWorkers) {
+            if (w->th.joinable()) w->th.join();
+        }
+    }
+
+    bool MjpegSliceDecoder::prepare(const uint8_t *jpeg, size_t size) {
+        mJpeg = nullptr;
+        mSize = 0;
+        if (mWorkers.size() < 2 || !parseJpegRestartLayout(jpeg, size, mLayout)) return false;
+
+        // Slices can only break where an interval boundary meets an MCU-row boundary.
+        const int ri = mLayout.restartInterval;
+        const int align = ri / std::gcd(ri, mLayout.mcusPerRow) * mLayout.mcusPerRow;
+        if (mLayout.mcuRows < 2 * (align / mLayout.mcusPerRow)) return false;
+
+        mJpeg = jpeg;
+        mSize = size;
+        return true;
+    }
+
+    bool MjpegSliceDecoder::decodeSlice(int idx, Worker &w) {
+        const Slice &sl = mSlices[idx];
+        const JpegRestartLayout &L = mLayout;
+
+        size_t bytes = L.scanStart + 2;
+        for (int i = 0; i < sl.intervals; i++) {
+            const int k = sl.firstInterval + i;
+            bytes += L.end[k] - L.begin[k] + 2;
+        }
+        w.scratch.resize(bytes);
+
+        uint8_t *o = w.scratch.data();
+        std::memcpy(o, mJpeg, L.scanStart);
+        o[L.sofHeightOff] = (uint8_t) (sl.rows >> 8);
+        o[L.sofHeightOff + 1] = (uint8_t) (sl.rows & 0xFF);
+        o += L.scanStart;
+        for (int i = 0; i < sl.intervals; i++) {
+            if (i > 0) {
+                *o++ = 0xFF;
+                *o++ = (uint8_t) (0xD0 + ((i - 1) & 7));
+            }
+            const int k = sl.firstInterval + i;
+            std::memcpy(o, mJpeg + L.begin[k], L.end[k] - L.begin[k]);
+            o += L.end[k] - L.begin[k];
+        }
+        *o++ = 0xFF;
+        *o++ = 0xD9;
+
+        const int h = std::min(sl.rows, mOutH - sl.row0);
+        return w.dec.decodeRgba(w.scratch.data(), (size_t) (o - w.scratch.data()),
+                                mDst + (size_t) sl.row0 * mDstStride, mDstStride, mOutW, h);
+    }
+
+    void MjpegSliceDecoder::workerLoop(int idx) {
+        uint64_t seen = 0;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lk(mLock);
+                mStartCv.wait(lk, [&] { return mStop || mGeneration != seen; });
+                if (mStop) return;
+                seen = mGeneration;
+                if (idx >= mSliceCount) continue;
+            }
+
+            const bool ok = decodeSlice(idx, *mWorkers[idx]);
+            {
+                std::lock_guard<std::mutex> lk(mLock);
+                mWorkers[idx]->ok = ok;
+                if (--mPending == 0) mDoneCv.notify_one();
+            }
+        }
+    }
+
+    bool MjpegSliceDecoder::decodeRgba(uint8_t *dst, size_t dstStride, int outW, int outH) {
+        const JpegRestartLayout &L = mLayout;
+        if (!mJpeg || !dst || outW != L.width || outH <= 0 || outH > L.height) return false;
+        if (dstStride < (size_t) outW * 4) return false;
+
+        const long long t0 = nowBoottimeNs();
+
+        // Split only the MCU rows the crop needs, in whole alignment units.
+        const int ri = L.restartInterval;
+        const int align = ri / std::gcd(ri, L.mcusPerRow) * L.mcusPerRow;
+        const int rowsPerUnit = align / L.mcusPerRow;
+        const int intervalsPerUnit = align / ri;
+        const int neededRows = (outH + L.mcuH - 1) / L.mcuH;
+        const int units = (neededRows + rowsPerUnit - 1) / rowsPerUnit;
+        const int count = std::min((int) mWorkers.size(), units);
+        if (count < 2) return false;
+
+        mSlices.resize(count);
+        for (int s = 0; s < count; s++) {
+            const int u0 = units * s / count, u1 = units * (s + 1) / count;
+            const int i0 = u0 * intervalsPerUnit;
+            const int i1 = std::min(u1 * intervalsPerUnit, (int) L.begin.size());
+            Slice &sl = mSlices[s];
+            sl.firstInterval = i0;
+            sl.intervals = i1 - i0;
+            sl.row0 = u0 * rowsPerUnit * L.mcuH;
+            sl.rows = std::min(u1 * rowsPerUnit * L.mcuH, L.height) - sl.row0;
+        }
+
+        mDst = dst;
+        mDstStride = dstStride;
+        mOutW = outW;
+        mOutH = outH;
+        {
+            std::lock_guard<std::mutex> lk(mLock);
+            mSliceCount = count;
+            mPending = count - 1;
+            mGeneration++;
+        }
+        mStartCv.notify_all();
+
+        bool ok = decodeSlice(0, *mWorkers[0]);
+        {
+            std::unique_lock<std::mutex> lk(mLock);
+            mDoneCv.wait(lk, [&] { return mPending == 0; });
+        }
+        for (int s = 1; s < count; s++) ok = ok && mWorkers[s]->ok;
+        if (!ok) return false;
+
+        const double us = (double) (nowBoottimeNs() - t0) / 1000.0;
+        mAvgUs = mAvgUs == 0.0 ? us : mAvgUs + (us - mAvgUs) / 8.0;
+        return true;
+    }
+
+} // namespace uvc
@@ -0,0 +1,104 @@
+// mjpeg_slice_decoder.h
+
+#pragma once
+
+#include "mjpeg_decoder.h"
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace uvc {
+
+    // Where the restart intervals of a baseline, single-scan JPEG live.
+    struct JpegRestartLayout {
+        int width = 0;
+        int height = 0;
+        int mcuW = 8;
+        int mcuH = 8;
+        int mcusPerRow = 0;
+        int mcuRows = 0;
+        int restartInterval = 0;        // MCUs per interval (DRI)
+        size_t sofHeightOff = 0;        // big-endian frame height inside the SOF segment
+        size_t scanStart = 0;           // first entropy-coded byte after the SOS header
+        std::vector<size_t> begin;      // per interval: first entropy byte
+        std::vector<size_t> end;        // per interval: one past the last (RST / EOI excluded)
+    };
+
+    // Parses headers and scans the entropy data for RSTn markers. False for
+    // progressive / multi-scan streams, streams without DRI, or inconsistent counts.
+    bool parseJpegRestartLayout(const uint8_t *jpeg, size_t size, JpegRestartLayout &out);
+
+    // Intra-frame parallel MJPEG decode. Restart intervals reset the DC predictors,
+    // so a run of whole intervals that starts and ends on an MCU-row boundary is a
+    // self-contained image: the original headers with the SOF height patched, the
+    // interval data with RST numbers restarted at 0, and an EOI. Each such slice is
+    // decoded on its own thread with its own MjpegDecoder straight into a disjoint
+    // row band of the output, then the caller joins.
+    class MjpegSliceDecoder {
+    public:
+        // threads <= 0 picks from the core count.
+        explicit MjpegSliceDecoder(int threads);
+
+        ~MjpegSliceDecoder();
+
+        // True when this frame splits into at least two MCU-row-aligned slices.
+        bool prepare(const uint8_t *jpeg, size_t size);
+
+        // Decodes the frame last passed to prepare(); same contract as
+        // MjpegDecoder::decodeRgba.
+        bool decodeRgba(uint8_t *dst, size_t dstStride, int outW, int outH);
+
+        // Slices used by the last decode.
+        int lastSlices() const { return mSliceCount; }
+
+        // Wall-clock decode time (all slices, join included), smoothed.
+        int avgDecodeUs() const { return (int) mAvgUs; }
+
+    private:
+        struct Slice {
+            int firstInterval = 0;
+            int intervals = 0;
+            int row0 = 0;       // first output pixel row
+            int rows = 0;       // pixel rows in this slice image
+        };
+
+        struct Worker {
+            std::thread th;
+            MjpegDecoder dec;
+            std::vector<uint8_t> scratch;
+            bool ok = false;
+        };
+
+        bool decodeSlice(int idx, Worker &w);
+
+        void workerLoop(int idx);
+
+        const uint8_t *mJpeg = nullptr;
+        size_t mSize = 0;
+        JpegRestartLayout mLayout;
+        std::vector<Slice> mSlices;
+        int mSliceCount = 0;
+
+        uint8_t *mDst = nullptr;
+        size_t mDstStride = 0;
+        int mOutW = 0;
+        int mOutH = 0;
+
+        // mWorkers[0] is the calling thread's context; the rest run their own threads.
+        std::vector<std::unique_ptr<Worker>> mWorkers;
+        std::mutex mLock;
+        std::condition_variable mStartCv;
+        std::condition_variable mDoneCv;
+        uint64_t mGeneration = 0;
+        int mPending = 0;
+        bool mStop = false;
+
+        double mAvgUs = 0.0;
+    };
+
+} // namespace uvc
@@ -0,0 +1,141 @@
+// mjpeg_validator.cpp
+
+#include "mjpeg_validator.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace uvc {
+
+    // ITU-T T.81 Annex K.3: bit counts per code length, then symbol values.
+    static const uint8_t kDcLumBits[16] = {0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0};
+    static const uint8_t kDcChromBits[16] = {0, 3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0};
+    static const uint8_t kDcVals[12] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11};
+
+    static const uint8_t kAcLumBits[16] = {0, 2, 1, 3, 3, 2, 4, 3, 5, 5, 4, 4, 0, 0, 1, 0x7d};
+    static const uint8_t kAcLumVals[162] = {
+            0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41, 0x06, 0x13, 0x51,
+            0x61, 0x07, 0x22, 0x71, 0x14, 0x32, 0x81, 0x91, 0xa1, 0x08, 0x23, 0x42, 0xb1, 0xc1,
+            0x15, 0x52, 0xd1, 0xf0, 0x24, 0x33, 0x62, 0x72, 0x82, 0x09, 0x0a, 0x16, 0x17, 0x18,
+            0x19, 0x1a, 0x25, 0x26, 0x27, 0x28, 0x29, 0x2a, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39,
+            0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49, 0x4a, 0x53, 0x54, 0x55, 0x56, 0x57,
+            0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6a, 0x73, 0x74, 0x75,
+            0x76, 0x77, 0x78, 0x79, 0x7a, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89, 0x8a, 0x92,
+            0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7,
+            0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3,
+            0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8,
+            0xd9, 0xda, 0xe1, 0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf1, 0xf2,
+            0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8, 0xf9, 0xfa};
+
+    static const uint8_t kAcChromBits[16] = {0, 2, 1, 2, 4, 4, 3, 4, 7, 5, 4, 4, 0, 1, 2, 0x77};
+    static const uint8_t kAcChromVals[162] = {
+            0x00, 0x01, 0x02, 0x03, 0x11, 0x04, 0x05, 0x21, 0x31, 0x06, 0x12, 0x41, 0x51, 0x07,
+            0x61, 0x71, 0x13, 0x22, 0x32, 0x81, 0x08, 0x14, 0x42, 0x91, 0xa1, 0xb1, 0xc1, 0x09,
+            0x23, 0x33, 0x52, 0xf0, 0x15, 0x62, 0x72, 0xd1, 0x0a, 0x16, 0x24, 0x34, 0xe1, 0x25,
+            0xf1, 0x17, 0x18, 0x19, 0x1a, 0x26, 0x27, 0x28, 0x29, 0x2a, 0x35, 0x36, 0x37, 0x38,
+            0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49, 0x4a, 0x53, 0x54, 0x55, 0x56,
+            0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6a, 0x73, 0x74,
+            0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89,
+            0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5,
+            0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba,
+            0xc2, 0xc3, 0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6,
+            0xd7, 0xd8, 0xd9, 0xda, 0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf2,
+            0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8, 0xf9, 0xfa};
+
+    static const std::vector<uint8_t> &standardDhtSegment() {
+        static const std::vector<uint8_t> seg = [] {
+            std::vector<uint8_t> s{0xFF, 0xC4, 0, 0};
+            auto table = [&s](uint8_t tcTh, const uint8_t *bits, const uint8_t *vals, size_t n) {
+                s.push_back(tcTh);
+                s.insert(s.end(), bits, bits + 16);
+                s.insert(s.end(), vals, vals + n);
+            };
+            table(0x00, kDcLumBits, kDcVals, sizeof(kDcVals));
+            table(0x01, kDcChromBits, kDcVals, sizeof(kDcVals));
+            table(0x10, kAcLumBits, kAcLumVals, sizeof(kAcLumVals));
+            table(0x11, kAcChromBits, kAcChromVals, sizeof(kAcChromVals));
+            const size_t len = s.size() - 2;
+            s[2] = (uint8_t) (len >> 8);
+            s[3] = (uint8_t) (len & 0xFF);
+            return s;
+        }();
+        return seg;
+    }
+
+    MjpegVerdict validateMjpeg(const uint8_t *jpeg, size_t size, int expectW, int expectH,
+                               MjpegInfo &info) {
+        info = MjpegInfo{};
+        if (!jpeg || size < 4 || jpeg[0] != 0xFF || jpeg[1] != 0xD8) return MjpegVerdict::Reject;
+
+        // EOI, allowing for the zero padding some cameras leave after it.
+        size_t e = size;
+        while (e > 2 && jpeg[e - 1] == 0x00) e--;
+        if (e < 4 || jpeg[e - 2] != 0xFF || jpeg[e - 1] != 0xD9) return MjpegVerdict::Reject;
+        info.end = e;
+
+        int ncomp = 0, hmax = 1, vmax = 1, blocks = 0;
+        size_t scanStart = 0;
+        size_t p = 2;
+        while (p + 4 <= e) {
+            if (jpeg[p] != 0xFF) return MjpegVerdict::Reject;
+            while (p < e && jpeg[p] == 0xFF) p++;
+            if (p >= e) return MjpegVerdict::Reject;
+            const uint8_t m = jpeg[p++];
+
+            if (m == 0x01 || (m >= 0xD0 && m <= 0xD7)) continue;
+            if (m == 0xD8 || m == 0xD9) return MjpegVerdict::Reject;
+            if (p + 2 > e) return MjpegVerdict::Reject;
+
+            const size_t len = ((size_t) jpeg[p] << 8) | jpeg[p + 1];
+            if (len < 2 || p + len > e) return MjpegVerdict::Reject;
+
+            if (m == 0xC0 || m == 0xC1) {
+                if (len < 8) return MjpegVerdict::Reject;
+                info.height = ((int) jpeg[p + 3] << 8) | jpeg[p + 4];
+                info.width = ((int) jpeg[p + 5] << 8) | jpeg[p + 6];
+                ncomp = jpeg[p + 7];
+                if (ncomp < 1 || ncomp > 4 || len < 8 + 3 * (size_t) ncomp)
+                    return MjpegVerdict::Reject;
+                for (int c = 0; c < ncomp; c++) {
+                    const uint8_t hv = jpeg[p + 8 + 3 * c + 1];
+                    const int h = hv >> 4, v = hv & 0x0F;
+                    if (h < 1 || h > 4 || v < 1 || v > 4) return MjpegVerdict::Reject;
+                    hmax = std::max(hmax, h);
+                    vmax = std::max(vmax, v);
+                    blocks += h * v;
+                }
+            } else if (m == 0xC4) {
+                info.hasDht = true;
+            } else if (m == 0xDA) {
+                info.sosOffset = p - 2;
+                scanStart = p + len;
+                break;
+            }
+            p += len;
+        }
+
+        if (ncomp == 0 || scanStart == 0 || info.width <= 0 || info.height <= 0)
+            return MjpegVerdict::Reject;
+        if ((expectW > 0 && info.width != expectW) || (expectH > 0 && info.height != expectH))
+            return MjpegVerdict::Reject;
+
+        if (ncomp == 1) hmax = vmax = blocks = 1;
+        const size_t mcus = (size_t) ((info.width + 8 * hmax - 1) / (8 * hmax)) *
+                            (size_t) ((info.height + 8 * vmax - 1) / (8 * vmax));
+        const size_t minScan = mcus * (size_t) blocks / 4;
+        if (scanStart + minScan + 2 > e) return MjpegVerdict::Reject;
+
+        return info.hasDht ? MjpegVerdict::Ok : MjpegVerdict::MissingDht;
+    }
+
+    void copyWithStandardDht(const uint8_t *jpeg, const MjpegInfo &info,
+                             std::vector<uint8_t> &out) {
+        const std::vector<uint8_t> &dht = standardDhtSegment();
+        out.resize(info.end + dht.size());
+        std::memcpy(out.data(), jpeg, info.sosOffset);
+        std::memcpy(out.data() + info.sosOffset, dht.data(), dht.size());
+        std::memcpy(out.data() + info.sosOffset + dht.size(), jpeg + info.sosOffset,
+                    info.end - info.sosOffset);
+    }
+
+} // namespace uvc
@@ -0,0 +1,38 @@
+// mjpeg_validator.h
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace uvc {
+
+    enum class MjpegVerdict {
+        Ok,
+        MissingDht,     // structurally fine, but needs the standard Huffman tables
+        Reject
+    };
+
+    struct MjpegInfo {
+        int width = 0;
+        int height = 0;
+        size_t sosOffset = 0;   // offset of the FF DA marker
+        size_t end = 0;         // one past EOI; trailing padding excluded
+        bool hasDht = false;
+    };
+
+    // Cheap structural check of one UVC payload before it is handed to a decoder:
+    // SOI, every header segment length in bounds, a baseline SOF matching
+    // expectW x expectH (when > 0), an SOS, an EOI after any zero padding, and enough
+    // entropy-coded bytes for the frame's MCU count (at least two bits per block).
+    // Only headers and the tail are touched; the scan data is never walked.
+    MjpegVerdict validateMjpeg(const uint8_t *jpeg, size_t size, int expectW, int expectH,
+                               MjpegInfo &info);
+
+    // Copies jpeg[0, info.end) into out with the ITU-T T.81 Annex K Huffman tables
+    // inserted right before SOS. Many UVC cameras omit DHT and rely on these.
+    void copyWithStandardDht(const uint8_t *jpeg, const MjpegInfo &info,
+                             std::vector<uint8_t> &out);
+
+} // namespace uvc
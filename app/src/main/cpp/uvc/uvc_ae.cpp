@@ -0,0 +1,82 @@
+// uvc_ae.cpp
+
+#include "uvc_ae.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace uvc {
+
+    AeMeter aeMeter(const LumaStats &s) {
+        AeMeter m{};
+        if (s.samples == 0) return m;
+
+        // Inner 2x2 zones count double: the subject is usually in the middle.
+        double wsum = 0.0, acc = 0.0;
+        for (int zy = 0; zy < LumaStats::kZonesY; zy++) {
+            for (int zx = 0; zx < LumaStats::kZonesX; zx++) {
+                if (s.zoneCount[zy][zx] == 0) continue;
+                const bool inner = zy > 0 && zy < LumaStats::kZonesY - 1 && zx > 0 &&
+                                   zx < LumaStats::kZonesX - 1;
+                const double w = inner ? 2.0 : 1.0;
+                acc += w * (double) s.zoneSum[zy][zx] / (double) s.zoneCount[zy][zx];
+                wsum += w;
+            }
+        }
+        m.luma = wsum > 0.0 ? acc / wsum : 0.0;
+
+        uint32_t hi = 0, lo = 0;
+        for (int i = 250; i < 256; i++) hi += s.hist[i];
+        for (int i = 0; i <= 5; i++) lo += s.hist[i];
+        m.clipped = (double) hi / (double) s.samples;
+        m.crushed = (double) lo / (double) s.samples;
+        return m;
+    }
+
+    static int snap(double v, int lo, int hi, int step) {
+        step = std::max(1, step);
+        // The top of the range need not be on the step grid; stay on the last step below it.
+        const int top = hi > lo ? lo + (hi - lo) / step * step : lo;
+        const double k = std::round((v - (double) lo) / (double) step);
+        return std::clamp(lo + (int) k * step, lo, top);
+    }
+
+    static double gainX(const AeParams &p, const AeLimits &lim, int gain) {
+        if (!lim.hasGain || lim.gainMax <= lim.gainMin) return 1.0;
+        return 1.0 + (double) (gain - lim.gainMin) / (double) (lim.gainMax - lim.gainMin) *
+                     (p.maxGainX - 1.0);
+    }
+
+    bool aeStep(const AeParams &p, const AeLimits &lim, const AeMeter &meter,
+                const AeSettings &cur, AeSettings &next) {
+        next = cur;
+        if (meter.luma <= 0.0 || (!lim.hasExp && !lim.hasGain)) return false;
+        if (std::fabs(meter.luma - p.targetLuma) <= p.tolerance) return false;
+
+        double ratio = std::pow((double) p.targetLuma / std::max(meter.luma, 1.0), p.gamma);
+        // A saturated mean understates how far over we are (and a crushed one how far
+        // under), so insist on at least a halving / doubling.
+        if (meter.luma > p.targetLuma && meter.clipped > 0.02) ratio = std::min(ratio, 0.5);
+        if (meter.luma < p.targetLuma && meter.crushed > 0.5) ratio = std::max(ratio, 2.0);
+        ratio = std::clamp(std::pow(ratio, p.kp), 1.0 / 16.0, 16.0);
+
+        const double exp = lim.hasExp ? (double) std::max(cur.exp, std::max(lim.expMin, 1)) : 1.0;
+        const double total = exp * gainX(p, lim, cur.gain) * ratio;
+
+        double rest = total;
+        if (lim.hasExp) {
+            next.exp = snap(std::min(total, (double) lim.expMax), lim.expMin, lim.expMax,
+                            lim.expStep);
+            rest = total / (double) std::max(next.exp, 1);
+        }
+        if (lim.hasGain) {
+            double g = (double) lim.gainMin;
+            if (lim.gainMax > lim.gainMin && p.maxGainX > 1.0) {
+                g += (rest - 1.0) / (p.maxGainX - 1.0) * (double) (lim.gainMax - lim.gainMin);
+            }
+            next.gain = snap(g, lim.gainMin, lim.gainMax, lim.gainStep);
+        }
+        return next != cur;
+    }
+
+} // namespace uvc
@@ -0,0 +1,52 @@
+// uvc_ae.h
+
+#pragma once
+
+#include "../common/yuv_convert.h"
+
+namespace uvc {
+
+    // What the controller may write. expMax is already capped for the frame rate;
+    // gainMax is the highest gain AE is allowed to use.
+    struct AeLimits {
+        bool hasExp = false;
+        int expMin = 0, expMax = 0, expStep = 1;
+        bool hasGain = false;
+        int gainMin = 0, gainMax = 0, gainStep = 1;
+    };
+
+    struct AeParams {
+        int targetLuma = 124;
+        int tolerance = 15;
+        double kp = 0.85;         // fraction of the log-exposure error corrected per update
+        double gamma = 2.2;       // luma ~ linear signal ^ (1 / gamma)
+        double maxGainX = 4.0;    // gainMax expressed as a linear multiplier over gainMin
+    };
+
+    struct AeSettings {
+        int exp = 0;
+        int gain = 0;
+
+        bool operator==(const AeSettings &o) const { return exp == o.exp && gain == o.gain; }
+
+        bool operator!=(const AeSettings &o) const { return !(*this == o); }
+    };
+
+    // One frame's reading: centre-weighted zone mean, plus the share of samples
+    // blown out (>= 250) or crushed (<= 5) from the histogram.
+    struct AeMeter {
+        double luma = 0.0;
+        double clipped = 0.0;
+        double crushed = 0.0;
+    };
+
+    AeMeter aeMeter(const LumaStats &s);
+
+    // Proportional step in log-exposure space: the total exposure (time x linear gain)
+    // is moved toward the value that lands `meter` on the target in one update, then
+    // split with exposure time first (up to expMax) and gain for the rest. Returns
+    // true with `next` filled when the settings should change.
+    bool aeStep(const AeParams &p, const AeLimits &lim, const AeMeter &meter,
+                const AeSettings &cur, AeSettings &next);
+
+} // namespace uvc
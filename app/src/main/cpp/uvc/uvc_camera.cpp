@@ -1,8 +1,21 @@
 // uvc_camera.cpp
 
 #include "uvc_camera.h"
+#include "mjpeg_decoder.h"
+#include "mjpeg_decode_pool.h"
+#include "mjpeg_slice_decoder.h"
+#include "mjpeg_validator.h"
+#include "uvc_ae.h"
+#include "uvc_caps_cache.h"
+#include "uvc_discovery.h"
+#include "uvc_hotplug.h"
 #include "../common/logging.h"
 #include "../common/time_utils.h"
+#include "../common/frame_mailbox.h"
+#include "../common/present_scheduler.h"
+#include "../common/vsync_monitor.h"
+#include "../common/window_frame.h"
+#include "../common/yuv_convert.h"
 
 #include <android/native_window_jni.h>
 #include <android/native_window.h>
@@ -18,19 +31,22 @@
 #include <linux/v4l2-controls.h>
 
 #include <atomic>
-#include <condition_variable>
+#include <cstdio>
 #include <cstring>
 #include <cmath>
+#include <condition_variable>
+#include <climits>
+#include <memory>
 #include <mutex>
 #include <string>
 #include <thread>
+#include <chrono>
 #include <vector>
 #include <algorithm>
 #include <dlfcn.h>
 
 #include <opencv2/core.hpp>
 #include <opencv2/imgproc.hpp>
-#include <opencv2/imgcodecs.hpp>
 
 #ifndef V4L2_CID_JPEG_COMPRESSION_QUALITY
 #define V4L2_CID_JPEG_COMPRESSION_QUALITY 0x009f090d
@@ -66,8 +82,13 @@
 #ifndef UVC_AE_TOL
 #define UVC_AE_TOL 15
 #endif
-#ifndef UVC_AE_ADJUST_INTERVAL_MS
-#define UVC_AE_ADJUST_INTERVAL_MS 100
+// While the device is gone, how often to retry opening it without a uevent.
+#ifndef UVC_RECONNECT_RETRY_MS
+#define UVC_RECONNECT_RETRY_MS 250
+#endif
+// Frame periods to ignore after a control write while the camera applies it.
+#ifndef UVC_AE_SETTLE_FRAMES
+#define UVC_AE_SETTLE_FRAMES 2
 #endif
 #ifndef UVC_AE_MAX_EXPOSURE_US_CAP
 #define UVC_AE_MAX_EXPOSURE_US_CAP 16000
@@ -85,56 +106,279 @@
 #define UVC_EDGE_PX 24
 #endif
 
-namespace uvc {
+// 1: decLoop converts straight out of the mmap'd V4L2 buffer and requeues it itself.
+// 0: capLoop copies every frame into a mailbox slot and requeues immediately.
+#ifndef UVC_ZERO_COPY_HANDOFF
+#define UVC_ZERO_COPY_HANDOFF 1
+#endif
 
-    static std::mutex gLock;
-    static std::string gLastError;
+#ifndef UVC_BUFFER_COUNT
+#define UVC_BUFFER_COUNT 8
+#endif
 
-    static int gFd = -1;
-    static ANativeWindow *gWin = nullptr;
+// 0: probe MMAP and USERPTR read bandwidth at start and keep the faster one.
+// 1: MMAP only. 2: USERPTR, falling back to MMAP when the driver refuses it.
+#ifndef UVC_MEMORY_MODE
+#define UVC_MEMORY_MODE 0
+#endif
+#ifndef UVC_MEM_PROBE_PASSES
+#define UVC_MEM_PROBE_PASSES 4
+#endif
 
-    struct MmapBuf {
-        void *ptr = nullptr;
-        size_t len = 0;
-    };
-    static std::vector<MmapBuf> gBufs;
+// MJPEG decode workers. 0: size the pool from the measured per-frame decode time
+// against the frame period. 1: decode inline on decLoop. N: fixed pool of N.
+#ifndef UVC_MJPEG_DECODE_WORKERS
+#define UVC_MJPEG_DECODE_WORKERS 0
+#endif
+#ifndef UVC_MJPEG_MAX_WORKERS
+#define UVC_MJPEG_MAX_WORKERS 4
+#endif
 
-    static std::atomic<bool> gRunning{false};
-    static std::thread gThCap;
-    static std::thread gThDec;
+// 0: split frames with restart markers into MCU-row slices decoded in parallel
+//    (lowest latency), otherwise use the frame pool above. 1: never slice.
+#ifndef UVC_MJPEG_DECODE_MODE
+#define UVC_MJPEG_DECODE_MODE 0
+#endif
+#ifndef UVC_MJPEG_SLICE_THREADS
+#define UVC_MJPEG_SLICE_THREADS 0   // 0: from the core count
+#endif
+
+// 1: YUYV / UYVY / YVYU streams go to a YV12 window: planes are only repacked
+// (4:2:2 -> 4:2:0) and the compositor converts colour. The seam keeps its blur but
+// not its alpha ramp (YUV buffers are opaque). MJPEG always renders RGBA.
+#ifndef UVC_WINDOW_YUV
+#define UVC_WINDOW_YUV 0
+#endif
+
+// 1: post each frame at its capture time plus a steady latency budget, aligned to the
+// display vsync, instead of as soon as it is decoded. 0: post immediately.
+#ifndef UVC_PRESENT_PACING
+#define UVC_PRESENT_PACING 1
+#endif
 
-    static std::atomic<long long> gLastFrameTsNs{0};
-    static std::atomic<long long> gPrevFrameTsNs{0};
-    static std::atomic<int> gFpsX100{0};
+namespace uvc {
 
-    static std::atomic<int> gChosenFps{0};
-    static std::atomic<uint32_t> gChosenFourcc{0};
-    static std::atomic<int> gChosenW{0};
-    static std::atomic<int> gChosenH{0};
+    struct CapBuf {
+        void *ptr = nullptr;
+        size_t len = 0;
+    };
 
-    static int gW = 0, gH = 0;
-    static std::atomic<int> gBytesPerLine{0};
+    // USERPTR backing store: one anonymous (cached) mapping, each slot rounded up to
+    // whole pages so every buffer starts page- and therefore cache-line-aligned.
+    struct BufArena {
+        uint8_t *base = nullptr;
+        size_t total = 0;
+        size_t slot = 0;
+    };
 
-    static std::mutex gFrameLock;
-    static std::condition_variable gFrameCv;
-    static std::vector<uint8_t> gFrameBytes;
-    static std::atomic<bool> gFrameReady{false};
+    // capLoop -> decLoop handoff. In zero-copy mode a slot owns a dequeued V4L2 buffer
+    // (bufIdx) until decLoop calls requeueBuf(); in copy mode it carries the bytes.
+    // Frames overwritten before decode count as skipped (decoder too slow).
+    struct FrameSlot {
+        int bufIdx = -1;
+        size_t bytes = 0;
+        long long tsNs = 0;
+        std::vector<uint8_t> copy;
+    };
 
     struct CtrlRange {
         bool ok = false;
         int minV = 0, maxV = 0, step = 1, defV = 0;
     };
-    static std::mutex gCtrlLock;
-    static CtrlRange gExpAbs{};
-    static CtrlRange gGain{};
-    static std::atomic<int> gCurExpAbs{0};
-    static std::atomic<int> gCurGain{0};
-    static std::atomic<bool> gAeEnabled{false};
-    static std::atomic<long long> gLastAeAdjustNs{0};
 
-    static void setErrLocked(const std::string &s) { gLastError = s; }
+    // Everything one external camera owns: device, buffers, threads, controls and
+    // metrics. Instances share nothing but the node claims below, which are only
+    // touched while opening or closing a device.
+    struct UvcCamera::Impl {
+        std::mutex mLock;
+        std::string mLastError;
+
+        // Capability cache: mCaps holds the open device's modes and control ranges, loaded
+        // from mCacheDir or probed in setupLocked, and is written back when it changed.
+        std::string mCacheDir;
+        UvcDeviceCaps mCaps;
+        bool mCapsHit = false;
+        bool mCapsDirty = false;
+        std::string mStartTimings;
+
+        int mFd = -1;
+        ANativeWindow *mWin = nullptr;
+        // Panel compositor layer in place of mWin: mLayer as set, mRunLayer as taken by
+        // the last start (what the render threads use).
+        ComposeLayer *mLayer = nullptr;
+        ComposeLayer *mRunLayer = nullptr;
+
+        std::vector<CapBuf> mBufs;
+        uint32_t mMemory = V4L2_MEMORY_MMAP;
+        BufArena mArena;
+
+        std::atomic<bool> mRunning{false};
+        std::thread mThCap;
+        std::thread mThDec;
+
+        // startAsync worker; mStartMutex guards mThStart only.
+        std::mutex mStartMutex;
+        std::thread mThStart;
+        std::atomic<int> mStartState{kStartIdle};
+
+        // Hot-plug recovery. capLoop raises mParkReq when the device disappears; decLoop
+        // drops every buffer reference and sets mDecParked until the device is reopened.
+        int mDesiredFps = 0;
+        int mNodeIdx = -1;
+        std::atomic<bool> mParkReq{false};
+        std::atomic<bool> mDecParked{false};
+        std::atomic<bool> mDeviceLost{false};
+        std::atomic<int> mReconnects{0};
+        std::atomic<int> mReconnectMs{0};   // device back -> first frame, last reconnect
+
+        // Capture-side timing, all in the CLOCK_BOOTTIME domain. mLastFrameTsNs is the
+        // kernel capture timestamp when the driver provides one, dequeue time otherwise.
+        std::atomic<long long> mLastFrameTsNs{0};
+        std::atomic<int> mFpsX100{0};
+        std::atomic<int> mDequeueLatencyUs{0};
+        std::atomic<uint32_t> mTsSourceFlags{0};
+        std::atomic<long long> mDroppedFrames{0};     // sequence gaps: USB link / driver
+        std::atomic<long long> mRejectedFrames{0};    // corrupt / truncated payloads
+
+        std::atomic<int> mChosenFps{0};
+        std::atomic<uint32_t> mChosenFourcc{0};
+        std::atomic<int> mChosenW{0};
+        std::atomic<int> mChosenH{0};
+
+        int mW = 0, mH = 0;
+        std::atomic<int> mBytesPerLine{0};
+
+        FrameMailbox<FrameSlot> mMailbox;
+        std::atomic<long long> mMailboxDropsBase{0};   // mailbox drops before the last setup
+        bool mZeroCopy = false;
+        bool mYuvOut = false;   // window is YV12 (UVC_WINDOW_YUV)
+        std::atomic<int> mBufsInFlight{0};
+
+        std::atomic<int> mMjpegDecodeUs{0};
+        std::atomic<int> mMjpegWorkersReq{UVC_MJPEG_DECODE_WORKERS};
+        std::atomic<int> mMjpegWorkers{0};
+        std::atomic<int> mMjpegSlices{0};
+        std::atomic<long long> mReorderDrops{0};   // decoded, but a newer frame went first
+
+        // Used by whichever thread presents (decLoop or the pool presenter), one at a time.
+        PresentScheduler mPacer;
+        bool mVsyncHeld = false;
+
+        std::mutex mCtrlLock;
+        CtrlRange mExpAbs{};
+        CtrlRange mGain{};
+        std::atomic<int> mCurExpAbs{0};
+        std::atomic<int> mCurGain{0};
+        std::atomic<bool> mAeEnabled{false};
+
+        // AE: decLoop meters every converted frame and posts new settings; mThAe is the
+        // only thread that writes them, so capture never blocks on a control transfer.
+        // Frames captured before mAeSettleUntilNs still show the previous settings.
+        std::thread mThAe;
+        std::mutex mAeMutex;
+        std::condition_variable mAeCv;
+        bool mAePending = false;
+        AeSettings mAeWant{};
+        AeLimits mAeLimits{};
+        LumaStats mAeStats;   // decLoop only
+        bool mMjpegDirect = false;   // decLoop only: the last MJPEG frame decoded
+        std::atomic<long long> mAeSettleUntilNs{0};
+        std::atomic<int> mAeLuma{0};
+
+        void setErrLocked(const std::string &s) { mLastError = s; }
+
+        void clearErrLocked() { mLastError.clear(); }
+
+        bool queryCtrl(int fd, __u32 id, v4l2_queryctrl &qc);
+
+        CtrlRange readRange(int fd, __u32 id);
+
+        void trySetJpegQualityMax(int fd);
+
+        void aeOnFrame(const LumaStats &st);
+
+        void aeLoop();
+
+        void stopAeThread();
+
+        bool reservePresent(long long tsNs);
+
+        void cancelPresent(long long tsNs);
+
+        void postPaced(WindowFrame &wf, long long tsNs);
+
+        void applyControls(int fd, int chosenFps, uint32_t activeFourcc);
+
+        void fillBuffer(v4l2_buffer &b, uint32_t idx);
+
+        void releaseBuffersLocked();
+
+        bool setupMmapBuffers(uint32_t count);
 
-    static void clearErrLocked() { gLastError.clear(); }
+        bool setupUserptrBuffers(uint32_t count, size_t sizeImage);
+
+        bool setupBuffersLocked(size_t sizeImage, uint32_t known);
+
+        bool queueAllBuffersLocked();
+
+        void closeDeviceLocked();
+
+        void teardownLocked();
+
+        bool setupLocked(int desiredFps, std::string &dbg, const CachedMode *pin = nullptr);
+
+        void requeueBuf(int idx);
+
+        bool lockFromCapture();
+
+        bool recoverDevice(V4l2HotplugListener &uev, long long &backNs);
+
+        void capLoop();
+
+        void presentRgba(cv::Mat &rgba, long long tsNs);
+
+        void decodeAndRender(const uint8_t *data, size_t size, long long tsNs,
+                             cv::Mat &rgbaReuse, MjpegDecoder &jpegDec,
+                             MjpegSliceDecoder *slices);
+
+        // One frame into dst (jw x outH): slice-parallel when prepared, else whole.
+        bool decodeMjpeg(const uint8_t *data, size_t size, cv::Mat &dst,
+                         MjpegDecoder &jpegDec, MjpegSliceDecoder *slices);
+
+        int mjpegWorkerTarget(int decodeUs);
+
+        void decLoop();
+
+        bool startWithWindow(ANativeWindow *win, int desiredFps);
+
+        void joinStarter();
+
+        bool start(JNIEnv *env, jobject surface, int desiredFps);
+
+        bool startAsync(JNIEnv *env, jobject surface, int desiredFps);
+
+        void stop();
+    };
+
+    using Impl = UvcCamera::Impl;
+
+    // /dev/videoN indices an instance has open, so two cameras never pick the same node.
+    static std::mutex gNodeClaimLock;
+    static std::vector<int> gClaimedNodes;
+
+    static bool claimNode(int idx) {
+        std::lock_guard<std::mutex> lk(gNodeClaimLock);
+        if (std::find(gClaimedNodes.begin(), gClaimedNodes.end(), idx) != gClaimedNodes.end())
+            return false;
+        gClaimedNodes.push_back(idx);
+        return true;
+    }
+
+    static void releaseNode(int idx) {
+        std::lock_guard<std::mutex> lk(gNodeClaimLock);
+        gClaimedNodes.erase(std::remove(gClaimedNodes.begin(), gClaimedNodes.end(), idx),
+                            gClaimedNodes.end());
+    }
 
     static int xioctl(int fd, unsigned long req, void *arg) {
         int r;
@@ -152,12 +396,32 @@ namespace uvc {
         return std::string(s);
     }
 
-    static bool queryCtrl(int fd, __u32 id, v4l2_queryctrl &qc) {
+    // Answered from mCaps when the control is cached; otherwise probed and recorded.
+    bool Impl::queryCtrl(int fd, __u32 id, v4l2_queryctrl &qc) {
         std::memset(&qc, 0, sizeof(qc));
         qc.id = id;
-        if (xioctl(fd, VIDIOC_QUERYCTRL, &qc) != 0) return false;
-        if (qc.flags & V4L2_CTRL_FLAG_DISABLED) return false;
-        return true;
+        if (const CachedCtrl *cc = mCaps.findCtrl(id)) {
+            qc.minimum = cc->minV;
+            qc.maximum = cc->maxV;
+            qc.step = cc->step;
+            qc.default_value = cc->defV;
+            return cc->ok;
+        }
+
+        const bool ok = xioctl(fd, VIDIOC_QUERYCTRL, &qc) == 0 &&
+                        !(qc.flags & V4L2_CTRL_FLAG_DISABLED);
+        CachedCtrl cc;
+        cc.id = id;
+        cc.ok = ok;
+        if (ok) {
+            cc.minV = (int) qc.minimum;
+            cc.maxV = (int) qc.maximum;
+            cc.step = (int) qc.step;
+            cc.defV = (int) qc.default_value;
+        }
+        mCaps.ctrls.push_back(cc);
+        mCapsDirty = true;
+        return ok;
     }
 
     static bool getCtrl(int fd, __u32 id, int &outVal) {
@@ -175,7 +439,7 @@ namespace uvc {
         return xioctl(fd, VIDIOC_S_CTRL, &c) == 0;
     }
 
-    static CtrlRange readRange(int fd, __u32 id) {
+    CtrlRange Impl::readRange(int fd, __u32 id) {
         CtrlRange r{};
         v4l2_queryctrl qc{};
         if (!queryCtrl(fd, id, qc)) return r;
@@ -198,10 +462,9 @@ namespace uvc {
         return v;
     }
 
-    static void trySetJpegQualityMax(int fd) {
+    void Impl::trySetJpegQualityMax(int fd) {
         v4l2_queryctrl qc{};
-        qc.id = V4L2_CID_JPEG_COMPRESSION_QUALITY;
-        if (xioctl(fd, VIDIOC_QUERYCTRL, &qc) == 0) {
+        if (queryCtrl(fd, V4L2_CID_JPEG_COMPRESSION_QUALITY, qc)) {
             (void) setCtrl(fd, V4L2_CID_JPEG_COMPRESSION_QUALITY, (int) qc.maximum);
         }
     }
@@ -225,20 +488,53 @@ namespace uvc {
         return true;
     }
 
-    static int openBestNode(std::string &dbg) {
-        int fallback = -1;
+    // Opens and claims the first free capture node. `prefer` (the node this instance had
+    // before a reconnect, or -1) is tried first.
+    static int openBestNode(std::string &dbg, v4l2_capability &capOut, int &indexOut,
+                            int prefer) {
+        // Only the nodes sysfs reports as uvcvideo capture nodes are opened; opening
+        // every /dev/videoN wakes unrelated drivers (ISP, codecs) and costs ~ms each.
+        std::vector<int> nodes = uvcCaptureNodes("/sys");
+        auto it = std::find(nodes.begin(), nodes.end(), prefer);
+        if (it != nodes.end()) std::rotate(nodes.begin(), it, it + 1);
+        for (int i: nodes) {
+            if (!claimNode(i)) continue;   // another UvcCamera streams from it
+            char path[64];
+            std::snprintf(path, sizeof(path), "/dev/video%d", i);
+            int fd = open(path, O_RDWR | O_NONBLOCK);
+            if (fd < 0) {
+                dbg += std::string("SYSFS ") + path + " open errno=" + std::to_string(errno) + "\n";
+                releaseNode(i);
+                continue;
+            }
+            v4l2_capability cap{};
+            if (!isCaptureNode(fd, cap)) {
+                close(fd);
+                releaseNode(i);
+                continue;
+            }
+            dbg += std::string("SELECT ") + path + " (sysfs)\n";
+            capOut = cap;
+            indexOut = i;
+            return fd;
+        }
+
+        // sysfs unreadable (SELinux) or no UVC node listed: probe every node.
+        int fallback = -1, fallbackIdx = -1;
         v4l2_capability fcap{};
         for (int i = 0; i < 64; i++) {
+            if (!claimNode(i)) continue;
             char path[64];
             std::snprintf(path, sizeof(path), "/dev/video%d", i);
             int fd = open(path, O_RDWR | O_NONBLOCK);
             if (fd < 0) {
-                if (errno == ENOENT) continue;
+                releaseNode(i);
                 continue;
             }
             v4l2_capability cap{};
             if (!isCaptureNode(fd, cap)) {
                 close(fd);
+                releaseNode(i);
                 continue;
             }
             bool isUvc = (std::strncmp((const char *) cap.driver, "uvcvideo", 7) == 0);
@@ -246,19 +542,26 @@ namespace uvc {
                 dbg += std::string("SELECT ") + path + "\n";
                 if (fallback >= 0) {
                     close(fallback);
+                    releaseNode(fallbackIdx);
                     fallback = -1;
                 }
+                capOut = cap;
+                indexOut = i;
                 return fd;
             }
             if (fallback < 0) {
                 fallback = fd;
+                fallbackIdx = i;
                 fcap = cap;
             } else {
                 close(fd);
+                releaseNode(i);
             }
         }
         if (fallback >= 0) {
             dbg += std::string("FALLBACK driver=") + (const char *) fcap.driver + "\n";
+            capOut = fcap;
+            indexOut = fallbackIdx;
         }
         return fallback;
     }
@@ -310,28 +613,14 @@ namespace uvc {
     static constexpr double UVC_SHARP_AMOUNT = 0.25;
     static constexpr int UVC_GAIN_MAX_CLAMP = 64; // conservative; raise only if too dark
 
-    static inline void setAlphaRect(cv::Mat &rgba, const cv::Rect &r, uint8_t a) {
-        if (rgba.empty()) return;
-        cv::Rect rr = r & cv::Rect(0, 0, rgba.cols, rgba.rows);
-        if (rr.width <= 0 || rr.height <= 0) return;
-
-        for (int y = rr.y; y < rr.y + rr.height; ++y) {
-            uint8_t *row = rgba.ptr<uint8_t>(y);
-            for (int x = rr.x; x < rr.x + rr.width; ++x) {
-                row[x * 4 + 3] = a;
-            }
-        }
-    }
-
+    // Seam band only: Gaussian blur over the top seamPx rows (rows below are read
+    // as context, not written), then the 0..255 alpha ramp. Every producer in this
+    // file emits opaque RGBA, so the rest of the frame already has alpha = 255.
     static inline void applyTopSeamFeather(cv::Mat &rgba, int seamPx) {
         if (rgba.empty()) return;
         seamPx = std::clamp(seamPx, 1, rgba.rows);
 
-        setAlphaRect(rgba, cv::Rect(0, 0, rgba.cols, rgba.rows), 255);
-
-        cv::Rect seamR(0, 0, rgba.cols, seamPx);
-        cv::Mat seam = rgba(seamR);
-
+        cv::Mat seam = rgba(cv::Rect(0, 0, rgba.cols, seamPx));
         cv::GaussianBlur(seam, seam, cv::Size(0, 0), UVC_SEAM_SIGMA_X, UVC_SEAM_SIGMA_Y);
 
         for (int y = 0; y < seamPx; ++y) {
@@ -339,47 +628,37 @@ namespace uvc {
                     255.0 * (double) y / (double) (seamPx - 1));
             uint8_t *row = rgba.ptr<uint8_t>(y);
             for (int x = 0; x < rgba.cols; ++x) {
-                row[x * 4 + 3] = std::min<uint8_t>(row[x * 4 + 3], a);
+                row[x * 4 + 3] = a;
             }
         }
-
-        if (seamPx < rgba.rows) {
-            setAlphaRect(rgba, cv::Rect(0, seamPx, rgba.cols, rgba.rows - seamPx), 255);
-        }
     }
 
     static inline void applyUvcSeamAndEdgeProcessing(cv::Mat &rgba) {
         if (rgba.empty()) return;
 
-        setAlphaRect(rgba, cv::Rect(0, 0, rgba.cols, rgba.rows), 255);
-
         const int seamPx = std::min(UVC_SEAM_PX, rgba.rows);
         if (seamPx > 0) {
             applyTopSeamFeather(rgba, seamPx);
         }
     }
 
-
-    static int avgLumaYuyvSample(const uint8_t *yuyv, int w, int h, int bytesPerLine) {
-        if (!yuyv || w <= 0 || h <= 0) return 0;
-        if (bytesPerLine <= 0) bytesPerLine = w * 2;
-
-        const int stepX = std::max(1, w / 64);
-        const int stepY = std::max(1, h / 36);
-
-        long long sum = 0;
-        int cnt = 0;
-
-        for (int y = 0; y < h; y += stepY) {
-            const uint8_t *row = yuyv + (size_t) y * (size_t) bytesPerLine;
-            for (int x = 0; x < w; x += stepX) {
-                // In packed YUYV family, Y is at even byte offsets per pixel pair.
-                // For sampling, row[2*x] works as long as row is aligned to the packed format.
-                sum += (int) row[2 * x];
-                cnt++;
-            }
+    // The seam blur of applyTopSeamFeather on a YV12 frame: luma with the RGBA sigmas,
+    // chroma over half the rows with half the sigmas. No alpha to ramp.
+    static void applyUvcSeamBlurYuv(const Yuv420Planes &p, int w, int rows) {
+        const int seamPx = std::min(UVC_SEAM_PX, rows);
+        if (seamPx <= 0 || w <= 0) return;
+        cv::Mat y(rows, w, CV_8UC1, p.y, p.yStride);
+        cv::Mat ySeam = y(cv::Rect(0, 0, w, seamPx));
+        cv::GaussianBlur(ySeam, ySeam, cv::Size(0, 0), UVC_SEAM_SIGMA_X, UVC_SEAM_SIGMA_Y);
+
+        const int cw = w / 2, cRows = rows / 2, cSeam = std::max(1, seamPx / 2);
+        if (cRows <= 0) return;
+        for (uint8_t *plane: {p.u, p.v}) {
+            cv::Mat c(cRows, cw, CV_8UC1, plane, p.uvStride);
+            cv::Mat cSeamRoi = c(cv::Rect(0, 0, cw, std::min(cSeam, cRows)));
+            cv::GaussianBlur(cSeamRoi, cSeamRoi, cv::Size(0, 0), UVC_SEAM_SIGMA_X / 2,
+                             UVC_SEAM_SIGMA_Y / 2);
         }
-        return cnt ? (int) (sum / cnt) : 0;
     }
 
     static int exposureCapAbsForFps(int fps, const CtrlRange &exp) {
@@ -394,107 +673,72 @@ namespace uvc {
         return capAbs;
     }
 
-    static void autoExposureMaybeAdjust(int avgLuma) {
-        if (!gAeEnabled.load(std::memory_order_relaxed)) return;
-        if (avgLuma <= 0) return;
-
-        long long now = nowBoottimeNs();
-        long long last = gLastAeAdjustNs.load(std::memory_order_relaxed);
-        const long long interval = (long long) UVC_AE_ADJUST_INTERVAL_MS * 1000000LL;
-        if (last != 0 && (now - last) < interval) return;
-        if (!gLastAeAdjustNs.compare_exchange_strong(last, now, std::memory_order_relaxed)) return;
-
-        const int target = UVC_AE_TARGET_LUMA;
-        const int tol = UVC_AE_TOL;
-        if (std::abs(avgLuma - target) <= tol) return;
-
-        std::lock_guard<std::mutex> lk(gCtrlLock);
-        if (gFd < 0) return;
-
-        const int fps = std::max(gChosenFps.load(std::memory_order_relaxed), 30);
-        const int expCap = exposureCapAbsForFps(fps, gExpAbs);
-
-        int curExp = gCurExpAbs.load(std::memory_order_relaxed);
-        int curGain = gCurGain.load(std::memory_order_relaxed);
-        int gainMaxEff = gGain.ok ? std::min(gGain.maxV, UVC_GAIN_MAX_CLAMP) : 0;
-
-        if (gExpAbs.ok && curExp == 0) {
-            int v = 0;
-            if (getCtrl(gFd, V4L2_CID_EXPOSURE_ABSOLUTE, v)) curExp = v;
-        }
-        if (gGain.ok && curGain == 0) {
-            int v = 0;
-            if (getCtrl(gFd, V4L2_CID_GAIN, v)) curGain = v;
+    // Decode thread: meter the frame just converted and hand any new settings to mThAe.
+    void Impl::aeOnFrame(const LumaStats &st) {
+        const AeMeter m = aeMeter(st);
+        if (m.luma <= 0.0) return;
+        mAeLuma.store((int) std::lround(m.luma), std::memory_order_relaxed);
+
+        AeParams p;
+        p.targetLuma = UVC_AE_TARGET_LUMA;
+        p.tolerance = UVC_AE_TOL;
+        const AeSettings cur{mCurExpAbs.load(std::memory_order_relaxed),
+                             mCurGain.load(std::memory_order_relaxed)};
+        AeSettings next;
+        if (!aeStep(p, mAeLimits, m, cur, next)) return;
+
+        mAeSettleUntilNs.store(LLONG_MAX, std::memory_order_relaxed);
+        {
+            std::lock_guard<std::mutex> lk(mAeMutex);
+            mAeWant = next;
+            mAePending = true;
         }
+        mAeCv.notify_one();
+    }
 
-        bool changed = false;
-
-        if (avgLuma > target + tol) {
-            if (gGain.ok && curGain > gGain.minV) {
-                int next = clampToRange(gGain, curGain - gGain.step);
-                if (next != curGain && setCtrl(gFd, V4L2_CID_GAIN, next)) {
-                    curGain = next;
-                    changed = true;
-                }
-            } else if (gExpAbs.ok && curExp > gExpAbs.minV) {
-                int next = clampToRange(gExpAbs, curExp - gExpAbs.step);
-                if (next != curExp && setCtrl(gFd, V4L2_CID_EXPOSURE_ABSOLUTE, next)) {
-                    curExp = next;
-                    changed = true;
-                }
+    void Impl::aeLoop() {
+        for (;;) {
+            AeSettings want;
+            {
+                std::unique_lock<std::mutex> lk(mAeMutex);
+                mAeCv.wait(lk, [this] { return mAePending || !mRunning.load(); });
+                if (!mRunning.load()) return;
+                want = mAeWant;
+                mAePending = false;
             }
-        } else if (avgLuma < target - tol) {
-            if (gExpAbs.ok && expCap > 0 && curExp < expCap) {
-                int next = std::min(curExp + gExpAbs.step, expCap);
-                next = clampToRange(gExpAbs, next);
-                if (next != curExp && setCtrl(gFd, V4L2_CID_EXPOSURE_ABSOLUTE, next)) {
-                    curExp = next;
-                    changed = true;
+            {
+                std::lock_guard<std::mutex> lk(mCtrlLock);
+                // Device gone; capLoop is reopening it and will redo the controls. Nothing
+                // was applied, so nothing to wait for: meter again from the next frame.
+                if (mFd < 0 || mDeviceLost.load(std::memory_order_relaxed)) {
+                    mAeSettleUntilNs.store(0, std::memory_order_relaxed);
+                    continue;
                 }
-            } else if (gGain.ok && gainMaxEff > 0 && curGain < gainMaxEff) {
-                int step = std::max(1, gGain.step);
-                int next = clampToRange(gGain, curGain + step);
-                next = std::min(next, gainMaxEff);
-                next = clampToRange(gGain, next);
-                if (next != curGain && setCtrl(gFd, V4L2_CID_GAIN, next)) {
-                    curGain = next;
-                    changed = true;
+                if (mExpAbs.ok && want.exp != mCurExpAbs.load(std::memory_order_relaxed) &&
+                    setCtrl(mFd, V4L2_CID_EXPOSURE_ABSOLUTE, want.exp)) {
+                    mCurExpAbs.store(want.exp, std::memory_order_relaxed);
+                }
+                if (mGain.ok && want.gain != mCurGain.load(std::memory_order_relaxed) &&
+                    setCtrl(mFd, V4L2_CID_GAIN, want.gain)) {
+                    mCurGain.store(want.gain, std::memory_order_relaxed);
                 }
             }
-        }
-
-        if (changed) {
-            gCurExpAbs.store(curExp, std::memory_order_relaxed);
-            gCurGain.store(curGain, std::memory_order_relaxed);
+            const int fps = std::max(mChosenFps.load(std::memory_order_relaxed), 1);
+            mAeSettleUntilNs.store(nowBoottimeNs() + UVC_AE_SETTLE_FRAMES * 1000000000LL / fps,
+                                   std::memory_order_relaxed);
         }
     }
 
-    static void renderRgbaToWindow(const uint8_t *rgba, int w, int h) {
-        if (!gWin) return;
-        ANativeWindow_Buffer out{};
-        if (ANativeWindow_lock(gWin, &out, nullptr) != 0) return;
-
-        uint8_t *dst = (uint8_t *) out.bits;
-        int dstStride = out.stride * 4;
-        int srcStride = w * 4;
-
-        int copyH = std::min(h, out.height);
-        int copyWBytes = std::min(w, out.width) * 4;
-
-        for (int y = 0; y < copyH; y++) {
-            std::memcpy(dst + y * dstStride, rgba + y * srcStride, copyWBytes);
-            if (copyWBytes < dstStride) {
-                std::memset(dst + y * dstStride + copyWBytes, 0, (size_t) (dstStride - copyWBytes));
-            }
-        }
-        for (int y = copyH; y < out.height; y++) {
-            std::memset(dst + y * dstStride, 0, (size_t) dstStride);
+    void Impl::stopAeThread() {
+        {
+            std::lock_guard<std::mutex> lk(mAeMutex);
+            mAePending = false;
         }
-
-        ANativeWindow_unlockAndPost(gWin);
+        mAeCv.notify_all();
+        if (mThAe.joinable()) mThAe.join();
     }
 
-    static void applyControls(int fd, int chosenFps, uint32_t activeFourcc) {
+    void Impl::applyControls(int fd, int chosenFps, uint32_t activeFourcc) {
         {
             v4l2_queryctrl qc{};
             if (queryCtrl(fd, V4L2_CID_POWER_LINE_FREQUENCY, qc)) {
@@ -525,16 +769,14 @@ namespace uvc {
 
         {
             v4l2_queryctrl qc{};
-            qc.id = V4L2_CID_SHARPNESS;
-            if (xioctl(fd, VIDIOC_QUERYCTRL, &qc) == 0) {
+            if (queryCtrl(fd, V4L2_CID_SHARPNESS, qc)) {
                 setCtrl(fd, V4L2_CID_SHARPNESS, 50);
             }
         }
 
         {
             v4l2_queryctrl qc{};
-            qc.id = V4L2_CID_GAMMA;
-            if (xioctl(fd, VIDIOC_QUERYCTRL, &qc) == 0) {
+            if (queryCtrl(fd, V4L2_CID_GAMMA, qc)) {
                 setCtrl(fd, V4L2_CID_GAMMA, (int) qc.default_value);
             }
         }
@@ -558,8 +800,8 @@ namespace uvc {
             bool gainOk = queryCtrl(fd, V4L2_CID_GAIN, qc);
             bool autogOk = queryCtrl(fd, V4L2_CID_AUTOGAIN, qc);
 
-            gExpAbs = readRange(fd, V4L2_CID_EXPOSURE_ABSOLUTE);
-            gGain = readRange(fd, V4L2_CID_GAIN);
+            mExpAbs = readRange(fd, V4L2_CID_EXPOSURE_ABSOLUTE);
+            mGain = readRange(fd, V4L2_CID_GAIN);
 
             if (isMjpeg) {
                 if (expAutoOk) {
@@ -568,7 +810,7 @@ namespace uvc {
                 if (autogOk) {
                     (void) setCtrl(fd, V4L2_CID_AUTOGAIN, 1);
                 }
-                gAeEnabled.store(false, std::memory_order_relaxed);
+                mAeEnabled.store(false, std::memory_order_relaxed);
             } else {
                 if (expAutoOk && expAbsOk) {
                     (void) setCtrl(fd, V4L2_CID_EXPOSURE_AUTO, V4L2_EXPOSURE_MANUAL);
@@ -578,24 +820,40 @@ namespace uvc {
                 }
 
                 const int fps = chosenFps > 0 ? chosenFps : 60;
-                const int expCap = exposureCapAbsForFps(fps, gExpAbs);
+                const int expCap = exposureCapAbsForFps(fps, mExpAbs);
 
-                if (gExpAbs.ok && expCap > 0) {
-                    int initExp = gExpAbs.minV + (int) ((expCap - gExpAbs.minV) * 0.25f);
-                    initExp = clampToRange(gExpAbs, initExp);
+                if (mExpAbs.ok && expCap > 0) {
+                    int initExp = mExpAbs.minV + (int) ((expCap - mExpAbs.minV) * 0.25f);
+                    initExp = clampToRange(mExpAbs, initExp);
                     if (setCtrl(fd, V4L2_CID_EXPOSURE_ABSOLUTE, initExp)) {
-                        gCurExpAbs.store(initExp, std::memory_order_relaxed);
+                        mCurExpAbs.store(initExp, std::memory_order_relaxed);
                     }
                 }
-                if (gGain.ok) {
-                    int initGain = gGain.minV;
-                    initGain = clampToRange(gGain, initGain);
+                if (mGain.ok) {
+                    int initGain = mGain.minV;
+                    initGain = clampToRange(mGain, initGain);
                     if (setCtrl(fd, V4L2_CID_GAIN, initGain)) {
-                        gCurGain.store(initGain, std::memory_order_relaxed);
+                        mCurGain.store(initGain, std::memory_order_relaxed);
                     }
                 }
 
-                gAeEnabled.store(gExpAbs.ok || gGain.ok, std::memory_order_relaxed);
+                mAeLimits = AeLimits{};
+                mAeLimits.hasExp = mExpAbs.ok && expCap > 0;
+                if (mAeLimits.hasExp) {
+                    mAeLimits.expMin = mExpAbs.minV;
+                    mAeLimits.expMax = expCap;
+                    mAeLimits.expStep = std::max(1, mExpAbs.step);
+                }
+                mAeLimits.hasGain = mGain.ok;
+                if (mGain.ok) {
+                    mAeLimits.gainMin = mGain.minV;
+                    mAeLimits.gainMax = std::max(mGain.minV,
+                                                 clampToRange(mGain, std::min(mGain.maxV,
+                                                                              UVC_GAIN_MAX_CLAMP)));
+                    mAeLimits.gainStep = std::max(1, mGain.step);
+                }
+                mAeEnabled.store(mAeLimits.hasExp || mAeLimits.hasGain,
+                                 std::memory_order_relaxed);
             }
         }
     }
@@ -661,8 +919,9 @@ namespace uvc {
         int scoreMeet = 0;
     };
 
-    static std::vector<ModeCand> buildCandidates(int fd, int desiredFps) {
-        std::vector<ModeCand> out;
+    // The ENUM_FRAMESIZES / ENUM_FRAMEINTERVALS walk; what the capability cache stores.
+    static std::vector<CachedMode> enumModes(int fd) {
+        std::vector<CachedMode> out;
 
         const uint32_t fmts[] = {V4L2_PIX_FMT_YUYV, V4L2_PIX_FMT_MJPEG};
 
@@ -674,20 +933,30 @@ namespace uvc {
             }
 
             for (auto &s: sizes) {
-                int w = s.first;
-                int h = s.second;
-                if (w <= 0 || h <= 0) continue;
-
-                int m = enumMaxFpsFor(fd, f, w, h);
-                ModeCand c{};
-                c.w = w;
-                c.h = h;
-                c.f = f;
-                c.maxFps = m;
-                c.scoreMeet = (m >= desiredFps) ? 1 : 0;
-                out.push_back(c);
+                if (s.first <= 0 || s.second <= 0) continue;
+                CachedMode m;
+                m.fourcc = f;
+                m.w = s.first;
+                m.h = s.second;
+                m.maxFps = enumMaxFpsFor(fd, f, s.first, s.second);
+                out.push_back(m);
             }
         }
+        return out;
+    }
+
+    static std::vector<ModeCand> buildCandidates(const std::vector<CachedMode> &modes,
+                                                 int desiredFps) {
+        std::vector<ModeCand> out;
+        for (const auto &m: modes) {
+            ModeCand c{};
+            c.w = m.w;
+            c.h = m.h;
+            c.f = m.fourcc;
+            c.maxFps = m.maxFps;
+            c.scoreMeet = (m.maxFps >= desiredFps) ? 1 : 0;
+            out.push_back(c);
+        }
 
         std::sort(out.begin(), out.end(), [](const ModeCand &a, const ModeCand &b) {
             bool aIsYuyv = (a.f == V4L2_PIX_FMT_YUYV);
@@ -720,56 +989,270 @@ namespace uvc {
         return out;
     }
 
-    static void teardownLocked() {
-        if (gFd >= 0) {
+    void Impl::fillBuffer(v4l2_buffer &b, uint32_t idx) {
+        b.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        b.memory = mMemory;
+        b.index = idx;
+        if (mMemory == V4L2_MEMORY_USERPTR && idx < mBufs.size()) {
+            b.m.userptr = (unsigned long) mBufs[idx].ptr;
+            b.length = (__u32) mBufs[idx].len;
+        }
+    }
+
+    void Impl::releaseBuffersLocked() {
+        if (mMemory == V4L2_MEMORY_MMAP) {
+            for (auto &b: mBufs) {
+                if (b.ptr && b.len) munmap(b.ptr, b.len);
+            }
+        }
+        if (mFd >= 0 && !mBufs.empty()) {
+            v4l2_requestbuffers req{};
+            req.count = 0;
+            req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+            req.memory = mMemory;
+            (void) xioctl(mFd, VIDIOC_REQBUFS, &req);
+        }
+        mBufs.clear();
+        if (mArena.base) {
+            munmap(mArena.base, mArena.total);
+            mArena = {};
+        }
+        mMemory = V4L2_MEMORY_MMAP;
+    }
+
+    bool Impl::setupMmapBuffers(uint32_t count) {
+        v4l2_requestbuffers req{};
+        req.count = count;
+        req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        req.memory = V4L2_MEMORY_MMAP;
+        if (xioctl(mFd, VIDIOC_REQBUFS, &req) != 0 || req.count < 2) {
+            setErrLocked("VIDIOC_REQBUFS failed");
+            return false;
+        }
+
+        mMemory = V4L2_MEMORY_MMAP;
+        mBufs.assign(req.count, {});
+        for (uint32_t i = 0; i < req.count; i++) {
+            v4l2_buffer b{};
+            fillBuffer(b, i);
+            if (xioctl(mFd, VIDIOC_QUERYBUF, &b) != 0) {
+                setErrLocked("VIDIOC_QUERYBUF failed");
+                return false;
+            }
+            void *p = mmap(nullptr, b.length, PROT_READ | PROT_WRITE, MAP_SHARED, mFd, b.m.offset);
+            if (p == MAP_FAILED) {
+                setErrLocked("mmap failed");
+                return false;
+            }
+            mBufs[i].ptr = p;
+            mBufs[i].len = b.length;
+        }
+        return true;
+    }
+
+    bool Impl::setupUserptrBuffers(uint32_t count, size_t sizeImage) {
+        if (sizeImage == 0) return false;
+
+        const size_t page = (size_t) sysconf(_SC_PAGESIZE);
+        const size_t slot = (sizeImage + page - 1) / page * page;
+        const size_t total = slot * count;
+        void *base = mmap(nullptr, total, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS,
+                          -1, 0);
+        if (base == MAP_FAILED) return false;
+        // Fault every page in now so neither the probe nor the first frames hit the zero page.
+        std::memset(base, 0, total);
+
+        v4l2_requestbuffers req{};
+        req.count = count;
+        req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        req.memory = V4L2_MEMORY_USERPTR;
+        if (xioctl(mFd, VIDIOC_REQBUFS, &req) != 0 || req.count < 2) {
+            munmap(base, total);
+            return false;
+        }
+
+        mArena.base = (uint8_t *) base;
+        mArena.total = total;
+        mArena.slot = slot;
+        mMemory = V4L2_MEMORY_USERPTR;
+        mBufs.assign(std::min(req.count, count), {});
+        for (size_t i = 0; i < mBufs.size(); i++) {
+            mBufs[i].ptr = mArena.base + i * slot;
+            mBufs[i].len = slot;
+        }
+        return true;
+    }
+
+    static double measureReadMBps(const void *p, size_t len) {
+        if (!p || len < 4096) return 0.0;
+        const size_t n = len / sizeof(uint64_t);
+        const uint64_t *w = (const uint64_t *) p;
+        uint64_t acc = 0;
+
+        long long t0 = nowBoottimeNs();
+        for (int pass = 0; pass < UVC_MEM_PROBE_PASSES; pass++) {
+            for (size_t i = 0; i < n; i++) acc += w[i];
+        }
+        long long dt = nowBoottimeNs() - t0;
+
+        volatile uint64_t sink = acc;   // keeps the loop; local, instances probe concurrently
+        (void) sink;
+        if (dt <= 0) return 0.0;
+        return (double) (n * sizeof(uint64_t)) * UVC_MEM_PROBE_PASSES * 1e3 / (double) dt;
+    }
+
+    // `known` is the memory type that won the read probe last time for this mode
+    // (0 = unknown); when set, the probe is skipped.
+    bool Impl::setupBuffersLocked(size_t sizeImage, uint32_t known) {
+        const uint32_t count = UVC_BUFFER_COUNT;
+        const int mode = UVC_MEMORY_MODE;
+        if (mode == 1) return setupMmapBuffers(count);
+        if (mode == 0 && known == V4L2_MEMORY_MMAP) return setupMmapBuffers(count);
+        if (mode == 0 && known == V4L2_MEMORY_USERPTR) {
+            return setupUserptrBuffers(count, sizeImage) || setupMmapBuffers(count);
+        }
+
+        double mmapMBps = 0.0;
+        if (mode == 0) {
+            if (setupMmapBuffers(count)) mmapMBps = measureReadMBps(mBufs[0].ptr, mBufs[0].len);
+            releaseBuffersLocked();
+        }
+
+        if (setupUserptrBuffers(count, sizeImage)) {
+            if (mode == 2) return true;
+            double userMBps = measureReadMBps(mBufs[0].ptr, mBufs[0].len);
+            ALOGI("UVC read probe: MMAP %.0f MB/s, USERPTR %.0f MB/s", mmapMBps, userMBps);
+            if (userMBps >= mmapMBps) return true;
+            releaseBuffersLocked();
+        } else {
+            ALOGI("UVC USERPTR refused by driver, using MMAP");
+        }
+        return setupMmapBuffers(count);
+    }
+
+    bool Impl::queueAllBuffersLocked() {
+        for (uint32_t i = 0; i < (uint32_t) mBufs.size(); i++) {
+            v4l2_buffer b{};
+            fillBuffer(b, i);
+            if (xioctl(mFd, VIDIOC_QBUF, &b) != 0) return false;
+        }
+        return true;
+    }
+
+    // Stream, buffers and fd only; the window and all statistics stay.
+    void Impl::closeDeviceLocked() {
+        if (mFd >= 0) {
             v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-            (void) xioctl(gFd, VIDIOC_STREAMOFF, &type);
+            (void) xioctl(mFd, VIDIOC_STREAMOFF, &type);
+        }
+        releaseBuffersLocked();
+        int fd;
+        {
+            std::lock_guard<std::mutex> lk(mCtrlLock);
+            fd = mFd;
+            mFd = -1;
+        }
+        if (fd >= 0) {
+            close(fd);
+            releaseNode(mNodeIdx);   // mNodeIdx stays: a reconnect prefers the same node
         }
-        for (auto &b: gBufs) {
-            if (b.ptr && b.len) munmap(b.ptr, b.len);
+    }
+
+    void Impl::teardownLocked() {
+        closeDeviceLocked();
+        if (mWin) {
+            ANativeWindow_release(mWin);
+            mWin = nullptr;
         }
-        gBufs.clear();
-        if (gFd >= 0) {
-            close(gFd);
-            gFd = -1;
+        {
+            mMailbox.reset([](FrameSlot &fs) {
+                fs.bufIdx = -1;
+                fs.bytes = 0;
+                std::vector<uint8_t>().swap(fs.copy);
+            });
         }
-        if (gWin) {
-            ANativeWindow_release(gWin);
-            gWin = nullptr;
+        mZeroCopy = false;
+        mYuvOut = false;
+        mBufsInFlight.store(0, std::memory_order_relaxed);
+        mMjpegDecodeUs.store(0, std::memory_order_relaxed);
+        mMjpegWorkers.store(0, std::memory_order_relaxed);
+        mMjpegSlices.store(0, std::memory_order_relaxed);
+        mReorderDrops.store(0, std::memory_order_relaxed);
+        mPacer.reset();
+        if (mVsyncHeld) {
+            vsyncMonitorRelease();
+            mVsyncHeld = false;
         }
+        mLastFrameTsNs.store(0, std::memory_order_relaxed);
+        mFpsX100.store(0, std::memory_order_relaxed);
+        mDequeueLatencyUs.store(0, std::memory_order_relaxed);
+        mTsSourceFlags.store(0, std::memory_order_relaxed);
+        mDroppedFrames.store(0, std::memory_order_relaxed);
+        mRejectedFrames.store(0, std::memory_order_relaxed);
+        mMailboxDropsBase.store(0, std::memory_order_relaxed);
+        mChosenFps.store(0, std::memory_order_relaxed);
+        mChosenFourcc.store(0, std::memory_order_relaxed);
+        mChosenW.store(0, std::memory_order_relaxed);
+        mChosenH.store(0, std::memory_order_relaxed);
+        mAeEnabled.store(false, std::memory_order_relaxed);
+        mExpAbs = {};
+        mGain = {};
+        mCurExpAbs.store(0, std::memory_order_relaxed);
+        mCurGain.store(0, std::memory_order_relaxed);
+        mAeLimits = {};
+        mAePending = false;
+        mAeSettleUntilNs.store(0, std::memory_order_relaxed);
+        mAeLuma.store(0, std::memory_order_relaxed);
+        mParkReq.store(false, std::memory_order_relaxed);
+        mDecParked.store(false, std::memory_order_relaxed);
+        mDeviceLost.store(false, std::memory_order_relaxed);
+        mReconnects.store(0, std::memory_order_relaxed);
+        mReconnectMs.store(0, std::memory_order_relaxed);
+        mNodeIdx = -1;
+        mW = 0;
+        mH = 0;
+        mLastError.clear();   // callers hold mLock
+    }
+
+    // `pin`, when given, is tried before anything else (the mode a reconnect restores).
+    bool Impl::setupLocked(int desiredFps, std::string &dbg, const CachedMode *pin) {
+        const long long t0 = nowBoottimeNs();
+        long long tPhase = t0;
+        std::string timings;
+        const auto phase = [&](const char *name) {
+            const long long now = nowBoottimeNs();
+            char s[48];
+            std::snprintf(s, sizeof(s), "%s=%.1fms ", name, (double) (now - tPhase) / 1e6);
+            timings += s;
+            tPhase = now;
+        };
+
+        v4l2_capability cap{};
+        int nodeIdx = -1;
+        const int fd = openBestNode(dbg, cap, nodeIdx, pin ? mNodeIdx : -1);
         {
-            std::lock_guard<std::mutex> lk(gFrameLock);
-            gFrameBytes.clear();
-            gFrameReady.store(false, std::memory_order_relaxed);
-        }
-        gLastFrameTsNs.store(0, std::memory_order_relaxed);
-        gPrevFrameTsNs.store(0, std::memory_order_relaxed);
-        gFpsX100.store(0, std::memory_order_relaxed);
-        gChosenFps.store(0, std::memory_order_relaxed);
-        gChosenFourcc.store(0, std::memory_order_relaxed);
-        gChosenW.store(0, std::memory_order_relaxed);
-        gChosenH.store(0, std::memory_order_relaxed);
-        gAeEnabled.store(false, std::memory_order_relaxed);
-        gExpAbs = {};
-        gGain = {};
-        gCurExpAbs.store(0, std::memory_order_relaxed);
-        gCurGain.store(0, std::memory_order_relaxed);
-        gLastAeAdjustNs.store(0, std::memory_order_relaxed);
-        gW = 0;
-        gH = 0;
-        std::lock_guard<std::mutex> lk(gLock);
-        gLastError.clear();
-    }
-
-    static bool setupLocked(int desiredFps, std::string &dbg) {
-        gFd = openBestNode(dbg);
-        if (gFd < 0) {
+            std::lock_guard<std::mutex> lk(mCtrlLock);
+            mFd = fd;
+        }
+        if (mFd < 0) {
             setErrLocked("UVC device open failed.\n" + dbg);
             return false;
         }
+        phase("open");
+        mNodeIdx = nodeIdx;   // claimed until closeDeviceLocked
+
+        const std::string key = uvcDeviceKey((const char *) cap.driver, (const char *) cap.card,
+                                             (const char *) cap.bus_info, uvcVidPid(nodeIdx));
+        mCapsHit = loadDeviceCaps(mCacheDir, key, mCaps);
+        mCapsDirty = !mCapsHit;
+        if (!mCapsHit) {
+            mCaps = UvcDeviceCaps{};
+            mCaps.key = key;
+            mCaps.modes = enumModes(mFd);
+        }
+        phase(mCapsHit ? "enum(cached)" : "enum");
 
         const int want = (desiredFps > 0 ? desiredFps : 60);
-        auto cands = buildCandidates(gFd, want);
 
         v4l2_format fmt{};
         bool ok = false;
@@ -779,305 +1262,944 @@ namespace uvc {
         int bestW = 0, bestH = 0;
         uint32_t bestFourcc = 0;
 
-        for (const auto &c: cands) {
-            if (!trySetFormat(gFd, c.w, c.h, c.f, fmt)) continue;
+        for (int pass = 0; pass < 2 && !ok; pass++) {
+            if (pass == 1) {
+                if (!mCapsHit) break;
+                // The cached modes no longer apply (firmware update, different unit on
+                // the same port); probe again and replace the entry.
+                ALOGI("UVC capability cache stale, re-enumerating");
+                mCaps = UvcDeviceCaps{};
+                mCaps.key = key;
+                mCaps.modes = enumModes(mFd);
+                mCapsHit = false;
+                mCapsDirty = true;
+            }
 
-            int tryFps = want;
-            if (c.maxFps > 0) tryFps = std::min(tryFps, c.maxFps);
-            trySetFps(gFd, tryFps);
-            trySetJpegQualityMax(gFd);
+            auto cands = buildCandidates(mCaps.modes, want);
+            // Last run's mode first when it was chosen for the same request.
+            if (mCaps.hasGood && mCaps.goodDesiredFps == want) {
+                auto it = std::find_if(cands.begin(), cands.end(), [this](const ModeCand &c) {
+                    return c.f == mCaps.goodFourcc && c.w == mCaps.goodW && c.h == mCaps.goodH;
+                });
+                if (it != cands.end()) std::rotate(cands.begin(), it, it + 1);
+            }
+            if (pin) {
+                auto it = std::find_if(cands.begin(), cands.end(), [pin](const ModeCand &c) {
+                    return c.f == pin->fourcc && c.w == pin->w && c.h == pin->h;
+                });
+                if (it != cands.end()) std::rotate(cands.begin(), it, it + 1);
+            }
 
-            int got = readFps(gFd, tryFps);
+            for (const auto &c: cands) {
+                if (!trySetFormat(mFd, c.w, c.h, c.f, fmt)) continue;
 
-            applyControls(gFd, got, fmt.fmt.pix.pixelformat);
+                int tryFps = want;
+                if (c.maxFps > 0) tryFps = std::min(tryFps, c.maxFps);
+                trySetFps(mFd, tryFps);
 
-            ok = true;
-            bestGotFps = got;
-            bestFmt = fmt;
-            bestW = (int) fmt.fmt.pix.width;
-            bestH = (int) fmt.fmt.pix.height;
-            bestFourcc = fmt.fmt.pix.pixelformat;
-            break;
+                ok = true;
+                bestGotFps = readFps(mFd, tryFps);
+                bestFmt = fmt;
+                bestW = (int) fmt.fmt.pix.width;
+                bestH = (int) fmt.fmt.pix.height;
+                bestFourcc = fmt.fmt.pix.pixelformat;
+                break;
+            }
         }
 
         if (!ok) {
             setErrLocked("VIDIOC_S_FMT failed (no candidate worked)");
             return false;
         }
+        phase("format");
+
+        trySetJpegQualityMax(mFd);
+        applyControls(mFd, bestGotFps, bestFourcc);
+        phase("controls");
+
+        (void) trySetFormat(mFd, bestW, bestH, bestFourcc, fmt);
+        mChosenFps.store(bestGotFps > 0 ? bestGotFps : want, std::memory_order_relaxed);
+        mW = (int) fmt.fmt.pix.width;
+        mH = (int) fmt.fmt.pix.height;
+        mChosenFourcc.store(fmt.fmt.pix.pixelformat, std::memory_order_relaxed);
+        mBytesPerLine.store((int) fmt.fmt.pix.bytesperline, std::memory_order_relaxed);
+
+        const int cropH = (int) (mH * UVC_CROP_HEIGHT_RATIO);
+        mChosenW.store(mW, std::memory_order_relaxed);
+        mChosenH.store(cropH, std::memory_order_relaxed);
+
+        const bool sameAsGood = mCaps.hasGood && mCaps.goodFourcc == bestFourcc &&
+                                mCaps.goodW == bestW && mCaps.goodH == bestH;
+        if (!setupBuffersLocked((size_t) fmt.fmt.pix.sizeimage,
+                                sameAsGood ? mCaps.goodMemory : 0))
+            return false;
 
-        (void) trySetFormat(gFd, bestW, bestH, bestFourcc, fmt);
-        gChosenFps.store(bestGotFps > 0 ? bestGotFps : want, std::memory_order_relaxed);
-        gW = (int) fmt.fmt.pix.width;
-        gH = (int) fmt.fmt.pix.height;
-        gChosenFourcc.store(fmt.fmt.pix.pixelformat, std::memory_order_relaxed);
-        gBytesPerLine.store((int) fmt.fmt.pix.bytesperline, std::memory_order_relaxed);
-
-        const int cropH = (int) (gH * UVC_CROP_HEIGHT_RATIO);
-        gChosenW.store(gW, std::memory_order_relaxed);
-        gChosenH.store(cropH, std::memory_order_relaxed);
-
-        v4l2_requestbuffers req{};
-        req.count = 8;
-        req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-        req.memory = V4L2_MEMORY_MMAP;
-        if (xioctl(gFd, VIDIOC_REQBUFS, &req) != 0 || req.count < 2) {
-            setErrLocked("VIDIOC_REQBUFS failed");
+        bool queued = queueAllBuffersLocked();
+        if (!queued && mMemory == V4L2_MEMORY_USERPTR) {
+            // Some drivers take USERPTR at REQBUFS and only reject the pointers at QBUF.
+            // Freeing the queue (REQBUFS 0) drops the buffers already queued.
+            ALOGI("UVC USERPTR QBUF refused by driver, using MMAP");
+            releaseBuffersLocked();
+            if (!setupMmapBuffers(UVC_BUFFER_COUNT)) return false;
+            queued = queueAllBuffersLocked();
+        }
+        if (!queued) {
+            setErrLocked("VIDIOC_QBUF failed");
             return false;
         }
+        phase("buffers");
 
-        gBufs.assign(req.count, {});
-        for (uint32_t i = 0; i < req.count; i++) {
-            v4l2_buffer b{};
-            b.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-            b.memory = V4L2_MEMORY_MMAP;
-            b.index = i;
-            if (xioctl(gFd, VIDIOC_QUERYBUF, &b) != 0) {
-                setErrLocked("VIDIOC_QUERYBUF failed");
-                return false;
-            }
-            void *p = mmap(nullptr, b.length, PROT_READ | PROT_WRITE, MAP_SHARED, gFd, b.m.offset);
-            if (p == MAP_FAILED) {
-                setErrLocked("mmap failed");
-                return false;
-            }
-            gBufs[i].ptr = p;
-            gBufs[i].len = b.length;
-            if (xioctl(gFd, VIDIOC_QBUF, &b) != 0) {
-                setErrLocked("VIDIOC_QBUF failed");
-                return false;
-            }
-        }
+        // Two buffers may sit in userspace (one pending, one being decoded); keep at
+        // least two queued so the driver never starves.
+        mZeroCopy = UVC_ZERO_COPY_HANDOFF && mBufs.size() >= 4;
 
         v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-        if (xioctl(gFd, VIDIOC_STREAMON, &type) != 0) {
+        if (xioctl(mFd, VIDIOC_STREAMON, &type) != 0) {
             setErrLocked("VIDIOC_STREAMON failed");
             return false;
         }
-
-        if (gWin) {
-            (void) ANativeWindow_setBuffersGeometry(gWin, gW, cropH,
-                                                    AHARDWAREBUFFER_FORMAT_R8G8B8A8_UNORM);
-            int fps = gChosenFps.load(std::memory_order_relaxed);
-            trySetFrameRate(gWin, (float) (fps > 0 ? fps : want));
+        phase("streamon");
+
+        const int gotFps = mChosenFps.load(std::memory_order_relaxed);
+        if (!sameAsGood || mCaps.goodDesiredFps != want || mCaps.goodFps != gotFps ||
+            mCaps.goodMemory != mMemory) {
+            mCaps.hasGood = true;
+            mCaps.goodDesiredFps = want;
+            mCaps.goodFourcc = bestFourcc;
+            mCaps.goodW = bestW;
+            mCaps.goodH = bestH;
+            mCaps.goodFps = gotFps;
+            mCaps.goodMemory = mMemory;
+            mCapsDirty = true;
+        }
+        if (mCapsDirty && saveDeviceCaps(mCacheDir, mCaps)) mCapsDirty = false;
+        phase("cache");
+
+        char total[64];
+        std::snprintf(total, sizeof(total), "total=%.1fms cache=%s",
+                      (double) (nowBoottimeNs() - t0) / 1e6, mCapsHit ? "hit" : "miss");
+        mStartTimings = timings + total;
+        ALOGI("UVC start: %s", mStartTimings.c_str());
+
+        if (mWin) {
+            const uint32_t f = mChosenFourcc.load(std::memory_order_relaxed);
+            const bool packed = f == V4L2_PIX_FMT_YUYV || f == V4L2_PIX_FMT_UYVY ||
+                                f == V4L2_PIX_FMT_YVYU;
+            // YV12 needs an even height; the odd last row, if any, is not shown.
+            mYuvOut = UVC_WINDOW_YUV && packed && cropH >= 2 &&
+                      ANativeWindow_setBuffersGeometry(mWin, mW, cropH & ~1,
+                                                       AHARDWAREBUFFER_FORMAT_YV12) == 0;
+            if (!mYuvOut)
+                (void) ANativeWindow_setBuffersGeometry(mWin, mW, cropH,
+                                                        AHARDWAREBUFFER_FORMAT_R8G8B8A8_UNORM);
+            int fps = mChosenFps.load(std::memory_order_relaxed);
+            trySetFrameRate(mWin, (float) (fps > 0 ? fps : want));
         }
 
         {
-            std::lock_guard<std::mutex> lk(gFrameLock);
             size_t cap = 512 * 1024;
-            if (gChosenFourcc.load(std::memory_order_relaxed) == V4L2_PIX_FMT_YUYV && gW > 0 &&
-                gH > 0) {
-                int bpl = gBytesPerLine.load(std::memory_order_relaxed);
-                if (bpl <= 0) bpl = gW * 2;
-                cap = (size_t) bpl * (size_t) gH;
-            } else if (gW > 0 && gH > 0) {
-                cap = (size_t) gW * (size_t) gH;
+            if (mChosenFourcc.load(std::memory_order_relaxed) == V4L2_PIX_FMT_YUYV && mW > 0 &&
+                mH > 0) {
+                int bpl = mBytesPerLine.load(std::memory_order_relaxed);
+                if (bpl <= 0) bpl = mW * 2;
+                cap = (size_t) bpl * (size_t) mH;
+            } else if (mW > 0 && mH > 0) {
+                cap = (size_t) mW * (size_t) mH;
             }
-            gFrameBytes.clear();
-            gFrameBytes.reserve(cap);
-            gFrameReady.store(false, std::memory_order_relaxed);
+            const bool zeroCopy = mZeroCopy;
+            // A reconnect sets up again within the session: keep its skipped frames.
+            mMailboxDropsBase.fetch_add(mMailbox.dropped(), std::memory_order_relaxed);
+            mMailbox.reset([cap, zeroCopy](FrameSlot &fs) {
+                fs.bufIdx = -1;
+                fs.bytes = 0;
+                fs.copy.clear();
+                if (!zeroCopy) fs.copy.reserve(cap);
+            });
         }
+        mBufsInFlight.store(0, std::memory_order_relaxed);
 
+        ALOGI("UVC buffers=%u memory=%s handoff=%s", (unsigned) mBufs.size(),
+              mMemory == V4L2_MEMORY_USERPTR ? "USERPTR" : "MMAP",
+              mZeroCopy ? "zero-copy" : "copy");
         return true;
     }
 
-    static void capLoop() {
-        while (gRunning.load(std::memory_order_relaxed)) {
-            pollfd pfd{};
-            pfd.fd = gFd;
-            pfd.events = POLLIN;
-            int pr = poll(&pfd, 1, 2000);
+    void Impl::requeueBuf(int idx) {
+        v4l2_buffer b{};
+        fillBuffer(b, (uint32_t) idx);
+        (void) xioctl(mFd, VIDIOC_QBUF, &b);
+        mBufsInFlight.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    // Kernel capture time of a dequeued buffer in the boottime domain. COPY/UNKNOWN
+    // timestamps carry no capture time, so those fall back to the dequeue instant.
+    static long long captureTimestampNs(const v4l2_buffer &b, long long dequeueNs) {
+        if ((b.flags & V4L2_BUF_FLAG_TIMESTAMP_MASK) != V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC)
+            return dequeueNs;
+        if (b.timestamp.tv_sec == 0 && b.timestamp.tv_usec == 0) return dequeueNs;
+
+        long long monoNs = (long long) b.timestamp.tv_sec * 1000000000LL +
+                           (long long) b.timestamp.tv_usec * 1000LL;
+        long long bootNs = monotonicToBoottimeNs(monoNs);
+        return bootNs <= dequeueNs ? bootNs : dequeueNs;
+    }
+
+    // start() / stop() hold mLock while they join capLoop, so the capture thread
+    // never blocks on it: it retries until it gets the lock or the session ends.
+    bool Impl::lockFromCapture() {
+        while (mRunning.load(std::memory_order_relaxed)) {
+            if (mLock.try_lock()) return true;
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+        return false;
+    }
+
+    // Capture thread, after the device vanished: park decLoop so nothing references
+    // the old buffers, close the dead node, then reopen the same mode into the same
+    // window as soon as a video4linux "add" arrives (or a periodic retry succeeds).
+    // `backNs` is when the device was seen again. False when stop() interrupted.
+    bool Impl::recoverDevice(V4l2HotplugListener &uev, long long &backNs) {
+        CachedMode prev;
+        prev.fourcc = mChosenFourcc.load(std::memory_order_relaxed);
+        prev.w = mW;
+        prev.h = mH;
+        prev.maxFps = mChosenFps.load(std::memory_order_relaxed);
+        ALOGI("UVC device lost (%s %dx%d), waiting for it to return",
+              fourccToStr(prev.fourcc).c_str(), prev.w, prev.h);
+
+        mDeviceLost.store(true, std::memory_order_relaxed);
+        mParkReq.store(true, std::memory_order_release);
+        mMailbox.wake();
+        while (!mDecParked.load(std::memory_order_acquire)) {
+            if (!mRunning.load(std::memory_order_relaxed)) return false;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        if (!lockFromCapture()) return false;
+        closeDeviceLocked();
+        mLock.unlock();
+
+        backNs = 0;
+        long long nextTry = 0;
+        while (mRunning.load(std::memory_order_relaxed)) {
+            bool added = false;
+            if (uev.fd() >= 0) {
+                pollfd p{};
+                p.fd = uev.fd();
+                p.events = POLLIN;
+                if (poll(&p, 1, 50) > 0) {
+                    added = (uev.drain({}) & V4l2HotplugListener::kAdded) != 0;
+                }
+            } else {
+                std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            }
+
+            const long long now = nowBoottimeNs();
+            if (added && backNs == 0) backNs = now;
+            if (!added && now < nextTry) continue;
+            nextTry = now + (long long) UVC_RECONNECT_RETRY_MS * 1000000LL;
+
+            if (!lockFromCapture()) return false;
+            std::string dbg;
+            const bool ok = setupLocked(mDesiredFps, dbg, &prev);
+            if (ok) {
+                clearErrLocked();
+            } else {
+                closeDeviceLocked();   // may have got as far as buffers / STREAMON
+            }
+            mLock.unlock();
+
+            if (ok) {
+                if (backNs == 0) backNs = now;
+                mReconnects.fetch_add(1, std::memory_order_relaxed);
+                mDeviceLost.store(false, std::memory_order_relaxed);
+                // Any step aeLoop skipped while the device was gone never settles.
+                mAeSettleUntilNs.store(0, std::memory_order_relaxed);
+                mParkReq.store(false, std::memory_order_release);
+                ALOGI("UVC device reopened as /dev/video%d", mNodeIdx);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void Impl::capLoop() {
+        static constexpr double kEmaAlpha = 1.0 / 8.0;
+        bool haveSeq = false;
+        uint32_t prevSeq = 0;
+        long long prevCapNs = 0;
+        double intervalEmaNs = 0.0;
+        double latencyEmaNs = 0.0;
+        long long reconnectNs = 0;
+
+        // Best effort: without netlink access the dead fd still reports POLLERR /
+        // ENODEV and recovery falls back to periodic open attempts.
+        V4l2HotplugListener uev;
+        if (!uev.open()) ALOGI("UVC uevent socket unavailable, hot-plug by polling");
+
+        while (mRunning.load(std::memory_order_relaxed)) {
+            pollfd pfd[2]{};
+            pfd[0].fd = mFd;
+            pfd[0].events = POLLIN;
+            pfd[1].fd = uev.fd();
+            pfd[1].events = POLLIN;
+            int pr = poll(pfd, uev.fd() >= 0 ? 2 : 1, 2000);
             if (pr <= 0) continue;
 
+            char node[16];
+            std::snprintf(node, sizeof(node), "video%d", mNodeIdx);
+            bool lost = (pfd[0].revents & (POLLERR | POLLHUP | POLLNVAL)) != 0 ||
+                        ((pfd[1].revents & POLLIN) &&
+                         (uev.drain(node) & V4l2HotplugListener::kRemoved));
+
             v4l2_buffer b{};
             b.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-            b.memory = V4L2_MEMORY_MMAP;
-            if (xioctl(gFd, VIDIOC_DQBUF, &b) != 0) continue;
-
-            long long ts = nowBoottimeNs();
-            gLastFrameTsNs.store(ts, std::memory_order_relaxed);
-            long long prev = gPrevFrameTsNs.exchange(ts, std::memory_order_relaxed);
-            if (prev != 0 && ts > prev) {
-                double fps = 1e9 / (double) (ts - prev);
+            b.memory = mMemory;
+            if (!lost) {
+                if (!(pfd[0].revents & POLLIN)) continue;
+                if (xioctl(mFd, VIDIOC_DQBUF, &b) != 0) {
+                    if (errno != ENODEV && errno != EIO) continue;
+                    lost = true;
+                }
+            }
+            if (lost) {
+                if (!recoverDevice(uev, reconnectNs)) break;
+                haveSeq = false;
+                prevCapNs = 0;
+                intervalEmaNs = 0.0;
+                latencyEmaNs = 0.0;
+                continue;
+            }
+
+            const long long dqNs = nowBoottimeNs();
+            if (reconnectNs != 0) {
+                mReconnectMs.store((int) ((dqNs - reconnectNs) / 1000000LL),
+                                   std::memory_order_relaxed);
+                ALOGI("UVC first frame %lld ms after the device came back",
+                      (dqNs - reconnectNs) / 1000000LL);
+                reconnectNs = 0;
+            }
+            const long long ts = captureTimestampNs(b, dqNs);
+            mLastFrameTsNs.store(ts, std::memory_order_relaxed);
+            mTsSourceFlags.store(b.flags & (V4L2_BUF_FLAG_TIMESTAMP_MASK |
+                                            V4L2_BUF_FLAG_TSTAMP_SRC_MASK),
+                                 std::memory_order_relaxed);
+
+            if (haveSeq && b.sequence > prevSeq + 1) {
+                mDroppedFrames.fetch_add((long long) (b.sequence - prevSeq - 1),
+                                         std::memory_order_relaxed);
+            }
+            haveSeq = true;
+            prevSeq = b.sequence;
+
+            if (ts != dqNs) {
+                double lat = (double) (dqNs - ts);
+                latencyEmaNs = latencyEmaNs == 0.0 ? lat : latencyEmaNs +
+                                                           kEmaAlpha * (lat - latencyEmaNs);
+                mDequeueLatencyUs.store((int) (latencyEmaNs / 1000.0), std::memory_order_relaxed);
+            }
+
+            if (prevCapNs != 0 && ts > prevCapNs) {
+                double dt = (double) (ts - prevCapNs);
+                intervalEmaNs = intervalEmaNs == 0.0 ? dt : intervalEmaNs +
+                                                            kEmaAlpha * (dt - intervalEmaNs);
+                double fps = 1e9 / intervalEmaNs;
                 if (fps > 0.0 && fps < 10000.0)
-                    gFpsX100.store((int) (fps * 100.0), std::memory_order_relaxed);
+                    mFpsX100.store((int) (fps * 100.0), std::memory_order_relaxed);
             }
+            prevCapNs = ts;
 
-            if (b.index < gBufs.size() && b.bytesused > 0) {
-                const uint8_t *src = (const uint8_t *) gBufs[b.index].ptr;
+            if (b.index < mBufs.size() && b.bytesused > 0) {
+                const uint8_t *src = (const uint8_t *) mBufs[b.index].ptr;
                 int used = (int) b.bytesused;
 
-                if (gChosenFourcc.load(std::memory_order_relaxed) == V4L2_PIX_FMT_YUYV && gW > 0 &&
-                    gH > 0) {
-                    int bpl = gBytesPerLine.load(std::memory_order_relaxed);
-                    if (bpl <= 0) bpl = gW * 2;
-                    size_t need = (size_t) bpl * (size_t) gH;
-
-                    if ((size_t) used >= need) {
-                        int avg = avgLumaYuyvSample(src, gW, gH, bpl);
-                        autoExposureMaybeAdjust(avg);
+                // Reject broken payloads here, before they cost a decode attempt.
+                bool needDht = false;
+                MjpegInfo mi;
+                if (b.flags & V4L2_BUF_FLAG_ERROR) {
+                    mRejectedFrames.fetch_add(1, std::memory_order_relaxed);
+                    (void) xioctl(mFd, VIDIOC_QBUF, &b);
+                    continue;
+                }
+                if (mChosenFourcc.load(std::memory_order_relaxed) == V4L2_PIX_FMT_MJPEG) {
+                    MjpegVerdict v = validateMjpeg(src, (size_t) used, mW, mH, mi);
+                    if (v == MjpegVerdict::Reject) {
+                        mRejectedFrames.fetch_add(1, std::memory_order_relaxed);
+                        (void) xioctl(mFd, VIDIOC_QBUF, &b);
+                        continue;
                     }
+                    used = (int) mi.end;
+                    needDht = v == MjpegVerdict::MissingDht;
                 }
 
-                {
-                    std::lock_guard<std::mutex> lk(gFrameLock);
-                    gFrameBytes.resize((size_t) used);
-                    std::memcpy(gFrameBytes.data(), src, (size_t) used);
-                    gFrameReady.store(true, std::memory_order_relaxed);
+                FrameSlot &slot = mMailbox.writeSlot();
+                slot.bytes = (size_t) used;
+                slot.tsNs = ts;
+                if (needDht) {
+                    // The patched frame lives in the slot; the V4L2 buffer goes straight back.
+                    slot.bufIdx = -1;
+                    copyWithStandardDht(src, mi, slot.copy);
+                } else if (mZeroCopy) {
+                    slot.bufIdx = (int) b.index;
+                    mBufsInFlight.fetch_add(1, std::memory_order_relaxed);
+                } else {
+                    slot.bufIdx = -1;
+                    slot.copy.resize((size_t) used);
+                    std::memcpy(slot.copy.data(), src, (size_t) used);
+                }
+
+                if (mMailbox.publish()) {
+                    // The decoder never saw the previous frame; give its buffer straight back.
+                    FrameSlot &stale = mMailbox.writeSlot();
+                    if (stale.bufIdx >= 0) {
+                        requeueBuf(stale.bufIdx);
+                        stale.bufIdx = -1;
+                    }
                 }
-                gFrameCv.notify_one();
+                if (mZeroCopy && !needDht) continue;
             }
-            (void) xioctl(gFd, VIDIOC_QBUF, &b);
+            (void) xioctl(mFd, VIDIOC_QBUF, &b);
         }
-        gFrameCv.notify_all();
+        mMailbox.wake();
     }
 
-    static void decLoop() {
-        std::vector<uint8_t> local;
-        cv::Mat rgbaReuse;
+    // False when the pacer drops the frame; the caller skips converting it.
+    bool Impl::reservePresent(long long tsNs) {
+        if (!UVC_PRESENT_PACING || mRunLayer || tsNs <= 0) return true;
+        mPacer.setDisplayTiming(displayPeriodNs(), lastVsyncNs());
+        return mPacer.reserveSlot(tsNs);
+    }
 
-        while (gRunning.load(std::memory_order_relaxed)) {
-            {
-                std::unique_lock<std::mutex> lk(gFrameLock);
-                gFrameCv.wait(lk, [] {
-                    return !gRunning.load(std::memory_order_relaxed) ||
-                           gFrameReady.load(std::memory_order_relaxed);
-                });
-                if (!gRunning.load(std::memory_order_relaxed)) break;
-                local.swap(gFrameBytes);
-                gFrameReady.store(false, std::memory_order_relaxed);
-            }
+    // The reserved frame will not be posted: free its slot for the next one.
+    void Impl::cancelPresent(long long tsNs) {
+        if (UVC_PRESENT_PACING && !mRunLayer && tsNs > 0) mPacer.cancelReservedSlot();
+    }
 
-            if (!gWin || local.empty()) continue;
+    // The frame is complete in `wf`: copy it in if it went to staging, wait for its
+    // slot, post.
+    void Impl::postPaced(WindowFrame &wf, long long tsNs) {
+        const bool paced = UVC_PRESENT_PACING && !mRunLayer && tsNs > 0;
+        wf.flush();
+        if (paced) mPacer.waitForReservedSlot();
+        wf.post();
+        if (paced) mPacer.presented();
+    }
 
-            uint32_t f = gChosenFourcc.load(std::memory_order_relaxed);
-            int cropH = (int) (gH * UVC_CROP_HEIGHT_RATIO);
-            if (cropH <= 0) cropH = 1;
+    // For frames that already exist in their own Mat (decode pool workers).
+    void Impl::presentRgba(cv::Mat &rgba, long long tsNs) {
+        if (!WindowFrame::accepts(mWin, mRunLayer, rgba.cols, rgba.rows, false) ||
+            !reservePresent(tsNs))
+            return;
+        applyUvcSeamAndEdgeProcessing(rgba);
+        WindowFrame wf(mWin, mRunLayer);
+        if (!wf.locked()) {
+            cancelPresent(tsNs);
+            return;
+        }
+        cv::Mat &dst = wf.target(rgba.cols, rgba.rows, rgba);
+        if (wf.direct()) rgba.copyTo(dst);
+        postPaced(wf, tsNs);
+    }
 
-            if (f == V4L2_PIX_FMT_YUYV) {
-                if (gW > 0 && gH > 0) {
-                    int bpl = gBytesPerLine.load(std::memory_order_relaxed);
-                    if (bpl <= 0) bpl = gW * 2;
+    // `slices` is non-null when the frame was prepare()d for slice-parallel decode.
+    void Impl::decodeAndRender(const uint8_t *data, size_t size, long long tsNs,
+                                cv::Mat &rgbaReuse, MjpegDecoder &jpegDec,
+                                MjpegSliceDecoder *slices) {
+        if ((!mWin && !mRunLayer) || !data || size == 0) return;
+
+        uint32_t f = mChosenFourcc.load(std::memory_order_relaxed);
+        int cropH = (int) (mH * UVC_CROP_HEIGHT_RATIO);
+        if (cropH <= 0) cropH = 1;
+
+        if (f == V4L2_PIX_FMT_YUYV || f == V4L2_PIX_FMT_UYVY || f == V4L2_PIX_FMT_YVYU) {
+            if (mW > 0 && mH > 0) {
+                int bpl = mBytesPerLine.load(std::memory_order_relaxed);
+                if (bpl <= 0) bpl = mW * 2;
+
+                size_t need = (size_t) bpl * (size_t) mH;
+                if (size >= need) {
+                    // Pick the output before reserving: a locked window buffer is posted
+                    // whatever happens, so it is only locked for a frame that will fill it.
+                    const int yuvRows = std::min(cropH, mH) & ~1;
+                    const bool yuv =
+                            mYuvOut && WindowFrame::accepts(mWin, mRunLayer, mW, yuvRows, true);
+                    const int rows = yuv ? yuvRows : std::min(cropH, mH);
+                    if (!yuv && !WindowFrame::accepts(mWin, mRunLayer, mW, rows, false)) return;
+                    if (!reservePresent(tsNs)) return;
+                    WindowFrame wf(mWin, mRunLayer);
+                    if (!wf.locked()) {
+                        cancelPresent(tsNs);
+                        return;
+                    }
 
-                    size_t need = (size_t) bpl * (size_t) gH;
-                    if (local.size() >= need) {
-                        cv::Mat yuv(gH, gW, CV_8UC2, local.data(), (size_t) bpl);
+                    // Convert + crop + opaque alpha in one sweep, normally straight into
+                    // the window buffer; only the seam band is touched again afterwards.
+                    // AE metering rides along on the same rows.
+                    const Yuv422Layout layout = f == V4L2_PIX_FMT_UYVY ? Yuv422Layout::UYVY
+                                                                       : f == V4L2_PIX_FMT_YVYU
+                                                                         ? Yuv422Layout::YVYU
+                                                                         : Yuv422Layout::YUYV;
+                    LumaStats *st = nullptr;
+                    if (mAeEnabled.load(std::memory_order_relaxed) &&
+                        tsNs >= mAeSettleUntilNs.load(std::memory_order_relaxed)) {
+                        mAeStats.clear();
+                        st = &mAeStats;
+                    }
 
-                        if (rgbaReuse.empty() || rgbaReuse.cols != gW || rgbaReuse.rows != gH) {
-                            rgbaReuse = cv::Mat(gH, gW, CV_8UC4);
+                    if (yuv) {
+                        // Passthrough: no colour conversion on the CPU at all. The buffer
+                        // was checked above; one that changed under us goes out black.
+                        Yuv420Planes planes;
+                        if (!wf.yuvPlanes(mW, rows, planes)) {
+                            wf.discard();
+                            cancelPresent(tsNs);
+                            return;
                         }
+                        yuv422ToYuv420(data, (size_t) bpl, mW, rows, planes, layout, st);
+                        if (st) aeOnFrame(*st);
+                        applyUvcSeamBlurYuv(planes, mW, rows);
+                        postPaced(wf, tsNs);
+                        return;
+                    }
 
-                        const uint32_t pix = gChosenFourcc.load(std::memory_order_relaxed);
-                        int code = -1;
-                        switch (pix) {
-                            case V4L2_PIX_FMT_YUYV:
-                                code = cv::COLOR_YUV2RGBA_YUY2;
-                                break;
-                            case V4L2_PIX_FMT_UYVY:
-                                code = cv::COLOR_YUV2RGBA_UYVY;
-                                break;
-                            case V4L2_PIX_FMT_YVYU:
-                                code = cv::COLOR_YUV2RGBA_YVYU;
-                                break;
-                            default:
-                                code = cv::COLOR_YUV2RGBA_YUY2;
-                                break; // fallback
-                        }
+                    cv::Mat &dst = wf.target(mW, rows, rgbaReuse);
+                    if (!yuv422ToRgba(data, (size_t) bpl, mW, rows, dst.data, dst.step, layout,
+                                      st)) {
+                        const int code = f == V4L2_PIX_FMT_UYVY ? cv::COLOR_YUV2RGBA_UYVY
+                                                                : f == V4L2_PIX_FMT_YVYU
+                                                                  ? cv::COLOR_YUV2RGBA_YVYU
+                                                                  : cv::COLOR_YUV2RGBA_YUY2;
+                        cv::Mat yuv(rows, mW, CV_8UC2, const_cast<uint8_t *>(data), (size_t) bpl);
+                        cv::cvtColor(yuv, dst, code);
+                    } else if (st) {
+                        aeOnFrame(*st);
+                    }
+                    applyUvcSeamAndEdgeProcessing(dst);
+                    postPaced(wf, tsNs);
+                }
+            }
+            return;
+        }
+
+        if (f == V4L2_PIX_FMT_MJPEG) {
+            int jw = 0, jh = 0;
+            if (!jpegFrameSize(data, size, jw, jh)) return;
+
+            const int outH = std::min(cropH, jh);
+            if (!WindowFrame::accepts(mWin, mRunLayer, jw, outH, false) ||
+                !reservePresent(tsNs))
+                return;
+
+            // A locked window buffer can only be posted, so a frame that fails to decode
+            // must fail before the lock: then nothing is posted and the window keeps
+            // showing the previous frame. Decoding into staging guarantees that but costs
+            // a copy into the buffer, so it is only used until a frame of the stream has
+            // decoded and again after any failure. Payloads were validated in capLoop, so
+            // a direct decode that still fails is a decoder fault; that frame goes out as
+            // far as it decoded and the stream drops back to staging.
+            if (!mMjpegDirect) {
+                rgbaReuse.create(outH, jw, CV_8UC4);
+                if (!decodeMjpeg(data, size, rgbaReuse, jpegDec, slices)) {
+                    cancelPresent(tsNs);
+                    return;
+                }
+                mMjpegDirect = true;
+                WindowFrame wf(mWin, mRunLayer);
+                if (!wf.locked()) {
+                    cancelPresent(tsNs);
+                    return;
+                }
+                cv::Mat &dst = wf.target(jw, outH, rgbaReuse);
+                if (wf.direct()) rgbaReuse.copyTo(dst);
+                applyUvcSeamAndEdgeProcessing(dst);
+                postPaced(wf, tsNs);
+                return;
+            }
+
+            WindowFrame wf(mWin, mRunLayer);
+            if (!wf.locked()) {
+                cancelPresent(tsNs);
+                return;
+            }
+            cv::Mat &dst = wf.target(jw, outH, rgbaReuse);
+            if (!decodeMjpeg(data, size, dst, jpegDec, slices)) {
+                mMjpegDirect = false;
+                if (mRunLayer) {
+                    wf.discard();   // the layer keeps its previous frame
+                    return;
+                }
+            }
+            applyUvcSeamAndEdgeProcessing(dst);
+            postPaced(wf, tsNs);
+        }
+    }
+
+    bool Impl::decodeMjpeg(const uint8_t *data, size_t size, cv::Mat &dst,
+                           MjpegDecoder &jpegDec, MjpegSliceDecoder *slices) {
+        if (slices && slices->decodeRgba(dst.data, dst.step, dst.cols, dst.rows)) {
+            mMjpegSlices.store(slices->lastSlices(), std::memory_order_relaxed);
+            mMjpegDecodeUs.store(slices->avgDecodeUs(), std::memory_order_relaxed);
+            return true;
+        }
+        if (!jpegDec.decodeRgba(data, size, dst.data, dst.step, dst.cols, dst.rows))
+            return false;
+        mMjpegSlices.store(0, std::memory_order_relaxed);
+        mMjpegDecodeUs.store(jpegDec.avgDecodeUs(), std::memory_order_relaxed);
+        return true;
+    }
 
-                        cv::cvtColor(yuv, rgbaReuse, code);
+    // Pool size for the current stream. Zero-copy workers each pin a V4L2 buffer, so
+    // leave capLoop at least four queued.
+    int Impl::mjpegWorkerTarget(int decodeUs) {
+        int cap = UVC_MJPEG_MAX_WORKERS;
+        if (mZeroCopy) cap = std::min(cap, std::max(1, (int) mBufs.size() - 4));
+        int req = mMjpegWorkersReq.load(std::memory_order_relaxed);
+        if (req > 0) return std::min(req, cap);
+        return mjpegWorkersFor(decodeUs, mChosenFps.load(std::memory_order_relaxed), cap);
+    }
 
-                        cv::Rect roi(0, 0, gW, cropH);
-                        if (roi.height > rgbaReuse.rows) roi.height = rgbaReuse.rows;
-                        if (roi.width > rgbaReuse.cols) roi.width = rgbaReuse.cols;
-                        cv::Mat cropped = rgbaReuse(roi);
+    void Impl::decLoop() {
+        static constexpr long long kWarmupFrames = 30;
+        static constexpr long long kResizeEveryFrames = 120;
 
-                        applyUvcSeamAndEdgeProcessing(cropped);
-                        renderRgbaToWindow(cropped.data, cropped.cols, cropped.rows);
-                    }
+        cv::Mat rgbaReuse;
+        MjpegDecoder jpegDec;
+        MjpegDecodePool pool;
+        std::unique_ptr<MjpegSliceDecoder> sliceDec;
+        if (UVC_MJPEG_DECODE_MODE == 0)
+            sliceDec = std::make_unique<MjpegSliceDecoder>(UVC_MJPEG_SLICE_THREADS);
+        MjpegJob job;
+        uint64_t seq = 0;
+        long long mjpegFrames = 0;
+        long long dropsBase = 0;
+        int lastReq = mMjpegWorkersReq.load(std::memory_order_relaxed);
+        int shrinkVotes = 0;
+
+        const auto stopPool = [&] {
+            if (!pool.running()) return;
+            pool.stop();
+            dropsBase += pool.reorderDrops();
+            mReorderDrops.store(dropsBase, std::memory_order_relaxed);
+        };
+
+        while (mRunning.load(std::memory_order_relaxed)) {
+            if (mParkReq.load(std::memory_order_acquire)) {
+                // Device gone: give back every buffer, then wait for capLoop to reopen.
+                stopPool();
+                mjpegFrames = 0;
+                mMjpegDirect = false;
+                mDecParked.store(true, std::memory_order_release);
+                while (mParkReq.load(std::memory_order_acquire) &&
+                       mRunning.load(std::memory_order_relaxed)) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(5));
                 }
+                mDecParked.store(false, std::memory_order_release);
                 continue;
             }
+            if (pool.running() && !pool.waitIdle(100000000LL)) continue;
+            FrameSlot *fs = mMailbox.waitAcquire(100000000LL);
+            if (!fs) continue;
+
+            const bool zc = fs->bufIdx >= 0;
+            const uint8_t *data = fs->copy.data();
+            size_t size = fs->copy.size();
+            if (zc) {
+                data = (size_t) fs->bufIdx < mBufs.size() ? (const uint8_t *) mBufs[fs->bufIdx].ptr
+                                                          : nullptr;
+                size = fs->bytes;
+            }
 
-            if (f == V4L2_PIX_FMT_MJPEG) {
-                try {
-                    cv::Mat buf(1, (int) local.size(), CV_8UC1, local.data());
-                    cv::Mat bgr = cv::imdecode(buf, cv::IMREAD_COLOR);
-                    if (!bgr.empty()) {
-                        if (rgbaReuse.empty() || rgbaReuse.cols != bgr.cols ||
-                            rgbaReuse.rows != bgr.rows) {
-                            rgbaReuse = cv::Mat(bgr.rows, bgr.cols, CV_8UC4);
+            int jw = 0, jh = 0;
+            bool sliced = false;
+            if (data &&
+                mChosenFourcc.load(std::memory_order_relaxed) == V4L2_PIX_FMT_MJPEG &&
+                jpegFrameSize(data, size, jw, jh)) {
+                sliced = sliceDec && sliceDec->prepare(data, size);
+            }
+            if (sliced) {
+                // Intra-frame parallelism already spreads this frame over the cores.
+                stopPool();
+                mMjpegWorkers.store(1, std::memory_order_relaxed);
+            } else if (jw > 0) {
+                mjpegFrames++;
+                const int req = mMjpegWorkersReq.load(std::memory_order_relaxed);
+                if (mjpegFrames == kWarmupFrames || mjpegFrames % kResizeEveryFrames == 0 ||
+                    (req != lastReq && mjpegFrames > kWarmupFrames)) {
+                    lastReq = req;
+                    const int cur = pool.running() ? pool.workers() : 1;
+                    const int want = mjpegWorkerTarget(
+                            pool.running() ? pool.avgDecodeUs() : jpegDec.avgDecodeUs());
+                    // Grow at once, shrink only when two evaluations in a row agree.
+                    shrinkVotes = want < cur ? shrinkVotes + 1 : 0;
+                    if (want > cur || (want < cur && (req > 0 || shrinkVotes >= 2))) {
+                        stopPool();
+                        shrinkVotes = 0;
+                        if (want > 1) {
+                            int cropH = std::max(1, (int) (mH * UVC_CROP_HEIGHT_RATIO));
+                            int fps = std::max(1, mChosenFps.load(std::memory_order_relaxed));
+                            pool.start(want, jw, std::min(cropH, jh), 1000000000LL / fps,
+                                       [this](cv::Mat &rgba, long long ts) { presentRgba(rgba, ts); },
+                                       [this](int idx) { requeueBuf(idx); });
                         }
-                        cv::cvtColor(bgr, rgbaReuse, cv::COLOR_BGR2RGBA);
-
-                        cv::Rect roi(0, 0, bgr.cols, cropH);
-                        if (roi.height > rgbaReuse.rows) roi.height = rgbaReuse.rows;
-                        if (roi.width > rgbaReuse.cols) roi.width = rgbaReuse.cols;
-                        cv::Mat cropped = rgbaReuse(roi);
-                        applyUvcSeamAndEdgeProcessing(cropped);
-                        renderRgbaToWindow(cropped.data, cropped.cols, cropped.rows);
+                        ALOGI("UVC: MJPEG decode workers %d -> %d", cur, want);
+                    }
+                }
+
+                if (pool.running() && (pool.outW() != jw || pool.outH() > jh)) {
+                    stopPool();   // resolution changed under us; re-size on the next check
+                    mjpegFrames = 0;
+                }
+
+                if (pool.running()) {
+                    job.seq = seq++;
+                    job.tsNs = fs->tsNs;
+                    job.token = zc ? fs->bufIdx : -1;
+                    job.data = data;
+                    job.size = size;
+                    if (!zc) job.owned.swap(fs->copy);
+                    if (pool.submit(job)) {
+                        fs->bufIdx = -1;
+                        if (!zc) fs->copy.swap(job.owned);
+                        mMjpegWorkers.store(pool.workers(), std::memory_order_relaxed);
+                        mMjpegDecodeUs.store(pool.avgDecodeUs(), std::memory_order_relaxed);
+                        mReorderDrops.store(dropsBase + pool.reorderDrops(),
+                                            std::memory_order_relaxed);
+                        continue;
                     }
-                } catch (...) {
+                    if (!zc) fs->copy.swap(job.owned);
                 }
+                mMjpegWorkers.store(1, std::memory_order_relaxed);
             }
+
+            MjpegSliceDecoder *sd = sliced ? sliceDec.get() : nullptr;
+            if (zc) {
+                if (data) decodeAndRender(data, size, fs->tsNs, rgbaReuse, jpegDec, sd);
+                requeueBuf(fs->bufIdx);
+                fs->bufIdx = -1;
+                continue;
+            }
+
+            decodeAndRender(data, size, fs->tsNs, rgbaReuse, jpegDec, sd);
         }
+        stopPool();
     }
 
-    bool start(JNIEnv *env, jobject surface, int desiredFps) {
-        std::lock_guard<std::mutex> lk(gLock);
+    // Takes ownership of `win` (released by teardownLocked, or here on failure).
+    bool Impl::startWithWindow(ANativeWindow *win, int desiredFps) {
+        std::lock_guard<std::mutex> lk(mLock);
         clearErrLocked();
 
-        if (gRunning.load(std::memory_order_relaxed)) {
-            gRunning.store(false, std::memory_order_relaxed);
-            gFrameCv.notify_all();
-            if (gThCap.joinable()) gThCap.join();
-            if (gThDec.joinable()) gThDec.join();
+        if (mRunning.load(std::memory_order_relaxed)) {
+            mRunning.store(false, std::memory_order_relaxed);
+            mMailbox.wake();
+            if (mThCap.joinable()) mThCap.join();
+            if (mThDec.joinable()) mThDec.join();
+            stopAeThread();
             teardownLocked();
         }
 
-        gWin = ANativeWindow_fromSurface(env, surface);
-        if (!gWin) {
+        mWin = win;
+        mRunLayer = mLayer;
+        if (!mWin && !mRunLayer) {
             setErrLocked("ANativeWindow_fromSurface failed");
             return false;
         }
 
         std::string dbg;
-        if (!setupLocked(desiredFps > 0 ? desiredFps : 60, dbg)) {
-            std::string e = gLastError;
+        mDesiredFps = desiredFps > 0 ? desiredFps : 60;
+        if (!setupLocked(mDesiredFps, dbg)) {
+            std::string e = mLastError;
             teardownLocked();
             setErrLocked("setup failed:\n" + e + "\n" + dbg);
             return false;
         }
 
-        gRunning.store(true, std::memory_order_relaxed);
-        gThCap = std::thread(capLoop);
-        gThDec = std::thread(decLoop);
+        if (UVC_PRESENT_PACING && !mRunLayer) {
+            vsyncMonitorAcquire();
+            mVsyncHeld = true;
+        }
+        mRunning.store(true, std::memory_order_relaxed);
+        mThCap = std::thread(&Impl::capLoop, this);
+        mThDec = std::thread(&Impl::decLoop, this);
+        if (mAeEnabled.load(std::memory_order_relaxed)) mThAe = std::thread(&Impl::aeLoop, this);
+        return true;
+    }
+
+    // Joins a finished (or still running) startAsync worker. Never called with mLock
+    // held: the worker needs it.
+    void Impl::joinStarter() {
+        std::lock_guard<std::mutex> lk(mStartMutex);
+        if (mThStart.joinable()) mThStart.join();
+    }
+
+    bool Impl::start(JNIEnv *env, jobject surface, int desiredFps) {
+        joinStarter();
+        ANativeWindow *win = surface ? ANativeWindow_fromSurface(env, surface) : nullptr;
+        mStartState.store(kStartStarting, std::memory_order_relaxed);
+        const bool ok = startWithWindow(win, desiredFps);
+        mStartState.store(ok ? kStartRunning : kStartFailed, std::memory_order_relaxed);
+        return ok;
+    }
+
+    bool Impl::startAsync(JNIEnv *env, jobject surface, int desiredFps) {
+        // The window must come from the JNI thread; everything else (discovery, format
+        // negotiation, buffer setup, STREAMON) runs on the worker.
+        ANativeWindow *win = surface ? ANativeWindow_fromSurface(env, surface) : nullptr;
+        std::lock_guard<std::mutex> lk(mStartMutex);
+        if (mStartState.load(std::memory_order_relaxed) == kStartStarting) {
+            if (win) ANativeWindow_release(win);
+            return false;
+        }
+        if (mThStart.joinable()) mThStart.join();   // already finished
+        mStartState.store(kStartStarting, std::memory_order_relaxed);
+        mThStart = std::thread([this, win, desiredFps] {
+            const bool ok = startWithWindow(win, desiredFps);
+            mStartState.store(ok ? kStartRunning : kStartFailed, std::memory_order_relaxed);
+        });
         return true;
     }
 
-    void stop() {
-        std::lock_guard<std::mutex> lk(gLock);
-        if (!gRunning.load(std::memory_order_relaxed)) return;
-        gRunning.store(false, std::memory_order_relaxed);
-        gFrameCv.notify_all();
-        if (gThCap.joinable()) gThCap.join();
-        if (gThDec.joinable()) gThDec.join();
+    void Impl::stop() {
+        joinStarter();
+        std::lock_guard<std::mutex> lk(mLock);
+        mStartState.store(kStartIdle, std::memory_order_relaxed);
+        if (!mRunning.load(std::memory_order_relaxed)) return;
+        mRunning.store(false, std::memory_order_relaxed);
+        mMailbox.wake();
+        if (mThCap.joinable()) mThCap.join();
+        if (mThDec.joinable()) mThDec.join();
+        stopAeThread();
         teardownLocked();
     }
 
-    long long lastFrameTimestampNs() { return gLastFrameTsNs.load(std::memory_order_relaxed); }
+    UvcCamera::UvcCamera() : mImpl(std::make_unique<Impl>()) {}
+
+    UvcCamera::~UvcCamera() { mImpl->stop(); }
+
+    bool UvcCamera::start(JNIEnv *env, jobject surface, int desiredFps) {
+        return mImpl->start(env, surface, desiredFps);
+    }
+
+    bool UvcCamera::startAsync(JNIEnv *env, jobject surface, int desiredFps) {
+        return mImpl->startAsync(env, surface, desiredFps);
+    }
+
+    int UvcCamera::startState() const {
+        return mImpl->mStartState.load(std::memory_order_relaxed);
+    }
+
+    void UvcCamera::stop() { mImpl->stop(); }
+
+    long long UvcCamera::lastFrameTimestampNs() const {
+        return mImpl->mLastFrameTsNs.load(std::memory_order_relaxed);
+    }
+
+    int UvcCamera::estimatedFpsX100() const {
+        return mImpl->mFpsX100.load(std::memory_order_relaxed);
+    }
+
+    int UvcCamera::chosenFps() const { return mImpl->mChosenFps.load(std::memory_order_relaxed); }
+
+    int UvcCamera::buffersInFlight() const {
+        return mImpl->mBufsInFlight.load(std::memory_order_relaxed);
+    }
+
+    long long UvcCamera::droppedFrames() const {
+        return mImpl->mDroppedFrames.load(std::memory_order_relaxed);
+    }
+
+    long long UvcCamera::rejectedFrames() const {
+        return mImpl->mRejectedFrames.load(std::memory_order_relaxed);
+    }
+
+    long long UvcCamera::skippedFrames() const {
+        return mImpl->mMailboxDropsBase.load(std::memory_order_relaxed) +
+               mImpl->mMailbox.dropped() + mImpl->mReorderDrops.load(std::memory_order_relaxed);
+    }
+
+    int UvcCamera::dequeueLatencyUs() const {
+        return mImpl->mDequeueLatencyUs.load(std::memory_order_relaxed);
+    }
+
+    int UvcCamera::mjpegDecodeUs() const {
+        return mImpl->mMjpegDecodeUs.load(std::memory_order_relaxed);
+    }
+
+    void UvcCamera::setMjpegDecodeWorkers(int n) {
+        mImpl->mMjpegWorkersReq.store(std::max(0, n), std::memory_order_relaxed);
+    }
+
+    int UvcCamera::mjpegDecodeWorkers() const {
+        return mImpl->mMjpegWorkers.load(std::memory_order_relaxed);
+    }
+
+    int UvcCamera::mjpegSlices() const {
+        return mImpl->mMjpegSlices.load(std::memory_order_relaxed);
+    }
+
+    int UvcCamera::aeLuma() const { return mImpl->mAeLuma.load(std::memory_order_relaxed); }
+
+    bool UvcCamera::deviceLost() const {
+        return mImpl->mDeviceLost.load(std::memory_order_relaxed);
+    }
+
+    int UvcCamera::reconnectCount() const {
+        return mImpl->mReconnects.load(std::memory_order_relaxed);
+    }
+
+    int UvcCamera::reconnectToFirstFrameMs() const {
+        return mImpl->mReconnectMs.load(std::memory_order_relaxed);
+    }
+
+    int UvcCamera::presentJitterUs() const { return mImpl->mPacer.stats().jitterUs; }
 
-    int estimatedFpsX100() { return gFpsX100.load(std::memory_order_relaxed); }
+    long long UvcCamera::presentLateDrops() const { return mImpl->mPacer.stats().lateDrops; }
 
-    int chosenFps() { return gChosenFps.load(std::memory_order_relaxed); }
+    int UvcCamera::presentLatencyUs() const { return mImpl->mPacer.stats().latencyUs; }
+
+    std::string UvcCamera::timestampSource() const {
+        uint32_t fl = mImpl->mTsSourceFlags.load(std::memory_order_relaxed);
+        if ((fl & V4L2_BUF_FLAG_TIMESTAMP_MASK) != V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC)
+            return "dequeue";
+        return (fl & V4L2_BUF_FLAG_TSTAMP_SRC_MASK) == V4L2_BUF_FLAG_TSTAMP_SRC_SOE ? "SOE"
+                                                                                    : "EOF";
+    }
+
+    std::string UvcCamera::memoryMode() const {
+        std::lock_guard<std::mutex> lk(mImpl->mLock);
+        if (mImpl->mBufs.empty()) return "n/a";
+        return mImpl->mMemory == V4L2_MEMORY_USERPTR ? "USERPTR" : "MMAP";
+    }
+
+    std::string UvcCamera::lastError() const {
+        std::lock_guard<std::mutex> lk(mImpl->mLock);
+        return mImpl->mLastError;
+    }
+
+    void UvcCamera::setComposeLayer(ComposeLayer *layer) {
+        std::lock_guard<std::mutex> lk(mImpl->mLock);
+        mImpl->mLayer = layer;
+    }
+
+    void UvcCamera::setCacheDir(const std::string &dir) {
+        std::lock_guard<std::mutex> lk(mImpl->mLock);
+        mImpl->mCacheDir = dir;
+    }
+
+    std::string UvcCamera::startTimings() const {
+        std::lock_guard<std::mutex> lk(mImpl->mLock);
+        return mImpl->mStartTimings;
+    }
 
-    std::string lastError() {
-        std::lock_guard<std::mutex> lk(gLock);
-        return gLastError;
+    int UvcCamera::node() const {
+        std::lock_guard<std::mutex> lk(mImpl->mLock);
+        return mImpl->mFd >= 0 ? mImpl->mNodeIdx : -1;
     }
 
-    std::string chosenMode() {
-        uint32_t f = gChosenFourcc.load(std::memory_order_relaxed);
-        int w = gChosenW.load(std::memory_order_relaxed);
-        int h = gChosenH.load(std::memory_order_relaxed);
+    std::string UvcCamera::chosenMode() const {
+        uint32_t f = mImpl->mChosenFourcc.load(std::memory_order_relaxed);
+        int w = mImpl->mChosenW.load(std::memory_order_relaxed);
+        int h = mImpl->mChosenH.load(std::memory_order_relaxed);
         if (!f || !w || !h) return "n/a";
         return fourccToStr(f) + " " + std::to_string(w) + "x" + std::to_string(h);
     }
@@ -3,21 +3,128 @@
 #pragma once
 
 #include <jni.h>
+#include <memory>
 #include <string>
 
+class ComposeLayer;
+
 namespace uvc {
-    bool start(JNIEnv *env, jobject surface, int desiredFps);
+    enum StartState : int {
+        kStartIdle = 0,
+        kStartStarting = 1,
+        kStartRunning = 2,
+        kStartFailed = 3    // details in lastError()
+    };
+
+    // One external UVC camera. Each instance owns its device node, capture / decode /
+    // AE threads, controls and metrics, so several can stream side by side; the only
+    // process-wide state is which /dev/videoN nodes are taken (see node()).
+    class UvcCamera {
+    public:
+        UvcCamera();
+
+        // Stops the stream (waiting for a pending startAsync()).
+        ~UvcCamera();
+
+        UvcCamera(const UvcCamera &) = delete;
+
+        UvcCamera &operator=(const UvcCamera &) = delete;
+
+        // With a layer set, frames go to the panel compositor instead of a window and
+        // `surface` may be null. Takes effect at the next start.
+        void setComposeLayer(ComposeLayer *layer);
+
+        // Opens the first UVC node no other instance holds.
+        bool start(JNIEnv *env, jobject surface, int desiredFps);
+
+        // Same as start() but returns right after taking the window; discovery and setup
+        // run on a worker. Poll startState(). Returns false if a start is still pending.
+        bool startAsync(JNIEnv *env, jobject surface, int desiredFps);
+
+        int startState() const;
+
+        // Also waits for a pending startAsync() to finish before stopping.
+        void stop();
+
+        long long lastFrameTimestampNs() const;
+
+        int estimatedFpsX100() const;
+
+        int chosenFps() const;
+
+        // V4L2 buffers currently owned by the decoder side (zero-copy handoff).
+        int buffersInFlight() const;
+
+        // "MMAP" or "USERPTR" once streaming, "n/a" otherwise.
+        std::string memoryMode() const;
+
+        // Frames lost before userspace, from gaps in v4l2_buffer.sequence.
+        long long droppedFrames() const;
+
+        // Frames discarded in capLoop: V4L2 error flag or an MJPEG payload that failed
+        // validation (truncated, bad segment lengths, wrong size). Never decoded.
+        long long rejectedFrames() const;
+
+        // Frames dequeued but superseded before the decoder picked them up, plus frames
+        // the MJPEG reorder stage dropped because a newer one was already shown.
+        long long skippedFrames() const;
+
+        // Smoothed kernel capture timestamp -> DQBUF delay.
+        int dequeueLatencyUs() const;
+
+        // Smoothed MJPEG decode time per frame (0 for YUYV).
+        int mjpegDecodeUs() const;
+
+        // MJPEG decode pool size: 0 = auto (default), 1 = inline, N = fixed.
+        void setMjpegDecodeWorkers(int n);
+
+        // Workers currently decoding MJPEG (1 = inline, 0 before the first MJPEG frame).
+        int mjpegDecodeWorkers() const;
+
+        // Restart-interval slices the last MJPEG frame was decoded in (0 = whole frame).
+        int mjpegSlices() const;
+
+        // Centre-weighted mean luma of the last metered frame (0 while AE is off).
+        int aeLuma() const;
+
+        // True while the device is off the bus and capLoop is waiting to reopen it.
+        bool deviceLost() const;
+
+        // Automatic reopens since start(), and for the last one the time from the device
+        // reappearing (uevent or successful open) to its first dequeued frame.
+        int reconnectCount() const;
+
+        int reconnectToFirstFrameMs() const;
+
+        // Present pacing: smoothed |post interval - capture interval|, frames dropped for
+        // missing their vsync slot, and the capture -> post latency being scheduled.
+        int presentJitterUs() const;
+
+        long long presentLateDrops() const;
+
+        int presentLatencyUs() const;
+
+        // Where lastFrameTimestampNs() comes from: "SOE", "EOF" or "dequeue".
+        std::string timestampSource() const;
+
+        std::string lastError() const;
 
-    void stop();
+        // Directory for the per-device capability cache (modes, control ranges, last
+        // good mode). Without one every start enumerates the device from scratch.
+        void setCacheDir(const std::string &dir);
 
-    long long lastFrameTimestampNs();
+        // Per-phase durations of the last successful start, e.g.
+        // "open=4.1ms enum(cached)=0.3ms format=38.0ms ... total=95.2ms cache=hit".
+        std::string startTimings() const;
 
-    int estimatedFpsX100();
+        // N of the /dev/videoN this instance has open, -1 when closed.
+        int node() const;
 
-    int chosenFps();
+        std::string chosenMode() const;   // örn: "YUYV 1280x720"
 
-    std::string lastError();
+        struct Impl;
 
-    // YENİ
-    std::string chosenMode();   // örn: "YUYV 1280x720"
+    private:
+        std::unique_ptr<Impl> mImpl;
+    };
 }
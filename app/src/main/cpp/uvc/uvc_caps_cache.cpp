@@ -0,0 +1,130 @@
+// uvc_caps_cache.cpp
+
+#include "uvc_caps_cache.h"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+namespace uvc {
+
+    // Bump when the file layout or what start() derives from it changes.
+    static constexpr int kCapsVersion = 1;
+
+    const CachedCtrl *UvcDeviceCaps::findCtrl(uint32_t id) const {
+        for (const auto &c: ctrls) {
+            if (c.id == id) return &c;
+        }
+        return nullptr;
+    }
+
+    std::string uvcDeviceKey(const char *driver, const char *card, const char *busInfo,
+                             const std::string &vidPid) {
+        std::string k = std::string(driver) + "|" + card + "|" + busInfo + "|" + vidPid;
+        for (char &c: k) {
+            if (c == '\n' || c == '\r') c = ' ';
+        }
+        return k;
+    }
+
+    static std::string readSysLine(const std::string &path) {
+        std::ifstream f(path);
+        std::string s;
+        if (!f || !std::getline(f, s)) return {};
+        while (!s.empty() && (s.back() == '\n' || s.back() == ' ')) s.pop_back();
+        return s;
+    }
+
+    std::string uvcVidPid(int videoIndex) {
+        // videoN/device is the USB interface; idVendor / idProduct live on its parent.
+        const std::string dev = "/sys/class/video4linux/video" + std::to_string(videoIndex) +
+                                "/device/../";
+        const std::string vid = readSysLine(dev + "idVendor");
+        const std::string pid = readSysLine(dev + "idProduct");
+        if (vid.empty() || pid.empty()) return {};
+        return vid + ":" + pid;
+    }
+
+    static std::string capsPath(const std::string &dir, const std::string &key) {
+        uint64_t h = 1469598103934665603ULL;   // FNV-1a
+        for (unsigned char c: key) {
+            h ^= c;
+            h *= 1099511628211ULL;
+        }
+        char name[40];
+        std::snprintf(name, sizeof(name), "/uvc-caps-%016llx.txt", (unsigned long long) h);
+        return dir + name;
+    }
+
+    bool loadDeviceCaps(const std::string &dir, const std::string &key, UvcDeviceCaps &out) {
+        out = UvcDeviceCaps{};
+        if (dir.empty()) return false;
+        std::ifstream f(capsPath(dir, key));
+        if (!f) return false;
+
+        std::string line;
+        int version = 0;
+        if (!std::getline(f, line) || std::sscanf(line.c_str(), "uvc-caps %d", &version) != 1 ||
+            version != kCapsVersion)
+            return false;
+        if (!std::getline(f, line) || line != "key " + key) return false;
+        out.key = key;
+
+        while (std::getline(f, line)) {
+            std::istringstream ss(line);
+            std::string tag;
+            ss >> tag;
+            if (tag == "mode") {
+                CachedMode m;
+                ss >> std::hex >> m.fourcc >> std::dec >> m.w >> m.h >> m.maxFps;
+                if (!ss || m.w <= 0 || m.h <= 0) return false;
+                out.modes.push_back(m);
+            } else if (tag == "ctrl") {
+                CachedCtrl c;
+                int ok = 0;
+                ss >> std::hex >> c.id >> std::dec >> ok >> c.minV >> c.maxV >> c.step >> c.defV;
+                if (!ss) return false;
+                c.ok = ok != 0;
+                out.ctrls.push_back(c);
+            } else if (tag == "good") {
+                ss >> out.goodDesiredFps >> std::hex >> out.goodFourcc >> std::dec >> out.goodW >>
+                   out.goodH >> out.goodFps >> out.goodMemory;
+                if (!ss) return false;
+                out.hasGood = true;
+            }
+        }
+        return !out.modes.empty();
+    }
+
+    bool saveDeviceCaps(const std::string &dir, const UvcDeviceCaps &caps) {
+        if (dir.empty() || caps.key.empty()) return false;
+        const std::string path = capsPath(dir, caps.key);
+        const std::string tmp = path + ".tmp";
+        {
+            std::ofstream f(tmp, std::ios::trunc);
+            if (!f) return false;
+            f << "uvc-caps " << kCapsVersion << "\n";
+            f << "key " << caps.key << "\n";
+            for (const auto &m: caps.modes) {
+                f << "mode " << std::hex << m.fourcc << std::dec << " " << m.w << " " << m.h
+                  << " " << m.maxFps << "\n";
+            }
+            for (const auto &c: caps.ctrls) {
+                f << "ctrl " << std::hex << c.id << std::dec << " " << (c.ok ? 1 : 0) << " "
+                  << c.minV << " " << c.maxV << " " << c.step << " " << c.defV << "\n";
+            }
+            if (caps.hasGood) {
+                f << "good " << caps.goodDesiredFps << " " << std::hex << caps.goodFourcc
+                  << std::dec << " " << caps.goodW << " " << caps.goodH << " " << caps.goodFps
+                  << " " << caps.goodMemory << "\n";
+            }
+            f.flush();
+            if (!f) {
+                std::remove(tmp.c_str());
+                return false;
+            }
+        }
+        return std::rename(tmp.c_str(), path.c_str()) == 0;
+    }
+
+} // namespace uvc
@@ -0,0 +1,56 @@
+// uvc_caps_cache.h
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace uvc {
+
+    // One enumerated format / size with the highest frame rate the device lists for it.
+    struct CachedMode {
+        uint32_t fourcc = 0;
+        int w = 0;
+        int h = 0;
+        int maxFps = 0;
+    };
+
+    // VIDIOC_QUERYCTRL result; ok = false records that the control is absent/disabled.
+    struct CachedCtrl {
+        uint32_t id = 0;
+        bool ok = false;
+        int minV = 0, maxV = 0, step = 1, defV = 0;
+    };
+
+    // Everything start() learns from a device that does not change between opens,
+    // plus the mode that last streamed successfully.
+    struct UvcDeviceCaps {
+        std::string key;
+        std::vector<CachedMode> modes;
+        std::vector<CachedCtrl> ctrls;
+
+        bool hasGood = false;
+        int goodDesiredFps = 0;   // the desiredFps the good mode was chosen for
+        uint32_t goodFourcc = 0;
+        int goodW = 0, goodH = 0;
+        int goodFps = 0;
+        uint32_t goodMemory = 0;  // V4L2_MEMORY_*
+
+        const CachedCtrl *findCtrl(uint32_t id) const;
+    };
+
+    // "driver|card|bus_info|vid:pid"; vidPid may be empty when sysfs is not readable.
+    std::string uvcDeviceKey(const char *driver, const char *card, const char *busInfo,
+                             const std::string &vidPid);
+
+    // "046d:0825" for /dev/videoN from sysfs, or "" when unavailable.
+    std::string uvcVidPid(int videoIndex);
+
+    // One small text file per device key under `dir`. load() fails on a missing,
+    // foreign or older-format file; save() writes a temp file and renames it.
+    bool loadDeviceCaps(const std::string &dir, const std::string &key, UvcDeviceCaps &out);
+
+    bool saveDeviceCaps(const std::string &dir, const UvcDeviceCaps &caps);
+
+} // namespace uvc
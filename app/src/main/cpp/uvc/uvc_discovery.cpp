@@ -0,0 +1,90 @@
+// uvc_discovery.cpp
+
+#include "uvc_discovery.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+#include <dirent.h>
+#include <unistd.h>
+
+namespace uvc {
+
+    static std::string readLine(const std::string &path) {
+        std::ifstream f(path);
+        std::string s;
+        if (!f || !std::getline(f, s)) return {};
+        while (!s.empty() && (s.back() == '\n' || s.back() == ' ')) s.pop_back();
+        return s;
+    }
+
+    static int readHex(const std::string &path) {
+        const std::string s = readLine(path);
+        if (s.empty()) return -1;
+        char *end = nullptr;
+        const long v = std::strtol(s.c_str(), &end, 16);
+        return end && *end == 0 ? (int) v : -1;
+    }
+
+    static std::string driverOf(const std::string &dev) {
+        char buf[256];
+        const ssize_t n = readlink((dev + "/driver").c_str(), buf, sizeof(buf) - 1);
+        if (n > 0) {
+            buf[n] = 0;
+            const char *slash = std::strrchr(buf, '/');
+            return slash ? slash + 1 : buf;
+        }
+        std::ifstream f(dev + "/uevent");
+        std::string line;
+        while (std::getline(f, line)) {
+            if (line.compare(0, 7, "DRIVER=") == 0) return line.substr(7);
+        }
+        return {};
+    }
+
+    std::vector<V4l2NodeInfo> listV4l2Nodes(const std::string &sysRoot) {
+        std::vector<V4l2NodeInfo> out;
+        const std::string cls = sysRoot + "/class/video4linux";
+        DIR *d = opendir(cls.c_str());
+        if (!d) return out;
+
+        while (dirent *e = readdir(d)) {
+            if (std::strncmp(e->d_name, "video", 5) != 0) continue;
+            char *end = nullptr;
+            const long n = std::strtol(e->d_name + 5, &end, 10);
+            if (end == e->d_name + 5 || *end != 0 || n < 0) continue;
+
+            const std::string node = cls + "/" + e->d_name;
+            const std::string dev = node + "/device";
+            V4l2NodeInfo info;
+            info.video = (int) n;
+            info.name = readLine(node + "/name");
+            info.driver = driverOf(dev);
+            const std::string idx = readLine(node + "/index");
+            info.index = idx.empty() ? 0 : std::atoi(idx.c_str());
+            info.ifaceClass = readHex(dev + "/bInterfaceClass");
+            info.ifaceSubClass = readHex(dev + "/bInterfaceSubClass");
+            out.push_back(info);
+        }
+        closedir(d);
+
+        std::sort(out.begin(), out.end(), [](const V4l2NodeInfo &a, const V4l2NodeInfo &b) {
+            return a.video < b.video;
+        });
+        return out;
+    }
+
+    std::vector<int> uvcCaptureNodes(const std::string &sysRoot) {
+        static constexpr int kUsbClassVideo = 0x0e;
+        std::vector<int> out;
+        for (const auto &n: listV4l2Nodes(sysRoot)) {
+            if (n.driver != "uvcvideo" || n.index != 0) continue;
+            if (n.ifaceClass >= 0 && n.ifaceClass != kUsbClassVideo) continue;
+            out.push_back(n.video);
+        }
+        return out;
+    }
+
+} // namespace uvc
@@ -0,0 +1,29 @@
+// uvc_discovery.h
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace uvc {
+
+    // What sysfs says about one /dev/videoN, read without opening the node.
+    struct V4l2NodeInfo {
+        int video = -1;          // N in /dev/videoN
+        std::string name;        // video4linux/videoN/name
+        std::string driver;      // driver bound to the parent device ("uvcvideo")
+        int index = 0;           // video4linux/videoN/index: 0 = first node of the device
+        int ifaceClass = -1;     // USB bInterfaceClass (0x0e = video), -1 if not USB
+        int ifaceSubClass = -1;
+    };
+
+    // Every videoN under <sysRoot>/class/video4linux, sorted by N. sysRoot is "/sys"
+    // on a device; tests point it at a fake tree. The driver comes from the
+    // device/driver link, or DRIVER= in device/uevent when there is no link.
+    std::vector<V4l2NodeInfo> listV4l2Nodes(const std::string &sysRoot);
+
+    // Nodes worth opening for UVC capture: uvcvideo on a USB video-class interface,
+    // and index 0 only, since the following nodes are metadata. Sorted by N.
+    std::vector<int> uvcCaptureNodes(const std::string &sysRoot);
+
+} // namespace uvc
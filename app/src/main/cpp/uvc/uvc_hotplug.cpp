@@ -0,0 +1,89 @@
+// uvc_hotplug.cpp
+
+#include "uvc_hotplug.h"
+
+#include <cstring>
+
+#include <linux/netlink.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace uvc {
+
+    bool parseUevent(const char *buf, size_t len, Uevent &out) {
+        out = Uevent{};
+        if (!buf || len == 0) return false;
+        const char *end = buf + len;
+
+        // Header "action@devpath".
+        const char *p = buf;
+        const char *z = (const char *) std::memchr(p, 0, (size_t) (end - p));
+        if (!z) return false;
+        const char *at = (const char *) std::memchr(p, '@', (size_t) (z - p));
+        if (!at) return false;
+        out.action.assign(p, at);
+
+        for (p = z + 1; p < end; p = z + 1) {
+            z = (const char *) std::memchr(p, 0, (size_t) (end - p));
+            if (!z) z = end;
+            const size_t n = (size_t) (z - p);
+            if (n > 7 && std::strncmp(p, "ACTION=", 7) == 0) {
+                out.action.assign(p + 7, n - 7);
+            } else if (n > 10 && std::strncmp(p, "SUBSYSTEM=", 10) == 0) {
+                out.subsystem.assign(p + 10, n - 10);
+            } else if (n > 8 && std::strncmp(p, "DEVNAME=", 8) == 0) {
+                out.devName.assign(p + 8, n - 8);
+                if (out.devName.compare(0, 5, "/dev/") == 0) out.devName.erase(0, 5);
+            }
+        }
+        return !out.action.empty();
+    }
+
+    bool V4l2HotplugListener::open() {
+        close();
+        int fd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK,
+                        NETLINK_KOBJECT_UEVENT);
+        if (fd < 0) return false;
+
+        sockaddr_nl addr{};
+        addr.nl_family = AF_NETLINK;
+        addr.nl_pid = 0;      // let the kernel pick
+        addr.nl_groups = 1;   // kernel broadcast group
+        if (bind(fd, (sockaddr *) &addr, sizeof(addr)) != 0) {
+            ::close(fd);
+            return false;
+        }
+        mFd = fd;
+        return true;
+    }
+
+    void V4l2HotplugListener::close() {
+        if (mFd >= 0) {
+            ::close(mFd);
+            mFd = -1;
+        }
+    }
+
+    int V4l2HotplugListener::drain(const std::string &devName) {
+        if (mFd < 0) return 0;
+        int bits = 0;
+        char buf[4096];
+        for (;;) {
+            sockaddr_nl from{};
+            socklen_t fromLen = sizeof(from);
+            const ssize_t n = recvfrom(mFd, buf, sizeof(buf), 0, (sockaddr *) &from, &fromLen);
+            if (n <= 0) break;
+            if (from.nl_pid != 0) continue;   // only the kernel, not other processes
+
+            Uevent ev;
+            if (!parseUevent(buf, (size_t) n, ev) || ev.subsystem != "video4linux") continue;
+            if (ev.action == "add") {
+                bits |= kAdded;
+            } else if (ev.action == "remove" && (devName.empty() || ev.devName == devName)) {
+                bits |= kRemoved;
+            }
+        }
+        return bits;
+    }
+
+} // namespace uvc
@@ -0,0 +1,45 @@
+// uvc_hotplug.h
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace uvc {
+
+    struct Uevent {
+        std::string action;      // "add", "remove", ...
+        std::string subsystem;   // "video4linux", "usb", ...
+        std::string devName;     // "video0" (relative to /dev)
+    };
+
+    // One NETLINK_KOBJECT_UEVENT datagram: "action@devpath\0KEY=VALUE\0...". Messages
+    // relayed by a userspace daemon ("libudev" header) are rejected.
+    bool parseUevent(const char *buf, size_t len, Uevent &out);
+
+    // Kernel uevent socket reduced to video4linux add/remove. open() fails when
+    // netlink is not permitted (SELinux); callers then fall back to retrying opens.
+    class V4l2HotplugListener {
+    public:
+        enum : int {
+            kAdded = 1,
+            kRemoved = 2
+        };
+
+        ~V4l2HotplugListener() { close(); }
+
+        bool open();
+
+        void close();
+
+        int fd() const { return mFd; }
+
+        // Reads every pending message and returns kAdded / kRemoved bits for
+        // video4linux nodes; removals count only for `devName` when it is non-empty.
+        int drain(const std::string &devName);
+
+    private:
+        int mFd = -1;
+    };
+
+} // namespace uvc
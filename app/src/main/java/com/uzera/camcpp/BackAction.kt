@@ -2,6 +2,7 @@ package com.uzera.camcpp
 
 import android.content.Context
 import android.graphics.Matrix
+import android.graphics.RectF
 import android.graphics.SurfaceTexture
 import android.hardware.camera2.CameraCharacteristics
 import android.hardware.camera2.CameraManager
@@ -35,6 +36,9 @@ class BackAction(
     private val backStarted = AtomicBoolean(false)
     private val backStarting = AtomicBoolean(false)
 
+    // Frames go to the native compositor's top layer instead of backTv.
+    private var composited = false
+
     fun setup() {
         initBackSensorOrientation()
         updateBackRotationFromDisplay()
@@ -92,8 +96,22 @@ class BackAction(
         backSt = null
     }
 
+    fun startComposited() {
+        stopBack()
+        composited = true
+        camExec.execute { nativeSetBackComposited(true) }
+        maybeStartBack()
+    }
+
+    fun stopComposited() {
+        if (!composited) return
+        stopBack()
+        composited = false
+        camExec.execute { nativeSetBackComposited(false) }
+    }
+
     fun maybeStartBack() {
-        val s = backSurface ?: return
+        val s = if (composited) null else (backSurface ?: return)
         if (!hasPermissionProvider()) return
         if (backStarted.get() || backStarting.get()) return
 
@@ -213,6 +231,20 @@ class BackAction(
 
         m.postTranslate(vw / 2f, vh / 2f)
 
+        // The camera crops to the part of the frame this shows; map the cropped buffer
+        // back onto the part of the frame it now holds.
+        val inv = Matrix()
+        if (m.invert(inv)) {
+            val r = RectF(0f, 0f, vw, vh)
+            inv.mapRect(r)
+            val shown =
+                nativeSetBackVisibleRegion(r.left / vw, r.top / vh, r.right / vw, r.bottom / vh)
+            if (shown.size == 4) {
+                m.preTranslate(shown[0] * vw, shown[1] * vh)
+                m.preScale(shown[2] - shown[0], shown[3] - shown[1])
+            }
+        }
+
         tv.setTransform(m)
         tv.invalidate()
     }
@@ -234,12 +266,28 @@ class BackAction(
     private external fun nativeGetBackChosenSensorOrientationDeg(): Int
     private external fun nativeGetBackChosenCameraId(): String
 
-    private external fun nativeStartBackPreview(surface: Surface, desiredFps: Int): Boolean
+    private external fun nativeStartBackPreview(surface: Surface?, desiredFps: Int): Boolean
     private external fun nativeStopBackPreview()
+    private external fun nativeSetBackComposited(on: Boolean)
 
     private external fun nativeGetBackLastSensorTimestampNs(): Long
     private external fun nativeGetBackEstimatedFpsX100(): Int
     private external fun nativeGetBackLastError(): String
+    private external fun nativeGetBackPresentJitterUs(): Int
+    private external fun nativeGetBackPresentLateDrops(): Long
+    private external fun nativeGetBackPresentLatencyUs(): Int
+    private external fun nativeGetBackFrameIntervalJitterUs(): Int
+    private external fun nativeGetBackOverwrittenFrames(): Long
+    private external fun nativeGetBackLostFrames(): Long
+    private external fun nativeGetBackAcquireLatencyUs(): Int
+    private external fun nativeGetBackConvertLatencyUs(): Int
+    private external fun nativeGetBackPostLatencyUs(): Int
+    private external fun nativeGetBackFrameDurationUs(): Int
+    private external fun nativeGetBackExposureUs(): Int
+    private external fun nativeGetBackRollingShutterSkewUs(): Int
+    private external fun nativeSetBackVisibleRegion(
+        left: Float, top: Float, right: Float, bottom: Float
+    ): FloatArray
 
     companion object {
         private const val TAG = "CamcppNDK"
@@ -4,7 +4,10 @@ import android.Manifest
 import android.content.pm.PackageManager
 import android.content.res.Configuration
 import android.graphics.Color
+import android.graphics.SurfaceTexture
 import android.os.Bundle
+import android.util.Log
+import android.view.Surface
 import android.view.WindowManager
 import android.widget.FrameLayout
 import android.widget.LinearLayout
@@ -35,6 +38,16 @@ class MainActivity : AppCompatActivity() {
     private val PANEL_POS_X = 250
     private val PANEL_POS_Y = 15
 
+    // Both cameras composed natively into one panel-sized window (DualCompositor) instead
+    // of two stacked TextureViews.
+    private val NATIVE_COMPOSITOR = false
+    // Multi-band seam blend in the compositor instead of the plain ramp.
+    private val PANEL_SEAM_MULTIBAND = false
+    // Directory of recorded MJPEG frames (*.jpg / *.mjpg) to time the UVC decoder on at
+    // startup, on its own thread; the summary is logged. null skips it.
+    private val MJPEG_BENCHMARK_DIR: String? = null
+    private var panelSurface: Surface? = null
+
     init {
         System.loadLibrary("camcpp")
     }
@@ -91,7 +104,7 @@ class MainActivity : AppCompatActivity() {
             }
             clipChildren = true
             clipToPadding = true
-            addView(stack)
+            addView(if (NATIVE_COMPOSITOR) createCompositorView() else stack)
         }
 
         root = FrameLayout(this).apply {
@@ -121,6 +134,10 @@ class MainActivity : AppCompatActivity() {
         uvcAction.setup()
         uvcAction.registerUsbReceiver()
 
+        MJPEG_BENCHMARK_DIR?.let { dir ->
+            Thread { Log.i(TAG, "MJPEG benchmark ${nativeBenchmarkMjpeg(dir, 20)}") }.start()
+        }
+
         hasPermission = ContextCompat.checkSelfPermission(
             this, Manifest.permission.CAMERA
         ) == PackageManager.PERMISSION_GRANTED
@@ -157,6 +174,43 @@ class MainActivity : AppCompatActivity() {
         root.post { scalePanelToFitIfNeeded() }
     }
 
+    private fun createCompositorView(): TextureView = TextureView(this).apply {
+        layoutParams = FrameLayout.LayoutParams(PANEL_W_PX, PANEL_H_PX)
+        surfaceTextureListener = object : TextureView.SurfaceTextureListener {
+            override fun onSurfaceTextureAvailable(st: SurfaceTexture, w: Int, h: Int) {
+                st.setDefaultBufferSize(PANEL_W_PX, PANEL_H_PX)
+                val s = Surface(st)
+                panelSurface = s
+                camExec.execute {
+                    nativeSetCompositorSeamMode(PANEL_SEAM_MULTIBAND)
+                    val ok = nativeStartCompositor(s)
+                    runOnUiThread {
+                        if (ok) {
+                            backAction.startComposited()
+                            uvcAction.startComposited()
+                        }
+                    }
+                }
+            }
+
+            override fun onSurfaceTextureSizeChanged(st: SurfaceTexture, w: Int, h: Int) {}
+
+            override fun onSurfaceTextureDestroyed(st: SurfaceTexture): Boolean {
+                backAction.stopComposited()
+                uvcAction.stopComposited()
+                val s = panelSurface
+                panelSurface = null
+                camExec.execute {
+                    nativeStopCompositor()
+                    s?.release()
+                }
+                return true
+            }
+
+            override fun onSurfaceTextureUpdated(st: SurfaceTexture) {}
+        }
+    }
+
     private fun scalePanelToFitIfNeeded() {
         val rw = root.width
         val rh = root.height
@@ -175,4 +229,15 @@ class MainActivity : AppCompatActivity() {
         panel.scaleX = scale
         panel.scaleY = scale
     }
+
+    private external fun nativeStartCompositor(surface: Surface): Boolean
+    private external fun nativeStopCompositor()
+    private external fun nativeSetCompositorSeamMode(multiBand: Boolean)
+    private external fun nativeGetCompositorFrames(): Long
+    private external fun nativeGetCompositorComposeUs(): Int
+    private external fun nativeBenchmarkMjpeg(dir: String, passes: Int): String
+
+    companion object {
+        private const val TAG = "CamcppNDK"
+    }
 }
@@ -8,6 +8,8 @@ import android.graphics.Matrix
 import android.graphics.SurfaceTexture
 import android.hardware.usb.UsbManager
 import android.os.Build
+import android.os.Handler
+import android.os.Looper
 import android.util.Log
 import android.view.Surface
 import android.view.TextureView
@@ -28,9 +30,17 @@ class UvcAction(
     private var extSt: SurfaceTexture? = null
     private var extSurface: Surface? = null
 
+    // Native UvcCamera handle; every UvcAction drives its own camera instance.
+    private var extCam = 0L
+
     private val extStarted = AtomicBoolean(false)
     private val extStarting = AtomicBoolean(false)
 
+    // Frames go to the native compositor's bottom layer instead of extTv, which may
+    // then never be attached; retries are posted to the main looper.
+    private var composited = false
+    private val mainHandler = Handler(Looper.getMainLooper())
+
     private var extModeCache: String = ""
     private var extFmtCache: String = ""
     private var extBufW: Int = 1920
@@ -42,13 +52,18 @@ class UvcAction(
     private val usbReceiver = object : BroadcastReceiver() {
         override fun onReceive(context: Context, intent: Intent) {
             when (intent.action) {
-                UsbManager.ACTION_USB_DEVICE_DETACHED -> activity.runOnUiThread { stopExt() }
+                // A running preview recovers natively: capLoop notices the device going
+                // away and reopens the same mode when it returns, so keep it alive.
+                UsbManager.ACTION_USB_DEVICE_DETACHED -> Log.i(TAG, "EXT usb detached")
                 UsbManager.ACTION_USB_DEVICE_ATTACHED -> {
                     camExec.execute {
+                        // The re-created /dev/video* node needs its permissions again
+                        // before the native reopen can succeed.
                         prepareUvcAccess()
                         activity.runOnUiThread {
-                            stopExt()
-                            extTv.postDelayed({ maybeStartExt() }, 200)
+                            if (!extStarted.get()) {
+                                mainHandler.postDelayed({ maybeStartExt() }, 200)
+                            }
                         }
                     }
                 }
@@ -57,6 +72,9 @@ class UvcAction(
     }
 
     fun setup() {
+        if (extCam == 0L) extCam = nativeCreateExtCamera()
+        nativeSetExtCacheDir(extCam, activity.cacheDir.absolutePath)
+
         extTv.addOnLayoutChangeListener { _, _, _, _, _, _, _, _, _ ->
             applyExtTransform()
         }
@@ -125,42 +143,84 @@ class UvcAction(
         extSurface = null
         extSt = null
         unregisterUsbReceiver()
+
+        val cam = extCam
+        extCam = 0L
+        if (cam != 0L) camExec.execute { nativeDestroyExtCamera(cam) }
+    }
+
+    fun startComposited() {
+        stopExt()
+        composited = true
+        val cam = extCam
+        if (cam != 0L) camExec.execute { nativeSetExtComposited(cam, true) }
+        maybeStartExt()
+    }
+
+    fun stopComposited() {
+        if (!composited) return
+        stopExt()
+        composited = false
+        val cam = extCam
+        if (cam != 0L) camExec.execute { nativeSetExtComposited(cam, false) }
     }
 
     fun maybeStartExt() {
-        val s = extSurface ?: return
+        val s = if (composited) null else (extSurface ?: return)
         if (!hasPermissionProvider()) return
         if (extStarted.get() || extStarting.get()) return
+        val cam = extCam
+        if (cam == 0L) return
 
         extStarting.set(true)
         camExec.execute {
-            val prepOk = prepareUvcAccess()
-            val ok = if (prepOk) nativeStartExternalPreview(s, DESIRED_FPS) else false
-            val mode = if (ok) nativeGetExtChosenMode() else ""
-
+            // Returns as soon as the window is taken; discovery and setup run natively
+            // on their own thread, so camExec stays free for stop and back-camera work.
+            val queued = prepareUvcAccess() &&
+                nativeStartExternalPreviewAsync(cam, s, DESIRED_FPS)
             activity.runOnUiThread {
-                extStarting.set(false)
-                extStarted.set(ok)
-
-                extModeCache = mode
-                if (mode.isNotBlank()) {
-                    updateExtBufFromModeString(mode)
-                    extSt?.setDefaultBufferSize(extBufW, extBufH)
-                    applyExtTransform()
-                } else {
-                    extFmtCache = ""
-                }
+                if (queued) pollExtStart() else extStarting.set(false)
             }
         }
     }
 
+    private fun pollExtStart() {
+        if (!extStarting.get()) return   // stopExt() ran meanwhile
+        when (nativeGetExtStartState(extCam)) {
+            START_STATE_STARTING -> mainHandler.postDelayed({ pollExtStart() }, START_POLL_MS)
+            START_STATE_RUNNING -> onExtStarted(true)
+            else -> {
+                Log.w(TAG, "EXT start failed: ${nativeGetExtLastError(extCam)}")
+                onExtStarted(false)
+            }
+        }
+    }
+
+    private fun onExtStarted(ok: Boolean) {
+        val mode = if (ok) nativeGetExtChosenMode(extCam) else ""
+        if (ok) Log.i(TAG, "EXT start ${nativeGetExtStartTimings(extCam)}")
+
+        extStarting.set(false)
+        extStarted.set(ok)
+
+        extModeCache = mode
+        if (mode.isNotBlank()) {
+            updateExtBufFromModeString(mode)
+            extSt?.setDefaultBufferSize(extBufW, extBufH)
+            applyExtTransform()
+        } else {
+            extFmtCache = ""
+        }
+    }
+
     fun stopExt() {
         if (!extStarted.get() && !extStarting.get()) return
         extStarted.set(false)
         extStarting.set(false)
         extModeCache = ""
         extFmtCache = ""
-        camExec.execute { nativeStopExternalPreview() }
+        val cam = extCam
+        camExec.execute { nativeStopExternalPreview(cam) }
     }
 
     /**
@@ -269,15 +329,50 @@ class UvcAction(
         return true
     }
 
-    private external fun nativeStartExternalPreview(surface: Surface, desiredFps: Int): Boolean
-    private external fun nativeStopExternalPreview()
-
-    private external fun nativeGetExtLastSensorTimestampNs(): Long
-    private external fun nativeGetExtEstimatedFpsX100(): Int
-    private external fun nativeGetExtLastError(): String
-    private external fun nativeGetExtChosenMode(): String
+    private external fun nativeCreateExtCamera(): Long
+    private external fun nativeDestroyExtCamera(handle: Long)
+    private external fun nativeStartExternalPreview(
+        handle: Long, surface: Surface?, desiredFps: Int
+    ): Boolean
+    private external fun nativeStartExternalPreviewAsync(
+        handle: Long, surface: Surface?, desiredFps: Int
+    ): Boolean
+    private external fun nativeSetExtComposited(handle: Long, on: Boolean)
+    private external fun nativeGetExtStartState(handle: Long): Int
+    private external fun nativeStopExternalPreview(handle: Long)
+
+    private external fun nativeGetExtLastSensorTimestampNs(handle: Long): Long
+    private external fun nativeGetExtEstimatedFpsX100(handle: Long): Int
+    private external fun nativeGetExtBuffersInFlight(handle: Long): Int
+    private external fun nativeGetExtMemoryMode(handle: Long): String
+    private external fun nativeGetExtDroppedFrames(handle: Long): Long
+    private external fun nativeGetExtRejectedFrames(handle: Long): Long
+    private external fun nativeGetExtSkippedFrames(handle: Long): Long
+    private external fun nativeGetExtDequeueLatencyUs(handle: Long): Int
+    private external fun nativeGetExtTimestampSource(handle: Long): String
+    private external fun nativeSetExtMjpegDecodeWorkers(handle: Long, n: Int)
+    private external fun nativeGetExtMjpegDecodeUs(handle: Long): Int
+    private external fun nativeGetExtMjpegDecodeWorkers(handle: Long): Int
+    private external fun nativeGetExtMjpegSlices(handle: Long): Int
+    private external fun nativeGetExtAeLuma(handle: Long): Int
+    private external fun nativeGetExtLastError(handle: Long): String
+    private external fun nativeGetExtChosenMode(handle: Long): String
+    private external fun nativeGetExtNode(handle: Long): Int
+    private external fun nativeSetExtCacheDir(handle: Long, dir: String)
+    private external fun nativeGetExtStartTimings(handle: Long): String
+    private external fun nativeGetExtDeviceLost(handle: Long): Boolean
+    private external fun nativeGetExtReconnectCount(handle: Long): Int
+    private external fun nativeGetExtReconnectToFirstFrameMs(handle: Long): Int
+    private external fun nativeGetExtPresentJitterUs(handle: Long): Int
+    private external fun nativeGetExtPresentLateDrops(handle: Long): Long
+    private external fun nativeGetExtPresentLatencyUs(handle: Long): Int
 
     companion object {
         private const val TAG = "CamcppNDK"
+
+        // uvc::StartState
+        private const val START_STATE_STARTING = 1
+        private const val START_STATE_RUNNING = 2
+        private const val START_POLL_MS = 16L
     }
 }
@@ -0,0 +1,87 @@
+// back_rotate_bench.cpp
+//
+// The back camera's convert + rotate: the tiled yuv420ToRgbaRotated() against the two
+// steps it replaced, yuv420ToRgba() into a full RGBA frame and cv::rotate of that. OpenCV
+// is not built for the host, so the rotate is written out the way cv::rotate does it:
+// transpose and a flip for 90 / 270, one flip of both axes for 180.
+//
+//   back_rotate_bench [width] [height] [passes]
+
+#include "bench_util.h"
+#include "common/yuv_convert.h"
+#include "yuv_test_image.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+namespace {
+
+    // Tight RGBA as 32-bit pixels: dst (w x h) = src (h x w) transposed.
+    void transpose(const uint32_t *src, int srcW, int srcH, uint32_t *dst) {
+        for (int r = 0; r < srcW; r++) {
+            uint32_t *d = dst + (size_t) r * srcH;
+            for (int c = 0; c < srcH; c++) d[c] = src[(size_t) c * srcW + r];
+        }
+    }
+
+    void flip(uint32_t *img, int w, int h, bool horizontal, bool vertical) {
+        if (vertical) {
+            for (int r = 0; r < h / 2; r++)
+                std::swap_ranges(img + (size_t) r * w, img + (size_t) (r + 1) * w,
+                                 img + (size_t) (h - 1 - r) * w);
+        }
+        if (horizontal) {
+            for (int r = 0; r < h; r++)
+                std::reverse(img + (size_t) r * w, img + (size_t) (r + 1) * w);
+        }
+    }
+
+    // cv::rotate(src, dst, ROTATE_*) of a tight w x h RGBA frame.
+    void rotateTwoStep(const std::vector<uint32_t> &src, int w, int h, int rotation,
+                       std::vector<uint32_t> &dst) {
+        if (rotation == 180) {
+            dst = src;
+            flip(dst.data(), w, h, true, true);
+            return;
+        }
+        transpose(src.data(), w, h, dst.data());
+        flip(dst.data(), h, w, rotation == 90, rotation == 270);
+    }
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    const int w = std::max(2, benchArg(argc, argv, 1, 1280) & ~1);
+    const int h = std::max(2, benchArg(argc, argv, 2, 720) & ~1);
+    const int passes = benchArg(argc, argv, 3, 100);
+
+    const Planes planes(w, h, 4242);
+    const Image im = makeImage(planes, Yuv420Layout::NV21, 0);
+    std::vector<uint32_t> full((size_t) w * h), twoStep((size_t) w * h), tiled((size_t) w * h);
+    std::printf("%dx%d NV21 isa=%s passes=%d\n", w, h, yuvConvertIsa(), passes);
+
+    int mismatches = 0;
+    for (int rotation: {90, 180, 270}) {
+        const int outW = rotation == 180 ? w : h;
+        const auto [twoStepMs, tiledMs] = benchPairMs(
+                passes,
+                [&] {
+                    yuv420ToRgba(im.src, w, h, (uint8_t *) full.data(), (size_t) w * 4);
+                    rotateTwoStep(full, w, h, rotation, twoStep);
+                },
+                [&] {
+                    yuv420ToRgbaRotated(im.src, w, h, rotation, (uint8_t *) tiled.data(),
+                                        (size_t) outW * 4);
+                });
+        const bool same = twoStep == tiled;
+        if (!same) mismatches++;
+        std::printf("  %3d: convert + rotate %.3f ms, tiled %.3f ms (%.2fx), match=%d\n",
+                    rotation, twoStepMs, tiledMs, tiledMs > 0 ? twoStepMs / tiledMs : 0.0,
+                    same ? 1 : 0);
+    }
+    return mismatches ? 1 : 0;
+}
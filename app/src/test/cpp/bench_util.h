@@ -0,0 +1,66 @@
+// bench_util.h
+
+#pragma once
+
+#include "common/time_utils.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <utility>
+#include <vector>
+
+// Host benchmarks are optimised executables built next to the tests but not run by
+// ctest: a timing is not a pass / fail. Each takes optional numeric arguments
+// (`./yuyv_convert_bench 1920 1080 200`) and prints its results.
+
+// argv[i] as a positive int; `def` when missing or not one.
+static inline int benchArg(int argc, char **argv, int i, int def) {
+    if (i >= argc) return def;
+    const int v = std::atoi(argv[i]);
+    return v > 0 ? v : def;
+}
+
+// Deterministic noise, so runs compare.
+static inline void benchFill(std::vector<uint8_t> &buf, uint32_t seed) {
+    for (auto &b: buf) {
+        seed = seed * 1664525u + 1013904223u;
+        b = (uint8_t) (seed >> 24);
+    }
+}
+
+// Median wall time of one call of fn over `passes` calls, in ms, after one call to warm
+// the caches and page in the buffers. The median rather than the mean, so a pass the
+// scheduler interrupts does not move the result.
+template<typename F>
+static double benchMs(int passes, F &&fn) {
+    fn();
+    std::vector<long long> ns((size_t) std::max(passes, 1));
+    for (auto &t: ns) {
+        const long long t0 = nowBoottimeNs();
+        fn();
+        t = nowBoottimeNs() - t0;
+    }
+    std::nth_element(ns.begin(), ns.begin() + ns.size() / 2, ns.end());
+    return (double) ns[ns.size() / 2] / 1e6;
+}
+
+// benchMs() of two calls measured alternately, so clock or load changes during the run
+// hit both alike: {median ms of a, median ms of b}.
+template<typename A, typename B>
+static std::pair<double, double> benchPairMs(int passes, A &&a, B &&b) {
+    a();
+    b();
+    std::vector<long long> na((size_t) std::max(passes, 1)), nb(na.size());
+    for (size_t i = 0; i < na.size(); i++) {
+        long long t0 = nowBoottimeNs();
+        a();
+        na[i] = nowBoottimeNs() - t0;
+        t0 = nowBoottimeNs();
+        b();
+        nb[i] = nowBoottimeNs() - t0;
+    }
+    std::nth_element(na.begin(), na.begin() + na.size() / 2, na.end());
+    std::nth_element(nb.begin(), nb.begin() + nb.size() / 2, nb.end());
+    return {(double) na[na.size() / 2] / 1e6, (double) nb[nb.size() / 2] / 1e6};
+}
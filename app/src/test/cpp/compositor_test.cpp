@@ -0,0 +1,252 @@
+// compositor_test.cpp
+
+#include "test_check.h"
+#include "common/dual_compositor.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+    // A small panel: top layer rows [0, 28), band [20, 28), bottom layer rows [20, 48).
+    ComposeLayout smallLayout() {
+        ComposeLayout lay;
+        lay.w = 64;
+        lay.h = 48;
+        lay.seamY = 24;
+        lay.overlap = 8;
+        return lay;
+    }
+
+    constexpr uint8_t kRed[4] = {200, 30, 10, 255};
+    constexpr uint8_t kBlue[4] = {20, 40, 220, 255};
+    constexpr uint8_t kBlack[4] = {0, 0, 0, 255};
+
+    void publishSolid(ComposeLayer &l, int w, int h, const uint8_t px[4]) {
+        size_t stride = 0;
+        uint8_t *dst = l.frame(w, h, stride);
+        for (int y = 0; y < h; y++) {
+            for (int x = 0; x < w; x++) std::memcpy(dst + y * stride + x * 4, px, 4);
+        }
+        l.publish();
+    }
+
+    bool rowIs(const MemoryComposeSink &s, int y, const uint8_t px[4]) {
+        const uint8_t *row = s.frame() + (size_t) y * s.stride();
+        for (int x = 0; x < s.width(); x++) {
+            if (std::memcmp(row + x * 4, px, 4) != 0) return false;
+        }
+        return true;
+    }
+
+    // What the band row `i` should hold: lower over upper by the ramp weight.
+    void bandPixel(const uint8_t up[4], const uint8_t lo[4], int weight, uint8_t out[4]) {
+        for (int c = 0; c < 3; c++)
+            out[c] = (uint8_t) ((up[c] * (256 - weight) + lo[c] * weight + 128) >> 8);
+        out[3] = 255;
+    }
+
+    void checkBand(const MemoryComposeSink &s, const ComposeLayout &lay, const uint8_t up[4],
+                   const uint8_t lo[4]) {
+        const SeamBlender ramp(lay.overlap);
+        const int bandTop = lay.seamY - lay.overlap / 2;
+        for (int i = 0; i < lay.overlap; i++) {
+            uint8_t want[4];
+            bandPixel(up, lo, ramp.weight(i), want);
+            CHECK(rowIs(s, bandTop + i, want));
+        }
+    }
+
+    // Nothing published yet: the whole panel is opaque black.
+    void testNoLayers() {
+        DualCompositor comp(smallLayout());
+        MemoryComposeSink sink;
+        CHECK(comp.composeOnce(sink));
+        CHECK_EQ(sink.width(), 64);
+        CHECK_EQ(sink.height(), 48);
+        for (int y = 0; y < sink.height(); y++) CHECK(rowIs(sink, y, kBlack));
+        CHECK_EQ(sink.posts(), 1);
+        CHECK_EQ(comp.stats().composed, 1);
+    }
+
+    // Each layer fills its half, the band in between blends them row by row.
+    void testHalvesAndBand() {
+        const ComposeLayout lay = smallLayout();
+        DualCompositor comp(lay);
+        publishSolid(comp.top(), 30, 20, kRed);      // scaled up to cover
+        publishSolid(comp.bottom(), 160, 90, kBlue); // scaled down to cover
+        MemoryComposeSink sink;
+        CHECK(comp.composeOnce(sink));
+        const int bandTop = lay.seamY - lay.overlap / 2, bandEnd = bandTop + lay.overlap;
+        for (int y = 0; y < bandTop; y++) CHECK(rowIs(sink, y, kRed));
+        for (int y = bandEnd; y < lay.h; y++) CHECK(rowIs(sink, y, kBlue));
+        checkBand(sink, lay, kRed, kBlue);
+
+        // MultiBand blends flat layers the same way, to rounding.
+        comp.setSeamMode(SeamMode::MultiBand);
+        MemoryComposeSink multi;
+        CHECK(comp.composeOnce(multi));
+        int off = 0;
+        for (size_t i = 0; i < (size_t) lay.w * lay.h * 4; i++)
+            off = std::max(off, std::abs(multi.frame()[i] - sink.frame()[i]));
+        CHECK(off <= 1);
+    }
+
+    // A layer that never published shows black, and the band fades into it.
+    void testMissingLayer() {
+        const ComposeLayout lay = smallLayout();
+        const int bandTop = lay.seamY - lay.overlap / 2, bandEnd = bandTop + lay.overlap;
+        {
+            DualCompositor comp(lay);
+            publishSolid(comp.top(), 64, 28, kRed);
+            MemoryComposeSink sink;
+            CHECK(comp.composeOnce(sink));
+            for (int y = 0; y < bandTop; y++) CHECK(rowIs(sink, y, kRed));
+            for (int y = bandEnd; y < lay.h; y++) CHECK(rowIs(sink, y, kBlack));
+            checkBand(sink, lay, kRed, kBlack);
+        }
+        {
+            DualCompositor comp(lay);
+            publishSolid(comp.bottom(), 64, 28, kBlue);
+            MemoryComposeSink sink;
+            CHECK(comp.composeOnce(sink));
+            for (int y = 0; y < bandTop; y++) CHECK(rowIs(sink, y, kBlack));
+            for (int y = bandEnd; y < lay.h; y++) CHECK(rowIs(sink, y, kBlue));
+            checkBand(sink, lay, kBlack, kBlue);
+        }
+    }
+
+    // A layer exactly the size of its area comes out unscaled, pixel for pixel.
+    void testExactSize() {
+        const ComposeLayout lay = smallLayout();
+        const int bandTop = lay.seamY - lay.overlap / 2, bandEnd = bandTop + lay.overlap;
+        DualCompositor comp(lay);
+        size_t stride = 0;
+        uint8_t *dst = comp.top().frame(lay.w, bandEnd, stride);
+        for (int y = 0; y < bandEnd; y++) {
+            for (int x = 0; x < lay.w; x++) {
+                uint8_t *p = dst + y * stride + x * 4;
+                p[0] = (uint8_t) (x * 4);
+                p[1] = (uint8_t) (y * 9);
+                p[2] = (uint8_t) (x ^ y);
+                p[3] = 255;
+            }
+        }
+        comp.top().publish();
+        MemoryComposeSink sink;
+        CHECK(comp.composeOnce(sink));
+        int bad = 0;
+        for (int y = 0; y < bandTop; y++) {
+            const uint8_t *row = sink.frame() + (size_t) y * sink.stride();
+            for (int x = 0; x < lay.w; x++) {
+                const uint8_t *p = row + x * 4;
+                if (p[0] != x * 4 || p[1] != (uint8_t) (y * 9) || p[2] != (x ^ y) || p[3] != 255)
+                    bad++;
+            }
+        }
+        CHECK_EQ(bad, 0);
+    }
+
+    // Only the valid rectangle of a frame is shown, scaled as if it were the whole frame
+    // (here exactly the area's size, so pixel for pixel); the rest is never read. The
+    // next frame() is whole again.
+    void testValidRect() {
+        const ComposeLayout lay = smallLayout();
+        const int bandTop = lay.seamY - lay.overlap / 2, bandEnd = bandTop + lay.overlap;
+        const int vx = 50, vy = 30;
+        DualCompositor comp(lay);
+        size_t stride = 0;
+        uint8_t *dst = comp.top().frame(200, 100, stride);
+        for (int y = 0; y < 100; y++) {
+            for (int x = 0; x < 200; x++) std::memcpy(dst + y * stride + x * 4, kRed, 4);
+        }
+        for (int y = 0; y < bandEnd; y++) {
+            for (int x = 0; x < lay.w; x++) {
+                uint8_t *p = dst + (y + vy) * stride + (x + vx) * 4;
+                p[0] = (uint8_t) (x * 4);
+                p[1] = (uint8_t) (y * 9);
+                p[2] = (uint8_t) (x ^ y);
+                p[3] = 255;
+            }
+        }
+        comp.top().setValid(vx, vy, lay.w, bandEnd);
+        comp.top().publish();
+        MemoryComposeSink sink;
+        CHECK(comp.composeOnce(sink));
+        int bad = 0;
+        for (int y = 0; y < bandTop; y++) {
+            const uint8_t *row = sink.frame() + (size_t) y * sink.stride();
+            for (int x = 0; x < lay.w; x++) {
+                const uint8_t *p = row + x * 4;
+                if (p[0] != x * 4 || p[1] != (uint8_t) (y * 9) || p[2] != (x ^ y) || p[3] != 255)
+                    bad++;
+            }
+        }
+        CHECK_EQ(bad, 0);
+
+        publishSolid(comp.top(), 200, 100, kBlue);
+        CHECK(comp.composeOnce(sink));
+        CHECK(rowIs(sink, 0, kBlue));
+    }
+
+    // A transparent bottom band (the UVC feather at 0) leaves the top layer showing.
+    void testBottomAlpha() {
+        const ComposeLayout lay = smallLayout();
+        const int bandTop = lay.seamY - lay.overlap / 2, bandEnd = bandTop + lay.overlap;
+        DualCompositor comp(lay);
+        publishSolid(comp.top(), 64, 28, kRed);
+        const uint8_t clearBlue[4] = {kBlue[0], kBlue[1], kBlue[2], 0};
+        publishSolid(comp.bottom(), 64, 28, clearBlue);
+        MemoryComposeSink sink;
+        CHECK(comp.composeOnce(sink));
+        for (int y = bandTop; y < bandEnd; y++) CHECK(rowIs(sink, y, kRed));
+    }
+
+    // composeIfNew() composes only after a publish, and the newest frame wins.
+    void testFreshness() {
+        DualCompositor comp(smallLayout());
+        MemoryComposeSink sink;
+        CHECK(!comp.composeIfNew(sink));
+        publishSolid(comp.top(), 64, 28, kBlue);
+        publishSolid(comp.top(), 64, 28, kRed);
+        CHECK_EQ(comp.top().overwritten(), 1);
+        CHECK(comp.composeIfNew(sink));
+        CHECK(rowIs(sink, 0, kRed));
+        CHECK(!comp.composeIfNew(sink));
+        CHECK_EQ(sink.posts(), 1);
+    }
+
+    // A sink without a buffer skips the frame without posting.
+    class NoBufferSink : public ComposeSink {
+    public:
+        bool lock(int, int, uint8_t *&, size_t &) override { return false; }
+
+        void post() override { posts++; }
+
+        int posts = 0;
+    };
+
+    void testNoBuffer() {
+        DualCompositor comp(smallLayout());
+        NoBufferSink sink;
+        CHECK(!comp.composeOnce(sink));
+        CHECK_EQ(sink.posts, 0);
+        CHECK_EQ(comp.stats().composed, 0);
+    }
+
+}  // namespace
+
+int main() {
+    testNoLayers();
+    testHalvesAndBand();
+    testMissingLayer();
+    testExactSize();
+    testValidRect();
+    testBottomAlpha();
+    testFreshness();
+    testNoBuffer();
+    return testResult("compositor_test");
+}
@@ -0,0 +1,152 @@
+// frame_mailbox_test.cpp
+
+#include "test_check.h"
+#include "common/frame_mailbox.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+namespace {
+
+    constexpr int kWords = 1024;   // 4 KiB a frame, so a torn copy shows
+
+    struct Frame {
+        long long seq = -1;
+        uint32_t words[kWords] = {};
+    };
+
+    uint32_t pattern(long long seq, int i) {
+        return (uint32_t) seq * 2654435761u + (uint32_t) i * 40503u;
+    }
+
+    void fill(Frame &f, long long seq) {
+        f.seq = seq;
+        for (int i = 0; i < kWords; i++) f.words[i] = pattern(seq, i);
+    }
+
+    bool whole(const Frame &f) {
+        for (int i = 0; i < kWords; i++) {
+            if (f.words[i] != pattern(f.seq, i)) return false;
+        }
+        return true;
+    }
+
+    struct RunResult {
+        long long produced = 0;
+        long long consumed = 0;
+        long long overwritten = 0;   // publish() returned true
+        long long torn = 0;
+        long long reordered = 0;
+    };
+
+    // One producer publishing `frames` frames, one every `periodUs` (0 = flat out), and a
+    // consumer that spends up to `workUs` on each frame it takes.
+    RunResult run(FrameMailbox<Frame> &mb, long long frames, int periodUs, int workUs) {
+        RunResult r;
+        std::atomic<bool> done{false};
+
+        std::thread consumer([&] {
+            long long last = -1;
+            unsigned rng = 12345;
+            const auto take = [&](Frame *f) {
+                r.consumed++;
+                if (!whole(*f)) r.torn++;
+                if (f->seq <= last) r.reordered++;
+                last = f->seq;
+                if (workUs > 0) {
+                    rng = rng * 1103515245u + 12345u;
+                    std::this_thread::sleep_for(
+                            std::chrono::microseconds((rng >> 16) % (unsigned) workUs));
+                }
+            };
+            while (!done.load(std::memory_order_acquire)) {
+                if (Frame *f = mb.waitAcquire(5000000LL)) take(f);
+            }
+            // The last frame may still be waiting.
+            if (Frame *f = mb.tryAcquire()) take(f);
+        });
+
+        const auto start = std::chrono::steady_clock::now();
+        for (long long seq = 0; seq < frames; seq++) {
+            if (periodUs > 0)
+                std::this_thread::sleep_until(start + std::chrono::microseconds(seq * periodUs));
+            fill(mb.writeSlot(), seq);
+            if (mb.publish()) r.overwritten++;
+            r.produced++;
+        }
+        done.store(true, std::memory_order_release);
+        mb.wake();
+        consumer.join();
+        return r;
+    }
+
+    void checkRun(const char *what, FrameMailbox<Frame> &mb, const RunResult &r) {
+        std::printf("%s: produced %lld consumed %lld dropped %lld\n", what, r.produced,
+                    r.consumed, mb.dropped());
+        CHECK_EQ(r.consumed + mb.dropped(), r.produced);
+        CHECK_EQ(r.overwritten, mb.dropped());
+        CHECK_EQ(r.torn, 0);
+        CHECK_EQ(r.reordered, 0);
+        CHECK(r.consumed > 0);
+    }
+
+    void resetMailbox(FrameMailbox<Frame> &mb) {
+        mb.reset([](Frame &f) { f.seq = -1; });
+    }
+
+    // 500 fps against a consumer that sometimes takes longer than a frame: drops, but
+    // never a torn or out-of-order frame, and every frame is accounted for.
+    void testPacedStress() {
+        FrameMailbox<Frame> mb;
+        const RunResult r = run(mb, 1000, 2000, 4000);
+        checkRun("paced 500 fps", mb, r);
+        CHECK(mb.dropped() > 0);
+    }
+
+    void testFlatOutStress() {
+        FrameMailbox<Frame> mb;
+        const RunResult r = run(mb, 200000, 0, 0);
+        checkRun("flat out", mb, r);
+    }
+
+    void testReset() {
+        FrameMailbox<Frame> mb;
+        fill(mb.writeSlot(), 1);
+        mb.publish();
+        fill(mb.writeSlot(), 2);
+        CHECK(mb.publish());   // frame 1 never seen
+        CHECK_EQ(mb.dropped(), 1);
+
+        int cleared = 0;
+        mb.reset([&](Frame &f) {
+            f.seq = -1;
+            cleared++;
+        });
+        CHECK_EQ(cleared, 3);
+        CHECK_EQ(mb.dropped(), 0);
+        CHECK(mb.tryAcquire() == nullptr);   // frame 2 is gone with the rest
+
+        // Usable again from the start.
+        fill(mb.writeSlot(), 7);
+        CHECK(!mb.publish());
+        Frame *f = mb.tryAcquire();
+        CHECK(f != nullptr);
+        if (f) CHECK_EQ(f->seq, 7);
+        CHECK(mb.tryAcquire() == nullptr);
+
+        // And under load after a reset, counting from zero.
+        resetMailbox(mb);
+        const RunResult r = run(mb, 20000, 0, 0);
+        checkRun("after reset", mb, r);
+    }
+
+}  // namespace
+
+int main() {
+    testPacedStress();
+    testFlatOutStress();
+    testReset();
+    return testResult("frame_mailbox_test");
+}
@@ -0,0 +1,243 @@
+// present_scheduler_test.cpp
+
+#include "test_check.h"
+#include "common/present_scheduler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace {
+
+    constexpr long long kMs = 1000000LL;
+
+    long long floorDiv(long long a, long long b) {
+        long long q = a / b;
+        return (a % b != 0 && (a < 0) != (b < 0)) ? q - 1 : q;
+    }
+
+    struct Posted {
+        long long captureNs;
+        long long postNs;
+    };
+
+    struct ShownStats {
+        int shown = 0;
+        double meanJudderMs = 0.0;
+        double maxJudderMs = 0.0;
+        double meanLatencyMs = 0.0;
+    };
+
+    // What reaches the screen: a post is latched at the first vsync at least kLatchNs
+    // later; of several posts latched at one vsync only the last is seen.
+    ShownStats displayed(const std::vector<Posted> &posts, long long periodNs) {
+        static constexpr long long kLatchNs = 1000000LL;
+        std::vector<Posted> shown;   // postNs replaced by the vsync it shows at
+        for (const auto &p: posts) {
+            const long long v = floorDiv(p.postNs + kLatchNs + periodNs - 1, periodNs) * periodNs;
+            if (!shown.empty() && shown.back().postNs == v) shown.back() = {p.captureNs, v};
+            else shown.push_back({p.captureNs, v});
+        }
+        ShownStats s;
+        s.shown = (int) shown.size();
+        double judder = 0.0, lat = 0.0;
+        for (size_t i = 0; i < shown.size(); i++) {
+            lat += (double) (shown[i].postNs - shown[i].captureNs);
+            if (i == 0) continue;
+            const double d = std::fabs((double) ((shown[i].postNs - shown[i - 1].postNs) -
+                                                 (shown[i].captureNs - shown[i - 1].captureNs)));
+            judder += d;
+            s.maxJudderMs = std::max(s.maxJudderMs, d / 1e6);
+        }
+        if (shown.size() > 1) s.meanJudderMs = judder / (double) (shown.size() - 1) / 1e6;
+        if (!shown.empty()) s.meanLatencyMs = lat / (double) shown.size() / 1e6;
+        return s;
+    }
+
+    struct PacingRun {
+        ShownStats immediate;
+        ShownStats paced;
+        PresentStats stats;
+    };
+
+    // A `fps` stream with up to `jitterMs` of random decode delay, posted as soon as each
+    // frame is ready and through PresentScheduler on a `displayHz` vsync grid.
+    PacingRun simulate(int fps, int displayHz, double jitterMs, int frames) {
+        // The camera runs off its own crystal (+200 ppm here) at an arbitrary phase to
+        // vsync.
+        const long long frameNs = (long long) (1e9 / fps * 1.0002);
+        const long long periodNs = 1000000000LL / displayHz;
+        const long long baseDecodeNs = 3 * kMs;
+        const long long renderNs = 1 * kMs;
+        const long long t0 = 1000000000LL + periodNs * 3 / 5;
+
+        std::vector<long long> ready((size_t) frames);
+        uint32_t seed = 12345;
+        for (int i = 0; i < frames; i++) {
+            seed = seed * 1664525u + 1013904223u;
+            const double r = (double) (seed >> 8) / (double) (1u << 24);
+            ready[(size_t) i] = t0 + i * frameNs + baseDecodeNs + (long long) (r * jitterMs * 1e6);
+        }
+
+        std::vector<Posted> immediate;
+        long long busyUntil = 0;
+        for (int i = 0; i < frames; i++) {
+            const long long post = std::max(ready[(size_t) i], busyUntil) + renderNs;
+            busyUntil = post;
+            immediate.push_back({t0 + i * frameNs, post});
+        }
+
+        ManualPresentClock clock;
+        PresentScheduler pacer(clock);
+        pacer.setDisplayTiming(periodNs, periodNs);
+        std::vector<Posted> paced;
+        for (int i = 0; i < frames; i++) {
+            clock.advanceTo(ready[(size_t) i]);
+            const long long cap = t0 + i * frameNs;
+            if (!pacer.waitForSlot(cap)) continue;
+            clock.advanceTo(clock.nowNs() + renderNs);
+            pacer.presented();
+            paced.push_back({cap, clock.nowNs()});
+        }
+
+        PacingRun r;
+        r.immediate = displayed(immediate, periodNs);
+        r.paced = displayed(paced, periodNs);
+        r.stats = pacer.stats();
+        std::printf("%dfps@%dHz jitter=%.1fms: immediate shown=%d judder=%.2fms max=%.2fms | "
+                    "paced shown=%d judder=%.2fms max=%.2fms latency=%.1fms lateDrops=%lld\n",
+                    fps, displayHz, jitterMs, r.immediate.shown, r.immediate.meanJudderMs,
+                    r.immediate.maxJudderMs, r.paced.shown, r.paced.meanJudderMs,
+                    r.paced.maxJudderMs, r.paced.meanLatencyMs, r.stats.lateDrops);
+        return r;
+    }
+
+    // Decode jitter does not reach the screen: paced frames judder far less than frames
+    // posted as soon as they are ready, nearly all of them are shown, and the latency
+    // stays within the jitter plus a couple of refreshes. A frame rate that does not
+    // divide the refresh rate keeps its cadence judder (25 fps at 60 Hz alternates 2 and
+    // 3 refreshes), but never a whole refresh of it.
+    void testPacingBeatsImmediate() {
+        struct Case {
+            int fps, hz;
+            double jitterMs;
+        };
+        for (const Case &c: {Case{30, 60, 8.0}, Case{30, 90, 12.0}, Case{60, 60, 4.0},
+                             Case{25, 60, 10.0}}) {
+            const int frames = 600;
+            const PacingRun r = simulate(c.fps, c.hz, c.jitterMs, frames);
+            const double periodMs = 1000.0 / c.hz;
+            CHECK(r.paced.meanJudderMs <= r.immediate.meanJudderMs);
+            if (c.hz % c.fps == 0) CHECK(r.paced.meanJudderMs < periodMs / 4);
+            else CHECK(r.paced.maxJudderMs < periodMs);
+            CHECK(r.paced.shown >= frames * 97 / 100);
+            CHECK(r.paced.meanLatencyMs < 3.0 + c.jitterMs + 2 * periodMs);
+            CHECK(r.stats.presented + r.stats.lateDrops == frames);
+        }
+    }
+
+    // Slots sit kLeadNs (4 ms) before a vsync, one frame per vsync.
+    void testVsyncSlots() {
+        const long long period = 16 * kMs;
+        ManualPresentClock clock;
+        PresentScheduler pacer(clock);
+        pacer.setDisplayTiming(period, 0 * kMs + period * 10);
+
+        clock.advanceTo(100 * kMs);
+        CHECK(pacer.reserveSlot(95 * kMs));   // 5 ms budget: wants 100 ms
+        pacer.waitForReservedSlot();
+        const long long first = clock.nowNs();
+        CHECK((first + 4 * kMs) % period == 0);
+        CHECK(first >= 100 * kMs);
+        pacer.presented();
+
+        // A second frame for the same vsync takes the next one.
+        CHECK(pacer.reserveSlot(96 * kMs));
+        pacer.waitForReservedSlot();
+        CHECK_EQ(clock.nowNs(), first + period);
+        pacer.presented();
+        CHECK_EQ(pacer.stats().presented, 2);
+        CHECK_EQ(pacer.stats().periodUs, 16000);
+    }
+
+    // A frame that turns up after its slot is dropped and counted, without waiting.
+    void testLateDrop() {
+        const long long period = 16 * kMs;
+        ManualPresentClock clock;
+        PresentScheduler pacer(clock);
+        pacer.setDisplayTiming(period, period);
+        for (int i = 0; i < 10; i++) {
+            clock.advanceTo(i * 33 * kMs + 5 * kMs);
+            CHECK(pacer.waitForSlot(i * 33 * kMs));
+            pacer.presented();
+        }
+        // Ready 40 ms after capture against a ~5 ms budget: well past its slot.
+        const long long cap = 10 * 33 * kMs;
+        clock.advanceTo(cap + 40 * kMs);
+        const long long before = clock.nowNs();
+        CHECK(!pacer.waitForSlot(cap));
+        CHECK_EQ(clock.nowNs(), before);
+        CHECK_EQ(pacer.stats().lateDrops, 1);
+        // The budget took the late frame in, so the next one at that delay is shown.
+        clock.advanceTo(cap + 33 * kMs + 40 * kMs);
+        CHECK(pacer.waitForSlot(cap + 33 * kMs));
+    }
+
+    // cancelReservedSlot(): the next frame gets the slot it would have had if the
+    // cancelled one had never reserved, not the vsync after.
+    void testCancelReservedSlot() {
+        const long long period = 16 * kMs;
+        long long slot[2] = {0, 0};
+        for (int cancel = 0; cancel < 2; cancel++) {
+            ManualPresentClock clock;
+            PresentScheduler pacer(clock);
+            pacer.setDisplayTiming(period, period);
+            clock.advanceTo(20 * kMs);
+            CHECK(pacer.waitForSlot(15 * kMs));
+            pacer.presented();
+
+            clock.advanceTo(40 * kMs);
+            if (cancel) {
+                CHECK(pacer.reserveSlot(35 * kMs));   // a frame whose decode then fails
+                pacer.cancelReservedSlot();
+            }
+            CHECK(pacer.reserveSlot(36 * kMs));
+            pacer.waitForReservedSlot();
+            slot[cancel] = clock.nowNs();
+            pacer.presented();
+            CHECK_EQ(pacer.stats().presented, 2);
+        }
+        CHECK_EQ(slot[1], slot[0]);
+    }
+
+    // Capture timestamps that go backwards (a new stream) start the pacing over.
+    void testRestart() {
+        const long long period = 16 * kMs;
+        ManualPresentClock clock;
+        PresentScheduler pacer(clock);
+        pacer.setDisplayTiming(period, period);
+        for (int i = 0; i < 5; i++) {
+            clock.advanceTo(1000 * kMs + i * 33 * kMs + 5 * kMs);
+            CHECK(pacer.waitForSlot(1000 * kMs + i * 33 * kMs));
+            pacer.presented();
+        }
+        clock.advanceTo(clock.nowNs() + 33 * kMs);
+        CHECK(pacer.waitForSlot(10 * kMs));
+        CHECK_EQ(pacer.stats().lateDrops, 0);
+
+        pacer.reset();
+        clock.advanceTo(clock.nowNs() + 5 * kMs);
+        CHECK(pacer.waitForSlot(clock.nowNs() - 2 * kMs));
+    }
+
+}  // namespace
+
+int main() {
+    testPacingBeatsImmediate();
+    testVsyncSlots();
+    testLateDrop();
+    testCancelReservedSlot();
+    testRestart();
+    return testResult("present_scheduler_test");
+}
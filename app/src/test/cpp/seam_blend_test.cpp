@@ -0,0 +1,152 @@
+// seam_blend_test.cpp
+
+#include "test_check.h"
+#include "common/seam_blend.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+    struct Rng {
+        uint32_t s;
+
+        uint8_t next() {
+            s = s * 1664525u + 1013904223u;
+            return (uint8_t) (s >> 24);
+        }
+    };
+
+    // `rows` RGBA rows `width` wide; `smooth` keeps neighbours close, like a camera image.
+    std::vector<uint8_t> image(int width, int rows, uint32_t seed, bool smooth) {
+        Rng rng{seed};
+        std::vector<uint8_t> px((size_t) width * rows * 4);
+        for (size_t i = 0; i < px.size(); i++) {
+            if (!smooth || i < 4) px[i] = rng.next();
+            else px[i] = (uint8_t) (px[i - 4] + (rng.next() & 7) - 3);
+        }
+        return px;
+    }
+
+    std::vector<const uint8_t *> rowPtrs(const std::vector<uint8_t> &px, int width, int rows) {
+        std::vector<const uint8_t *> p(rows);
+        for (int y = 0; y < rows; y++) p[y] = px.data() + (size_t) y * width * 4;
+        return p;
+    }
+
+    // Largest colour difference over n bytes of RGBA (alpha is always 255 out).
+    int maxDiff(const uint8_t *a, const uint8_t *b, size_t n) {
+        int m = 0;
+        for (size_t i = 0; i < n; i++) {
+            if (i % 4 != 3) m = std::max(m, std::abs(a[i] - b[i]));
+        }
+        return m;
+    }
+
+    // Centred on the band rows, below 256, each row's pair summing to 256.
+    void testLut() {
+        for (int rows: {1, 2, 5, 24, 44, 88}) {
+            SeamBlender b(rows);
+            CHECK_EQ(b.rows(), rows);
+            for (int i = 0; i < rows; i++) {
+                CHECK(b.weight(i) > 0 && b.weight(i) < 256);
+                if (i) CHECK(b.weight(i) >= b.weight(i - 1));
+                const int pair = b.weight(i) + b.weight(rows - 1 - i);
+                CHECK(pair >= 255 && pair <= 256);
+            }
+        }
+        SeamBlender none(0);
+        CHECK_EQ(none.rows(), 0);
+    }
+
+    // The vector row kernel against the scalar one, for every width around the vector
+    // size and every weight, with and without the lower alpha.
+    void testRowKernel() {
+        std::printf("seamBlendIsa=%s\n", seamBlendIsa());
+        const int maxW = 70;
+        const std::vector<uint8_t> a = image(maxW, 1, 1, false), b = image(maxW, 1, 2, false);
+        SeamBlender blender(257);   // weights 0..255 across the rows
+        std::vector<uint8_t> got(maxW * 4), want(maxW * 4);
+        int bad = 0;
+        for (int width = 1; width <= maxW; width++) {
+            for (int row = 0; row < blender.rows(); row++) {
+                for (bool alpha: {false, true}) {
+                    blender.blendRow(row, a.data(), b.data(), got.data(), width, alpha);
+                    seamBlendRowScalar(a.data(), b.data(), want.data(), width,
+                                       blender.weight(row), alpha);
+                    if (std::memcmp(got.data(), want.data(), (size_t) width * 4) != 0) bad++;
+                }
+            }
+        }
+        CHECK_EQ(bad, 0);
+    }
+
+    void testScalarEnds() {
+        const int w = 9;
+        const std::vector<uint8_t> a = image(w, 1, 3, false), b = image(w, 1, 4, false);
+        std::vector<uint8_t> out(w * 4);
+        seamBlendRowScalar(a.data(), b.data(), out.data(), w, 0, false);
+        for (int x = 0; x < w; x++) {
+            CHECK(std::memcmp(&out[x * 4], &a[x * 4], 3) == 0);
+            CHECK_EQ(out[x * 4 + 3], 255);
+        }
+        seamBlendRowScalar(a.data(), b.data(), out.data(), w, 256, false);
+        for (int x = 0; x < w; x++) CHECK(std::memcmp(&out[x * 4], &b[x * 4], 3) == 0);
+
+        // A transparent lower pixel leaves the upper one whatever the weight.
+        std::vector<uint8_t> clear = b;
+        for (int x = 0; x < w; x++) clear[x * 4 + 3] = 0;
+        seamBlendRowScalar(a.data(), clear.data(), out.data(), w, 200, true);
+        for (int x = 0; x < w; x++) CHECK(std::memcmp(&out[x * 4], &a[x * 4], 3) == 0);
+    }
+
+    // MultiBand: flat areas blend as Linear, the band edges stay close to Linear, and a
+    // fully transparent lower band gives back the upper one.
+    void testMultiBand() {
+        const int w = 200, rows = 44;
+        SeamBlender blender(rows);
+        std::vector<uint8_t> lin((size_t) w * rows * 4), mb(lin.size());
+        const size_t stride = (size_t) w * 4;
+
+        std::vector<uint8_t> flatA(lin.size()), flatB(lin.size());
+        for (size_t i = 0; i < flatA.size(); i++) {
+            flatA[i] = (uint8_t) (i % 4 == 3 ? 255 : 40 + 20 * (i % 4));
+            flatB[i] = (uint8_t) (i % 4 == 3 ? 255 : 220 - 30 * (i % 4));
+        }
+        auto pa = rowPtrs(flatA, w, rows), pb = rowPtrs(flatB, w, rows);
+        blender.blend(pa.data(), pb.data(), lin.data(), stride, w, SeamMode::Linear, true);
+        blender.blend(pa.data(), pb.data(), mb.data(), stride, w, SeamMode::MultiBand, true);
+        CHECK(maxDiff(lin.data(), mb.data(), lin.size()) <= 1);
+
+        const std::vector<uint8_t> a = image(w, rows, 5, true), b = image(w, rows, 6, true);
+        pa = rowPtrs(a, w, rows);
+        pb = rowPtrs(b, w, rows);
+        blender.blend(pa.data(), pb.data(), lin.data(), stride, w, SeamMode::Linear, false);
+        blender.blend(pa.data(), pb.data(), mb.data(), stride, w, SeamMode::MultiBand, false);
+        const int top = maxDiff(lin.data(), mb.data(), stride);
+        const int bottom = maxDiff(lin.data() + (rows - 1) * stride,
+                                   mb.data() + (rows - 1) * stride, stride);
+        std::printf("multiBand vs linear: top row %d, bottom row %d\n", top, bottom);
+        CHECK(top <= 16);
+        CHECK(bottom <= 16);
+        for (int y = 0; y < rows; y++) CHECK_EQ(mb[y * stride + 3], 255);
+
+        std::vector<uint8_t> clear = b;
+        for (size_t i = 3; i < clear.size(); i += 4) clear[i] = 0;
+        pb = rowPtrs(clear, w, rows);
+        blender.blend(pa.data(), pb.data(), mb.data(), stride, w, SeamMode::MultiBand, true);
+        CHECK_EQ(maxDiff(mb.data(), a.data(), mb.size()), 0);
+    }
+
+}  // namespace
+
+int main() {
+    testLut();
+    testRowKernel();
+    testScalarEnds();
+    testMultiBand();
+    return testResult("seam_blend_test");
+}
@@ -0,0 +1,126 @@
+// stream_negotiator_test.cpp
+
+#include "test_check.h"
+#include "back/stream_negotiator.h"
+
+#include <vector>
+
+using namespace backcam;
+
+namespace {
+
+    // The back view's cover area (BACK_COVER_W x BACK_COVER_H) in a landscape sensor's
+    // orientation, as start() asks for it at 60 fps.
+    constexpr int kCoverW = 800;
+    constexpr int kCoverH = 450;
+
+    constexpr long long kNsAt60 = 16666666;
+    constexpr long long kNsAt45 = 22222222;
+    constexpr long long kNsAt30 = 33333333;
+
+    StreamRequest request(int fps = 60) {
+        StreamRequest r;
+        r.coverW = kCoverW;
+        r.coverH = kCoverH;
+        r.desiredFps = fps;
+        return r;
+    }
+
+    const std::vector<FpsRange> kRanges = {{15, 30}, {30, 30}, {30, 60}, {60, 60}};
+
+    // No stream configurations: what start() asked for before negotiating.
+    void testNoMetadata() {
+        const StreamChoice c = negotiateStream(StreamCaps{}, request());
+        CHECK_EQ(c.w, 1280);
+        CHECK_EQ(c.h, 720);
+        CHECK_EQ(c.fpsRange.min, 30);
+        CHECK_EQ(c.fpsRange.max, 30);
+        CHECK_EQ(c.fps, 30);
+        CHECK(!c.why.empty());
+    }
+
+    // Listed out of order; 640x360 is too small and 960x540 too slow, so 1280x720 is
+    // the smallest covering size at 60, with the range of the highest floor.
+    void testSmallestAtRate() {
+        StreamCaps caps;
+        caps.yuvSizes = {{1920, 1080, kNsAt60}, {960, 540, kNsAt30}, {640, 360, kNsAt60},
+                         {1280, 720, kNsAt60}, {3840, 2160, kNsAt30}};
+        caps.fpsRanges = kRanges;
+        const StreamChoice c = negotiateStream(caps, request());
+        CHECK_EQ(c.w, 1280);
+        CHECK_EQ(c.h, 720);
+        CHECK_EQ(c.fpsRange.min, 60);
+        CHECK_EQ(c.fpsRange.max, 60);
+        CHECK_EQ(c.fps, 60);
+
+        // At 30 fps the smaller 960x540 is enough, and {30, 30} beats {15, 30}.
+        const StreamChoice c30 = negotiateStream(caps, request(30));
+        CHECK_EQ(c30.w, 960);
+        CHECK_EQ(c30.h, 540);
+        CHECK_EQ(c30.fpsRange.min, 30);
+        CHECK_EQ(c30.fpsRange.max, 30);
+        CHECK_EQ(c30.fps, 30);
+    }
+
+    // No covering size reaches 60: the fastest one, the smallest of equals, at the rate
+    // its frame duration allows.
+    void testFastestWhenNoneReaches() {
+        StreamCaps caps;
+        caps.yuvSizes = {{960, 540, kNsAt30}, {1280, 720, kNsAt45}, {1920, 1080, kNsAt45},
+                         {3840, 2160, kNsAt30}};
+        caps.fpsRanges = kRanges;
+        const StreamChoice c = negotiateStream(caps, request());
+        CHECK_EQ(c.w, 1280);
+        CHECK_EQ(c.h, 720);
+        CHECK_EQ(c.fpsRange.min, 30);
+        CHECK_EQ(c.fpsRange.max, 60);
+        CHECK_EQ(c.fps, 45);
+    }
+
+    // Sizes of another aspect ratio are passed over even when smaller and fast enough;
+    // one within 1 % of it (854x480) is not.
+    void testAspect() {
+        StreamCaps caps;
+        caps.yuvSizes = {{1024, 768, kNsAt60}, {800, 600, kNsAt60}, {1280, 720, kNsAt60}};
+        caps.fpsRanges = kRanges;
+        StreamChoice c = negotiateStream(caps, request());
+        CHECK_EQ(c.w, 1280);
+        CHECK_EQ(c.h, 720);
+
+        caps.yuvSizes.push_back({854, 480, kNsAt60});
+        c = negotiateStream(caps, request());
+        CHECK_EQ(c.w, 854);
+        CHECK_EQ(c.h, 480);
+
+        // Nothing covers: the largest of the requested aspect ratio over a larger 4:3.
+        caps.yuvSizes = {{640, 480, kNsAt60}, {640, 360, kNsAt60}, {320, 180, kNsAt60}};
+        c = negotiateStream(caps, request());
+        CHECK_EQ(c.w, 640);
+        CHECK_EQ(c.h, 360);
+        caps.yuvSizes = {{640, 480, kNsAt60}, {320, 240, kNsAt60}};
+        c = negotiateStream(caps, request());
+        CHECK_EQ(c.w, 640);
+        CHECK_EQ(c.h, 480);
+    }
+
+    // No AE ranges listed: {30, 30}, still limited by the size.
+    void testNoRanges() {
+        StreamCaps caps;
+        caps.yuvSizes = {{1280, 720, kNsAt60}};
+        const StreamChoice c = negotiateStream(caps, request());
+        CHECK_EQ(c.w, 1280);
+        CHECK_EQ(c.fpsRange.min, 30);
+        CHECK_EQ(c.fpsRange.max, 30);
+        CHECK_EQ(c.fps, 30);
+    }
+
+}  // namespace
+
+int main() {
+    testNoMetadata();
+    testSmallestAtRate();
+    testFastestWhenNoneReaches();
+    testAspect();
+    testNoRanges();
+    return testResult("stream_negotiator_test");
+}
@@ -0,0 +1,37 @@
+// test_check.h
+
+#pragma once
+
+#include <cstdio>
+
+// Minimal assertions for the host tests: a failed CHECK prints where and why and the
+// test carries on; main() returns testResult().
+static int gTestFailures = 0;
+
+#define CHECK(cond)                                                                    \
+    do {                                                                               \
+        if (!(cond)) {                                                                 \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            gTestFailures++;                                                           \
+        }                                                                              \
+    } while (0)
+
+#define CHECK_EQ(a, b)                                                                 \
+    do {                                                                               \
+        const auto va_ = (a);                                                          \
+        const auto vb_ = (b);                                                          \
+        if (!(va_ == vb_)) {                                                           \
+            std::fprintf(stderr, "%s:%d: CHECK_EQ(%s, %s) failed: %lld vs %lld\n",     \
+                         __FILE__, __LINE__, #a, #b, (long long) va_, (long long) vb_); \
+            gTestFailures++;                                                           \
+        }                                                                              \
+    } while (0)
+
+static inline int testResult(const char *name) {
+    if (gTestFailures) {
+        std::fprintf(stderr, "%s: %d check(s) failed\n", name, gTestFailures);
+        return 1;
+    }
+    std::printf("%s: ok\n", name);
+    return 0;
+}
@@ -0,0 +1,265 @@
+// uvc_ae_test.cpp
+
+#include "test_check.h"
+#include "uvc/uvc_ae.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <vector>
+
+using namespace uvc;
+
+namespace {
+
+    constexpr int kSimW = 160;
+    constexpr int kSimH = 120;
+    constexpr int kGammaSteps = 4096;
+    constexpr int kSimLatency = 2;   // frames before a control write shows up
+
+    // A typical UVC part: exposure_absolute in 100 us units capped for the frame rate,
+    // gain 0..255 of which AE uses 0..64.
+    AeLimits typicalLimits(int fps) {
+        AeLimits lim;
+        lim.hasExp = true;
+        lim.expMin = 1;
+        lim.expMax = std::clamp((int) (1000000.0 / fps * 0.65), 100, 16000) / 100;
+        lim.hasGain = true;
+        lim.gainMin = 0;
+        lim.gainMax = 64;
+        return lim;
+    }
+
+    // The sensor's model of the gain control, as aeStep() assumes it.
+    double gainX(const AeParams &p, const AeLimits &lim, int gain) {
+        if (!lim.hasGain || lim.gainMax <= lim.gainMin) return 1.0;
+        return 1.0 + (double) (gain - lim.gainMin) / (double) (lim.gainMax - lim.gainMin) *
+                     (p.maxGainX - 1.0);
+    }
+
+    struct SimSensor {
+        std::vector<float> reflect;
+        std::vector<uint8_t> yuyv;
+        std::vector<uint8_t> luma;   // signal 0..1 in kGammaSteps -> encoded Y
+        double scene = 1.0;
+
+        SimSensor() : reflect(kSimW * kSimH), yuyv(kSimW * kSimH * 2), luma(kGammaSteps + 1) {
+            for (int i = 0; i <= kGammaSteps; i++) {
+                const double sig = (double) i / kGammaSteps;
+                luma[i] = (uint8_t) std::lround(16.0 + 219.0 * std::pow(sig, 1.0 / 2.2));
+            }
+            for (int y = 0; y < kSimH; y++) {
+                for (int x = 0; x < kSimW; x++) {
+                    const double ramp = 0.1 + 0.8 * (double) x / (kSimW - 1);
+                    const bool check = ((x / 20) + (y / 20)) & 1;
+                    reflect[y * kSimW + x] = (float) (check ? ramp : ramp * 0.5);
+                }
+            }
+        }
+
+        // Limited-range luma of a gamma-encoded, clipping sensor.
+        const uint8_t *frame(double exposure) {
+            const double k = scene * exposure * kGammaSteps;
+            for (int i = 0; i < kSimW * kSimH; i++) {
+                const int sig = (int) std::min<double>(kGammaSteps, reflect[i] * k + 0.5);
+                yuyv[2 * i] = luma[sig];
+                yuyv[2 * i + 1] = 128;
+            }
+            return yuyv.data();
+        }
+    };
+
+    using StepFn = std::function<bool(int frame, const AeMeter &, const AeSettings &,
+                                      AeSettings &)>;
+
+    struct SimResult {
+        int frames = -1;   // frames after the step until luma stays in band; -1 never
+        AeSettings before, after;
+    };
+
+    // Synthetic YUYV frames go through yuv422ToRgba() metering and `ctl`, with two
+    // frames of control latency, and the scene brightness changes by `step` halfway.
+    SimResult runSim(const AeParams &p, const AeLimits &lim, double step, int fps,
+                     const StepFn &ctl) {
+        SimSensor sensor;
+        // Scene level that needs ~half the exposure cap at unity gain.
+        sensor.scene = 1.0 / (0.45 * std::max(lim.expMax, 1) * 0.0011);
+
+        AeSettings cur{lim.hasExp ? lim.expMin + (lim.expMax - lim.expMin) / 4 : 0,
+                       lim.gainMin};
+        std::vector<AeSettings> pipe(kSimLatency, cur);   // settings of frames in flight
+        std::vector<uint8_t> rgba((size_t) kSimW * kSimH * 4);
+        LumaStats st;
+        int settle = 0;
+
+        const int warm = 10 * fps, total = warm + 10 * fps;
+        int lastOut = warm;
+        SimResult r;
+        for (int f = 0; f < total; f++) {
+            if (f == warm) {
+                sensor.scene *= step;
+                r.before = cur;
+            }
+            const AeSettings seen = pipe.front();
+            pipe.erase(pipe.begin());
+            pipe.push_back(cur);
+
+            const double gx = gainX(p, lim, seen.gain);
+            const double e = (lim.hasExp ? seen.exp : 1) * 0.0011 * gx;
+            st.clear();
+            yuv422ToRgba(sensor.frame(e), kSimW * 2, kSimW, kSimH, rgba.data(), kSimW * 4,
+                         Yuv422Layout::YUYV, &st);
+            const AeMeter m = aeMeter(st);
+            if (f >= warm && std::fabs(m.luma - p.targetLuma) > p.tolerance) lastOut = f + 1;
+
+            if (settle > 0) {
+                settle--;
+                continue;
+            }
+            AeSettings next;
+            if (ctl(f, m, cur, next)) {
+                cur = next;
+                settle = kSimLatency;
+            }
+        }
+        r.after = cur;
+        r.frames = lastOut < total ? lastOut - warm : -1;
+        return r;
+    }
+
+    // The controller aeStep() replaced: one exposure or gain step per 100 ms.
+    bool legacyStep(const AeParams &p, const AeLimits &lim, int fps, int frame,
+                    const AeMeter &m, const AeSettings &cur, AeSettings &next) {
+        next = cur;
+        if (frame % std::max(1, fps / 10) != 0) return false;
+        if (std::fabs(m.luma - p.targetLuma) <= p.tolerance) return false;
+        if (m.luma > p.targetLuma) {
+            if (lim.hasGain && cur.gain > lim.gainMin) next.gain -= lim.gainStep;
+            else if (lim.hasExp && cur.exp > lim.expMin) next.exp -= lim.expStep;
+        } else {
+            if (lim.hasExp && cur.exp < lim.expMax) next.exp += lim.expStep;
+            else if (lim.hasGain && cur.gain < lim.gainMax) next.gain += lim.gainStep;
+        }
+        return next != cur;
+    }
+
+    // After a scene change of `step`x the proportional controller is back in band within
+    // a handful of updates, and well before the old one.
+    void testConvergence() {
+        struct Case {
+            double step;
+            int fps;
+            int maxFrames;
+        };
+        const AeParams p;
+        for (const Case &c: {Case{4.0, 30, 12}, Case{0.25, 30, 12}, Case{2.0, 60, 12},
+                             Case{0.5, 15, 12}, Case{8.0, 30, 15}}) {
+            const AeLimits lim = typicalLimits(c.fps);
+            const SimResult prop = runSim(
+                    p, lim, c.step, c.fps,
+                    [&](int, const AeMeter &m, const AeSettings &cur, AeSettings &next) {
+                        return aeStep(p, lim, m, cur, next);
+                    });
+            const SimResult old = runSim(
+                    p, lim, c.step, c.fps,
+                    [&](int f, const AeMeter &m, const AeSettings &cur, AeSettings &next) {
+                        return legacyStep(p, lim, c.fps, f, m, cur, next);
+                    });
+            std::printf("step=%.2fx fps=%d: proportional %d frames (exp %d->%d gain %d->%d), "
+                        "legacy %d frames\n",
+                        c.step, c.fps, prop.frames, prop.before.exp, prop.after.exp,
+                        prop.before.gain, prop.after.gain, old.frames);
+            CHECK(prop.frames >= 0);
+            CHECK(prop.frames <= c.maxFrames);
+            CHECK(old.frames < 0 || prop.frames < old.frames);
+            if (c.step > 1.0) CHECK(prop.after.exp < prop.before.exp);
+            else CHECK(prop.after.exp > prop.before.exp || prop.after.gain > prop.before.gain);
+        }
+    }
+
+    AeMeter meterOf(double luma) {
+        AeMeter m;
+        m.luma = luma;
+        return m;
+    }
+
+    void testStep() {
+        const AeParams p;
+        const AeLimits lim = typicalLimits(30);   // exposure 1..160, gain 0..64
+        const AeSettings cur{100, 0};
+        AeSettings next;
+
+        CHECK(!aeStep(p, lim, meterOf(p.targetLuma + p.tolerance), cur, next));
+        CHECK(next == cur);
+        CHECK(!aeStep(p, lim, meterOf(0.0), cur, next));   // nothing metered
+
+        // Too bright: shorter exposure, gain stays at its floor.
+        CHECK(aeStep(p, lim, meterOf(200.0), cur, next));
+        CHECK(next.exp < cur.exp);
+        CHECK_EQ(next.gain, 0);
+
+        // Too dark: exposure up to its cap first, then gain.
+        CHECK(aeStep(p, lim, meterOf(60.0), cur, next));
+        CHECK(next.exp > cur.exp);
+        CHECK(aeStep(p, lim, meterOf(20.0), AeSettings{lim.expMax, 0}, next));
+        CHECK_EQ(next.exp, lim.expMax);
+        CHECK(next.gain > 0 && next.gain <= lim.gainMax);
+
+        // Blown-out highlights: at least a halving even when the mean is near target.
+        AeMeter clipped = meterOf(p.targetLuma + p.tolerance + 1);
+        clipped.clipped = 0.1;
+        CHECK(aeStep(p, lim, clipped, cur, next));
+        CHECK(next.exp <= (int) std::ceil(cur.exp * std::pow(0.5, p.kp)));
+
+        // Snapped to the control's step and range.
+        AeLimits coarse = lim;
+        coarse.expStep = 10;
+        CHECK(aeStep(p, coarse, meterOf(60.0), AeSettings{51, 0}, next));
+        CHECK_EQ((next.exp - coarse.expMin) % 10, 0);
+        CHECK(next.exp <= coarse.expMax);
+        CHECK(aeStep(p, coarse, meterOf(20.0), AeSettings{151, 0}, next));
+        CHECK_EQ(next.exp, 151);   // 160 is off the grid
+        CHECK(next.gain > 0);
+
+        // Gain only (no exposure control).
+        AeLimits gainOnly;
+        gainOnly.hasGain = true;
+        gainOnly.gainMax = 64;
+        CHECK(aeStep(p, gainOnly, meterOf(60.0), AeSettings{0, 8}, next));
+        CHECK(next.gain > 8);
+        AeLimits none;
+        CHECK(!aeStep(p, none, meterOf(60.0), cur, next));
+    }
+
+    // The centre zones count double; the histogram gives the clipped and crushed shares.
+    void testMeter() {
+        LumaStats st;
+        st.clear();
+        CHECK_EQ(aeMeter(st).luma, 0.0);
+        for (int zy = 0; zy < LumaStats::kZonesY; zy++) {
+            for (int zx = 0; zx < LumaStats::kZonesX; zx++) {
+                const bool inner = zy == 1 || zy == 2 ? zx == 1 || zx == 2 : false;
+                st.zoneSum[zy][zx] = inner ? 200 * 10 : 50 * 10;
+                st.zoneCount[zy][zx] = 10;
+            }
+        }
+        st.hist[255] = 10;
+        st.hist[3] = 30;
+        st.hist[128] = 60;
+        st.samples = 100;
+        const AeMeter m = aeMeter(st);
+        // 4 inner zones at 200 weighted 2, 12 outer at 50 weighted 1.
+        CHECK(std::fabs(m.luma - (4 * 2 * 200.0 + 12 * 50.0) / 20.0) < 1e-9);
+        CHECK(std::fabs(m.clipped - 0.1) < 1e-9);
+        CHECK(std::fabs(m.crushed - 0.3) < 1e-9);
+    }
+
+}  // namespace
+
+int main() {
+    testMeter();
+    testStep();
+    testConvergence();
+    return testResult("uvc_ae_test");
+}
@@ -0,0 +1,129 @@
+// uvc_discovery_test.cpp
+
+#include "test_check.h"
+#include "uvc/uvc_discovery.h"
+
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace uvc;
+namespace fs = std::filesystem;
+
+namespace {
+
+    void writeFile(const fs::path &p, const std::string &content) {
+        fs::create_directories(p.parent_path());
+        std::ofstream(p) << content;
+    }
+
+    // A USB interface directory under devices/, as the device link of a videoN points at.
+    fs::path makeInterface(const fs::path &root, const std::string &name, const char *cls,
+                           const char *subClass) {
+        const fs::path dev = root / "devices/platform/usb1" / name;
+        fs::create_directories(dev);
+        if (cls) writeFile(dev / "bInterfaceClass", std::string(cls) + "\n");
+        if (subClass) writeFile(dev / "bInterfaceSubClass", std::string(subClass) + "\n");
+        return dev;
+    }
+
+    // class/video4linux/video<n> with its name and index files and a device link.
+    void makeNode(const fs::path &root, const std::string &entry, const std::string &name,
+                  const char *index, const fs::path &dev) {
+        const fs::path node = root / "class/video4linux" / entry;
+        writeFile(node / "name", name + "\n");
+        if (index) writeFile(node / "index", std::string(index) + "\n");
+        fs::create_directory_symlink(dev, node / "device");
+    }
+
+    // The sysfs of a phone with a UVC camera plugged in, plus the odd cases:
+    //   video0  uvcvideo (driver link), index 0, video class     -> capture
+    //   video1  same interface, index 1: its metadata node       -> skipped
+    //   video2  uvcvideo from DRIVER= in uevent, no driver link  -> capture
+    //   video3  uvcvideo on a vendor-specific (0xff) interface   -> skipped
+    //   video4  the SoC camera driver, not USB                   -> skipped
+    //   video10 uvcvideo with no interface class (not USB)       -> capture
+    // and entries that are not videoN at all.
+    fs::path makeTree() {
+        char tmpl[] = "/tmp/uvc_discovery_test.XXXXXX";
+        const fs::path root = mkdtemp(tmpl);
+        const fs::path drivers = root / "bus/usb/drivers";
+        fs::create_directories(drivers / "uvcvideo");
+        fs::create_directories(root / "bus/platform/drivers/qcom-camss");
+
+        const fs::path cam = makeInterface(root, "1-1:1.0", "0e", "01");
+        fs::create_directory_symlink(drivers / "uvcvideo", cam / "driver");
+        makeNode(root, "video0", "USB Camera: USB Camera", "0", cam);
+        makeNode(root, "video1", "USB Camera: USB Camera", "1", cam);
+
+        const fs::path noLink = makeInterface(root, "1-2:1.0", "0e", "01");
+        writeFile(noLink / "uevent",
+                  "DEVTYPE=usb_interface\nDRIVER=uvcvideo\nPRODUCT=46d/825/12\n");
+        makeNode(root, "video2", "UVC Camera (046d:0825)", "0", noLink);
+
+        const fs::path vendor = makeInterface(root, "1-3:1.0", "ff", "00");
+        fs::create_directory_symlink(drivers / "uvcvideo", vendor / "driver");
+        makeNode(root, "video3", "Vendor Cam", "0", vendor);
+
+        const fs::path soc = root / "devices/platform/soc/camss";
+        fs::create_directories(soc);
+        fs::create_directory_symlink(root / "bus/platform/drivers/qcom-camss", soc / "driver");
+        makeNode(root, "video4", "msm_vidc", "0", soc);
+
+        const fs::path bare = makeInterface(root, "virtual", nullptr, nullptr);
+        writeFile(bare / "uevent", "DRIVER=uvcvideo\n");
+        makeNode(root, "video10", "Loopback UVC", nullptr, bare);
+
+        fs::create_directories(root / "class/video4linux/video");
+        fs::create_directories(root / "class/video4linux/videoX");
+        fs::create_directories(root / "class/video4linux/v4l-subdev0");
+        return root;
+    }
+
+    void testListNodes(const fs::path &root) {
+        const std::vector<V4l2NodeInfo> nodes = listV4l2Nodes(root.string());
+        CHECK_EQ(nodes.size(), 6u);
+        if (nodes.size() != 6) return;
+
+        const int want[] = {0, 1, 2, 3, 4, 10};   // numeric order, not video10 < video2
+        for (size_t i = 0; i < nodes.size(); i++) CHECK_EQ(nodes[i].video, want[i]);
+
+        CHECK(nodes[0].name == "USB Camera: USB Camera");
+        CHECK(nodes[0].driver == "uvcvideo");
+        CHECK_EQ(nodes[0].index, 0);
+        CHECK_EQ(nodes[0].ifaceClass, 0x0e);
+        CHECK_EQ(nodes[0].ifaceSubClass, 0x01);
+
+        CHECK_EQ(nodes[1].index, 1);
+        CHECK(nodes[2].driver == "uvcvideo");   // from the uevent
+        CHECK_EQ(nodes[3].ifaceClass, 0xff);
+        CHECK(nodes[4].driver == "qcom-camss");
+        CHECK_EQ(nodes[4].ifaceClass, -1);
+        CHECK_EQ(nodes[5].index, 0);             // no index file
+        CHECK_EQ(nodes[5].ifaceClass, -1);
+    }
+
+    void testCaptureNodes(const fs::path &root) {
+        const std::vector<int> nodes = uvcCaptureNodes(root.string());
+        CHECK(nodes == std::vector<int>({0, 2, 10}));
+    }
+
+    // No video4linux class at all (no V4L2 in the kernel, or no sysfs access).
+    void testMissingRoot(const fs::path &root) {
+        CHECK(listV4l2Nodes((root / "nowhere").string()).empty());
+        CHECK(uvcCaptureNodes((root / "nowhere").string()).empty());
+    }
+
+}  // namespace
+
+int main() {
+    const fs::path root = makeTree();
+    testListNodes(root);
+    testCaptureNodes(root);
+    testMissingRoot(root);
+    std::error_code ec;
+    fs::remove_all(root, ec);
+    return testResult("uvc_discovery_test");
+}
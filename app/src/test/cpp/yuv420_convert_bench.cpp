@@ -0,0 +1,81 @@
+// yuv420_convert_bench.cpp
+//
+// yuv420ToRgba() on synthetic YUV_420_888 planes in every chroma layout, tight and with
+// 64 bytes of row padding: the vector path, the scalar loop, and the route layouts
+// cvtColorTwoPlane could not take used to go, a copy into tight planar scratch before
+// converting (timed with the I420 kernel, as OpenCV is not built for the host).
+//
+//   yuv420_convert_bench [width] [height] [passes]
+
+#include "bench_util.h"
+#include "common/yuv_convert.h"
+#include "yuv_test_image.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+    // Any layout into tight I420, sample by sample.
+    void toTightI420(const Yuv420Source &src, int w, int h, std::vector<uint8_t> &out,
+                     Yuv420Source &tight) {
+        const int cw = w / 2, ch = (h + 1) / 2;
+        out.resize((size_t) w * h + (size_t) cw * ch * 2);
+        uint8_t *y = out.data(), *u = y + (size_t) w * h, *v = u + (size_t) cw * ch;
+        for (int r = 0; r < h; r++) std::memcpy(y + (size_t) r * w, src.y + r * src.yStride, w);
+        for (int r = 0; r < ch; r++) {
+            const uint8_t *su = src.u + r * src.uStride, *sv = src.v + r * src.vStride;
+            for (int c = 0; c < cw; c++) {
+                u[(size_t) r * cw + c] = su[c * src.uvPixelStride];
+                v[(size_t) r * cw + c] = sv[c * src.uvPixelStride];
+            }
+        }
+        tight.y = y;
+        tight.u = u;
+        tight.v = v;
+        tight.yStride = (size_t) w;
+        tight.uStride = tight.vStride = (size_t) cw;
+        tight.uvPixelStride = 1;
+    }
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    const int w = std::max(2, benchArg(argc, argv, 1, 1280) & ~1);
+    const int h = std::max(2, benchArg(argc, argv, 2, 720) & ~1);
+    const int passes = benchArg(argc, argv, 3, 200);
+
+    const Planes planes(w, h, 777);
+    const size_t stride = (size_t) w * 4;
+    std::vector<uint8_t> rgba(stride * h), ref(stride * h), scratch;
+    std::printf("%dx%d isa=%s passes=%d\n", w, h, yuvConvertIsa(), passes);
+
+    int mismatches = 0;
+    for (Yuv420Layout layout: {Yuv420Layout::NV21, Yuv420Layout::NV12, Yuv420Layout::I420,
+                               Yuv420Layout::Other}) {
+        for (int pad: {0, 64}) {
+            const Image im = makeImage(planes, layout, pad);
+            const double simdMs = benchMs(passes, [&] {
+                yuv420ToRgba(im.src, w, h, rgba.data(), stride);
+            });
+            const double scalarMs = benchMs(passes, [&] {
+                yuv420ToRgbaScalar(im.src, w, h, ref.data(), stride);
+            });
+            Yuv420Source tight;
+            const double copyMs = benchMs(passes, [&] {
+                toTightI420(im.src, w, h, scratch, tight);
+                yuv420ToRgba(tight, w, h, ref.data(), stride);
+            });
+            const bool same = rgba == ref;
+            if (!same) mismatches++;
+            std::printf("  %-5s pad=%-2d in place %.3f ms (%.0f Mpx/s), scalar %.3f ms, "
+                        "planar copy + convert %.3f ms, match=%d\n",
+                        yuv420LayoutName(layout), pad, simdMs,
+                        simdMs > 0 ? (double) w * h / simdMs / 1e3 : 0.0, scalarMs, copyMs,
+                        same ? 1 : 0);
+        }
+    }
+    return mismatches ? 1 : 0;
+}
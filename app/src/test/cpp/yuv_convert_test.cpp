@@ -0,0 +1,588 @@
+// yuv_convert_test.cpp
+
+#include "test_check.h"
+#include "common/yuv_convert.h"
+#include "yuv_test_image.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+    // An RGBA destination `pad` bytes wider than its rows, the padding checked for
+    // overwrites.
+    struct Rgba {
+        int w, h;
+        size_t stride;
+        std::vector<uint8_t> buf;
+
+        Rgba(int width, int height, int pad)
+                : w(width), h(height), stride((size_t) width * 4 + pad),
+                  buf(stride * height, 0xA5) {}
+
+        uint8_t *data() { return buf.data(); }
+
+        // Rows equal `tight` (w x h x 4) and the padding is untouched.
+        bool equals(const std::vector<uint8_t> &tight) const {
+            for (int r = 0; r < h; r++) {
+                const uint8_t *row = &buf[r * stride];
+                if (std::memcmp(row, &tight[(size_t) r * w * 4], (size_t) w * 4) != 0)
+                    return false;
+                for (size_t i = (size_t) w * 4; i < stride; i++) {
+                    if (row[i] != 0xA5) return false;
+                }
+            }
+            return true;
+        }
+    };
+
+    // Clockwise rotation of a tight w x h RGBA image.
+    std::vector<uint8_t> rotate(const std::vector<uint8_t> &in, int w, int h, int rotation) {
+        std::vector<uint8_t> out(in.size());
+        const int outW = rotation == 90 || rotation == 270 ? h : w;
+        for (int r = 0; r < h; r++) {
+            for (int c = 0; c < w; c++) {
+                int orow = r, ocol = c;
+                if (rotation == 90) {
+                    orow = c;
+                    ocol = h - 1 - r;
+                } else if (rotation == 180) {
+                    orow = h - 1 - r;
+                    ocol = w - 1 - c;
+                } else if (rotation == 270) {
+                    orow = w - 1 - c;
+                    ocol = r;
+                }
+                std::memcpy(&out[((size_t) orow * outW + ocol) * 4], &in[((size_t) r * w + c) * 4],
+                            4);
+            }
+        }
+        return out;
+    }
+
+    const Yuv420Layout kLayouts[] = {Yuv420Layout::NV21, Yuv420Layout::NV12, Yuv420Layout::I420,
+                                     Yuv420Layout::Other};
+    const int kPads[] = {0, 1, 7, 64};
+
+    // Sizes around the vector widths (16 / 32 pixels) and the rotation tile, with an odd
+    // height among them.
+    struct Size {
+        int w, h;
+    };
+    const Size kSizes[] = {{2, 2}, {30, 6}, {66, 35}, {320, 48}};
+
+    void testKnownColours() {
+        uint8_t px[4];
+        refPixel(16, 128, 128, px);
+        CHECK(px[0] == 0 && px[1] == 0 && px[2] == 0 && px[3] == 255);
+        refPixel(235, 128, 128, px);
+        CHECK(px[0] == 255 && px[1] == 255 && px[2] == 255);
+
+        // One pair of 4:2:0 pixels through the converter itself.
+        const uint8_t y[4] = {16, 235, 16, 235}, u[1] = {128}, v[1] = {128};
+        Yuv420Source s;
+        s.y = y;
+        s.u = u;
+        s.v = v;
+        s.yStride = 2;
+        s.uStride = s.vStride = 1;
+        s.uvPixelStride = 1;
+        uint8_t out[16] = {};
+        CHECK(yuv420ToRgba(s, 2, 2, out, 8));
+        CHECK(out[0] == 0 && out[4] == 255 && out[8] == 0 && out[15] == 255);
+    }
+
+    // Every layout and row padding: the layout is recognised, and the vector and scalar
+    // paths both give the reference, leaving the destination padding alone.
+    void testLayoutsAndPadding() {
+        for (const Size &sz: kSizes) {
+            const Planes p(sz.w, sz.h, (uint32_t) (sz.w * 131 + sz.h));
+            const std::vector<uint8_t> ref = p.reference();
+            for (Yuv420Layout layout: kLayouts) {
+                for (int pad: kPads) {
+                    const Image im = makeImage(p, layout, pad);
+                    CHECK(yuv420Layout(im.src) == layout);
+                    CHECK(yuv420Valid(im.src, sz.w, sz.h));
+
+                    Rgba simd(sz.w, sz.h, pad * 4), scalar(sz.w, sz.h, pad * 4);
+                    CHECK(yuv420ToRgba(im.src, sz.w, sz.h, simd.data(), simd.stride));
+                    CHECK(yuv420ToRgbaScalar(im.src, sz.w, sz.h, scalar.data(), scalar.stride));
+                    if (!simd.equals(ref) || !scalar.equals(ref)) {
+                        std::fprintf(stderr, "%dx%d %s pad=%d: simd %s, scalar %s\n", sz.w,
+                                     sz.h, yuv420LayoutName(layout), pad,
+                                     simd.equals(ref) ? "ok" : "WRONG",
+                                     scalar.equals(ref) ? "ok" : "WRONG");
+                        gTestFailures++;
+                    }
+                }
+            }
+        }
+    }
+
+    // Each quarter turn, vector and scalar, equals the reference rotated.
+    void testRotations() {
+        static const int kRotations[] = {0, 90, 180, 270};
+        for (const Size &sz: kSizes) {
+            const Planes p(sz.w, sz.h, (uint32_t) (sz.w * 7 + sz.h * 3));
+            const std::vector<uint8_t> ref = p.reference();
+            for (Yuv420Layout layout: kLayouts) {
+                const Image im = makeImage(p, layout, 7);
+                for (int rot: kRotations) {
+                    const bool turned = rot == 90 || rot == 270;
+                    const int ow = turned ? sz.h : sz.w, oh = turned ? sz.w : sz.h;
+                    const std::vector<uint8_t> want = rotate(ref, sz.w, sz.h, rot);
+                    Rgba simd(ow, oh, 12), scalar(ow, oh, 12);
+                    CHECK(yuv420ToRgbaRotated(im.src, sz.w, sz.h, rot, simd.data(),
+                                              simd.stride));
+                    CHECK(yuv420ToRgbaRotatedScalar(im.src, sz.w, sz.h, rot, scalar.data(),
+                                                    scalar.stride));
+                    if (!simd.equals(want) || !scalar.equals(want)) {
+                        std::fprintf(stderr, "%dx%d %s rot=%d: simd %s, scalar %s\n", sz.w,
+                                     sz.h, yuv420LayoutName(layout), rot,
+                                     simd.equals(want) ? "ok" : "WRONG",
+                                     scalar.equals(want) ? "ok" : "WRONG");
+                        gTestFailures++;
+                    }
+                }
+            }
+        }
+    }
+
+    // Rejected input fails before anything is written.
+    void testRejects() {
+        const Planes p(32, 8, 99);
+        const Image im = makeImage(p, Yuv420Layout::NV21, 0);
+        Rgba out(32, 8, 0);
+        const std::vector<uint8_t> before = out.buf;
+
+        CHECK(!yuv420Valid(im.src, 31, 8));   // odd width
+        CHECK(!yuv420ToRgba(im.src, 31, 8, out.data(), out.stride));
+        CHECK(!yuv420ToRgbaRotated(im.src, 31, 8, 90, out.data(), out.stride));
+
+        Yuv420Source narrow = im.src;
+        narrow.yStride = 16;   // shorter than a row
+        CHECK(!yuv420Valid(narrow, 32, 8));
+        CHECK(!yuv420ToRgba(narrow, 32, 8, out.data(), out.stride));
+
+        Yuv420Source noChroma = im.src;
+        noChroma.u = nullptr;
+        CHECK(!yuv420Valid(noChroma, 32, 8));
+        CHECK(!yuv420ToRgbaScalar(noChroma, 32, 8, out.data(), out.stride));
+
+        CHECK(!yuv420ToRgbaRotated(im.src, 32, 8, 45, out.data(), out.stride));
+        CHECK(out.buf == before);
+    }
+
+    // ---- Packed 4:2:2 ----
+
+    const Yuv422Layout k422Layouts[] = {Yuv422Layout::YUYV, Yuv422Layout::UYVY,
+                                        Yuv422Layout::YVYU};
+
+    const char *name422(Yuv422Layout layout) {
+        return layout == Yuv422Layout::YUYV ? "YUYV" : layout == Yuv422Layout::UYVY ? "UYVY"
+                                                                                    : "YVYU";
+    }
+
+    // Byte offsets of Y0, U, Y1, V within a pixel pair.
+    struct Pair422 {
+        int y0, u, y1, v;
+    };
+
+    Pair422 pairOf(Yuv422Layout layout) {
+        switch (layout) {
+            case Yuv422Layout::UYVY:
+                return {1, 0, 3, 2};
+            case Yuv422Layout::YVYU:
+                return {0, 3, 2, 1};
+            default:
+                return {0, 1, 2, 3};
+        }
+    }
+
+    // One random packed image, rows padded by `pad` bytes.
+    struct Packed422 {
+        int w, h;
+        size_t stride;
+        std::vector<uint8_t> buf;
+
+        Packed422(int width, int height, int pad, uint32_t seed)
+                : w(width), h(height), stride((size_t) width * 2 + pad), buf(stride * height) {
+            Rng rng{seed};
+            for (auto &b: buf) b = rng.next();
+        }
+
+        std::vector<uint8_t> reference(Yuv422Layout layout) const {
+            const Pair422 ix = pairOf(layout);
+            std::vector<uint8_t> out((size_t) w * h * 4);
+            for (int r = 0; r < h; r++) {
+                const uint8_t *row = &buf[r * stride];
+                for (int c = 0; c < w; c += 2) {
+                    const uint8_t *pr = row + c * 2;
+                    uint8_t *o = &out[((size_t) r * w + c) * 4];
+                    refPixel(pr[ix.y0], pr[ix.u], pr[ix.v], o);
+                    refPixel(pr[ix.y1], pr[ix.u], pr[ix.v], o + 4);
+                }
+            }
+            return out;
+        }
+    };
+
+    // Every 4:2:2 byte order and row padding, vector and scalar, against the reference.
+    void test422ToRgba() {
+        for (const Size &sz: kSizes) {
+            for (Yuv422Layout layout: k422Layouts) {
+                for (int pad: kPads) {
+                    const Packed422 in(sz.w, sz.h, pad, (uint32_t) (sz.w * 17 + sz.h + pad));
+                    const std::vector<uint8_t> ref = in.reference(layout);
+                    Rgba simd(sz.w, sz.h, pad * 4), scalar(sz.w, sz.h, pad * 4);
+                    CHECK(yuv422ToRgba(in.buf.data(), in.stride, sz.w, sz.h, simd.data(),
+                                       simd.stride, layout));
+                    CHECK(yuv422ToRgbaScalar(in.buf.data(), in.stride, sz.w, sz.h,
+                                             scalar.data(), scalar.stride, layout));
+                    if (!simd.equals(ref) || !scalar.equals(ref)) {
+                        std::fprintf(stderr, "%dx%d %s pad=%d: simd %s, scalar %s\n", sz.w,
+                                     sz.h, name422(layout), pad,
+                                     simd.equals(ref) ? "ok" : "WRONG",
+                                     scalar.equals(ref) ? "ok" : "WRONG");
+                        gTestFailures++;
+                    }
+                }
+            }
+        }
+
+        // Converting fewer rows than the frame has is the crop: nothing below is written.
+        const Packed422 in(64, 20, 0, 7);
+        Rgba out(64, 20, 0);
+        CHECK(yuv422ToRgba(in.buf.data(), in.stride, 64, 12, out.data(), out.stride,
+                           Yuv422Layout::YUYV));
+        const std::vector<uint8_t> ref = in.reference(Yuv422Layout::YUYV);
+        CHECK(std::memcmp(out.buf.data(), ref.data(), (size_t) 64 * 12 * 4) == 0);
+        bool untouched = true;
+        for (size_t i = out.stride * 12; i < out.buf.size(); i++) untouched &= out.buf[i] == 0xA5;
+        CHECK(untouched);
+
+        CHECK(!yuv422ToRgba(in.buf.data(), in.stride, 63, 12, out.data(), out.stride,
+                            Yuv422Layout::YUYV));   // odd width
+        CHECK(!yuv422ToRgba(in.buf.data(), 100, 64, 12, out.data(), out.stride,
+                            Yuv422Layout::YUYV));   // stride shorter than a row
+    }
+
+    // The metering side channel: Y0 of every pair on every rowStep-th row, binned into
+    // the histogram and 4 x 4 zones, accumulated across calls.
+    void test422Stats() {
+        for (Yuv422Layout layout: k422Layouts) {
+            const Packed422 in(66, 35, 3, 4242);
+            const Pair422 ix = pairOf(layout);
+            LumaStats want;
+            want.clear();
+            const int pairs = in.w / 2;
+            for (int r = 0; r < in.h; r += 4) {
+                const int zy = r * LumaStats::kZonesY / in.h;
+                for (int p = 0; p < pairs; p++) {
+                    int zx = LumaStats::kZonesX - 1;   // zone zx starts at pairs * zx / 4
+                    while (p < pairs * zx / LumaStats::kZonesX) zx--;
+                    const uint8_t y = in.buf[r * in.stride + p * 4 + ix.y0];
+                    want.hist[y]++;
+                    want.zoneSum[zy][zx] += y;
+                    want.zoneCount[zy][zx]++;
+                    want.samples++;
+                }
+            }
+
+            for (int repack = 0; repack < 2; repack++) {
+                LumaStats st;
+                st.rowStep = 4;
+                st.clear();
+                Rgba out(in.w, in.h, 0);
+                std::vector<uint8_t> planes((size_t) in.w * in.h * 2);
+                Yuv420Planes dst;
+                dst.y = planes.data();
+                dst.yStride = (size_t) in.w;
+                dst.u = dst.y + (size_t) in.w * in.h;
+                dst.v = dst.u + (size_t) in.w * in.h / 2;
+                dst.uvStride = (size_t) in.w / 2;
+                for (int pass = 0; pass < 2; pass++) {
+                    if (repack) {
+                        CHECK(yuv422ToYuv420(in.buf.data(), in.stride, in.w, in.h, dst, layout,
+                                             &st));
+                    } else {
+                        CHECK(yuv422ToRgba(in.buf.data(), in.stride, in.w, in.h, out.data(),
+                                           out.stride, layout, &st));
+                    }
+                }
+                CHECK_EQ(st.samples, 2 * want.samples);
+                bool same = true;
+                for (int i = 0; i < 256; i++) same &= st.hist[i] == 2 * want.hist[i];
+                for (int zy = 0; zy < LumaStats::kZonesY; zy++) {
+                    for (int zx = 0; zx < LumaStats::kZonesX; zx++) {
+                        same &= st.zoneSum[zy][zx] == 2 * want.zoneSum[zy][zx];
+                        same &= st.zoneCount[zy][zx] == 2 * want.zoneCount[zy][zx];
+                    }
+                }
+                if (!same) {
+                    std::fprintf(stderr, "%s %s: stats differ\n", name422(layout),
+                                 repack ? "repack" : "rgba");
+                    gTestFailures++;
+                }
+            }
+        }
+    }
+
+    // ---- 4:2:0 repack (YUV passthrough) ----
+
+    // A planar 4:2:0 destination, each plane's rows `pad` bytes wider than the image and
+    // the padding checked for overwrites.
+    struct Planar420 {
+        int w, h;
+        size_t ys, cs;
+        std::vector<uint8_t> y, u, v;
+
+        Planar420(int width, int height, int pad)
+                : w(width), h(height), ys((size_t) width + pad), cs((size_t) width / 2 + pad),
+                  y(ys * height, 0xA5), u(cs * ((height + 1) / 2), 0xA5), v(u) {}
+
+        Yuv420Planes planes() {
+            Yuv420Planes p;
+            p.y = y.data();
+            p.yStride = ys;
+            p.u = u.data();
+            p.v = v.data();
+            p.uvStride = cs;
+            return p;
+        }
+
+        static bool planeEquals(const std::vector<uint8_t> &got, size_t stride, int pw, int ph,
+                                const std::vector<uint8_t> &tight) {
+            for (int r = 0; r < ph; r++) {
+                const uint8_t *row = &got[r * stride];
+                if (std::memcmp(row, &tight[(size_t) r * pw], (size_t) pw) != 0) return false;
+                for (size_t i = (size_t) pw; i < stride; i++) {
+                    if (row[i] != 0xA5) return false;
+                }
+            }
+            return true;
+        }
+
+        bool equals(const Planes &p) const {
+            const int ch = (h + 1) / 2;
+            return planeEquals(y, ys, w, h, p.y) && planeEquals(u, cs, w / 2, ch, p.u) &&
+                   planeEquals(v, cs, w / 2, ch, p.v);
+        }
+    };
+
+    // What the repack should give: luma as is, each chroma sample the rounded mean of
+    // the two rows it covers, an odd last row's chroma taken alone.
+    Planes repackReference(const Packed422 &in, Yuv422Layout layout) {
+        const Pair422 ix = pairOf(layout);
+        Planes out(in.w, in.h, 0);
+        const int cw = in.w / 2;
+        for (int r = 0; r < in.h; r++) {
+            const uint8_t *row = &in.buf[r * in.stride];
+            for (int c = 0; c < cw; c++) {
+                out.y[(size_t) r * in.w + 2 * c] = row[4 * c + ix.y0];
+                out.y[(size_t) r * in.w + 2 * c + 1] = row[4 * c + ix.y1];
+            }
+        }
+        for (int r = 0; r < in.h; r += 2) {
+            const uint8_t *a = &in.buf[r * in.stride];
+            const uint8_t *b = &in.buf[std::min(r + 1, in.h - 1) * in.stride];
+            const size_t o = (size_t) (r / 2) * cw;
+            for (int c = 0; c < cw; c++) {
+                out.u[o + c] = (uint8_t) ((a[4 * c + ix.u] + b[4 * c + ix.u] + 1) / 2);
+                out.v[o + c] = (uint8_t) ((a[4 * c + ix.v] + b[4 * c + ix.v] + 1) / 2);
+            }
+        }
+        return out;
+    }
+
+    // Every 4:2:2 byte order, row padding on both sides and size (an odd height among
+    // them), vector and scalar, against the reference.
+    void test422ToYuv420() {
+        for (const Size &sz: kSizes) {
+            for (Yuv422Layout layout: k422Layouts) {
+                for (int pad: kPads) {
+                    const Packed422 in(sz.w, sz.h, pad, (uint32_t) (sz.w * 5 + sz.h * 11 + pad));
+                    const Planes ref = repackReference(in, layout);
+                    Planar420 simd(sz.w, sz.h, pad), scalar(sz.w, sz.h, pad);
+                    CHECK(yuv422ToYuv420(in.buf.data(), in.stride, sz.w, sz.h, simd.planes(),
+                                         layout));
+                    CHECK(yuv422ToYuv420Scalar(in.buf.data(), in.stride, sz.w, sz.h,
+                                               scalar.planes(), layout));
+                    if (!simd.equals(ref) || !scalar.equals(ref)) {
+                        std::fprintf(stderr, "repack %dx%d %s pad=%d: simd %s, scalar %s\n",
+                                     sz.w, sz.h, name422(layout), pad,
+                                     simd.equals(ref) ? "ok" : "WRONG",
+                                     scalar.equals(ref) ? "ok" : "WRONG");
+                        gTestFailures++;
+                    }
+                }
+            }
+        }
+
+        const Packed422 in(32, 8, 0, 5);
+        Planar420 out(32, 8, 0);
+        Yuv420Planes narrow = out.planes();
+        narrow.uvStride = 8;   // shorter than a chroma row
+        CHECK(!yuv422ToYuv420(in.buf.data(), in.stride, 32, 8, narrow, Yuv422Layout::YUYV));
+        CHECK(!yuv422ToYuv420(in.buf.data(), in.stride, 31, 8, out.planes(),
+                              Yuv422Layout::YUYV));
+        CHECK(!yuv422ToYuv420(in.buf.data(), in.stride, 32, 8, Yuv420Planes(),
+                              Yuv422Layout::YUYV));
+    }
+
+    // NV21 split: lossless, so the planes come back exactly as the image was made.
+    void testNv21ToYuv420() {
+        for (const Size &sz: kSizes) {
+            const int h = sz.h & ~1;   // NV21 frames have an even height
+            const Planes p(sz.w, h, (uint32_t) (sz.w * 3 + h));
+            for (int pad: kPads) {
+                const Image im = makeImage(p, Yuv420Layout::NV21, pad);
+                Planar420 simd(sz.w, h, pad), scalar(sz.w, h, pad);
+                CHECK(nv21ToYuv420(im.src.y, im.src.yStride, im.src.v, im.src.vStride, sz.w, h,
+                                   simd.planes()));
+                CHECK(nv21ToYuv420Scalar(im.src.y, im.src.yStride, im.src.v, im.src.vStride,
+                                         sz.w, h, scalar.planes()));
+                if (!simd.equals(p) || !scalar.equals(p)) {
+                    std::fprintf(stderr, "nv21 %dx%d pad=%d: simd %s, scalar %s\n", sz.w, h,
+                                 pad, simd.equals(p) ? "ok" : "WRONG",
+                                 scalar.equals(p) ? "ok" : "WRONG");
+                    gTestFailures++;
+                }
+            }
+        }
+        const Planes p(32, 8, 1);
+        const Image im = makeImage(p, Yuv420Layout::NV21, 0);
+        Planar420 out(32, 8, 0);
+        CHECK(!nv21ToYuv420(im.src.y, im.src.yStride, im.src.v, im.src.vStride, 32, 7,
+                            out.planes()));   // odd height
+    }
+
+    // ---- YUV passthrough against the RGBA path ----
+
+    // With UVC_WINDOW_YUV the window gets the repacked planes and the compositor converts
+    // them. yuv420ToRgba() of those planes stands in for the compositor here: it uses the
+    // matrix of the RGBA path, so what is compared is what the repack drops, the chroma
+    // of every second row.
+
+    Yuv420Source sourceOf(const Planar420 &p) {
+        Yuv420Source src;
+        src.y = p.y.data();
+        src.u = p.u.data();
+        src.v = p.v.data();
+        src.yStride = p.ys;
+        src.uStride = src.vStride = p.cs;
+        src.uvPixelStride = 1;
+        return src;
+    }
+
+    // Smooth content, as a camera gives away from edges: luma and chroma gradients with
+    // a gentle ripple. With `grey` the chroma is neutral.
+    Packed422 smooth422(int w, int h, Yuv422Layout layout, bool grey) {
+        constexpr double kTwoPi = 6.283185307179586;
+        Packed422 out(w, h, 0, 1);
+        const Pair422 ix = pairOf(layout);
+        for (int r = 0; r < h; r++) {
+            uint8_t *row = &out.buf[r * out.stride];
+            for (int c = 0; c < w; c += 2) {
+                const auto luma = [&](int x) {
+                    return (uint8_t) std::lround(24.0 + 200.0 * (x + r) / (w + h) +
+                                                 8.0 * std::sin(kTwoPi * x / 37.0));
+                };
+                uint8_t *pr = row + c * 2;
+                pr[ix.y0] = luma(c);
+                pr[ix.y1] = luma(c + 1);
+                pr[ix.u] = grey ? 128 : (uint8_t) std::lround(
+                        128.0 + 80.0 * std::sin(kTwoPi * r / 192.0 + c / 64.0));
+                pr[ix.v] = grey ? 128 : (uint8_t) std::lround(
+                        128.0 + 80.0 * std::cos(kTwoPi * (r + c) / 256.0));
+            }
+        }
+        return out;
+    }
+
+    // Largest channel difference and PSNR (dB) of the RGB of two tight RGBA images.
+    struct RgbaDiff {
+        int max = 0;
+        double psnr = 0.0;
+    };
+
+    RgbaDiff diffRgba(const std::vector<uint8_t> &a, const std::vector<uint8_t> &b) {
+        RgbaDiff d;
+        double sq = 0.0;
+        size_t n = 0;
+        for (size_t i = 0; i < a.size(); i++) {
+            if (i % 4 == 3) continue;
+            const int e = std::abs(a[i] - b[i]);
+            d.max = std::max(d.max, e);
+            sq += (double) e * e;
+            n++;
+        }
+        d.psnr = sq == 0.0 ? 99.0 : 10.0 * std::log10(255.0 * 255.0 * (double) n / sq);
+        return d;
+    }
+
+    // UVC: the 4:2:2 frame converted directly against repacked and then converted. Exact
+    // on neutral chroma; on smooth colour (under 3 levels of chroma per row) no channel
+    // more than 6 levels off and PSNR above 40 dB.
+    void testPassthroughMatchesRgba() {
+        for (const Size &sz: kSizes) {
+            for (Yuv422Layout layout: k422Layouts) {
+                for (bool grey: {true, false}) {
+                    const Packed422 in = smooth422(sz.w, sz.h, layout, grey);
+                    const size_t stride = (size_t) sz.w * 4;
+                    std::vector<uint8_t> direct(stride * sz.h), viaYuv(stride * sz.h);
+                    Planar420 planes(sz.w, sz.h, 0);
+                    CHECK(yuv422ToRgba(in.buf.data(), in.stride, sz.w, sz.h, direct.data(),
+                                       stride, layout));
+                    CHECK(yuv422ToYuv420(in.buf.data(), in.stride, sz.w, sz.h, planes.planes(),
+                                         layout));
+                    CHECK(yuv420ToRgba(sourceOf(planes), sz.w, sz.h, viaYuv.data(), stride));
+                    const RgbaDiff d = diffRgba(direct, viaYuv);
+                    const bool ok = grey ? d.max == 0 : d.max <= 6 && d.psnr > 40.0;
+                    if (!ok) {
+                        std::fprintf(stderr, "passthrough %dx%d %s%s: max %d, %.1f dB\n",
+                                     sz.w, sz.h, name422(layout), grey ? " grey" : "", d.max,
+                                     d.psnr);
+                        gTestFailures++;
+                    }
+                }
+            }
+        }
+    }
+
+    // Back camera: the NV21 split loses nothing, so both paths give the same pixels.
+    void testNv21PassthroughMatchesRgba() {
+        for (const Size &sz: kSizes) {
+            const int h = sz.h & ~1;
+            const Planes p(sz.w, h, (uint32_t) (sz.w * 7 + h));
+            const Image im = makeImage(p, Yuv420Layout::NV21, 7);
+            const size_t stride = (size_t) sz.w * 4;
+            std::vector<uint8_t> direct(stride * h), viaYuv(stride * h);
+            Planar420 planes(sz.w, h, 0);
+            CHECK(yuv420ToRgba(im.src, sz.w, h, direct.data(), stride));
+            CHECK(nv21ToYuv420(im.src.y, im.src.yStride, im.src.v, im.src.vStride, sz.w, h,
+                               planes.planes()));
+            CHECK(yuv420ToRgba(sourceOf(planes), sz.w, h, viaYuv.data(), stride));
+            CHECK(direct == viaYuv);
+        }
+    }
+
+}  // namespace
+
+int main() {
+    std::printf("yuvConvertIsa=%s yuvRepackIsa=%s\n", yuvConvertIsa(), yuvRepackIsa());
+    testKnownColours();
+    testLayoutsAndPadding();
+    testRotations();
+    testRejects();
+    test422ToRgba();
+    test422Stats();
+    test422ToYuv420();
+    testNv21ToYuv420();
+    testPassthroughMatchesRgba();
+    testNv21PassthroughMatchesRgba();
+    return testResult("yuv_convert_test");
+}
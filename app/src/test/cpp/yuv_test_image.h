@@ -0,0 +1,111 @@
+// yuv_test_image.h
+
+#pragma once
+
+#include "common/yuv_convert.h"
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Synthetic YUV_420_888 images for the host tests and benchmarks.
+
+struct Rng {
+    uint32_t s;
+
+    uint8_t next() {
+        s = s * 1664525u + 1013904223u;
+        return (uint8_t) (s >> 24);
+    }
+};
+
+// The BT.601 limited-range matrix of cv::cvtColor (COLOR_YUV2RGBA_*), written out
+// here independently of the converters.
+inline void refPixel(int y, int u, int v, uint8_t *o) {
+    const auto sat = [](int x) { return (uint8_t) (x < 0 ? 0 : x > 255 ? 255 : x); };
+    const int yy = (y > 16 ? y - 16 : 0) * 1220542;
+    u -= 128;
+    v -= 128;
+    o[0] = sat((yy + (1 << 19) + 1673527 * v) >> 20);
+    o[1] = sat((yy + (1 << 19) - 852492 * v - 409993 * u) >> 20);
+    o[2] = sat((yy + (1 << 19) + 2116026 * u) >> 20);
+    o[3] = 255;
+}
+
+// Tight planes of one random image.
+struct Planes {
+    int w = 0, h = 0;
+    std::vector<uint8_t> y, u, v;   // w x h, then (w / 2) x ((h + 1) / 2) each
+
+    Planes(int width, int height, uint32_t seed) : w(width), h(height) {
+        Rng rng{seed};
+        y.resize((size_t) w * h);
+        u.resize((size_t) (w / 2) * ((h + 1) / 2));
+        v.resize(u.size());
+        for (auto &b: y) b = rng.next();
+        for (auto &b: u) b = rng.next();
+        for (auto &b: v) b = rng.next();
+    }
+
+    // Unrotated RGBA, w x h, tight.
+    std::vector<uint8_t> reference() const {
+        std::vector<uint8_t> out((size_t) w * h * 4);
+        for (int r = 0; r < h; r++) {
+            for (int c = 0; c < w; c++) {
+                const size_t ci = (size_t) (r / 2) * (w / 2) + c / 2;
+                refPixel(y[(size_t) r * w + c], u[ci], v[ci], &out[((size_t) r * w + c) * 4]);
+            }
+        }
+        return out;
+    }
+};
+
+// The planes laid out as a camera HAL might hand them over: each row padded by `pad`
+// bytes, the interleaved chroma plane ending at its last sample.
+struct Image {
+    std::vector<uint8_t> y, c0, c1;
+    Yuv420Source src;
+};
+
+inline Image makeImage(const Planes &p, Yuv420Layout layout, int pad) {
+    const int w = p.w, h = p.h, cw = w / 2, ch = (h + 1) / 2;
+    Image im;
+    const size_t ys = (size_t) w + pad;
+    im.y.assign(ys * h, 0xEE);
+    for (int r = 0; r < h; r++) std::memcpy(&im.y[r * ys], &p.y[(size_t) r * w], (size_t) w);
+    im.src.y = im.y.data();
+    im.src.yStride = ys;
+
+    if (layout == Yuv420Layout::NV12 || layout == Yuv420Layout::NV21) {
+        const size_t cs = (size_t) w + pad;
+        im.c0.assign(cs * (ch - 1) + (size_t) cw * 2, 0xEE);
+        const bool vu = layout == Yuv420Layout::NV21;
+        for (int r = 0; r < ch; r++) {
+            for (int c = 0; c < cw; c++) {
+                im.c0[r * cs + 2 * c + (vu ? 1 : 0)] = p.u[(size_t) r * cw + c];
+                im.c0[r * cs + 2 * c + (vu ? 0 : 1)] = p.v[(size_t) r * cw + c];
+            }
+        }
+        im.src.u = im.c0.data() + (vu ? 1 : 0);
+        im.src.v = im.c0.data() + (vu ? 0 : 1);
+        im.src.uStride = im.src.vStride = cs;
+        im.src.uvPixelStride = 2;
+        return im;
+    }
+    // I420, or Other: separate planes with every third byte used.
+    const int ps = layout == Yuv420Layout::I420 ? 1 : 3;
+    const size_t cs = (size_t) (cw - 1) * ps + 1 + pad;
+    im.c0.assign(cs * ch, 0xEE);
+    im.c1.assign(cs * ch, 0xEE);
+    for (int r = 0; r < ch; r++) {
+        for (int c = 0; c < cw; c++) {
+            im.c0[r * cs + c * ps] = p.u[(size_t) r * cw + c];
+            im.c1[r * cs + c * ps] = p.v[(size_t) r * cw + c];
+        }
+    }
+    im.src.u = im.c0.data();
+    im.src.v = im.c1.data();
+    im.src.uStride = im.src.vStride = cs;
+    im.src.uvPixelStride = ps;
+    return im;
+}
@@ -0,0 +1,94 @@
+// yuyv_convert_bench.cpp
+//
+// Memory traffic of the UVC YUYV path: the fused yuv422ToRgba() (crop and alpha in
+// the conversion) against the sequence it replaced, a whole-frame cvtColor followed by
+// separate alpha passes over the crop around the seam ramp. cvtColor is bit-exact with
+// yuv422ToRgba() and OpenCV is not built for the host, so the old sequence converts
+// with the same kernel and what differs is the extra passes. The seam blur runs the
+// same in both and needs OpenCV, so it is left out of both.
+//
+//   yuyv_convert_bench [width] [height] [passes] [crop %]
+
+#include "bench_util.h"
+#include "common/yuv_convert.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+    constexpr int kSeamPx = 12;   // UVC_SEAM_PX
+
+    // The alpha ramp of applyTopSeamFeather: row 0 transparent, the last seam row opaque.
+    void seamRamp(uint8_t *rgba, size_t stride, int w, int seamPx, bool keepLower) {
+        for (int y = 0; y < seamPx; y++) {
+            const uint8_t a = seamPx == 1 ? 255 : (uint8_t) std::lround(
+                    255.0 * (double) y / (double) (seamPx - 1));
+            uint8_t *row = rgba + (size_t) y * stride;
+            for (int x = 0; x < w; x++)
+                row[x * 4 + 3] = keepLower ? std::min(row[x * 4 + 3], a) : a;
+        }
+    }
+
+    void setAlpha(uint8_t *rgba, size_t stride, int w, int row0, int rows) {
+        for (int y = row0; y < row0 + rows; y++) {
+            uint8_t *row = rgba + (size_t) y * stride;
+            for (int x = 0; x < w; x++) row[x * 4 + 3] = 255;
+        }
+    }
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    const int w = std::max(2, benchArg(argc, argv, 1, 1280) & ~1);
+    const int h = benchArg(argc, argv, 2, 720);
+    const int passes = benchArg(argc, argv, 3, 200);
+    const int rows = std::clamp(h * std::min(benchArg(argc, argv, 4, 100), 100) / 100, 1, h);
+    const int seamPx = std::min(kSeamPx, rows);
+
+    std::vector<uint8_t> yuyv((size_t) w * 2 * h);
+    benchFill(yuyv, 12345);
+    const size_t stride = (size_t) w * 4;
+    std::vector<uint8_t> full(stride * h), fused(stride * rows);
+
+    // The old order: convert everything, crop as a view, alpha over the crop twice
+    // (caller and seam pass), the ramp, then alpha again below the seam.
+    const double legacyMs = benchMs(passes, [&] {
+        yuv422ToRgba(yuyv.data(), (size_t) w * 2, w, h, full.data(), stride,
+                     Yuv422Layout::YUYV);
+        setAlpha(full.data(), stride, w, 0, rows);
+        setAlpha(full.data(), stride, w, 0, rows);
+        seamRamp(full.data(), stride, w, seamPx, true);
+        setAlpha(full.data(), stride, w, seamPx, rows - seamPx);
+    });
+    const double fusedMs = benchMs(passes, [&] {
+        yuv422ToRgba(yuyv.data(), (size_t) w * 2, w, rows, fused.data(), stride,
+                     Yuv422Layout::YUYV);
+        seamRamp(fused.data(), stride, w, seamPx, false);
+    });
+    const double rampMs =
+            benchMs(passes, [&] { seamRamp(fused.data(), stride, w, seamPx, false); });
+
+    const bool exact = std::memcmp(full.data(), fused.data(), stride * rows) == 0;
+
+    // Bytes moved: YUYV read and RGBA written, plus a read and a write of every RGBA row
+    // an alpha pass touches.
+    const double rgbaRow = (double) stride;
+    const double legacyBytes = (double) w * 2 * h + rgbaRow * h +
+                               2 * rgbaRow * (2 * rows + seamPx + (rows - seamPx));
+    const double fusedBytes = (double) w * 2 * rows + rgbaRow * rows + 2 * rgbaRow * seamPx;
+
+    std::printf("%dx%d rows=%d seam=%d isa=%s passes=%d\n", w, h, rows, seamPx,
+                yuvConvertIsa(), passes);
+    std::printf("  legacy (convert + alpha passes): %.3f ms, %.1f MB/frame\n", legacyMs,
+                legacyBytes / 1e6);
+    std::printf("  fused yuv422ToRgba + seam ramp:  %.3f ms, %.1f MB/frame (%.2fx)\n", fusedMs,
+                fusedBytes / 1e6, fusedMs > 0 ? legacyMs / fusedMs : 0.0);
+    std::printf("  of which the seam ramp:          %.3f ms (%.1f%%)\n", rampMs,
+                fusedMs > 0 ? 100.0 * rampMs / fusedMs : 0.0);
+    std::printf("  bitExact=%d\n", exact ? 1 : 0);
+    return exact ? 0 : 1;
+}